@@ -283,6 +283,9 @@ init_agent_read_config(const char *app)
     netsnmp_ds_register_config(ASN_INTEGER, app, "avgBulkVarbindSize",
                                NETSNMP_DS_APPLICATION_ID,
                                NETSNMP_DS_AGENT_AVG_BULKVARBINDSIZE);
+    netsnmp_ds_register_config(ASN_INTEGER, app, "agentWorkerThreads",
+                               NETSNMP_DS_APPLICATION_ID,
+                               NETSNMP_DS_AGENT_WORKER_THREADS);
 #ifndef NETSNMP_NO_PDU_STATS
     netsnmp_ds_register_config(ASN_INTEGER, app, "pduStatsMax",
                                NETSNMP_DS_APPLICATION_ID,
@@ -77,209 +77,258 @@ netsnmp_feature_child_of(agent_registry_all, libnetsnmpagent);
 
 netsnmp_feature_child_of(unregister_mib_table_row, agent_registry_all);
 
-/** @defgroup agent_lookup_cache Lookup cache, storing the registered OIDs.
- *     Maintain the cache used for locating sub-trees and OIDs.
+
+/** @defgroup agent_subtree_index Subtree index, locating the registered OIDs.
+ *     Each context keeps a radix tree of the start OIDs of its top-level
+ *     subtrees (the ones linked through next and prev), with one node per
+ *     sub-identifier and the children of a node sorted by sub-identifier.
+ *     Finding the subtree that covers an OID therefore costs O(OID length)
+ *     rather than a walk along the list of registrations.
  *   @ingroup agent_registry
  *
  * @{
  */
 
-/**  Lookup cache - default size.*/
-#define SUBTREE_DEFAULT_CACHE_SIZE 8
-/**  Lookup cache - max acceptable size.*/
-#define SUBTREE_MAX_CACHE_SIZE     32
-int lookup_cache_size = 0; /*enabled later after registrations are loaded */
-
-typedef struct lookup_cache_s {
-   netsnmp_subtree *next;
-   netsnmp_subtree *previous;
-} lookup_cache;
-
-typedef struct lookup_cache_context_s {
-   char *context;
-   struct lookup_cache_context_s *next;
-   int thecachecount;
-   int currentpos;
-   lookup_cache cache[SUBTREE_MAX_CACHE_SIZE];
-} lookup_cache_context;
-
-static lookup_cache_context *thecontextcache = NULL;
-
-/** Set the lookup cache size for optimized agent registration performance.
- * Note that it is only used by master agent - sub-agent doesn't need the cache.
- * The rough guide is that the cache size should be equal to the maximum
- * number of simultaneous managers you expect to talk to the agent (M) times 80%
- * (or so, he says randomly) the average number (N) of varbinds you
- * expect to receive in a given request for a manager.  ie, M times N.
- * Bigger does NOT necessarily mean better.  Certainly 16 should be an
- * upper limit.  32 is the hard coded limit.
- *
- * @param newsize set to the maximum size of a cache for a given
- * context.  Set to 0 to completely disable caching, or to -1 to set
- * to the default cache size (8), or to a number of your chosing.  The
+struct netsnmp_subtree_index_s {
+    oid             subid;
+    netsnmp_subtree *subtree;   /* top-level subtree starting at this OID */
+    struct netsnmp_subtree_index_s **children;  /* sorted by subid */
+    int             children_len;
+    int             children_max;
+};
+typedef struct netsnmp_subtree_index_s netsnmp_subtree_index;
+
+/** Set the lookup cache size.
+ * @deprecated The lookup cache has been superseded by the subtree index,
+ * which doesn't need tuning.  This function does nothing.
+ *
+ * @param newsize ignored.
  */
 void
 netsnmp_set_lookup_cache_size(int newsize) {
-    if (newsize < 0)
-        lookup_cache_size = SUBTREE_DEFAULT_CACHE_SIZE;
-    else if (newsize < SUBTREE_MAX_CACHE_SIZE)
-        lookup_cache_size = newsize;
-    else
-        lookup_cache_size = SUBTREE_MAX_CACHE_SIZE;
 }
 
 /** Retrieves the current value of the lookup cache size
- *  Should be called from master agent only - sub-agent doesn't need the cache.
+ * @deprecated The lookup cache has been superseded by the subtree index.
  *
- *  @return the current lookup cache size
+ *  @return 0
  */
 int
 netsnmp_get_lookup_cache_size(void) {
-    return lookup_cache_size;
+    return 0;
 }
 
-/** Returns lookup cache entry for the context of given name.
- *
- *  @param context Name of the context. Name is case sensitive.
- *
- *  @return the lookup cache context
+/** @private
+ *  Frees an index node and everything below it.
  */
-NETSNMP_STATIC_INLINE lookup_cache_context *
-get_context_lookup_cache(const char *context) {
-    lookup_cache_context *ptr;
-    if (!context)
-        context = "";
-
-    for(ptr = thecontextcache; ptr; ptr = ptr->next) {
-        if (strcmp(ptr->context, context) == 0)
-            break;
-    }
-    if (!ptr) {
-        if (netsnmp_subtree_find_first(context)) {
-            ptr = SNMP_MALLOC_TYPEDEF(lookup_cache_context);
-            ptr->next = thecontextcache;
-            ptr->context = strdup(context);
-            thecontextcache = ptr;
-        } else {
-            return NULL;
-        }
-    }
-    return ptr;
+static void
+subtree_index_free(netsnmp_subtree_index *node)
+{
+    int i;
+
+    if (node == NULL)
+        return;
+    for (i = 0; i < node->children_len; i++)
+        subtree_index_free(node->children[i]);
+    free(node->children);
+    free(node);
 }
 
-/** Adds an entry to the Lookup Cache under specified context name.
- *
- *  @param context  Name of the context. Name is case sensitive.
- *
- *  @param next     Next subtree item.
- *
- *  @param previous Previous subtree item.
+/** @private
+ *  Returns the position of the first child of node whose sub-identifier
+ *  is not less than subid.
  */
-NETSNMP_STATIC_INLINE void
-lookup_cache_add(const char *context,
-                 netsnmp_subtree *next, netsnmp_subtree *previous) {
-    lookup_cache_context *cptr;
-
-    if ((cptr = get_context_lookup_cache(context)) == NULL)
-        return;
+NETSNMP_STATIC_INLINE int
+subtree_index_pos(const netsnmp_subtree_index *node, oid subid)
+{
+    int lo = 0, hi = node->children_len, mid;
 
-    if (cptr->thecachecount < lookup_cache_size)
-        cptr->thecachecount++;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (node->children[mid]->subid < subid)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
 
-    cptr->cache[cptr->currentpos].next = next;
-    cptr->cache[cptr->currentpos].previous = previous;
+/** @private
+ *  Returns the index node for the given OID, or NULL if there is none.
+ */
+static netsnmp_subtree_index *
+subtree_index_lookup(netsnmp_subtree_index *node, const oid *name, size_t len)
+{
+    size_t i;
+    int pos;
 
-    if (++cptr->currentpos >= lookup_cache_size)
-        cptr->currentpos = 0;
+    for (i = 0; node && i < len; i++) {
+        pos = subtree_index_pos(node, name[i]);
+        if (pos >= node->children_len || node->children[pos]->subid != name[i])
+            return NULL;
+        node = node->children[pos];
+    }
+    return node;
 }
 
 /** @private
- *  Replaces next and previous pointer in given Lookup Cache.
- *
- *  @param ptr      Lookup Cache pointer.
+ *  Adds (or replaces) the entry for the start OID of the given subtree.
  *
- *  @param next     Next subtree item.
- *
- *  @param previous Previous subtree item.
+ *  @return 0 on success, -1 if out of memory.
  */
-NETSNMP_STATIC_INLINE void
-lookup_cache_replace(lookup_cache *ptr,
-                     netsnmp_subtree *next, netsnmp_subtree *previous) {
+static int
+subtree_index_add(netsnmp_subtree_index *node, netsnmp_subtree *s)
+{
+    netsnmp_subtree_index *child, **children;
+    size_t i;
+    int pos, max;
+
+    for (i = 0; i < s->start_len; i++) {
+        pos = subtree_index_pos(node, s->start_a[i]);
+        if (pos < node->children_len &&
+            node->children[pos]->subid == s->start_a[i]) {
+            node = node->children[pos];
+            continue;
+        }
+        if (node->children_len == node->children_max) {
+            max = node->children_max ? 2 * node->children_max : 4;
+            children = (netsnmp_subtree_index **)
+                realloc(node->children, max * sizeof(*children));
+            if (children == NULL)
+                return -1;
+            node->children = children;
+            node->children_max = max;
+        }
+        child = SNMP_MALLOC_TYPEDEF(netsnmp_subtree_index);
+        if (child == NULL)
+            return -1;
+        child->subid = s->start_a[i];
+        memmove(&node->children[pos + 1], &node->children[pos],
+                (node->children_len - pos) * sizeof(*node->children));
+        node->children[pos] = child;
+        node->children_len++;
+        node = child;
+    }
+    node->subtree = s;
+    return 0;
+}
+
+/** @private
+ *  Removes the entry for the given subtree, pruning nodes that no longer
+ *  lead to any entry.
+ */
+static void
+subtree_index_remove(netsnmp_subtree_index *root, netsnmp_subtree *s)
+{
+    netsnmp_subtree_index *path[MAX_OID_LEN + 1], *node = root;
+    int pos[MAX_OID_LEN + 1];
+    size_t i;
 
-    ptr->next = next;
-    ptr->previous = previous;
+    if (s->start_len > MAX_OID_LEN)
+        return;
+    for (i = 0; i < s->start_len; i++) {
+        path[i] = node;
+        pos[i] = subtree_index_pos(node, s->start_a[i]);
+        if (pos[i] >= node->children_len ||
+            node->children[pos[i]]->subid != s->start_a[i])
+            return;
+        node = node->children[pos[i]];
+    }
+    if (node->subtree != s)
+        return;
+    node->subtree = NULL;
+
+    while (i-- > 0 && node->subtree == NULL && node->children_len == 0) {
+        subtree_index_free(node);
+        node = path[i];
+        node->children_len--;
+        memmove(&node->children[pos[i]], &node->children[pos[i] + 1],
+                (node->children_len - pos[i]) * sizeof(*node->children));
+    }
 }
 
-/** Finds an entry in the Lookup Cache.
- *
- *  @param context  Case sensitive name of the context.
- *
- *  @param name     The OID we're searching for.
- *
- *  @param name_len Number of sub-ids (single integers) in the OID.
- *
- *  @param retcmp   Value set to snmp_oid_compare() call result.
- *                  The value, if set, is always nonnegative.
- *
- *  @return gives Lookup Cache entry, or NULL if not found.
- *
- *  @see snmp_oid_compare()
+/** @private
+ *  Returns the entry with the largest OID below (and including) node.
  */
-NETSNMP_STATIC_INLINE lookup_cache *
-lookup_cache_find(const char *context, const oid *name, size_t name_len,
-                  int *retcmp) {
-    lookup_cache_context *cptr;
-    lookup_cache *ret = NULL;
-    int cmp;
+static netsnmp_subtree *
+subtree_index_last(const netsnmp_subtree_index *node)
+{
+    netsnmp_subtree *s;
     int i;
 
-    if ((cptr = get_context_lookup_cache(context)) == NULL)
-        return NULL;
+    for (i = node->children_len - 1; i >= 0; i--)
+        if ((s = subtree_index_last(node->children[i])) != NULL)
+            return s;
+    return node->subtree;
+}
 
-    for(i = 0; i < cptr->thecachecount && i < lookup_cache_size; i++) {
-        if (cptr->cache[i].previous->start_a)
-            cmp = snmp_oid_compare(name, name_len,
-                                   cptr->cache[i].previous->start_a,
-                                   cptr->cache[i].previous->start_len);
-        else
-            cmp = 1;
-        if (cmp >= 0) {
-            *retcmp = cmp;
-            ret = &(cptr->cache[i]);
-        }
+/** @private
+ *  Returns the subtree with the largest start OID not greater than name,
+ *  i.e. the one a walk along the list would stop at.
+ */
+static netsnmp_subtree *
+subtree_index_find_prev(const netsnmp_subtree_index *node,
+                        const oid *name, size_t len)
+{
+    netsnmp_subtree *best = NULL, *s;
+    size_t i;
+    int pos, j;
+
+    for (i = 0; ; i++) {
+        /* this node's OID is a prefix of name, so it sorts before it */
+        if (node->subtree)
+            best = node->subtree;
+        if (i == len)
+            break;
+        /* anything below a smaller sibling beats that */
+        pos = subtree_index_pos(node, name[i]);
+        for (j = pos - 1; j >= 0; j--)
+            if ((s = subtree_index_last(node->children[j])) != NULL) {
+                best = s;
+                break;
+            }
+        if (pos >= node->children_len || node->children[pos]->subid != name[i])
+            break;
+        node = node->children[pos];
     }
-    return ret;
+    return best;
 }
 
 /** @private
- *  Clears cache count and position in Lookup Cache.
+ *  (Re)builds the index of a context from its list of subtrees.
  */
-NETSNMP_STATIC_INLINE void
-invalidate_lookup_cache(const char *context) {
-    lookup_cache_context *cptr;
-    if ((cptr = get_context_lookup_cache(context)) != NULL) {
-        cptr->thecachecount = 0;
-        cptr->currentpos = 0;
+static void
+subtree_index_build(subtree_context_cache *ptr)
+{
+    netsnmp_subtree *s;
+
+    subtree_index_free(ptr->index);
+    ptr->index = SNMP_MALLOC_TYPEDEF(netsnmp_subtree_index);
+    for (s = ptr->first_subtree; s && ptr->index; s = s->next) {
+        if (s->start_a && subtree_index_add(ptr->index, s) < 0) {
+            subtree_index_free(ptr->index);
+            ptr->index = NULL;
+        }
     }
+    DEBUGMSGTL(("subtree", "%s index for context \"%s\"\n",
+                ptr->index ? "built" : "couldn't build", ptr->context_name));
 }
 
-void
-clear_lookup_cache(void) {
-
-    lookup_cache_context *ptr = NULL, *next = NULL;
-
-    ptr = thecontextcache;
-    while (ptr) {
-	next = ptr->next;
-	SNMP_FREE(ptr->context);
-	SNMP_FREE(ptr);
-	ptr = next;
+/** @private
+ *  Records s as the top-level subtree at its start OID.  If that fails,
+ *  the index is dropped and rebuilt on the next lookup.
+ */
+static void
+subtree_index_insert(subtree_context_cache *ptr, netsnmp_subtree *s)
+{
+    if (ptr && ptr->index && subtree_index_add(ptr->index, s) < 0) {
+        subtree_index_free(ptr->index);
+        ptr->index = NULL;
     }
-    thecontextcache = NULL; /* !!! */
 }
 
 /**  @} */
-/* End of Lookup cache code */
+/* End of Subtree index code */
 
 /** @defgroup agent_context_cache Context cache, storing the OIDs under their contexts.
  *     Maintain the cache used for locating sub-trees registered under different contexts.
@@ -301,6 +350,39 @@ get_top_context_cache(void)
     return context_subtrees;
 }
 
+/** @private
+ *  Returns the context whose index has s as a top-level subtree.
+ */
+static subtree_context_cache *
+subtree_index_context(netsnmp_subtree *s)
+{
+    subtree_context_cache *ptr;
+    netsnmp_subtree_index *node;
+
+    for (ptr = context_subtrees; ptr; ptr = ptr->next) {
+        node = subtree_index_lookup(ptr->index, s->start_a, s->start_len);
+        if (node && node->subtree == s)
+            return ptr;
+    }
+    return NULL;
+}
+
+/** @private
+ *  Returns the context cache entry of the given context, or NULL.
+ */
+static subtree_context_cache *
+subtree_context_find(const char *context_name)
+{
+    subtree_context_cache *ptr;
+
+    if (!context_name)
+        context_name = "";
+    for (ptr = context_subtrees; ptr; ptr = ptr->next)
+        if (ptr->context_name && strcmp(ptr->context_name, context_name) == 0)
+            return ptr;
+    return NULL;
+}
+
 /** Finds the first subtree registered under given context.
  *
  *  @param context_name Text name of the context we're searching for.
@@ -367,6 +449,9 @@ netsnmp_remove_subtree(netsnmp_subtree *tree)
 {
     subtree_context_cache *ptr;
 
+    if ((ptr = subtree_index_context(tree)) != NULL)
+        subtree_index_remove(ptr->index, tree);
+
     if (!tree->prev) {
         for (ptr = context_subtrees; ptr; ptr = ptr->next)
             if (ptr->first_subtree == tree)
@@ -414,7 +499,7 @@ netsnmp_subtree_replace_first(netsnmp_subtree *new_tree,
 
 void clear_subtree (netsnmp_subtree *sub);
 
-/** Completely clears both the Context cache and the Lookup cache.
+/** Completely clears the Context cache, including the subtree indexes.
  */
 void
 clear_context(void) {
@@ -433,13 +518,13 @@ clear_context(void) {
 	    clear_subtree(t);
 	}
 
+        subtree_index_free(ptr->index);
         free(NETSNMP_REMOVE_CONST(char*, ptr->context_name));
         SNMP_FREE(ptr);
 
 	ptr = next;
     }
     context_subtrees = NULL; /* !!! */
-    clear_lookup_cache();
 }
 
 /**  @} */
@@ -588,6 +673,7 @@ void
 netsnmp_subtree_join(netsnmp_subtree *root)
 {
     netsnmp_subtree *s, *tmp, *c, *d;
+    subtree_context_cache *ptr;
 
     while (root != NULL) {
         s = root->next;
@@ -615,6 +701,8 @@ netsnmp_subtree_join(netsnmp_subtree *root)
             DEBUGMSG(("subtree", " so new end "));
             DEBUGMSGOID(("subtree", root->end_a, root->end_len));
             DEBUGMSG(("subtree", "\n"));
+            if ((ptr = subtree_index_context(s)) != NULL)
+                subtree_index_remove(ptr->index, s);
             /*
              * Probably need to free children too?  
              */
@@ -743,6 +831,9 @@ netsnmp_subtree_split(netsnmp_subtree *current, oid name[], int name_len)
         netsnmp_subtree_change_prev(ptr, new_sub);
     }
 
+    /* If current is a top-level subtree, the new one is as well */
+    subtree_index_insert(subtree_index_context(current), new_sub);
+
     return new_sub;
 }
 
@@ -826,6 +917,7 @@ netsnmp_subtree_load(netsnmp_subtree *new_sub, const char *context_name)
 	    }
 
             netsnmp_subtree_change_next(new_sub, tree2);
+            subtree_index_insert(subtree_context_find(context_name), new_sub);
 
 #if 0
             /* The code below cannot be reached which is why it has been
@@ -922,6 +1014,9 @@ netsnmp_subtree_load(netsnmp_subtree *new_sub, const char *context_name)
 		new_sub->children = next;
                 netsnmp_subtree_change_prev(new_sub, next->prev);
                 netsnmp_subtree_change_next(new_sub, next->next);
+                /*  new_sub takes over from next as the top-level subtree */
+                subtree_index_insert(subtree_context_find(context_name),
+                                     new_sub);
 	
 		for (next = new_sub->next; next != NULL;next = next->children){
                     netsnmp_subtree_change_prev(next, new_sub);
@@ -977,26 +1072,29 @@ netsnmp_subtree *
 netsnmp_subtree_find_prev(const oid *name, size_t len, netsnmp_subtree *subtree,
 			  const char *context_name)
 {
-    lookup_cache *lookup_cache = NULL;
+    subtree_context_cache *ctx;
     netsnmp_subtree *myptr = NULL, *previous = NULL;
-    int cmp = 1;
     size_t ll_off = 0;
 
+    /*
+     * Searches through everything go through the index of the context;
+     * only searches from some other starting point walk the list.
+     */
+    ctx = subtree_context_find(context_name);
+    if (ctx && ctx->first_subtree &&
+        (subtree == NULL || subtree == ctx->first_subtree)) {
+        if (ctx->index == NULL)
+            subtree_index_build(ctx);
+        if (ctx->index) {
+            return subtree_index_find_prev(ctx->index, name, len);
+        }
+    }
+
     if (subtree) {
         myptr = subtree;
     } else {
 	/* look through everything */
-        if (lookup_cache_size) {
-            lookup_cache = lookup_cache_find(context_name, name, len, &cmp);
-            if (lookup_cache) {
-                myptr = lookup_cache->next;
-                previous = lookup_cache->previous;
-            }
-            if (!myptr)
-                myptr = netsnmp_subtree_find_first(context_name);
-        } else {
-            myptr = netsnmp_subtree_find_first(context_name);
-        }
+        myptr = netsnmp_subtree_find_first(context_name);
     }
 
     /*
@@ -1031,13 +1129,6 @@ netsnmp_subtree_find_prev(const oid *name, size_t len, netsnmp_subtree *subtree,
 #else
         if (snmp_oid_compare(name, len, myptr->start_a, myptr->start_len) < 0) {
 #endif
-            if (lookup_cache_size && previous && cmp) {
-                if (lookup_cache) {
-                    lookup_cache_replace(lookup_cache, myptr, previous);
-                } else {
-                    lookup_cache_add(context_name, myptr, previous);
-                }
-            }
             return previous;
         }
     }
@@ -1138,7 +1229,6 @@ netsnmp_register_mib(const char *moduleName,
     netsnmp_subtree *subtree, *sub2;
     int             res;
     struct register_parameters reg_parms;
-    int old_lookup_cache_val = netsnmp_get_lookup_cache_size();
 
     if (moduleName == NULL ||
         mibloc     == NULL) {
@@ -1210,7 +1300,6 @@ netsnmp_register_mib(const char *moduleName,
     subtree->flags |= SUBTREE_ATTACHED;
     subtree->global_cacheid = reginfo->global_cacheid;
 
-    netsnmp_set_lookup_cache_size(0);
     res = netsnmp_subtree_load(subtree, context);
 
     /*  If registering a range, use the first subtree as a template for the
@@ -1224,8 +1313,6 @@ netsnmp_register_mib(const char *moduleName,
 	    if (sub2 == NULL) {
                 unregister_mib_context(mibloc, mibloclen, priority,
                                        range_subid, range_ubound, context);
-                netsnmp_set_lookup_cache_size(old_lookup_cache_val);
-                invalidate_lookup_cache(context);
                 return MIB_REGISTRATION_FAILED;
             }
 
@@ -1246,15 +1333,11 @@ netsnmp_register_mib(const char *moduleName,
                                        range_subid, range_ubound, context);
                 netsnmp_remove_subtree(sub2);
 		netsnmp_subtree_free(sub2);
-                netsnmp_set_lookup_cache_size(old_lookup_cache_val);
-                invalidate_lookup_cache(context);
                 return res;
             }
         }
     } else if (res == MIB_DUPLICATE_REGISTRATION ||
                res == MIB_REGISTRATION_FAILED) {
-        netsnmp_set_lookup_cache_size(old_lookup_cache_val);
-        invalidate_lookup_cache(context);
         netsnmp_subtree_free(subtree);
         return res;
     }
@@ -1285,8 +1368,6 @@ netsnmp_register_mib(const char *moduleName,
                             SNMPD_CALLBACK_REGISTER_OID, &reg_parms);
     }
 
-    netsnmp_set_lookup_cache_size(old_lookup_cache_val);
-    invalidate_lookup_cache(context);
     return res;
 }
 
@@ -1601,6 +1682,7 @@ void
 netsnmp_subtree_unload(netsnmp_subtree *sub, netsnmp_subtree *prev, const char *context)
 {
     netsnmp_subtree *ptr;
+    subtree_context_cache *ctx;
 
     DEBUGMSGTL(("register_mib", "unload("));
     if (sub != NULL) {
@@ -1619,7 +1701,6 @@ netsnmp_subtree_unload(netsnmp_subtree *sub, netsnmp_subtree *prev, const char *
 
     if (prev != NULL) {         /* non-leading entries are easy */
         prev->children = sub->children;
-        invalidate_lookup_cache(context);
         return;
     }
     /*
@@ -1637,6 +1718,8 @@ netsnmp_subtree_unload(netsnmp_subtree *sub, netsnmp_subtree *prev, const char *
 	if (sub->prev == NULL) {
 	    netsnmp_subtree_replace_first(sub->next, context);
 	}
+        if ((ctx = subtree_index_context(sub)) != NULL)
+            subtree_index_remove(ctx->index, sub);
 
     } else {
         for (ptr = sub->prev; ptr; ptr = ptr->children)
@@ -1647,8 +1730,8 @@ netsnmp_subtree_unload(netsnmp_subtree *sub, netsnmp_subtree *prev, const char *
 	if (sub->prev == NULL) {
 	    netsnmp_subtree_replace_first(sub->children, context);
 	}
+        subtree_index_insert(subtree_index_context(sub), sub->children);
     }
-    invalidate_lookup_cache(context);
 }
 
 /**
@@ -1691,11 +1774,9 @@ unregister_mib_context(oid * name, size_t len, int priority,
     netsnmp_subtree *list, *myptr = NULL;
     netsnmp_subtree *prev, *child, *next; /* loop through children */
     struct register_parameters reg_parms;
-    int old_lookup_cache_val = netsnmp_get_lookup_cache_size();
     int unregistering = 1;
     int orig_subid_val = -1;
 
-    netsnmp_set_lookup_cache_size(0);
 
     if ((range_subid > 0) &&  ((size_t)range_subid <= len))
         orig_subid_val = name[range_subid-1];
@@ -1777,8 +1858,6 @@ unregister_mib_context(oid * name, size_t len, int priority,
                         SNMPD_CALLBACK_UNREGISTER_OID, &reg_parms);
 
     netsnmp_subtree_free(myptr);
-    netsnmp_set_lookup_cache_size(old_lookup_cache_val);
-    invalidate_lookup_cache(context);
     return MIB_UNREGISTERED_OK;
 }
 
@@ -0,0 +1,521 @@
+/*
+ * agent_workers.c: worker thread pool for read-only request processing.
+ *
+ * By default every handler runs on the main agent thread, so a single slow
+ * handler stalls all other managers.  When "agentWorkerThreads" is set to a
+ * positive value, GET, GETNEXT and GETBULK requests for registrations that
+ * declare HANDLER_CAN_THREAD_SAFE are handed to a pool of worker threads,
+ * using the same delegation mechanism as AgentX: the original requests are
+ * marked as delegated while a worker processes private copies of them, and
+ * the results are copied back on the main thread once the worker is done.
+ * All other handlers (and all SET processing) stay on the main thread.
+ *
+ * A registration may only be marked HANDLER_CAN_THREAD_SAFE if its handler
+ * can run concurrently with the main thread and with itself, and must not
+ * be unregistered while requests for it are outstanding.  The helpers in
+ * front of that handler are not covered by the flag: requests are only
+ * handed to workers if all of them are marked MIB_HANDLER_REENTRANT.
+ * Messages logged by workers are serialized by snmp_log_string().
+ */
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-features.h>
+
+#include <sys/types.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#include <errno.h>
+#include <signal.h>
+
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/agent/bulk_to_next.h>
+#include <net-snmp/agent/agent_callbacks.h>
+
+#include "agent_workers.h"
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE) && !defined(WIN32)
+#include <pthread.h>
+#define NETSNMP_AGENT_WORKERS 1
+#endif
+
+#ifdef NETSNMP_AGENT_WORKERS
+
+#define AGENT_WORKERS_MAX   64
+
+typedef struct agent_work_s {
+    netsnmp_agent_session        *asp;
+    netsnmp_handler_registration *reginfo;
+    netsnmp_agent_request_info    reqinfo;   /* private to the worker */
+    int                           mode;      /* mode of the asp */
+    netsnmp_request_info         *orig;      /* requests in the asp */
+    netsnmp_request_info         *requests;  /* copies used by the worker */
+    int                           count;
+    int                           status;
+    int                           orphaned;  /* asp released while queued */
+    struct agent_work_s          *next;      /* pending/done queue */
+    struct agent_work_s          *next_inflight;
+} agent_work;
+
+static pthread_mutex_t work_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  idle_cond = PTHREAD_COND_INITIALIZER;
+static agent_work *work_pending, *work_pending_tail; /* protected by lock */
+static agent_work *work_done;                         /* protected by lock */
+static int         workers_running;                   /* protected by lock */
+static int         workers_busy;                      /* protected by lock */
+
+/* main thread only */
+static agent_work *work_inflight;
+static pthread_t   worker_thread[AGENT_WORKERS_MAX];
+static int         worker_count;
+static int         work_pipe[2] = { -1, -1 };
+
+static void _agent_work_free(agent_work *work);
+static void _agent_workers_done(int fd, void *data);
+static int  _agent_workers_shutdown_cb(int majorID, int minorID,
+                                       void *serverarg, void *clientarg);
+static int  _agent_workers_reconfig_cb(int majorID, int minorID,
+                                       void *serverarg, void *clientarg);
+
+static void *
+_agent_worker_main(void *arg)
+{
+    agent_work *work;
+    char        c = 0;
+
+    pthread_mutex_lock(&work_lock);
+    while (workers_running) {
+        if (NULL == work_pending) {
+            pthread_cond_wait(&work_cond, &work_lock);
+            continue;
+        }
+        work = work_pending;
+        work_pending = work->next;
+        if (NULL == work_pending)
+            work_pending_tail = NULL;
+        workers_busy++;
+        pthread_mutex_unlock(&work_lock);
+
+        work->status = netsnmp_call_handlers(work->reginfo, &work->reqinfo,
+                                             work->requests);
+
+        pthread_mutex_lock(&work_lock);
+        work->next = work_done;
+        work_done = work;
+        if (--workers_busy == 0 && NULL == work_pending)
+            pthread_cond_broadcast(&idle_cond);
+        pthread_mutex_unlock(&work_lock);
+        while (write(work_pipe[1], &c, 1) < 0 && errno == EINTR)
+            ;
+        pthread_mutex_lock(&work_lock);
+    }
+    pthread_mutex_unlock(&work_lock);
+    return NULL;
+}
+
+static int
+_agent_workers_start(int count)
+{
+    sigset_t    all, old;
+    int         i;
+
+    if (count > AGENT_WORKERS_MAX)
+        count = AGENT_WORKERS_MAX;
+
+    if (pipe(work_pipe) < 0) {
+        snmp_log_perror("agent workers: pipe");
+        return -1;
+    }
+#ifdef FD_CLOEXEC
+    fcntl(work_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(work_pipe[1], F_SETFD, FD_CLOEXEC);
+#endif
+    /*
+     * the main loop drains the pipe until it is empty, and a worker must
+     * never block on a full pipe: one pending wakeup is enough
+     */
+    fcntl(work_pipe[0], F_SETFL, fcntl(work_pipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(work_pipe[1], F_SETFL, fcntl(work_pipe[1], F_GETFL) | O_NONBLOCK);
+    if (register_readfd(work_pipe[0], _agent_workers_done, NULL) !=
+        FD_REGISTERED_OK) {
+        close(work_pipe[0]);
+        close(work_pipe[1]);
+        work_pipe[0] = work_pipe[1] = -1;
+        return -1;
+    }
+
+    workers_running = 1;
+
+    /*
+     * signals must keep being delivered to the main thread
+     */
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    for (i = 0; i < count; i++) {
+        if (pthread_create(&worker_thread[i], NULL, _agent_worker_main,
+                           NULL) != 0) {
+            snmp_log(LOG_ERR, "agent workers: could only start %d of %d"
+                     " threads\n", i, count);
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    worker_count = i;
+
+    if (0 == worker_count) {
+        netsnmp_agent_workers_shutdown();
+        return -1;
+    }
+
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY, SNMP_CALLBACK_SHUTDOWN,
+                           _agent_workers_shutdown_cb, NULL);
+    snmp_register_callback(SNMP_CALLBACK_APPLICATION,
+                           SNMPD_CALLBACK_PRE_UPDATE_CONFIG,
+                           _agent_workers_reconfig_cb, NULL);
+    DEBUGMSGTL(("agent_workers", "started %d worker threads\n",
+                worker_count));
+    return 0;
+}
+
+/*
+ * Hands the requests of one tree cache entry to the worker pool.  Returns
+ * 1 if the requests have been delegated to a worker, 0 if the caller must
+ * process them itself.
+ */
+int
+netsnmp_agent_workers_dispatch(netsnmp_agent_session *asp,
+                               netsnmp_handler_registration *reginfo,
+                               netsnmp_request_info *requests)
+{
+    static int      start_failed;
+    netsnmp_request_info *request, *copy;
+    netsnmp_mib_handler *handler;
+    agent_work     *work;
+    int             count, threads, i;
+
+    if (!(reginfo->modes & HANDLER_CAN_THREAD_SAFE))
+        return 0;
+    /*
+     * the registration only vouches for its own handler, at the end of
+     * the chain; helpers injected in front of it must be reentrant too
+     */
+    for (handler = reginfo->handler; handler && handler->next;
+         handler = handler->next)
+        if (!(handler->flags & MIB_HANDLER_REENTRANT))
+            return 0;
+
+    switch (asp->mode) {
+    case MODE_GET:
+    case MODE_GETNEXT:
+        break;
+    case MODE_GETBULK:
+        /*
+         * native getbulk handlers walk the varbind chain of the request,
+         * which the private copies don't have.
+         */
+        if (reginfo->modes & HANDLER_CAN_GETBULK)
+            return 0;
+        break;
+    default:
+        return 0;
+    }
+
+    if (0 == worker_count) {
+        threads = netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                                     NETSNMP_DS_AGENT_WORKER_THREADS);
+        if (threads <= 0 || start_failed)
+            return 0;
+        if (_agent_workers_start(threads) < 0) {
+            start_failed = 1;
+            return 0;
+        }
+    }
+
+    for (count = 0, request = requests; request; request = request->next)
+        count++;
+
+    work = SNMP_MALLOC_TYPEDEF(agent_work);
+    if (NULL == work)
+        return 0;
+    work->requests = calloc(count, sizeof(netsnmp_request_info));
+    if (NULL == work->requests) {
+        free(work);
+        return 0;
+    }
+    work->asp = asp;
+    work->reginfo = reginfo;
+    work->mode = asp->mode;
+    work->orig = requests;
+    work->count = count;
+    work->reqinfo.asp = asp;
+    work->reqinfo.agent_data = NULL;
+    /*
+     * the bulk_to_next helper is finished on the main thread, see
+     * _agent_work_complete()
+     */
+    work->reqinfo.mode = (asp->mode == MODE_GETBULK) ? MODE_GETNEXT :
+        asp->mode;
+
+    for (i = 0, request = requests; request; request = request->next, i++) {
+        copy = &work->requests[i];
+        copy->requestvb = SNMP_MALLOC_TYPEDEF(netsnmp_variable_list);
+        if (NULL == copy->requestvb ||
+            snmp_clone_var(request->requestvb, copy->requestvb)) {
+            work->count = i + 1;
+            _agent_work_free(work);
+            return 0;
+        }
+        copy->requestvb_start = copy->requestvb;
+        copy->agent_req_info = &work->reqinfo;
+        if (request->range_end) {
+            copy->range_end = netsnmp_memdup(request->range_end,
+                                             request->range_end_len *
+                                             sizeof(oid));
+            copy->range_end_len = request->range_end_len;
+        }
+        copy->inclusive = request->inclusive;
+        copy->index = request->index;
+        copy->repeat = request->repeat;
+        copy->orig_repeat = request->orig_repeat;
+        copy->subtree = request->subtree;
+        copy->prev = i ? &work->requests[i - 1] : NULL;
+        copy->next = (i + 1 < count) ? &work->requests[i + 1] : NULL;
+    }
+
+    for (request = requests; request; request = request->next)
+        request->delegated = REQUEST_IS_DELEGATED;
+
+    work->next_inflight = work_inflight;
+    work_inflight = work;
+
+    DEBUGMSGTL(("agent_workers", "queueing %d request(s) for %s\n", count,
+                reginfo->handlerName));
+    pthread_mutex_lock(&work_lock);
+    if (work_pending_tail)
+        work_pending_tail->next = work;
+    else
+        work_pending = work;
+    work_pending_tail = work;
+    pthread_cond_signal(&work_cond);
+    pthread_mutex_unlock(&work_lock);
+
+    return 1;
+}
+
+static void
+_agent_work_free(agent_work *work)
+{
+    int             i;
+
+    for (i = 0; i < work->count; i++) {
+        /*
+         * a getnext handler may have moved the copy on to another varbind
+         */
+        snmp_free_var(work->requests[i].requestvb);
+        SNMP_FREE(work->requests[i].range_end);
+        netsnmp_free_request_data_sets(&work->requests[i]);
+    }
+    netsnmp_free_agent_data_sets(&work->reqinfo);
+    free(work->requests);
+    free(work);
+}
+
+static void
+_agent_work_complete(agent_work *work)
+{
+    netsnmp_request_info *request, *copy;
+    netsnmp_variable_list *vb;
+    int             i;
+
+    for (i = 0, request = work->orig; request && i < work->count;
+         request = request->next, i++) {
+        copy = &work->requests[i];
+        vb = copy->requestvb;
+        snmp_set_var_objid(request->requestvb, vb->name, vb->name_length);
+        snmp_set_var_typed_value(request->requestvb, vb->type,
+                                 vb->val.string, vb->val_len);
+        request->inclusive = copy->inclusive;
+        request->repeat = copy->repeat;
+        request->processed = copy->processed;
+        request->status = copy->status;
+        if (SNMP_ERR_NOERROR != work->status && 0 == request->status)
+            request->status = work->status;
+        request->delegated = REQUEST_IS_NOT_DELEGATED;
+    }
+
+    if (MODE_GETBULK == work->mode)
+        netsnmp_bulk_to_next_fix_requests(work->orig);
+}
+
+/*
+ * Called from the main event loop when workers have finished requests.
+ */
+static void
+_agent_workers_done(int fd, void *data)
+{
+    agent_work     *done, *work, **prevp;
+    netsnmp_agent_session *asp;
+    char            buf[64];
+    ssize_t         n;
+    int             pending;
+
+    do {
+        n = read(fd, buf, sizeof(buf));
+    } while (n > 0 || (n < 0 && errno == EINTR));
+
+    pthread_mutex_lock(&work_lock);
+    done = work_done;
+    work_done = NULL;
+    pthread_mutex_unlock(&work_lock);
+
+    while (done) {
+        work = done;
+        done = work->next;
+
+        for (prevp = &work_inflight; *prevp; prevp = &(*prevp)->next_inflight)
+            if (*prevp == work) {
+                *prevp = work->next_inflight;
+                break;
+            }
+
+        asp = work->asp;
+        if (!work->orphaned) {
+            /*
+             * the registration may be gone by now, see
+             * _agent_workers_reconfig_cb()
+             */
+            DEBUGMSGTL(("agent_workers", "completed %d request(s)\n",
+                        work->count));
+            _agent_work_complete(work);
+            _agent_work_free(work);
+            continue;
+        }
+
+        /*
+         * the session was released while we were working on it; free it
+         * once the last outstanding piece of work is back.
+         */
+        _agent_work_free(work);
+        for (pending = 0, work = work_inflight; work;
+             work = work->next_inflight)
+            if (work->asp == asp)
+                pending++;
+        if (!pending)
+            free_agent_snmp_session(asp);
+    }
+
+    netsnmp_check_outstanding_agent_requests();
+}
+
+/*
+ * Called by free_agent_snmp_session().  Returns 1 if workers still
+ * reference the session, in which case freeing is deferred until they
+ * are done.
+ */
+int
+netsnmp_agent_workers_release(netsnmp_agent_session *asp)
+{
+    agent_work     *work;
+    int             pending = 0;
+
+    for (work = work_inflight; work; work = work->next_inflight) {
+        if (work->asp == asp) {
+            work->orphaned = 1;
+            pending++;
+        }
+    }
+    if (pending)
+        DEBUGMSGTL(("agent_workers", "deferring release of asp %p\n", asp));
+    return pending ? 1 : 0;
+}
+
+void
+netsnmp_agent_workers_shutdown(void)
+{
+    agent_work     *work;
+    int             i;
+
+    if (work_pipe[0] < 0)
+        return;
+
+    pthread_mutex_lock(&work_lock);
+    workers_running = 0;
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&work_lock);
+    for (i = 0; i < worker_count; i++)
+        pthread_join(worker_thread[i], NULL);
+    worker_count = 0;
+
+    /*
+     * the sessions are being torn down as well, so just drop the work
+     */
+    while (work_inflight) {
+        work = work_inflight;
+        work_inflight = work->next_inflight;
+        _agent_work_free(work);
+    }
+    work_pending = work_pending_tail = work_done = NULL;
+
+    unregister_readfd(work_pipe[0]);
+    close(work_pipe[0]);
+    close(work_pipe[1]);
+    work_pipe[0] = work_pipe[1] = -1;
+}
+
+static int
+_agent_workers_shutdown_cb(int majorID, int minorID, void *serverarg,
+                           void *clientarg)
+{
+    netsnmp_agent_workers_shutdown();
+    return 0;
+}
+
+/*
+ * Reloading the configuration unregisters handlers, so let the workers
+ * finish the requests they have been handed first.
+ */
+static int
+_agent_workers_reconfig_cb(int majorID, int minorID, void *serverarg,
+                           void *clientarg)
+{
+    pthread_mutex_lock(&work_lock);
+    while (workers_running && (workers_busy || work_pending))
+        pthread_cond_wait(&idle_cond, &work_lock);
+    pthread_mutex_unlock(&work_lock);
+    return 0;
+}
+
+#else /* !NETSNMP_AGENT_WORKERS */
+
+int
+netsnmp_agent_workers_dispatch(netsnmp_agent_session *asp,
+                               netsnmp_handler_registration *reginfo,
+                               netsnmp_request_info *requests)
+{
+    return 0;
+}
+
+int
+netsnmp_agent_workers_release(netsnmp_agent_session *asp)
+{
+    return 0;
+}
+
+void
+netsnmp_agent_workers_shutdown(void)
+{
+}
+
+#endif /* !NETSNMP_AGENT_WORKERS */
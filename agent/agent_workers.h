@@ -0,0 +1,24 @@
+#ifndef AGENT_WORKERS_H
+#define AGENT_WORKERS_H
+
+/*
+ * Request worker pool: runs handlers of registrations marked
+ * HANDLER_CAN_THREAD_SAFE on worker threads for read-only requests.
+ * Internal to the agent library.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int  netsnmp_agent_workers_dispatch(netsnmp_agent_session *asp,
+                                    netsnmp_handler_registration *reginfo,
+                                    netsnmp_request_info *requests);
+int  netsnmp_agent_workers_release(netsnmp_agent_session *asp);
+void netsnmp_agent_workers_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AGENT_WORKERS_H */
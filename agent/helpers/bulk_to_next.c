@@ -35,17 +35,17 @@ netsnmp_get_bulk_to_next_handler(void)
                                netsnmp_bulk_to_next_helper);
 
     if (NULL != handler)
-        handler->flags |= MIB_HANDLER_AUTO_NEXT;
+        handler->flags |= MIB_HANDLER_AUTO_NEXT | MIB_HANDLER_REENTRANT;
 
     return handler;
 }
 
-/** takes answered requests and decrements the repeat count and
- *  updates the requests to the next to-do varbind in the list */
-void
-netsnmp_bulk_to_next_fix_requests(netsnmp_request_info *requests)
+/** takes an answered request and, if it has repeats left, decrements
+ *  the repeat count and moves it on to its next to-do varbind.
+ *  @return 1 if the request was advanced, 0 if it is finished */
+int
+netsnmp_bulk_to_next_fix_request(netsnmp_request_info *request)
 {
-    netsnmp_request_info *request;
     /*
      * Make sure that:
      *    - repeats remain
@@ -55,29 +55,40 @@ netsnmp_bulk_to_next_fix_requests(netsnmp_request_info *requests)
      * then
      * update the varbinds for the next request series 
      */
-    for (request = requests; request; request = request->next) {
-        if (request->repeat > 0 &&
-            request->requestvb->type != ASN_NULL &&
-            request->requestvb->type != ASN_PRIV_RETRY &&
-            (snmp_oid_compare(request->requestvb->name,
-                              request->requestvb->name_length,
-                              request->range_end,
-                              request->range_end_len) < 0) &&
-            request->requestvb->next_variable ) {
-            request->repeat--;
-            snmp_set_var_objid(request->requestvb->next_variable,
-                               request->requestvb->name,
-                               request->requestvb->name_length);
-            request->requestvb = request->requestvb->next_variable;
-            request->requestvb->type = ASN_PRIV_RETRY;
-            /*
-             * if inclusive == 2, it was set in check_getnext_results for
-             * the previous requestvb. Now that we've moved on, clear it.
-             */
-            if (2 == request->inclusive)
-                request->inclusive = 0;
-        }
+    if (request->repeat > 0 &&
+        request->requestvb->type != ASN_NULL &&
+        request->requestvb->type != ASN_PRIV_RETRY &&
+        (snmp_oid_compare(request->requestvb->name,
+                          request->requestvb->name_length,
+                          request->range_end,
+                          request->range_end_len) < 0) &&
+        request->requestvb->next_variable ) {
+        request->repeat--;
+        snmp_set_var_objid(request->requestvb->next_variable,
+                           request->requestvb->name,
+                           request->requestvb->name_length);
+        request->requestvb = request->requestvb->next_variable;
+        request->requestvb->type = ASN_PRIV_RETRY;
+        /*
+         * the next search starts after the answer we just got, whether
+         * the previous one was inclusive (an AgentX search range, or
+         * inclusive == 2 set in check_getnext_results) or not.
+         */
+        request->inclusive = 0;
+        return 1;
     }
+    return 0;
+}
+
+/** takes answered requests and decrements the repeat count and
+ *  updates the requests to the next to-do varbind in the list */
+void
+netsnmp_bulk_to_next_fix_requests(netsnmp_request_info *requests)
+{
+    netsnmp_request_info *request;
+
+    for (request = requests; request; request = request->next)
+        netsnmp_bulk_to_next_fix_request(request);
 }
 
 /** @internal Implements the bulk_to_next handler */
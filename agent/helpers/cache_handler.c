@@ -98,6 +98,17 @@ void            release_cached_resources(unsigned int regNo,
  *  not be used if cache is not synchronized automatically as it would
  *  result in stale cache information when if polling happens too fast.
  *
+ *  If NETSNMP_CACHE_BACKGROUND_RELOAD is set, requests never wait for the
+ *  cache to be loaded again, once it has been loaded. A request that finds
+ *  the cache in the last quarter of its timeout, or expired, is answered
+ *  from the cache as it is, and the load routine is called from an alarm
+ *  as soon as the request has been dealt with. The new contents replace
+ *  the old ones in a single step, so a request sees either of them but
+ *  never a mix. An expired cache is only released once it has not been
+ *  used for a further timeout period. This flag is ignored for caches with
+ *  NETSNMP_CACHE_HINT_HANDLER_ARGS set, or without a positive timeout,
+ *  and SET requests still load an expired cache before going on.
+ *
  *
  *  Here are some suggestions for some common situations.
  *
@@ -129,6 +140,17 @@ void            release_cached_resources(unsigned int regNo,
  *          NETSNMP_CACHE_DONT_AUTO_RELEASE
  *          NETSNMP_CACHE_AUTO_RELOAD
  *
+ *  Expensive to load, polled regularly:
+ *      If loading the cache takes long enough to delay the requests which
+ *      happen to find it expired (e.g. parsing a large kernel table), and
+ *      the data can be slightly out of date, have it loaded outside of the
+ *      requests. Set the following flag:
+ *
+ *          NETSNMP_CACHE_BACKGROUND_RELOAD
+ *
+ *      To keep the cache fresh even without requests, add
+ *      NETSNMP_CACHE_AUTO_RELOAD as well.
+ *
  *  Dynamically updated, unloaded after timeout:
  *      If the cache is kept up to date dynamically by listening for
  *      change notifications somehow, but it should not be in memory
@@ -136,6 +158,15 @@ void            release_cached_resources(unsigned int regNo,
  *
  *          NETSNMP_CACHE_RESET_TIMER_ON_USE
  *
+ *  Incrementally reloaded table:
+ *      If the cache holds the rows of a table container, and most rows are
+ *      unchanged from one load to the next, the load routine can bring the
+ *      existing rows up to date with netsnmp_container_table_sync() instead
+ *      of building them all again. The free routine is then only called
+ *      when an unused cache expires. Set the following flag:
+ *
+ *          NETSNMP_CACHE_DONT_FREE_BEFORE_LOAD
+ *
  *  @{
  */
 
@@ -261,6 +292,9 @@ netsnmp_cache_free(netsnmp_cache *cache)
     if(0 != cache->timer_id)
         netsnmp_cache_timer_stop(cache);
 
+    if(0 != cache->reload_id)
+        snmp_alarm_unregister(cache->reload_id);
+
     if (cache->valid)
         _cache_free(cache);
 
@@ -314,6 +348,7 @@ _timer_reload(unsigned int regNo, void *clientargs)
     DEBUGMSGT(("cache_timer:start", "loading cache %p\n", cache));
 
     cache->expired = 1;
+    cache->cache_hint = NULL;
 
     _cache_load(cache);
 }
@@ -565,14 +600,51 @@ netsnmp_cache_check_expired(netsnmp_cache *cache)
     return cache->expired;
 }
 
-/** Reload the cache if required */
-int
-netsnmp_cache_check_and_reload(netsnmp_cache * cache)
+/** can the cache be loaded outside of the requests? */
+static int
+_cache_reloads_in_background(netsnmp_cache *cache)
+{
+    return (cache->flags & NETSNMP_CACHE_BACKGROUND_RELOAD) &&
+        !(cache->flags & NETSNMP_CACHE_HINT_HANDLER_ARGS) &&
+        (cache->timeout > 0);
+}
+
+/** callback function to load a cache outside of a request */
+static void
+_background_reload(unsigned int regNo, void *clientargs)
+{
+    netsnmp_cache *cache = (netsnmp_cache *)clientargs;
+
+    DEBUGMSGT(("helper:cache_handler", "background load of cache %p\n",
+               cache));
+
+    cache->reload_id = 0;
+    cache->cache_hint = NULL;
+    _cache_load(cache);
+}
+
+static int
+_cache_check_and_reload(netsnmp_cache * cache, int can_wait)
 {
     if (!cache) {
         DEBUGMSGT(("helper:cache_handler", " no cache\n"));
         return 0;	/* ?? or -1 */
     }
+    if (cache->valid && can_wait && _cache_reloads_in_background(cache) &&
+        netsnmp_ready_monotonic(cache->timestampM, 750 * cache->timeout)) {
+        /*
+         * answer from the current contents, and load the cache again
+         * once the request has been dealt with
+         */
+        DEBUGMSGT(("helper:cache_handler", " cached (%d), %s\n",
+                   cache->timeout, cache->reload_id ?
+                   "background load pending" : "loading in background"));
+        if (0 == cache->reload_id)
+            cache->reload_id = snmp_alarm_register(0, 0, _background_reload,
+                                                   cache);
+        if (0 != cache->reload_id)
+            return 0;
+    }
     if (!cache->valid || netsnmp_cache_check_expired(cache))
         return _cache_load( cache );
     else {
@@ -582,6 +654,13 @@ netsnmp_cache_check_and_reload(netsnmp_cache * cache)
     }
 }
 
+/** Reload the cache if required */
+int
+netsnmp_cache_check_and_reload(netsnmp_cache * cache)
+{
+    return _cache_check_and_reload(cache, 1);
+}
+
 /** Is the cache valid for a given request? */
 int
 netsnmp_cache_is_valid(netsnmp_agent_request_info * reqinfo, 
@@ -670,7 +749,7 @@ netsnmp_cache_helper_handler(netsnmp_mib_handler * handler,
          * call the load hook, and update the cache timestamp.
          * If it's not already there, add to reqinfo
          */
-        netsnmp_cache_check_and_reload(cache);
+        _cache_check_and_reload(cache, MODE_IS_GET(reqinfo->mode));
         netsnmp_cache_reqinfo_insert(cache, reqinfo, addrstr);
         /** next handler called automatically - 'AUTO_NEXT' */
         break;
@@ -785,7 +864,10 @@ release_cached_resources(unsigned int regNo, void *clientargs)
              * Otherwise, note that we still have at
              *   least one active cache.
              */
-            if (netsnmp_cache_check_expired(cache)) {
+            if (netsnmp_cache_check_expired(cache) &&
+                (!_cache_reloads_in_background(cache) ||
+                 netsnmp_ready_monotonic(cache->timestampM,
+                                         2000 * cache->timeout))) {
                 if(! (cache->flags & NETSNMP_CACHE_DONT_FREE_EXPIRED))
                     _cache_free(cache);
             } else {
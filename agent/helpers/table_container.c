@@ -28,6 +28,7 @@
 
 #include <net-snmp/agent/table.h>
 #include <net-snmp/library/container.h>
+#include <net-snmp/library/container_hash.h>
 #include <net-snmp/library/snmp_assert.h>
 
 netsnmp_feature_provide(table_container);
@@ -37,6 +38,8 @@ netsnmp_feature_child_of(table_container_extract, table_container_all);
 netsnmp_feature_child_of(table_container_management, table_container_all);
 netsnmp_feature_child_of(table_container_row_remove, table_container_all);
 netsnmp_feature_child_of(table_container_row_insert, table_container_all);
+netsnmp_feature_child_of(table_container_hash_index, table_container_all);
+netsnmp_feature_child_of(table_container_sync, table_container_all);
 netsnmp_feature_child_of(table_container_all, mib_helpers);
 
 #ifndef NETSNMP_FEATURE_REMOVE_TABLE_CONTAINER
@@ -65,6 +68,9 @@ typedef struct container_table_data_s {
    /** container for the table rows */
    netsnmp_container          *table;
 
+   /** container for exact GET/SET lookups: table, or its hash index */
+   netsnmp_container          *lookup;
+
     /*
      * mutex_type                lock;
      */
@@ -147,6 +153,12 @@ typedef struct container_table_data_s {
  *    contraints and inserting any newly created rows into the container
  *    and the request's data list.
  *
+ *  GET and SET requests on tables using the default netsnmp_index key use
+ *  a hash index, if one was attached to the container with
+ *  netsnmp_container_table_add_hash_index() before the table was
+ *  registered, instead of searching the container itself. GET-NEXT and
+ *  GET-BULK always use the container.
+ *
  *  If a row is found, it will be inserted into
  *  the request's data list. The sub-handler may retrieve it by calling
  *      netsnmp_container_table_extract_context(request); *
@@ -292,6 +304,24 @@ netsnmp_container_table_data_free(container_table_data *tad)
 	free(tad);
 }
 
+/*
+ * Returns the container exact lookups should use: the hash index of the
+ * table, if one has been attached, otherwise the table itself.
+ */
+static netsnmp_container *
+_find_lookup_container(netsnmp_container *table, char key_type)
+{
+    netsnmp_container *c;
+
+    if (TABLE_CONTAINER_KEY_NETSNMP_INDEX != key_type)
+        return table;
+    for (c = table->next; c; c = c->next)
+        if (c->container_name &&
+            0 == strcmp(c->container_name, TABLE_CONTAINER_HASH_INDEX))
+            return c;
+    return table;
+}
+
 /** returns a netsnmp_mib_handler object for the table_container helper */
 netsnmp_mib_handler *
 netsnmp_container_table_handler_get(netsnmp_table_registration_info *tabreg,
@@ -326,6 +356,7 @@ netsnmp_container_table_handler_get(netsnmp_table_registration_info *tabreg,
     if(NULL == container)
         container = netsnmp_container_find("table_container");
     tad->table = container;
+    tad->lookup = _find_lookup_container(container, tad->key_type);
 
     if (NULL==container->compare)
         container->compare = netsnmp_compare_netsnmp_index;
@@ -380,6 +411,7 @@ netsnmp_container_table_unregister(netsnmp_handler_registration *reginfo)
     if (tad) {
         CONTAINER_FREE( tad->table );
         tad->table = NULL;
+        tad->lookup = NULL;
 	/*
 	 * Note: don't free the memory tad points at here - that is done
 	 * by netsnmp_container_table_data_free().
@@ -388,6 +420,229 @@ netsnmp_container_table_unregister(netsnmp_handler_registration *reginfo)
     return netsnmp_unregister_table( reginfo );
 }
 
+#ifndef NETSNMP_FEATURE_REMOVE_TABLE_CONTAINER_HASH_INDEX
+static void
+_hash_index_add_row(void *row, void *index)
+{
+    netsnmp_container *c = (netsnmp_container *)index;
+
+    c->insert(c, row);
+}
+
+/**
+ * Attach a hash index to a table container, for exact lookups of rows
+ * by GET and SET requests. The rows must start with a netsnmp_index,
+ * and the container must use the default netsnmp_compare_netsnmp_index
+ * compare routine. Rows already in the container are added to the index.
+ * The table helper picks the index up when the table is registered, so
+ * attach it before calling netsnmp_container_table_handler_get().
+ *
+ * From then on, rows must only be added and removed through
+ * CONTAINER_INSERT(), CONTAINER_REMOVE() and CONTAINER_CLEAR(), which
+ * keep all the indexes of a container up to date, and the index of a row
+ * must not be changed while the row is in the container.
+ *
+ * @return the hash index, or NULL on error.
+ */
+netsnmp_container *
+netsnmp_container_table_add_hash_index(netsnmp_container *container)
+{
+    netsnmp_container *index;
+
+    if ((NULL == container) || (NULL != container->prev) ||
+        (NULL == container->compare) ||
+        (netsnmp_compare_netsnmp_index != container->compare)) {
+        snmp_log(LOG_ERR,
+                 "bad param in netsnmp_container_table_add_hash_index\n");
+        return NULL;
+    }
+
+    index = netsnmp_container_find("hash");
+    if (NULL == index) {
+        snmp_log(LOG_ERR, "could not create table container hash index\n");
+        return NULL;
+    }
+    index->compare = container->compare;
+    index->ncompare = container->ncompare;
+    /** the primary container takes care of duplicate keys */
+    index->flags = CONTAINER_KEY_ALLOW_DUPLICATES;
+    index->container_name = strdup(TABLE_CONTAINER_HASH_INDEX);
+
+    CONTAINER_FOR_EACH(container, _hash_index_add_row, index);
+    if (CONTAINER_SIZE(index) != CONTAINER_SIZE(container)) {
+        snmp_log(LOG_ERR, "could not fill table container hash index\n");
+        CONTAINER_FREE(index);
+        return NULL;
+    }
+    netsnmp_container_add_index(container, index);
+    DEBUGMSGTL(("table_container", "added hash index to %s (%d rows)\n",
+                container->container_name ? container->container_name : "",
+                (int)CONTAINER_SIZE(index)));
+
+    return index;
+}
+#endif /* NETSNMP_FEATURE_REMOVE_TABLE_CONTAINER_HASH_INDEX */
+
+#ifndef NETSNMP_FEATURE_REMOVE_TABLE_CONTAINER_SYNC
+typedef struct sync_item_s {
+    netsnmp_index   index;      /* MUST BE FIRST */
+    void           *item;
+} sync_item;
+
+typedef struct sync_load_s {
+    const netsnmp_container_table_sync_ops *ops;
+    void           *context;
+    sync_item      *items;
+    oid            *oids;
+    size_t          count;
+} sync_load;
+
+static void
+_sync_add_item(void *item, void *magic)
+{
+    sync_load      *s = (sync_load *)magic;
+    sync_item      *si = &s->items[s->count];
+
+    si->index.oids = &s->oids[s->count * s->ops->max_index_len];
+    si->index.len = s->ops->max_index_len;
+    if (0 != s->ops->index(item, &si->index, s->context)) {
+        s->ops->item_free(item, s->context);
+        return;
+    }
+    si->item = item;
+    ++s->count;
+}
+
+/**
+ * Bring the rows of a table container up to date from a container of
+ * freshly loaded items (e.g. data_access entries), reusing the rows that
+ * are still there instead of releasing and re-creating all of them.
+ *
+ * The rows must start with a netsnmp_index, and the container must use
+ * the default netsnmp_compare_netsnmp_index compare routine. The index
+ * callback gives the table index for each item, which is used to match it
+ * with a row. Rows with a match are passed to update, items without one
+ * to create, and rows without one are removed from the container and
+ * passed to release. Items with a duplicate index, or which the index
+ * callback rejects, are passed to item_free.
+ *
+ * Either way, every item is taken over, so the items container should be
+ * freed without freeing its contents. If -1 is returned, nothing was
+ * changed and the items still belong to the caller.
+ *
+ * This is intended for cache load routines of caches with the
+ * NETSNMP_CACHE_DONT_FREE_BEFORE_LOAD flag set.
+ *
+ * @return 0 on success, or -1 on error.
+ */
+int
+netsnmp_container_table_sync(netsnmp_container *container,
+                             netsnmp_container *items,
+                             const netsnmp_container_table_sync_ops *ops,
+                             void *context)
+{
+    netsnmp_iterator *it;
+    sync_load       s;
+    void          **stale, *row;
+    size_t          rows, i, j, kept = 0, added = 0, removed = 0;
+    int             rc;
+
+    if ((NULL == container) || (NULL == items) || (NULL == ops) ||
+        (netsnmp_compare_netsnmp_index != container->compare) ||
+        (NULL == ops->index) || (NULL == ops->update) ||
+        (NULL == ops->create) || (NULL == ops->release) ||
+        (NULL == ops->item_free) || (0 == ops->max_index_len)) {
+        snmp_log(LOG_ERR, "bad param in netsnmp_container_table_sync\n");
+        return -1;
+    }
+
+    rows = CONTAINER_SIZE(container);
+    i = CONTAINER_SIZE(items);
+    s.ops = ops;
+    s.context = context;
+    s.count = 0;
+    s.items = (sync_item *)calloc(i + 1, sizeof(sync_item));
+    s.oids = (oid *)calloc(i * ops->max_index_len + 1, sizeof(oid));
+    stale = (void **)calloc(rows + 1, sizeof(void *));
+    it = CONTAINER_ITERATOR(container);
+    if ((NULL == s.items) || (NULL == s.oids) || (NULL == stale) ||
+        (NULL == it)) {
+        snmp_log(LOG_ERR, "could not sync table container\n");
+        free(s.items);
+        free(s.oids);
+        free(stale);
+        if (it)
+            ITERATOR_RELEASE(it);
+        return -1;
+    }
+
+    /*
+     * index the items, in the order of the rows, dropping duplicates
+     */
+    CONTAINER_FOR_EACH(items, _sync_add_item, &s);
+    qsort(s.items, s.count, sizeof(sync_item), netsnmp_compare_netsnmp_index);
+    for (i = 0, j = 0; i < s.count; ++i) {
+        if (j && (0 == netsnmp_compare_netsnmp_index(&s.items[j - 1],
+                                                     &s.items[i]))) {
+            ops->item_free(s.items[i].item, context);
+            continue;
+        }
+        s.items[j++] = s.items[i];
+    }
+    s.count = j;
+
+    /*
+     * walk the rows and the items side by side. items with a row are
+     * used up, the others are moved to the front of the array.
+     */
+    row = ITERATOR_FIRST(it);
+    for (i = 0, j = 0; (NULL != row) || (i < s.count); ) {
+        if (NULL == row)
+            rc = 1;
+        else if (i == s.count)
+            rc = -1;
+        else
+            rc = netsnmp_compare_netsnmp_index(row, &s.items[i]);
+        if (rc < 0) {
+            stale[removed++] = row;
+            row = ITERATOR_NEXT(it);
+        } else if (rc > 0) {
+            s.items[j++] = s.items[i++];
+        } else {
+            ops->update(row, s.items[i++].item, context);
+            ++kept;
+            row = ITERATOR_NEXT(it);
+        }
+    }
+    ITERATOR_RELEASE(it);
+
+    for (i = 0; i < removed; ++i) {
+        CONTAINER_REMOVE(container, stale[i]);
+        ops->release(stale[i], context);
+    }
+    for (i = 0; i < j; ++i) {
+        row = ops->create(s.items[i].item, context);
+        if (NULL == row)
+            continue;
+        if (CONTAINER_INSERT(container, row) != 0) {
+            ops->release(row, context);
+            continue;
+        }
+        ++added;
+    }
+
+    DEBUGMSGTL(("table_container:sync", "%s: %d kept, %d added, %d removed\n",
+                container->container_name ? container->container_name : "",
+                (int)kept, (int)added, (int)removed));
+
+    free(s.items);
+    free(s.oids);
+    free(stale);
+
+    return 0;
+}
+#endif /* NETSNMP_FEATURE_REMOVE_TABLE_CONTAINER_SYNC */
+
 /** retrieve the container used by the table_container helper */
 #ifndef NETSNMP_FEATURE_REMOVE_TABLE_CONTAINER_EXTRACT
 netsnmp_container*
@@ -662,9 +917,8 @@ _data_lookup(netsnmp_handler_registration *reginfo,
         }
     } /** GETNEXT/GETBULK */
     else {
-
         _set_key( tad, request, tblreq_info, &key, &index );
-        row = (netsnmp_index*)CONTAINER_FIND(tad->table, key);
+        row = (netsnmp_index*)CONTAINER_FIND(tad->lookup, key);
         if (NULL == row) {
             /*
              * not results found. For a get, that is an error
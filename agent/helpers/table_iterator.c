@@ -83,6 +83,17 @@
         then the free_loop_context_at_end pointer should be set, which
         is more efficient since a malloc/free will only be performed
         once for every iteration.
+
+    Looping over every row for each request makes a walk of a large
+    table quadratic in the number of rows.  Setting the
+    NETSNMP_ITERATOR_FLAG_SNAPSHOT flag makes the helper iterate the
+    table once, keep the index OIDs and data contexts of all rows in a
+    sorted array and answer GET and GETNEXT requests by binary search
+    instead.  If a cache handler sits above the iterator, the snapshot
+    is kept until that cache is reloaded (so the data contexts must
+    remain valid for as long as the cached data does); otherwise it is
+    built once per PDU, which still helps GETBULK.  The hooks are used
+    as before, except that the hint for sorted tables is not passed.
  *
  *  @{
  */
@@ -117,6 +128,8 @@ netsnmp_feature_require(data_list_get_list_node);
 netsnmp_feature_require(oid_stash_add_data);
 #endif /* NETSNMP_FEATURE_REQUIRE_STASH_CACHE */
 
+static void _ti_snapshot_free(void *it);
+
 /* ==================================
  *
  * Iterator API: Table maintenance
@@ -169,6 +182,10 @@ netsnmp_iterator_delete_table( netsnmp_iterator_info *iinfo )
         snmp_free_varbind( iinfo->indexes );
         iinfo->indexes = NULL;
     }
+    if (iinfo->snapshot) {
+        _ti_snapshot_free( iinfo->snapshot );
+        iinfo->snapshot = NULL;
+    }
     netsnmp_table_registration_info_free(iinfo->table_reginfo);
     SNMP_FREE( iinfo );
 }
@@ -447,6 +464,339 @@ netsnmp_iterator_remember(netsnmp_request_info *request,
 }    
 
 #define TABLE_ITERATOR_NOTAGAIN 255
+
+/*
+ * Sorted snapshot of all rows, used instead of looping over the
+ * table for each request when NETSNMP_ITERATOR_FLAG_SNAPSHOT is set.
+ */
+#define TI_REQUEST_SNAPSHOT "ti_snapshot"
+
+typedef struct ti_snapshot_row_s {
+    oid    *index;
+    size_t  index_len;
+    void   *data_context;
+} ti_snapshot_row;
+
+typedef struct ti_snapshot_s {
+    netsnmp_iterator_info *iinfo;
+    ti_snapshot_row *rows;
+    size_t           count;
+    netsnmp_cache   *cache;     /* cache the rows were taken from, if any */
+    struct timeval   loaded;    /* and when that cache had been loaded */
+} ti_snapshot;
+
+static void
+_ti_snapshot_free(void *it)
+{
+    ti_snapshot *snap = (ti_snapshot *)it;
+    size_t       i;
+
+    if (!snap)
+        return;
+    for (i = 0; i < snap->count; i++) {
+        if (snap->rows[i].data_context && snap->iinfo->free_data_context)
+            (snap->iinfo->free_data_context)(snap->rows[i].data_context,
+                                             snap->iinfo);
+        free(snap->rows[i].index);
+    }
+    free(snap->rows);
+    free(snap);
+}
+
+static int
+_ti_snapshot_compare(const void *a, const void *b)
+{
+    const ti_snapshot_row *ra = (const ti_snapshot_row *)a;
+    const ti_snapshot_row *rb = (const ti_snapshot_row *)b;
+
+    return snmp_oid_compare(ra->index, ra->index_len,
+                            rb->index, rb->index_len);
+}
+
+/*
+ * Loop over the whole table once, keeping the index OID and data
+ * context of every row, and sort the rows by index.
+ */
+static ti_snapshot *
+_ti_snapshot_build(netsnmp_iterator_info *iinfo,
+                   netsnmp_variable_list *indexes, size_t max_index_len)
+{
+    ti_snapshot           *snap;
+    ti_snapshot_row       *rows;
+    netsnmp_variable_list *index_search, *vars;
+    void                  *loop_context = NULL, *last_loop_context;
+    void                  *data_context = NULL;
+    oid                    index[MAX_OID_LEN];
+    size_t                 index_len, size = 0, i, j;
+    int                    failed = 0;
+
+    snap = SNMP_MALLOC_TYPEDEF(ti_snapshot);
+    if (!snap)
+        return NULL;
+    snap->iinfo = iinfo;
+
+    index_search = snmp_clone_varbind(indexes);
+    if (!index_search) {
+        free(snap);
+        return NULL;
+    }
+
+    vars = (iinfo->get_first_data_point)(&loop_context, &data_context,
+                                         index_search, iinfo);
+    while (vars) {
+        index_search = vars;
+        if (!data_context && iinfo->make_data_context)
+            data_context = (iinfo->make_data_context)(loop_context, iinfo);
+
+        if (snap->count == size) {
+            size = size ? 2 * size : 64;
+            rows = (ti_snapshot_row *)realloc(snap->rows,
+                                              size * sizeof(ti_snapshot_row));
+            if (!rows)
+                failed = 1;
+            else
+                snap->rows = rows;
+        }
+        if (!failed &&
+            build_oid_noalloc(index, max_index_len, &index_len, NULL, 0,
+                              vars) == SNMPERR_SUCCESS &&
+            (snap->rows[snap->count].index =
+             (oid *)netsnmp_memdup(index, index_len * sizeof(oid)))) {
+            snap->rows[snap->count].index_len = index_len;
+            snap->rows[snap->count].data_context = data_context;
+            snap->count++;
+        } else if (data_context && iinfo->free_data_context) {
+            (iinfo->free_data_context)(data_context, iinfo);
+        }
+
+        last_loop_context = loop_context;
+        data_context = NULL;
+        vars = (iinfo->get_next_data_point)(&loop_context, &data_context,
+                                            index_search, iinfo);
+        if (iinfo->free_loop_context && last_loop_context &&
+            data_context != last_loop_context &&
+            (!snap->count ||
+             snap->rows[snap->count - 1].data_context != last_loop_context))
+            (iinfo->free_loop_context)(last_loop_context, iinfo);
+    }
+    if (loop_context && iinfo->free_loop_context_at_end)
+        (iinfo->free_loop_context_at_end)(loop_context, iinfo);
+    snmp_free_varbind(index_search);
+
+    if (failed) {
+        _ti_snapshot_free(snap);
+        return NULL;
+    }
+
+    /*
+     * sort, keeping only the first of any rows with the same index
+     */
+    if (snap->count > 1) {
+        qsort(snap->rows, snap->count, sizeof(ti_snapshot_row),
+              _ti_snapshot_compare);
+        for (i = 1, j = 0; i < snap->count; i++) {
+            if (_ti_snapshot_compare(&snap->rows[j], &snap->rows[i]) == 0) {
+                if (snap->rows[i].data_context && iinfo->free_data_context)
+                    (iinfo->free_data_context)(snap->rows[i].data_context,
+                                               iinfo);
+                free(snap->rows[i].index);
+            } else
+                snap->rows[++j] = snap->rows[i];
+        }
+        snap->count = j + 1;
+    }
+    return snap;
+}
+
+/*
+ * Find the snapshot to use for this request, building it if needed.
+ * A snapshot taken from a cache handler above us lasts until that
+ * cache is next loaded; otherwise it only lasts for the current PDU.
+ */
+static ti_snapshot *
+_ti_snapshot_get(netsnmp_iterator_info *iinfo,
+                 netsnmp_handler_registration *reginfo,
+                 netsnmp_agent_request_info *reqinfo,
+                 size_t max_index_len)
+{
+    netsnmp_mib_handler *cache_handler;
+    netsnmp_cache       *cache = NULL;
+    ti_snapshot         *snap = (ti_snapshot *)iinfo->snapshot;
+    char                 name[sizeof(TI_REQUEST_SNAPSHOT) + 24];
+
+    cache_handler = netsnmp_find_handler_by_name(reginfo, "cache_handler");
+    if (cache_handler)
+        cache = (netsnmp_cache *)cache_handler->myvoid;
+
+    if (cache && cache->valid && cache->timestampM) {
+        if (snap && snap->cache == cache &&
+            memcmp(&snap->loaded, cache->timestampM,
+                   sizeof(struct timeval)) == 0)
+            return snap;
+        snap = _ti_snapshot_build(iinfo, iinfo->table_reginfo->indexes,
+                                  max_index_len);
+        _ti_snapshot_free(iinfo->snapshot);
+        iinfo->snapshot = snap;
+        if (snap) {
+            snap->cache = cache;
+            memcpy(&snap->loaded, cache->timestampM, sizeof(struct timeval));
+            DEBUGMSGTL(("table_iterator:snapshot", "%s: %" NETSNMP_PRIz
+                        "u rows, kept with cache\n", reginfo->handlerName,
+                        snap->count));
+        }
+        return snap;
+    }
+
+    if (snap) {
+        /* the cache has gone away, and the rows with it */
+        _ti_snapshot_free(snap);
+        iinfo->snapshot = NULL;
+    }
+
+    snprintf(name, sizeof(name), "%s:%p", TI_REQUEST_SNAPSHOT, iinfo);
+    snap = (ti_snapshot *)netsnmp_agent_get_list_data(reqinfo, name);
+    if (!snap) {
+        snap = _ti_snapshot_build(iinfo, iinfo->table_reginfo->indexes,
+                                  max_index_len);
+        if (!snap)
+            return NULL;
+        netsnmp_agent_add_list_data(reqinfo,
+                                    netsnmp_create_data_list(name, snap,
+                                                             _ti_snapshot_free));
+        DEBUGMSGTL(("table_iterator:snapshot", "%s: %" NETSNMP_PRIz
+                    "u rows, kept for this request\n", reginfo->handlerName,
+                    snap->count));
+    }
+    return snap;
+}
+
+/*
+ * Index of the first row whose index is greater than the given one
+ * (or, for exact searches, greater than or equal to it).
+ */
+static size_t
+_ti_snapshot_search(ti_snapshot *snap, const oid *index, size_t index_len,
+                    int exact)
+{
+    size_t lo = 0, hi = snap->count, mid;
+    int    rc;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        rc = snmp_oid_compare(snap->rows[mid].index, snap->rows[mid].index_len,
+                              index, index_len);
+        if (rc < 0 || (rc == 0 && !exact))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * Fill in the per-request cache from the snapshot, as the loop in
+ * netsnmp_table_iterator_helper_handler would have done.
+ */
+static int
+_ti_snapshot_lookup(ti_snapshot *snap,
+                    netsnmp_handler_registration *reginfo,
+                    netsnmp_agent_request_info *reqinfo,
+                    netsnmp_request_info *requests,
+                    oid *coloid, size_t coloid_len)
+{
+    netsnmp_iterator_info      *iinfo = snap->iinfo;
+    netsnmp_table_request_info *table_info;
+    netsnmp_request_info       *request;
+    netsnmp_variable_list      *vb;
+    ti_snapshot_row            *row;
+    ti_cache_info              *ti_info;
+    size_t                      i;
+    unsigned int                nc;
+    int                         rc;
+
+    for (request = requests; request; request = request->next) {
+        if (request->processed)
+            continue;
+        table_info = netsnmp_extract_table_info(request);
+        if (table_info == NULL)
+            return SNMP_ERR_GENERR;
+        vb = request->requestvb;
+
+        if (reqinfo->mode == MODE_GET) {
+            /* looking for an exact match */
+            if (vb->name_length <= coloid_len)
+                continue;
+            i = _ti_snapshot_search(snap, vb->name + coloid_len,
+                                    vb->name_length - coloid_len, 1);
+            if (i == snap->count ||
+                snmp_oid_compare(snap->rows[i].index, snap->rows[i].index_len,
+                                 vb->name + coloid_len,
+                                 vb->name_length - coloid_len) != 0)
+                continue;
+        } else {
+            /* looking for the next row, moving on a column if needed */
+            for (;;) {
+                coloid[reginfo->rootoid_len + 1] = table_info->colnum;
+                rc = snmp_oid_compare(vb->name,
+                                      SNMP_MIN(vb->name_length, coloid_len),
+                                      coloid, coloid_len);
+                if (rc < 0)
+                    i = 0;
+                else if (rc == 0)
+                    i = _ti_snapshot_search(snap, vb->name + coloid_len,
+                                            vb->name_length - coloid_len, 0);
+                else
+                    i = snap->count;
+                if (i < snap->count)
+                    break;
+                nc = netsnmp_table_next_column(table_info);
+                if (0 == nc) {
+                    coloid[reginfo->rootoid_len + 1] = table_info->colnum + 1;
+                    snmp_set_var_objid(vb, coloid, reginfo->rootoid_len + 2);
+                    request->processed = TABLE_ITERATOR_NOTAGAIN;
+                    break;
+                }
+                table_info->colnum = nc;
+            }
+            if (request->processed)
+                continue;
+        }
+        row = &snap->rows[i];
+
+        ti_info = (ti_cache_info *)
+            netsnmp_request_get_list_data(request, TI_REQUEST_CACHE);
+        if (!ti_info) {
+            ti_info = SNMP_MALLOC_TYPEDEF(ti_cache_info);
+            if (ti_info == NULL)
+                return SNMP_ERR_GENERR;
+            netsnmp_request_add_list_data(request,
+                                          netsnmp_create_data_list
+                                          (TI_REQUEST_CACHE,
+                                           ti_info,
+                                           netsnmp_free_ti_cache));
+        }
+        /* the data context stays with the snapshot */
+        ti_info->data_context = row->data_context;
+        ti_info->free_context = NULL;
+        ti_info->iinfo = iinfo;
+
+        if (reqinfo->mode == MODE_GETNEXT) {
+            memcpy(ti_info->best_match, coloid, coloid_len * sizeof(oid));
+            memcpy(ti_info->best_match + coloid_len, row->index,
+                   row->index_len * sizeof(oid));
+            ti_info->best_match_len = coloid_len + row->index_len;
+            if (ti_info->results)
+                snmp_free_varbind(ti_info->results);
+            ti_info->results =
+                snmp_clone_varbind(iinfo->table_reginfo->indexes);
+            if (!ti_info->results)
+                return SNMP_ERR_GENERR;
+            parse_oid_indexes(row->index, row->index_len, ti_info->results);
+        }
+    }
+    return SNMP_ERR_NOERROR;
+}
+
 /* implements the table_iterator helper */
 int
 netsnmp_table_iterator_helper_handler(netsnmp_mib_handler *handler,
@@ -471,6 +821,7 @@ netsnmp_table_iterator_helper_handler(netsnmp_mib_handler *handler,
     void           *callback_loop_context = NULL, *last_loop_context;
     void           *callback_data_context = NULL;
     ti_cache_info  *ti_info = NULL;
+    ti_snapshot    *snapshot = NULL;
     int             request_count = 0;
 #ifndef NETSNMP_FEATURE_REMOVE_STASH_CACHE
     netsnmp_oid_stash_node **cinfo = NULL;
@@ -573,16 +924,36 @@ netsnmp_table_iterator_helper_handler(netsnmp_mib_handler *handler,
         break;
     }
 
+    /*
+     * answer from a sorted snapshot of the rows, if asked to
+     */
+    if ((iinfo->flags & NETSNMP_ITERATOR_FLAG_SNAPSHOT) &&
+        (reqinfo->mode == MODE_GET || reqinfo->mode == MODE_GETNEXT)) {
+        snapshot = _ti_snapshot_get(iinfo, reginfo, reqinfo,
+                                    MAX_OID_LEN - coloid_len);
+        if (snapshot &&
+            _ti_snapshot_lookup(snapshot, reginfo, reqinfo, requests,
+                                coloid, coloid_len) != SNMP_ERR_NOERROR)
+            return SNMP_ERR_GENERR;
+    }
+#ifndef NETSNMP_NO_WRITE_SUPPORT
+    else if (iinfo->snapshot && MODE_IS_SET(reqinfo->mode)) {
+        /* the rows may be about to change */
+        _ti_snapshot_free(iinfo->snapshot);
+        iinfo->snapshot = NULL;
+    }
+#endif /* NETSNMP_NO_WRITE_SUPPORT */
+
     /*
      * collect all information for each needed row
      */
-    if (reqinfo->mode == MODE_GET ||
+    if (!snapshot && (reqinfo->mode == MODE_GET ||
         reqinfo->mode == MODE_GETNEXT ||
         reqinfo->mode == MODE_GET_STASH
 #ifndef NETSNMP_NO_WRITE_SUPPORT
         || reqinfo->mode == MODE_SET_RESERVE1
 #endif /* NETSNMP_NO_WRITE_SUPPORT */
-        ) {
+        )) {
         /*
          * Count the number of request in the list,
          *   so that we'll know when we're finished
@@ -1,6 +1,16 @@
 
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-features.h>
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+#include <signal.h>
+#include <errno.h>
+
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
 #include <net-snmp/agent/watcher.h>
@@ -24,6 +34,13 @@ netsnmp_feature_require(insert_table_row);
 
 oid  ns_extend_oid[]    = { 1, 3, 6, 1, 4, 1, 8072, 1, 3, 2 };
 
+#define EXTEND_MAX_OUTPUT   (1024*100)
+#define EXTEND_ASYNC_TIMEOUT 60	/* default for '-timeout' */
+
+#if defined(USING_UTILITIES_EXECUTE_MODULE) && HAVE_EXECV && HAVE_SYS_WAIT_H
+#define EXTEND_ASYNC_SUPPORT 1
+#endif
+
 typedef struct extend_registration_block_s {
     netsnmp_table_data *dinfo;
     oid                *root_oid;
@@ -319,6 +336,55 @@ shutdown_extend(void)
          *
          *************************/
 
+/*
+ * Build the command line for an entry
+ */
+static void
+_extend_command_line(netsnmp_extend *extension, char *buf, size_t len)
+{
+    if ( extension->args )
+        snprintf( buf, len, "%s %s", extension->command, extension->args );
+    else 
+        snprintf( buf, len, "%s", extension->command );
+}
+
+/*
+ * Install the (malloc'ed, NUL-terminated) output of a command,
+ * and pick it apart into separate lines.
+ */
+static void
+_extend_set_output(netsnmp_extend *extension, char *buf, int len)
+{
+    char *cp;
+    int   i;
+
+    if (len > 0 && buf[ len-1 ] == '\n')
+        buf[ --len ] = '\0';	/* Stomp on trailing newline */
+    extension->output   = buf;
+    extension->out_len  = len;
+
+    extension->numlines = 1;
+    for (cp=buf; *cp; cp++) {
+        if (*cp == '\n')
+            extension->numlines++;
+    }
+    if ( extension->numlines > 1 ) {
+        extension->lines = (char**)calloc( sizeof(char *), extension->numlines );
+        if (!extension->lines) {
+            extension->numlines = 1;
+            extension->lines = &extension->output;
+            return;
+        }
+        extension->lines[ 0 ] = buf;
+        for (cp=buf, i=1; *cp; cp++) {
+            if (*cp == '\n')
+                extension->lines[ i++ ] = cp+1;
+        }
+    } else {
+        extension->lines = &extension->output;
+    }
+}
+
 int
 extend_load_cache(netsnmp_cache *cache, void *magic)
 {
@@ -326,51 +392,31 @@ extend_load_cache(netsnmp_cache *cache, void *magic)
     NETSNMP_LOGONCE((LOG_WARNING,"support for run_exec_command not available\n"));
     return -1;
 #else
-    int  out_len = 1024*100;
-    char out_buf[ 1024*100 ];
+    int  out_len = EXTEND_MAX_OUTPUT;
+    char out_buf[ EXTEND_MAX_OUTPUT ];
     int  cmd_len = 255*2 + 2;	/* 2 * DisplayStrings */
     char cmd_buf[ 255*2 + 2 ];
     int  ret;
-    char *cp;
-    char *line_buf[ 1024 ];
+    char *output;
     netsnmp_extend *extension = (netsnmp_extend *)magic;
 
     if (!magic)
         return -1;
     DEBUGMSGTL(( "nsExtendTable:cache", "load %s", extension->token ));
-    if ( extension->args )
-        snprintf( cmd_buf, cmd_len, "%s %s", extension->command, extension->args );
-    else 
-        snprintf( cmd_buf, cmd_len, "%s", extension->command );
+    _extend_command_line( extension, cmd_buf, cmd_len );
     if ( extension->flags & NS_EXTEND_FLAGS_SHELL )
         ret = run_shell_command( cmd_buf, extension->input, out_buf, &out_len);
     else
         ret = run_exec_command(  cmd_buf, extension->input, out_buf, &out_len);
     DEBUGMSG(( "nsExtendTable:cache", ": %s : %d\n", cmd_buf, ret));
     if (ret >= 0) {
-        if (out_buf[   out_len-1 ] == '\n')
-            out_buf[ --out_len   ] =  '\0';	/* Stomp on trailing newline */
-        extension->output   = strdup( out_buf );
-        extension->out_len  = out_len;
-        /*
-         * Now we need to pick the output apart into separate lines.
-         * Start by counting how many lines we've got, and keeping
-         * track of where each line starts in a static buffer
-         */
-        extension->numlines = 1;
-        line_buf[ 0 ] = extension->output;
-        for (cp=extension->output; *cp; cp++) {
-            if (*cp == '\n') {
-                line_buf[ extension->numlines++ ] = cp+1;
-            }
-        }
-        if ( extension->numlines > 1 ) {
-            extension->lines = (char**)calloc( sizeof(char *), extension->numlines );
-            memcpy( extension->lines, line_buf,
-                                       sizeof(char *) * extension->numlines );
-        } else {
-            extension->lines = &extension->output;
-        }
+        if (out_len < 0)
+            out_len = 0;
+        out_buf[ out_len ] = '\0';
+        output = netsnmp_memdup( out_buf, out_len + 1 );
+        if (!output)
+            return -1;
+        _extend_set_output( extension, output, out_len );
     }
     extension->result = ret;
     return ret;
@@ -398,6 +444,295 @@ extend_free_cache(netsnmp_cache *cache, void *magic)
 }
 
 
+        /*************************
+         *
+         *  Asynchronous command runs ('extend -async')
+         *  The command's output is collected via the fd event
+         *  manager, and requests arriving meanwhile are delegated
+         *  (or answered from the previous output, with -serveStale).
+         *
+         *************************/
+
+static int _extend_output1_value(netsnmp_agent_request_info *reqinfo,
+                                 netsnmp_request_info *request,
+                                 netsnmp_extend *extension);
+
+#ifdef EXTEND_ASYNC_SUPPORT
+/*
+ * Install the result of a finished run, and answer any waiting requests.
+ * 'status' is the wait status of the command, or -1 if it failed.
+ */
+static void
+_extend_async_finish(netsnmp_extend *extension, int status)
+{
+    netsnmp_cache           *cache = extension->cache;
+    netsnmp_delegated_cache *dcache, *dnext;
+
+    if (extension->timer_id) {
+        snmp_alarm_unregister(extension->timer_id);
+        extension->timer_id = 0;
+    }
+    if (extension->reap_id) {
+        snmp_alarm_unregister(extension->reap_id);
+        extension->reap_id = 0;
+    }
+
+    DEBUGMSGTL(( "nsExtendTable:async", "%s finished: %d (%d bytes)\n",
+                 extension->token, status, extension->alen ));
+    if (status >= 0) {
+        if (cache->valid)
+            extend_free_cache(cache, extension);
+        extension->abuf[ extension->alen ] = '\0';
+        _extend_set_output(extension, extension->abuf, extension->alen);
+        extension->abuf = NULL;
+        /* Match the results reported by run_shell/exec_command */
+        if (extension->flags & NS_EXTEND_FLAGS_SHELL)
+            extension->result = status;
+        else
+            extension->result = WEXITSTATUS(status);
+        cache->valid   = 1;
+        cache->expired = 0;
+        netsnmp_set_monotonic_marker(&cache->timestampM);
+    } else {
+        SNMP_FREE(extension->abuf);
+        if (!(extension->flags & NS_EXTEND_FLAGS_STALE) && cache->valid) {
+            extend_free_cache(cache, extension);
+            cache->valid = 0;
+        }
+    }
+    extension->alen = 0;
+
+    /*
+     * Waiting requests are chained through their 'localinfo' pointers
+     */
+    dcache = extension->waiting;
+    extension->waiting     = NULL;
+    extension->num_waiting = 0;
+    for ( ; dcache; dcache = dnext) {
+        dnext = (netsnmp_delegated_cache *)dcache->localinfo;
+        if (netsnmp_handler_check_cache(dcache)) {
+            dcache->requests->delegated = 0;
+            if (cache->valid)
+                _extend_output1_value(dcache->reqinfo, dcache->requests,
+                                      extension);
+            else if (dcache->reqinfo->mode != MODE_GET)
+                /* GETNEXT/GETBULK: move on past this entry */
+                snmp_set_var_typed_value(dcache->requests->requestvb,
+                                         ASN_PRIV_RETRY, NULL, 0);
+            else
+                netsnmp_set_request_error(dcache->reqinfo, dcache->requests,
+                                          SNMP_NOSUCHINSTANCE);
+            /*
+             * The bulk_to_next helper has already moved the other
+             *   varbinds on to their next repetition; catch this one up.
+             */
+            if (dcache->reqinfo->mode == MODE_GETBULK)
+                netsnmp_bulk_to_next_fix_requests(dcache->requests);
+        }
+        netsnmp_free_delegated_cache(dcache);
+    }
+}
+
+static void
+_extend_async_close(netsnmp_extend *extension)
+{
+    if (extension->fd >= 0) {
+        unregister_readfd(extension->fd);
+        close(extension->fd);
+        extension->fd = -1;
+    }
+}
+
+/*
+ * Reap a command that has closed its output.
+ * Polled from an alarm until it has exited.
+ */
+static void
+_extend_async_reap(unsigned int clientreg, void *clientarg)
+{
+    netsnmp_extend *extension = (netsnmp_extend *)clientarg;
+    int status, rc;
+
+    rc = waitpid(extension->pid, &status, WNOHANG);
+    if (rc == 0)
+        return;
+    if (rc < 0) {
+        snmp_log_perror("extend: waitpid");
+        status = -1;
+    }
+    extension->pid = 0;
+    _extend_async_finish(extension, status);
+}
+
+static void
+_extend_async_read(int fd, void *data)
+{
+    netsnmp_extend *extension = (netsnmp_extend *)data;
+    char    buf[4096];
+    ssize_t count;
+    int     len;
+    struct timeval poll = { 0, 100000 };
+
+    count = read(fd, buf, sizeof(buf));
+    if (count < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+    if (count > 0) {
+        /*
+         * Keep draining the pipe once the buffer is full,
+         * so the command doesn't block writing to it.
+         */
+        len = SNMP_MIN(count, EXTEND_MAX_OUTPUT - extension->alen);
+        if (len > 0) {
+            memcpy(extension->abuf + extension->alen, buf, len);
+            extension->alen += len;
+        }
+        return;
+    }
+
+    /*
+     * End of the output: the command has (almost) finished
+     */
+    _extend_async_close(extension);
+    _extend_async_reap(0, extension);
+    if (extension->pid)
+        extension->reap_id = snmp_alarm_register_hr(poll, SA_REPEAT,
+                                        _extend_async_reap, extension);
+}
+
+/*
+ * Kill a running command, failing any requests waiting for it
+ */
+static void
+_extend_async_kill(netsnmp_extend *extension)
+{
+    int status;
+
+    if (!extension->pid)
+        return;
+    kill(extension->pid, SIGKILL);
+    waitpid(extension->pid, &status, 0);
+    extension->pid = 0;
+    _extend_async_close(extension);
+    _extend_async_finish(extension, -1);
+}
+
+static void
+_extend_async_timeout(unsigned int clientreg, void *clientarg)
+{
+    netsnmp_extend *extension = (netsnmp_extend *)clientarg;
+
+    extension->timer_id = 0;
+    snmp_log(LOG_WARNING, "extend: %s timed out after %d seconds\n",
+             extension->token, extension->timeout);
+    _extend_async_kill(extension);
+}
+
+static int
+_extend_async_start(netsnmp_extend *extension)
+{
+    char cmd_buf[ 255*2 + 2 ];	/* 2 * DisplayStrings */
+    int  fd, pid;
+
+    extension->abuf = (char *)malloc(EXTEND_MAX_OUTPUT + 1);
+    if (!extension->abuf)
+        return -1;
+    _extend_command_line( extension, cmd_buf, sizeof(cmd_buf) );
+    pid = start_exec_command( cmd_buf, extension->input,
+                              extension->flags & NS_EXTEND_FLAGS_SHELL, &fd );
+    if (pid < 0) {
+        SNMP_FREE(extension->abuf);
+        return -1;
+    }
+    if (register_readfd(fd, _extend_async_read, extension) != FD_REGISTERED_OK) {
+        int status;
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+        close(fd);
+        SNMP_FREE(extension->abuf);
+        return -1;
+    }
+    DEBUGMSGTL(( "nsExtendTable:async", "%s started: %s (pid %d)\n",
+                 extension->token, cmd_buf, pid ));
+    extension->pid  = pid;
+    extension->fd   = fd;
+    extension->alen = 0;
+    if (extension->timeout > 0)
+        extension->timer_id = snmp_alarm_register(extension->timeout, 0,
+                                        _extend_async_timeout, extension);
+    return 0;
+}
+#endif /* EXTEND_ASYNC_SUPPORT */
+
+/*
+ * Make sure an entry's output is up to date, without blocking
+ *   for an asynchronous entry.
+ * Returns 0 if the output can be used now (for an asynchronous entry,
+ *   the previous output while a fresh run is in progress), 1 if the
+ *   caller needs to wait for the entry's first run, or -1 on failure.
+ */
+static int
+_extend_check_output(netsnmp_extend *extension)
+{
+#ifdef EXTEND_ASYNC_SUPPORT
+    netsnmp_cache *cache = extension->cache;
+
+    if ((extension->flags & NS_EXTEND_FLAGS_ASYNC) &&
+        !(extension->flags & NS_EXTEND_FLAGS_WRITEABLE)) {
+        if (!extension->pid &&
+            (!cache->valid || netsnmp_cache_check_expired(cache)) &&
+            _extend_async_start(extension) < 0)
+            return cache->valid ? 0 : -1;
+        return cache->valid ? 0 : 1;
+    }
+#endif /* EXTEND_ASYNC_SUPPORT */
+    return (netsnmp_cache_check_and_reload(extension->cache) < 0) ? -1 : 0;
+}
+
+/*
+ * Should a request for the nsExtendOutput1Table wait for the run in
+ *   progress rather than use the previous output?  (Only -serveStale
+ *   entries answer from the previous output.)
+ */
+static int
+_extend_must_wait(netsnmp_extend *extension)
+{
+#ifdef EXTEND_ASYNC_SUPPORT
+    return (extension->flags & NS_EXTEND_FLAGS_ASYNC) && extension->pid &&
+           !(extension->flags & NS_EXTEND_FLAGS_STALE);
+#else
+    return 0;
+#endif /* EXTEND_ASYNC_SUPPORT */
+}
+
+/*
+ * Delegate a request until the run in progress has finished
+ */
+static int
+_extend_wait_output(netsnmp_extend               *extension,
+                    netsnmp_mib_handler          *handler,
+                    netsnmp_handler_registration *reginfo,
+                    netsnmp_agent_request_info   *reqinfo,
+                    netsnmp_request_info         *request)
+{
+    netsnmp_delegated_cache *dcache;
+
+    if (extension->max_waiting > 0 &&
+        extension->num_waiting >= extension->max_waiting) {
+        DEBUGMSGTL(( "nsExtendTable:async", "%s: too many waiting\n",
+                     extension->token ));
+        return -1;
+    }
+    dcache = netsnmp_create_delegated_cache(handler, reginfo, reqinfo,
+                                            request, extension->waiting);
+    if (!dcache)
+        return -1;
+    request->delegated = 1;
+    extension->waiting = dcache;
+    extension->num_waiting++;
+    return 0;
+}
+
+
         /*************************
          *
          *  Utility routines for setting up a new entry
@@ -433,6 +768,9 @@ _free_extension( netsnmp_extend *extension, extend_registration_block *ereg )
         netsnmp_table_data_remove_and_delete_row( ereg->dinfo, extension->row);
     }
 
+#ifdef EXTEND_ASYNC_SUPPORT
+    _extend_async_kill( extension );
+#endif
     SNMP_FREE( extension->token );
     SNMP_FREE( extension->cache );
     SNMP_FREE( extension->command );
@@ -457,6 +795,8 @@ _new_extension( char *exec_name, int exec_flags, extend_registration_block *ereg
         return NULL;
     extension->token    = strdup( exec_name );
     extension->flags    = exec_flags;
+    extension->timeout  = EXTEND_ASYNC_TIMEOUT;
+    extension->fd       = -1;
     extension->cache    = netsnmp_cache_create( 0, extend_load_cache,
                                                    extend_free_cache, NULL, 0 );
     if (extension->cache)
@@ -520,24 +860,39 @@ extend_parse_config(const char *token, char *cptr)
     int  flags;
     int cache_timeout = 0;
     int exec_type = NS_EXTEND_ETYPE_EXEC;
+    int async_flags = 0;
+    int async_timeout = EXTEND_ASYNC_TIMEOUT;
+    int max_waiting = 0;
+    char opt_str[32];
 
     cptr = copy_nword(cptr, exec_name, sizeof(exec_name));
-    if (strcmp(exec_name, "-cacheTime") == 0) {
-        char cache_timeout_str[32];
-
-        cptr = copy_nword(cptr, cache_timeout_str, sizeof(cache_timeout_str));
-        /* If atoi can't do the conversion, it returns 0 */
-        cache_timeout = atoi(cache_timeout_str);
-        cptr = copy_nword(cptr, exec_name, sizeof(exec_name));
-    }
-    if (strcmp(exec_name, "-execType") == 0) {
-        char exec_type_str[16];
-
-        cptr = copy_nword(cptr, exec_type_str, sizeof(exec_type_str));
-        if (strcmp(exec_type_str, "sh") == 0)
-            exec_type = NS_EXTEND_ETYPE_SHELL;
-        else
-            exec_type = NS_EXTEND_ETYPE_EXEC;
+    while (*exec_name == '-') {
+        if (strcmp(exec_name, "-cacheTime") == 0) {
+            cptr = copy_nword(cptr, opt_str, sizeof(opt_str));
+            /* If atoi can't do the conversion, it returns 0 */
+            cache_timeout = atoi(opt_str);
+        } else if (strcmp(exec_name, "-execType") == 0) {
+            cptr = copy_nword(cptr, opt_str, sizeof(opt_str));
+            if (strcmp(opt_str, "sh") == 0)
+                exec_type = NS_EXTEND_ETYPE_SHELL;
+            else
+                exec_type = NS_EXTEND_ETYPE_EXEC;
+        } else if (strcmp(exec_name, "-async") == 0) {
+            async_flags |= NS_EXTEND_FLAGS_ASYNC;
+        } else if (strcmp(exec_name, "-serveStale") == 0) {
+            async_flags |= NS_EXTEND_FLAGS_ASYNC | NS_EXTEND_FLAGS_STALE;
+        } else if (strcmp(exec_name, "-timeout") == 0) {
+            cptr = copy_nword(cptr, opt_str, sizeof(opt_str));
+            async_timeout = atoi(opt_str);
+        } else if (strcmp(exec_name, "-maxWaiting") == 0) {
+            cptr = copy_nword(cptr, opt_str, sizeof(opt_str));
+            max_waiting = atoi(opt_str);
+        } else
+            break;
+        if (!cptr) {
+            config_perror("ERROR: missing extension name");
+            return;
+        }
         cptr = copy_nword(cptr, exec_name, sizeof(exec_name));
     }
     if ( *exec_name == '.' ) {
@@ -558,7 +913,7 @@ extend_parse_config(const char *token, char *cptr)
     }
     cptr = copy_nword(cptr, exec_command, sizeof(exec_command));
     /* XXX - check 'exec_command' exists & is executable */
-    flags = (NS_EXTEND_FLAGS_ACTIVE | NS_EXTEND_FLAGS_CONFIG);
+    flags = (NS_EXTEND_FLAGS_ACTIVE | NS_EXTEND_FLAGS_CONFIG | async_flags);
     if (!strcmp( token, "sh"        ) ||
         !strcmp( token, "extend-sh" ) ||
         !strcmp( token, "sh2") ||
@@ -585,6 +940,8 @@ extend_parse_config(const char *token, char *cptr)
             extension->args = strdup( cptr );
         if (cache_timeout != 0)
             extension->cache->timeout = cache_timeout;
+        extension->timeout     = async_timeout;
+        extension->max_waiting = max_waiting;
     } else {
         snmp_log(LOG_ERR, "Failed to register extend entry '%s' - possibly duplicate name.\n", exec_name );
         return;
@@ -1036,7 +1393,7 @@ handle_nsExtendConfigTable(netsnmp_mib_handler          *handler,
                     extension->flags |=  NS_EXTEND_FLAGS_WRITEABLE;
                     break;
                 case 3:
-                    (void)netsnmp_cache_check_and_reload( extension->cache );
+                    (void)_extend_check_output( extension );
                     break;
                 }
                 break;
@@ -1107,6 +1464,64 @@ handle_nsExtendConfigTable(netsnmp_mib_handler          *handler,
 }
 
 
+/*
+ * Fill in one nsExtendOutput1Table value from an entry's output
+ */
+static int
+_extend_output1_value(netsnmp_agent_request_info *reqinfo,
+                      netsnmp_request_info       *request,
+                      netsnmp_extend             *extension)
+{
+    netsnmp_table_request_info *table_info;
+    int len;
+
+    table_info = netsnmp_extract_table_info( request );
+    switch (table_info->colnum) {
+    case COLUMN_EXTOUT1_OUTLEN:
+        snmp_set_var_typed_value(
+             request->requestvb, ASN_INTEGER,
+            (u_char*)&extension->out_len, sizeof(int));
+        break;
+    case COLUMN_EXTOUT1_OUTPUT1:
+        /* 
+         * If we've got more than one line,
+         * find the length of the first one.
+         * Otherwise find the length of the whole string.
+         */
+        if (extension->numlines > 1) {
+            len = (extension->lines[1])-(extension->output) -1;
+        } else if (extension->output) {
+            len = strlen(extension->output);
+        } else {
+            len = 0;
+        }
+        snmp_set_var_typed_value(
+             request->requestvb, ASN_OCTET_STR,
+             extension->output, len);
+        break;
+    case COLUMN_EXTOUT1_OUTPUT2:
+        snmp_set_var_typed_value(
+             request->requestvb, ASN_OCTET_STR,
+             extension->output,
+            (extension->output)?extension->out_len:0);
+        break;
+    case COLUMN_EXTOUT1_NUMLINES:
+        snmp_set_var_typed_value(
+             request->requestvb, ASN_INTEGER,
+            (u_char*)&extension->numlines, sizeof(int));
+        break;
+    case COLUMN_EXTOUT1_RESULT:
+        snmp_set_var_typed_value(
+             request->requestvb, ASN_INTEGER,
+            (u_char*)&extension->result, sizeof(int));
+        break;
+    default:
+        netsnmp_set_request_error(reqinfo, request, SNMP_NOSUCHOBJECT);
+        return SNMP_NOSUCHOBJECT;
+    }
+    return SNMP_ERR_NOERROR;
+}
+
 int
 handle_nsExtendOutput1Table(netsnmp_mib_handler          *handler,
                      netsnmp_handler_registration *reginfo,
@@ -1114,14 +1529,12 @@ handle_nsExtendOutput1Table(netsnmp_mib_handler          *handler,
                      netsnmp_request_info         *requests)
 {
     netsnmp_request_info       *request;
-    netsnmp_table_request_info *table_info;
     netsnmp_extend             *extension;
-    int len;
+    int rc;
 
     for ( request=requests; request; request=request->next ) {
         if (request->processed)
             continue;
-        table_info = netsnmp_extract_table_info( request );
         extension  = (netsnmp_extend*)netsnmp_extract_table_row_data( request );
 
         DEBUGMSGTL(( "nsExtendTable:output1", "varbind: "));
@@ -1139,15 +1552,27 @@ handle_nsExtendOutput1Table(netsnmp_mib_handler          *handler,
                                           SNMP_NOSUCHINSTANCE);
                 continue;
             }
-            if (!(extension->flags & NS_EXTEND_FLAGS_WRITEABLE) &&
-                (netsnmp_cache_check_and_reload( extension->cache ) < 0 )) {
-                /*
-                 * If reloading the output cache of a 'run-on-read'
-                 * entry fails, then skip it.
-                 */
-                netsnmp_set_request_error(reqinfo, request,
-                                          SNMP_NOSUCHINSTANCE);
-                continue;
+            if (!(extension->flags & NS_EXTEND_FLAGS_WRITEABLE)) {
+                rc = _extend_check_output( extension );
+                if (rc > 0 || (rc == 0 && _extend_must_wait( extension ))) {
+                    /*
+                     * An asynchronous run is in progress,
+                     * so answer this once it's finished.
+                     */
+                    if (_extend_wait_output( extension, handler, reginfo,
+                                             reqinfo, request ) == 0)
+                        continue;
+                    rc = -1;
+                }
+                if (rc != 0) {
+                    /*
+                     * If reloading the output cache of a 'run-on-read'
+                     * entry fails, then skip it.
+                     */
+                    netsnmp_set_request_error(reqinfo, request,
+                                              SNMP_NOSUCHINSTANCE);
+                    continue;
+                }
             }
             if ((extension->flags & NS_EXTEND_FLAGS_WRITEABLE) &&
                 (netsnmp_cache_check_expired( extension->cache ) == 1 )) {
@@ -1159,50 +1584,7 @@ handle_nsExtendOutput1Table(netsnmp_mib_handler          *handler,
                                           SNMP_NOSUCHINSTANCE);
                 continue;
             }
-
-            switch (table_info->colnum) {
-            case COLUMN_EXTOUT1_OUTLEN:
-                snmp_set_var_typed_value(
-                     request->requestvb, ASN_INTEGER,
-                    (u_char*)&extension->out_len, sizeof(int));
-                break;
-            case COLUMN_EXTOUT1_OUTPUT1:
-                /* 
-                 * If we've got more than one line,
-                 * find the length of the first one.
-                 * Otherwise find the length of the whole string.
-                 */
-                if (extension->numlines > 1) {
-                    len = (extension->lines[1])-(extension->output) -1;
-                } else if (extension->output) {
-                    len = strlen(extension->output);
-                } else {
-                    len = 0;
-                }
-                snmp_set_var_typed_value(
-                     request->requestvb, ASN_OCTET_STR,
-                     extension->output, len);
-                break;
-            case COLUMN_EXTOUT1_OUTPUT2:
-                snmp_set_var_typed_value(
-                     request->requestvb, ASN_OCTET_STR,
-                     extension->output,
-                    (extension->output)?extension->out_len:0);
-                break;
-            case COLUMN_EXTOUT1_NUMLINES:
-                snmp_set_var_typed_value(
-                     request->requestvb, ASN_INTEGER,
-                    (u_char*)&extension->numlines, sizeof(int));
-                break;
-            case COLUMN_EXTOUT1_RESULT:
-                snmp_set_var_typed_value(
-                     request->requestvb, ASN_INTEGER,
-                    (u_char*)&extension->result, sizeof(int));
-                break;
-            default:
-                netsnmp_set_request_error(reqinfo, request, SNMP_NOSUCHOBJECT);
-                continue;
-            }
+            _extend_output1_value( reqinfo, request, extension );
             break;
         default:
             netsnmp_set_request_error(reqinfo, request, SNMP_ERR_GENERR);
@@ -1264,7 +1646,7 @@ _extend_find_entry( netsnmp_request_info       *request,
              * Ensure the output is available...
              */
             if (!(eptr->flags & NS_EXTEND_FLAGS_ACTIVE) ||
-               (netsnmp_cache_check_and_reload( eptr->cache ) < 0 ))
+               (_extend_check_output( eptr ) != 0 ))
                 return NULL;
 
             /*
@@ -1288,7 +1670,7 @@ _extend_find_entry( netsnmp_request_info       *request,
              */
             for (eptr = ereg->ehead; eptr; eptr = eptr->next ) {
                 if ((eptr->flags & NS_EXTEND_FLAGS_ACTIVE) &&
-                    (netsnmp_cache_check_and_reload( eptr->cache ) >= 0 )) {
+                    (_extend_check_output( eptr ) == 0 )) {
                     line_idx = 1;
                     break;
                 }
@@ -1319,7 +1701,7 @@ _extend_find_entry( netsnmp_request_info       *request,
              */
             for (    ; eptr; eptr = eptr->next ) {
                 if ((eptr->flags & NS_EXTEND_FLAGS_ACTIVE) &&
-                    (netsnmp_cache_check_and_reload( eptr->cache ) >= 0 )) {
+                    (_extend_check_output( eptr ) == 0 )) {
                     break;
                 }
                 line_idx = 1;
@@ -1341,7 +1723,7 @@ _extend_find_entry( netsnmp_request_info       *request,
                     line_idx = 1;
                     for (eptr = eptr->next ; eptr; eptr = eptr->next ) {
                         if ((eptr->flags & NS_EXTEND_FLAGS_ACTIVE) &&
-                            (netsnmp_cache_check_and_reload( eptr->cache ) >= 0 )) {
+                            (_extend_check_output( eptr ) == 0 )) {
                             break;
                         }
                     }
@@ -1540,11 +1922,11 @@ var_extensible_old(struct variable * vp,
             *var_len = strlen(cmdline);
         return (u_char *) cmdline;
     case ERRORFLAG:        /* return code from the process */
-        netsnmp_cache_check_and_reload( exten->exec_entry->cache );
+        (void)_extend_check_output( exten->exec_entry );
         long_ret = exten->exec_entry->result;
         return (u_char *) &long_ret;
     case ERRORMSG:         /* first line of text returned from the process */
-        netsnmp_cache_check_and_reload( exten->exec_entry->cache );
+        (void)_extend_check_output( exten->exec_entry );
         if (exten->exec_entry->numlines > 1) {
             *var_len = (exten->exec_entry->lines[1])-
                 (exten->exec_entry->output) -1;
@@ -21,6 +21,16 @@ typedef struct netsnmp_extend_s {
     int      result;
 
     int      flags;
+    int      timeout;       /* seconds before an async run is killed */
+    int      max_waiting;   /* requests that may wait on an async run */
+    int      num_waiting;
+    netsnmp_delegated_cache *waiting;
+    int      pid;           /* async run in progress (or 0) */
+    int      fd;
+    char    *abuf;
+    int      alen;
+    unsigned int timer_id;
+    unsigned int reap_id;
     netsnmp_cache     *cache;
     netsnmp_table_row *row;
     netsnmp_table_data *dinfo;
@@ -61,6 +71,8 @@ void                 extend_parse_config(const char*, char*);
 #define NS_EXTEND_FLAGS_SHELL       0x02
 #define NS_EXTEND_FLAGS_WRITEABLE   0x04
 #define NS_EXTEND_FLAGS_CONFIG      0x08
+#define NS_EXTEND_FLAGS_ASYNC       0x10
+#define NS_EXTEND_FLAGS_STALE       0x20
 
 #define NS_EXTEND_ETYPE_EXEC    1
 #define NS_EXTEND_ETYPE_SHELL   2
@@ -329,12 +329,13 @@ nsVacmAccessTable_handler(netsnmp_mib_handler *handler,
 
             switch (table_info->colnum) {
             case COLUMN_NSVACMCONTEXTMATCH:
-                entry->contextMatch = *request->requestvb->val.integer;
+                vacm_setAccessContextMatch(entry,
+                                         *request->requestvb->val.integer);
                 break;
             case COLUMN_NSVACMVIEWNAME:
-                memset( entry->views[viewIdx], 0, VACMSTRINGLEN );
-                memcpy( entry->views[viewIdx], request->requestvb->val.string,
-                                               request->requestvb->val_len);
+                vacm_setAccessView(entry, viewIdx,
+                                   (char *)request->requestvb->val.string,
+                                   request->requestvb->val_len);
                 break;
             case COLUMN_VACMACCESSSTORAGETYPE:
                 entry->storageType = *request->requestvb->val.integer;
@@ -342,7 +343,7 @@ nsVacmAccessTable_handler(netsnmp_mib_handler *handler,
             case COLUMN_NSVACMACCESSSTATUS:
                 switch (*request->requestvb->val.integer) {
                 case RS_DESTROY:
-                    memset( entry->views[viewIdx], 0, VACMSTRINGLEN );
+                    vacm_setAccessView(entry, viewIdx, "", 0);
                     break;
                 }
                 break;
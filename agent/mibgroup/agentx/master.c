@@ -50,6 +50,7 @@
 #include "snmpd.h"
 #include "agentx/protocol.h"
 #include "agentx/master_admin.h"
+#include "agentx/master_stats.h"
 
 netsnmp_feature_require(handler_mark_requests_as_delegated);
 netsnmp_feature_require(unix_socket_paths);
@@ -203,6 +204,93 @@ real_init_master(void)
     DEBUGMSGTL(("agentx/master", "initializing...   DONE\n"));
 }
 
+/*
+ * Copy one answer from a subagent back into the original request
+ */
+static void
+_agentx_update_request(netsnmp_request_info *request,
+                       netsnmp_variable_list *var)
+{
+    DEBUGMSGTL(("agentx/master",
+                "  handle_agentx_response: processing: "));
+    DEBUGMSGOID(("agentx/master", var->name, var->name_length));
+    DEBUGMSG(("agentx/master", "\n"));
+    if (netsnmp_ds_get_boolean(NETSNMP_DS_APPLICATION_ID, NETSNMP_DS_AGENT_VERBOSE)) {
+        DEBUGMSGTL(("agentx/master", "    >> "));
+        DEBUGMSGVAR(("agentx/master", var));
+        DEBUGMSG(("agentx/master", "\n"));
+    }
+
+    /*
+     * update the oid in the original request 
+     */
+    if (var->type != SNMP_ENDOFMIBVIEW) {
+        snmp_set_var_typed_value(request->requestvb, var->type,
+                                 var->val.string, var->val_len);
+        snmp_set_var_objid(request->requestvb, var->name,
+                           var->name_length);
+    }
+    request->delegated = REQUEST_IS_NOT_DELEGATED;
+}
+
+/*
+ * Merge the answer to a GETBULK back into the requests.  The varbinds
+ * were sent with the requests that have no repeats left first (see
+ * agentx_master_handler), so the response holds one answer for each of
+ * those, followed by rows of one answer per repeating request.  Each
+ * repeating request takes answers from its column until it runs out of
+ * repeats, of answers or of its search range; whatever is left is asked
+ * for again on the next pass of the getnext loop.
+ *
+ * Returns 0 if the response doesn't cover every request.
+ */
+static int
+_agentx_bulk_response(netsnmp_request_info *requests,
+                      netsnmp_variable_list *vars)
+{
+    netsnmp_request_info *request;
+    netsnmp_variable_list *var = vars, *col;
+    int             i, repeaters = 0;
+
+    for (request = requests; request; request = request->next) {
+        if (request->repeat > 0) {
+            repeaters++;
+            continue;
+        }
+        if (!var)
+            return 0;
+        _agentx_update_request(request, var);
+        var = var->next_variable;
+    }
+    if (!repeaters)
+        return var == NULL;
+
+    for (request = requests, col = var; request; request = request->next) {
+        if (request->repeat <= 0)
+            continue;
+        if (!col)
+            return 0;
+        for (var = col; var; ) {
+            _agentx_update_request(request, var);
+            if (var->type == SNMP_ENDOFMIBVIEW) {
+                /*
+                 * nothing more in range here; let the agent move on to
+                 * the next subtree rather than asking this one again
+                 */
+                snmp_set_var_typed_value(request->requestvb, ASN_NULL,
+                                         NULL, 0);
+                break;
+            }
+            if (!netsnmp_bulk_to_next_fix_request(request))
+                break;
+            for (i = 0; var && i < repeaters; i++)
+                var = var->next_variable;
+        }
+        col = col->next_variable;
+    }
+    return 1;
+}
+
         /*
          * Handle the response from an AgentX subagent,
          *   merging the answers back into the original query
@@ -218,6 +306,8 @@ agentx_got_response(int operation,
     netsnmp_variable_list *var;
     netsnmp_session *ax_session;
 
+    agentx_stats_update(operation, session, reqid);
+
     cache = netsnmp_handler_check_cache(cache);
     if (!cache) {
         DEBUGMSGTL(("agentx/master", "response too late on session %8p\n",
@@ -372,46 +462,32 @@ agentx_got_response(int operation,
          */
         DEBUGMSGTL(("agentx/master",
                     "agentx_got_response() beginning...\n"));
-        for (var = pdu->variables, request = requests; request && var;
-             request = request->next, var = var->next_variable) {
-            /*
-             * Otherwise, process successful requests
-             */
-            DEBUGMSGTL(("agentx/master",
-                        "  handle_agentx_response: processing: "));
-            DEBUGMSGOID(("agentx/master", var->name, var->name_length));
-            DEBUGMSG(("agentx/master", "\n"));
-            if (netsnmp_ds_get_boolean(NETSNMP_DS_APPLICATION_ID, NETSNMP_DS_AGENT_VERBOSE)) {
-                DEBUGMSGTL(("agentx/master", "    >> "));
-                DEBUGMSGVAR(("agentx/master", var));
-                DEBUGMSG(("agentx/master", "\n"));
+        if (cache->reqinfo->mode == MODE_GETBULK) {
+            if (!_agentx_bulk_response(requests, pdu->variables)) {
+                snmp_log(LOG_ERR,
+                         "response to agentx request illegal.  bailing out.\n");
+                netsnmp_handler_mark_requests_as_delegated(requests,
+                                               REQUEST_IS_NOT_DELEGATED);
+                netsnmp_set_request_error(cache->reqinfo, requests,
+                                          SNMP_ERR_GENERR);
             }
+        } else {
+            for (var = pdu->variables, request = requests; request && var;
+                 request = request->next, var = var->next_variable)
+                _agentx_update_request(request, var);
 
-            /*
-             * update the oid in the original request 
-             */
-            if (var->type != SNMP_ENDOFMIBVIEW) {
-                snmp_set_var_typed_value(request->requestvb, var->type,
-                                         var->val.string, var->val_len);
-                snmp_set_var_objid(request->requestvb, var->name,
-                                   var->name_length);
+            if (request || var) {
+                /*
+                 * ack, this is bad.  The # of varbinds don't match and
+                 * there is no way to fix the problem 
+                 */
+                snmp_log(LOG_ERR,
+                         "response to agentx request illegal.  bailing out.\n");
+                netsnmp_set_request_error(cache->reqinfo, requests,
+                                          SNMP_ERR_GENERR);
             }
-            request->delegated = REQUEST_IS_NOT_DELEGATED;
-        }
-
-        if (request || var) {
-            /*
-             * ack, this is bad.  The # of varbinds don't match and
-             * there is no way to fix the problem 
-             */
-            snmp_log(LOG_ERR,
-                     "response to agentx request illegal.  bailing out.\n");
-            netsnmp_set_request_error(cache->reqinfo, requests,
-                                      SNMP_ERR_GENERR);
         }
 
-        if (cache->reqinfo->mode == MODE_GETBULK)
-            netsnmp_bulk_to_next_fix_requests(requests);
     } else {
         /*
          * mark set requests as handled 
@@ -426,6 +502,74 @@ agentx_got_response(int operation,
     return 1;
 }
 
+/*
+ * Add the search range or value for one request to an AgentX PDU
+ */
+static void
+_agentx_add_request(netsnmp_pdu *pdu, netsnmp_agent_request_info *reqinfo,
+                    netsnmp_request_info *request)
+{
+    size_t nlen = request->requestvb->name_length;
+    oid   *nptr = request->requestvb->name;
+    
+    DEBUGMSGTL(("agentx/master","request for variable ("));
+    DEBUGMSGOID(("agentx/master", nptr, nlen));
+    DEBUGMSG(("agentx/master", ")\n"));
+
+    if (reqinfo->mode == MODE_GETNEXT || reqinfo->mode == MODE_GETBULK) {
+
+        if (snmp_oid_compare(nptr, nlen, request->subtree->start_a,
+                             request->subtree->start_len) < 0) {
+            DEBUGMSGTL(("agentx/master","inexact request preceding region ("));
+            DEBUGMSGOID(("agentx/master", request->subtree->start_a,
+                         request->subtree->start_len));
+            DEBUGMSG(("agentx/master", ")\n"));
+            nptr = request->subtree->start_a;
+            nlen = request->subtree->start_len;
+            request->inclusive = 1;
+        }
+
+        if (request->inclusive) {
+            DEBUGMSGTL(("agentx/master", "INCLUSIVE varbind "));
+            DEBUGMSGOID(("agentx/master", nptr, nlen));
+            DEBUGMSG(("agentx/master", " scoped to "));
+            DEBUGMSGOID(("agentx/master", request->range_end,
+                         request->range_end_len));
+            DEBUGMSG(("agentx/master", "\n"));
+            snmp_pdu_add_variable(pdu, nptr, nlen, ASN_PRIV_INCL_RANGE,
+                                  (u_char *) request->range_end,
+                                  request->range_end_len *
+                                  sizeof(oid));
+            request->inclusive = 0;
+        } else {
+            DEBUGMSGTL(("agentx/master", "EXCLUSIVE varbind "));
+            DEBUGMSGOID(("agentx/master", nptr, nlen));
+            DEBUGMSG(("agentx/master", " scoped to "));
+            DEBUGMSGOID(("agentx/master", request->range_end,
+                         request->range_end_len));
+            DEBUGMSG(("agentx/master", "\n"));
+            snmp_pdu_add_variable(pdu, nptr, nlen, ASN_PRIV_EXCL_RANGE,
+                                  (u_char *) request->range_end,
+                                  request->range_end_len *
+                                  sizeof(oid));
+        }
+    } else {
+        snmp_pdu_add_variable(pdu, request->requestvb->name,
+                              request->requestvb->name_length,
+                              request->requestvb->type,
+                              request->requestvb->val.string,
+                              request->requestvb->val_len);
+    }
+
+    /*
+     * mark the request as delayed 
+     */
+    if (pdu->command != AGENTX_MSG_CLEANUPSET)
+        request->delegated = REQUEST_IS_DELEGATED;
+    else
+        request->delegated = REQUEST_IS_NOT_DELEGATED;
+}
+
 /*
  *
  * AgentX State diagram.  [mode] = internal mode it's mapped from:
@@ -446,10 +590,11 @@ agentx_master_handler(netsnmp_mib_handler *handler,
                       netsnmp_request_info *requests)
 {
     netsnmp_session *ax_session = (netsnmp_session *) handler->myvoid;
-    netsnmp_request_info *request = requests;
+    netsnmp_request_info *request;
     netsnmp_pdu    *pdu;
     void           *cb_data;
-    int             result;
+    int             result, non_repeaters = 0, max_repeat = 0;
+    long            reqid;
 
     DEBUGMSGTL(("agentx/master",
                 "agentx master handler starting, mode = 0x%02x\n",
@@ -472,8 +617,28 @@ agentx_master_handler(netsnmp_mib_handler *handler,
         pdu = snmp_pdu_create(AGENTX_MSG_GETNEXT);
         break;
 
-    case MODE_GETBULK:         /* WWWXXX */
-        pdu = snmp_pdu_create(AGENTX_MSG_GETNEXT);
+    case MODE_GETBULK:
+        /*
+         * Forward the repetitions still owed as a single GetBulk rather
+         * than one GetNext round trip per repetition.  Requests down to
+         * their last repetition are sent as non-repeaters; if that is
+         * all of them a GetNext does the same job.
+         */
+        for (request = requests; request; request = request->next) {
+            if (request->repeat <= 0)
+                non_repeaters++;
+            else if (request->repeat > max_repeat)
+                max_repeat = request->repeat;
+        }
+        if (max_repeat == 0) {
+            pdu = snmp_pdu_create(AGENTX_MSG_GETNEXT);
+            break;
+        }
+        pdu = snmp_pdu_create(AGENTX_MSG_GETBULK);
+        if (pdu) {
+            pdu->non_repeaters = non_repeaters;
+            pdu->max_repetitions = SNMP_MIN(max_repeat + 1, 0xffff);
+        }
         break;
 
 #ifndef NETSNMP_NO_WRITE_SUPPORT
@@ -525,76 +690,19 @@ agentx_master_handler(netsnmp_mib_handler *handler,
     if (ax_session->subsession->flags & AGENTX_MSG_FLAG_NETWORK_BYTE_ORDER)
         pdu->flags |= AGENTX_MSG_FLAG_NETWORK_BYTE_ORDER;
 
-    while (request) {
-
-        size_t nlen = request->requestvb->name_length;
-        oid   *nptr = request->requestvb->name;
-        
-        DEBUGMSGTL(("agentx/master","request for variable ("));
-        DEBUGMSGOID(("agentx/master", nptr, nlen));
-        DEBUGMSG(("agentx/master", ")\n"));
-        
+    if (pdu->command == AGENTX_MSG_GETBULK) {
         /*
-         * loop through all the requests and create agentx ones out of them 
+         * the GetBulk PDU wants its non-repeaters first 
          */
-
-        if (reqinfo->mode == MODE_GETNEXT || reqinfo->mode == MODE_GETBULK) {
-
-            if (snmp_oid_compare(nptr, nlen, request->subtree->start_a,
-                                 request->subtree->start_len) < 0) {
-                DEBUGMSGTL(("agentx/master","inexact request preceding region ("));
-                DEBUGMSGOID(("agentx/master", request->subtree->start_a,
-                             request->subtree->start_len));
-                DEBUGMSG(("agentx/master", ")\n"));
-                nptr = request->subtree->start_a;
-                nlen = request->subtree->start_len;
-                request->inclusive = 1;
-            }
-
-            if (request->inclusive) {
-                DEBUGMSGTL(("agentx/master", "INCLUSIVE varbind "));
-                DEBUGMSGOID(("agentx/master", nptr, nlen));
-                DEBUGMSG(("agentx/master", " scoped to "));
-                DEBUGMSGOID(("agentx/master", request->range_end,
-                             request->range_end_len));
-                DEBUGMSG(("agentx/master", "\n"));
-                snmp_pdu_add_variable(pdu, nptr, nlen, ASN_PRIV_INCL_RANGE,
-                                      (u_char *) request->range_end,
-                                      request->range_end_len *
-                                      sizeof(oid));
-                request->inclusive = 0;
-            } else {
-                DEBUGMSGTL(("agentx/master", "EXCLUSIVE varbind "));
-                DEBUGMSGOID(("agentx/master", nptr, nlen));
-                DEBUGMSG(("agentx/master", " scoped to "));
-                DEBUGMSGOID(("agentx/master", request->range_end,
-                             request->range_end_len));
-                DEBUGMSG(("agentx/master", "\n"));
-                snmp_pdu_add_variable(pdu, nptr, nlen, ASN_PRIV_EXCL_RANGE,
-                                      (u_char *) request->range_end,
-                                      request->range_end_len *
-                                      sizeof(oid));
-            }
-        } else {
-            snmp_pdu_add_variable(pdu, request->requestvb->name,
-                                  request->requestvb->name_length,
-                                  request->requestvb->type,
-                                  request->requestvb->val.string,
-                                  request->requestvb->val_len);
-        }
-
-        /*
-         * mark the request as delayed 
-         */
-        if (pdu->command != AGENTX_MSG_CLEANUPSET)
-            request->delegated = REQUEST_IS_DELEGATED;
-        else
-            request->delegated = REQUEST_IS_NOT_DELEGATED;
-
-        /*
-         * next... 
-         */
-        request = request->next;
+        for (request = requests; request; request = request->next)
+            if (request->repeat <= 0)
+                _agentx_add_request(pdu, reqinfo, request);
+        for (request = requests; request; request = request->next)
+            if (request->repeat > 0)
+                _agentx_add_request(pdu, reqinfo, request);
+    } else {
+        for (request = requests; request; request = request->next)
+            _agentx_add_request(pdu, reqinfo, request);
     }
 
     /*
@@ -614,9 +722,13 @@ agentx_master_handler(netsnmp_mib_handler *handler,
      */
     DEBUGMSGTL(("agentx/master", "sending pdu (req=0x%x,trans=0x%x,sess=0x%x)\n",
                 (unsigned)pdu->reqid, (unsigned)pdu->transid, (unsigned)pdu->sessid));
+    reqid = pdu->reqid;
+    agentx_stats_set_timeout(ax_session);
     result = snmp_async_send(ax_session, pdu, agentx_got_response, cb_data);
     if (result == 0) {
         snmp_free_pdu(pdu);
+    } else if (cb_data) {
+        agentx_stats_sent(ax_session, reqid);
     }
 
     return SNMP_ERR_NOERROR;
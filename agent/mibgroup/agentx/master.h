@@ -6,6 +6,7 @@ config_belongs_in(agent_module)
 config_require(agentx/protocol)
 config_require(agentx/master_admin)
 config_require(agentx/agentx_config)
+config_require(agentx/master_stats)
 
      void            init_master(void);
      void            real_init_master(void);
@@ -38,6 +38,7 @@
 #include "agentx/client.h"
 #include "agentx/subagent.h"
 #include "agentx/master_admin.h"
+#include "agentx/master_stats.h"
 
 #include <net-snmp/agent/agent_index.h>
 #include <net-snmp/agent/agent_trap.h>
@@ -116,6 +117,7 @@ open_agentx_session(netsnmp_session * session, netsnmp_pdu *pdu)
     session->subsession = sp;
     DEBUGMSGTL(("agentx/master", "opened %8p = %ld with flags = %02lx\n",
                 sp, sp->sessid, sp->flags & AGENTX_MSG_FLAGS_MASK));
+    agentx_stats_open(session, sp);
 
     return sp->sessid;
 }
@@ -152,6 +154,7 @@ close_agentx_session(netsnmp_session * session, int sessid)
         unregister_mibs_by_session(session);
         unregister_index_by_session(session);
         unregister_sysORTable_by_session(session);
+        agentx_stats_close(session, -1);
 	SNMP_FREE(session->myvoid);
         return AGENTX_ERR_NOERROR;
     }
@@ -165,6 +168,7 @@ close_agentx_session(netsnmp_session * session, int sessid)
             unregister_mibs_by_session(sp);
             unregister_index_by_session(sp);
             unregister_sysORTable_by_session(sp);
+            agentx_stats_close(session, sessid);
 
             *prevNext = sp->next;
 
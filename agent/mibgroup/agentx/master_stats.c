@@ -0,0 +1,417 @@
+/*
+ *  AgentX master agent: per-subagent statistics and adaptive timeouts
+ *
+ *  The master agent keeps, for each open AgentX session, the requests
+ *  still waiting for an answer, a smoothed round trip time and a
+ *  latency histogram.  These are shown in NET-SNMP-AGENT-MIB's
+ *  nsAgentxStatsTable, and the round trip time is used to choose how
+ *  long to wait for the next request on that session: the configured
+ *  agentxTimeout (or the timeout the subagent asked for in its Open
+ *  PDU, if that is longer), stretched to srtt + 4 * rttvar for a
+ *  subagent that is usually slower than that.  A timeout still drops
+ *  the subagent (see agentx_got_response()), so this keeps a busy but
+ *  healthy subagent from being disconnected by one slow table walk.
+ */
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-features.h>
+
+#include <sys/types.h>
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#if TIME_WITH_SYS_TIME
+# include <sys/time.h>
+# include <time.h>
+#else
+# if HAVE_SYS_TIME_H
+#  include <sys/time.h>
+# else
+#  include <time.h>
+# endif
+#endif
+
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/agent/table.h>
+#include <net-snmp/agent/table_iterator.h>
+
+#include "snmpd.h"
+#include "agentx/master_stats.h"
+
+#define AGENTX_LATENCY_BUCKETS  5
+#define AGENTX_MAX_TIMEOUT      (255L * 1000L * 1000L)  /* usec */
+
+typedef struct agentx_pending_s {
+    long            reqid;
+    struct timeval  sent;
+    int             resent;
+} agentx_pending;
+
+typedef struct agentx_stats_s {
+    struct agentx_stats_s *next;
+    netsnmp_session *session;   /* the subagent's connection */
+    u_long          sessid;
+    char           *descr;
+    long            base_timeout;       /* usec */
+
+    u_long          requests;
+    u_long          responses;
+    u_long          timeouts;
+    u_long          latency[AGENTX_LATENCY_BUCKETS];
+
+    long            srtt;       /* usec; 0 until the first answer */
+    long            rttvar;     /* usec */
+
+    agentx_pending *pending;
+    int             npending;
+    int             maxpending;
+} agentx_stats;
+
+static agentx_stats *agentx_stats_list = NULL;
+
+/*
+ * The entry for the AgentX session requests on a connection are sent
+ * as (see agentx_master_handler)
+ */
+static agentx_stats *
+_stats_for_session(netsnmp_session *session)
+{
+    agentx_stats   *st;
+
+    if (!session || !session->subsession)
+        return NULL;
+    for (st = agentx_stats_list; st; st = st->next)
+        if (st->session == session &&
+            st->sessid == (u_long)session->subsession->sessid)
+            return st;
+    return NULL;
+}
+
+/*
+ * How long to wait for one try of the next request to this subagent
+ */
+static long
+_stats_timeout(agentx_stats *st)
+{
+    long            rto = st->srtt + 4 * st->rttvar;
+
+    if (rto <= st->base_timeout)
+        return st->base_timeout;
+    return SNMP_MIN(rto, AGENTX_MAX_TIMEOUT);
+}
+
+void
+agentx_stats_open(netsnmp_session *session, netsnmp_session *sp)
+{
+    agentx_stats   *st, **prevNext;
+
+    st = SNMP_MALLOC_TYPEDEF(agentx_stats);
+    if (!st)
+        return;
+    st->session = session;
+    st->sessid = sp->sessid;
+    st->descr = strdup(sp->securityName ? sp->securityName : "");
+    st->base_timeout = netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                                          NETSNMP_DS_AGENT_AGENTX_TIMEOUT);
+    /*
+     * the subagent's own timeout from its Open PDU is in seconds
+     */
+    if (sp->timeout > 0 && sp->timeout * 1000L * 1000L > st->base_timeout)
+        st->base_timeout = SNMP_MIN(sp->timeout * 1000L * 1000L,
+                                    AGENTX_MAX_TIMEOUT);
+
+    /*
+     * session ids only grow, so appending keeps the list sorted
+     */
+    for (prevNext = &agentx_stats_list; *prevNext;
+         prevNext = &(*prevNext)->next)
+        ;
+    *prevNext = st;
+    DEBUGMSGTL(("agentx/master/stats", "session %lu (%s), timeout %ld\n",
+                st->sessid, st->descr, st->base_timeout));
+}
+
+/*
+ * Forget one session, or with sessid == -1 every session on a connection
+ */
+void
+agentx_stats_close(netsnmp_session *session, int sessid)
+{
+    agentx_stats   *st, **prevNext = &agentx_stats_list;
+
+    while ((st = *prevNext) != NULL) {
+        if (st->session == session &&
+            (sessid == -1 || st->sessid == (u_long)sessid)) {
+            *prevNext = st->next;
+            SNMP_FREE(st->pending);
+            SNMP_FREE(st->descr);
+            free(st);
+        } else
+            prevNext = &st->next;
+    }
+}
+
+/*
+ * Set up the connection's timeout for the next request
+ */
+void
+agentx_stats_set_timeout(netsnmp_session *session)
+{
+    agentx_stats   *st = _stats_for_session(session);
+
+    if (st)
+        session->timeout = _stats_timeout(st);
+}
+
+void
+agentx_stats_sent(netsnmp_session *session, long reqid)
+{
+    agentx_stats   *st = _stats_for_session(session);
+    agentx_pending *p;
+
+    if (!st)
+        return;
+    if (st->npending == st->maxpending) {
+        int             n = st->maxpending ? 2 * st->maxpending : 8;
+
+        p = (agentx_pending *) realloc(st->pending, n * sizeof(*p));
+        if (!p)
+            return;
+        st->pending = p;
+        st->maxpending = n;
+    }
+    p = &st->pending[st->npending++];
+    p->reqid = reqid;
+    p->resent = 0;
+    netsnmp_get_monotonic_clock(&p->sent);
+    st->requests++;
+}
+
+static void
+_stats_answered(agentx_stats *st, agentx_pending *p)
+{
+    struct timeval  now;
+    long            rtt, delta;
+    int             bucket;
+
+    netsnmp_get_monotonic_clock(&now);
+    rtt = (now.tv_sec - p->sent.tv_sec) * 1000000L +
+        (now.tv_usec - p->sent.tv_usec);
+    if (rtt < 0)
+        rtt = 0;
+
+    st->responses++;
+    for (bucket = 0, delta = 1000; bucket < AGENTX_LATENCY_BUCKETS - 1 &&
+         rtt >= delta; bucket++, delta *= 10)
+        ;
+    st->latency[bucket]++;
+
+    /*
+     * Only first tries give an unambiguous round trip time (Karn)
+     */
+    if (p->resent)
+        return;
+    if (!st->srtt) {
+        st->srtt = rtt;
+        st->rttvar = rtt / 2;
+    } else {
+        delta = st->srtt > rtt ? st->srtt - rtt : rtt - st->srtt;
+        st->rttvar = (3 * st->rttvar + delta) / 4;
+        st->srtt = (7 * st->srtt + rtt) / 8;
+    }
+    if (!st->srtt)
+        st->srtt = 1;
+}
+
+/*
+ * Account for a callback from agentx_got_response()
+ */
+void
+agentx_stats_update(int operation, netsnmp_session *session, long reqid)
+{
+    agentx_stats   *st;
+    agentx_pending *p = NULL;
+
+    for (st = agentx_stats_list; st; st = st->next) {
+        int             i;
+
+        if (st->session != session)
+            continue;
+        for (i = 0; i < st->npending; i++)
+            if (st->pending[i].reqid == reqid) {
+                p = &st->pending[i];
+                break;
+            }
+        if (p)
+            break;
+    }
+    if (!p)
+        return;
+
+    switch (operation) {
+    case NETSNMP_CALLBACK_OP_RESEND:
+        p->resent = 1;
+        return;
+
+    case NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE:
+        _stats_answered(st, p);
+        break;
+
+    case NETSNMP_CALLBACK_OP_TIMED_OUT:
+        st->timeouts++;
+        break;
+
+    default:
+        break;
+    }
+
+    *p = st->pending[--st->npending];
+}
+
+/*
+ * nsAgentxStatsTable
+ */
+void
+init_master_stats(void)
+{
+    const oid       nsAgentxStatsTable_oid[] =
+        { 1, 3, 6, 1, 4, 1, 8072, 1, 10, 1 };
+    netsnmp_table_registration_info *table_info;
+    netsnmp_handler_registration *my_handler;
+    netsnmp_iterator_info *iinfo;
+
+    if (netsnmp_ds_get_boolean(NETSNMP_DS_APPLICATION_ID,
+                               NETSNMP_DS_AGENT_ROLE) != MASTER_AGENT)
+        return;
+
+    table_info = SNMP_MALLOC_TYPEDEF(netsnmp_table_registration_info);
+    iinfo = SNMP_MALLOC_TYPEDEF(netsnmp_iterator_info);
+    my_handler = netsnmp_create_handler_registration(
+        "nsAgentxStatsTable", nsAgentxStatsTable_handler,
+        nsAgentxStatsTable_oid, OID_LENGTH(nsAgentxStatsTable_oid),
+        HANDLER_CAN_RONLY);
+
+    if (!my_handler || !table_info || !iinfo) {
+        if (my_handler)
+            netsnmp_handler_registration_free(my_handler);
+        SNMP_FREE(table_info);
+        SNMP_FREE(iinfo);
+        return;
+    }
+
+    netsnmp_table_helper_add_index(table_info, ASN_UNSIGNED);
+    table_info->min_column = COLUMN_NSAGENTXSESSIONDESCR;
+    table_info->max_column = COLUMN_NSAGENTXLATENCYOVER1S;
+    iinfo->get_first_data_point = nsAgentxStatsTable_get_first_data_point;
+    iinfo->get_next_data_point = nsAgentxStatsTable_get_next_data_point;
+    iinfo->table_reginfo = table_info;
+
+    DEBUGMSGTL(("agentx/master/stats",
+                "Registering table nsAgentxStatsTable as a table iterator\n"));
+    netsnmp_register_table_iterator2(my_handler, iinfo);
+}
+
+netsnmp_variable_list *
+nsAgentxStatsTable_get_first_data_point(void **my_loop_context,
+                                        void **my_data_context,
+                                        netsnmp_variable_list *
+                                        put_index_data,
+                                        netsnmp_iterator_info *iinfo)
+{
+    *my_loop_context = agentx_stats_list;
+    return nsAgentxStatsTable_get_next_data_point(my_loop_context,
+                                                  my_data_context,
+                                                  put_index_data, iinfo);
+}
+
+netsnmp_variable_list *
+nsAgentxStatsTable_get_next_data_point(void **my_loop_context,
+                                       void **my_data_context,
+                                       netsnmp_variable_list *
+                                       put_index_data,
+                                       netsnmp_iterator_info *iinfo)
+{
+    agentx_stats   *st = (agentx_stats *) * my_loop_context;
+
+    if (!st)
+        return NULL;
+
+    snmp_set_var_typed_integer(put_index_data, ASN_UNSIGNED, st->sessid);
+    *my_data_context = st;
+    *my_loop_context = st->next;
+    return put_index_data;
+}
+
+int
+nsAgentxStatsTable_handler(netsnmp_mib_handler *handler,
+                           netsnmp_handler_registration *reginfo,
+                           netsnmp_agent_request_info *reqinfo,
+                           netsnmp_request_info *requests)
+{
+    netsnmp_table_request_info *table_info;
+    netsnmp_request_info *request;
+    agentx_stats   *st;
+    u_long          val;
+
+    if (reqinfo->mode != MODE_GET)
+        return SNMP_ERR_NOERROR;
+
+    for (request = requests; request; request = request->next) {
+        if (request->processed)
+            continue;
+        st = (agentx_stats *) netsnmp_extract_iterator_context(request);
+        table_info = netsnmp_extract_table_info(request);
+        if (!st || !table_info) {
+            netsnmp_set_request_error(reqinfo, request,
+                                      SNMP_NOSUCHINSTANCE);
+            continue;
+        }
+
+        switch (table_info->colnum) {
+        case COLUMN_NSAGENTXSESSIONDESCR:
+            snmp_set_var_typed_value(request->requestvb, ASN_OCTET_STR,
+                                     st->descr, strlen(st->descr));
+            continue;
+        case COLUMN_NSAGENTXREQUESTS:
+            val = st->requests;
+            break;
+        case COLUMN_NSAGENTXRESPONSES:
+            val = st->responses;
+            break;
+        case COLUMN_NSAGENTXTIMEOUTS:
+            val = st->timeouts;
+            break;
+        case COLUMN_NSAGENTXOUTSTANDING:
+            snmp_set_var_typed_integer(request->requestvb, ASN_GAUGE,
+                                       st->npending);
+            continue;
+        case COLUMN_NSAGENTXROUNDTRIPTIME:
+            snmp_set_var_typed_integer(request->requestvb, ASN_GAUGE,
+                                       st->srtt);
+            continue;
+        case COLUMN_NSAGENTXTIMEOUT:
+            snmp_set_var_typed_integer(request->requestvb, ASN_GAUGE,
+                                       _stats_timeout(st) / 1000);
+            continue;
+        case COLUMN_NSAGENTXLATENCYUNDER1MS:
+        case COLUMN_NSAGENTXLATENCYUNDER10MS:
+        case COLUMN_NSAGENTXLATENCYUNDER100MS:
+        case COLUMN_NSAGENTXLATENCYUNDER1S:
+        case COLUMN_NSAGENTXLATENCYOVER1S:
+            val = st->latency[table_info->colnum -
+                              COLUMN_NSAGENTXLATENCYUNDER1MS];
+            break;
+        default:
+            netsnmp_set_request_error(reqinfo, request,
+                                      SNMP_NOSUCHOBJECT);
+            continue;
+        }
+        snmp_set_var_typed_integer(request->requestvb, ASN_COUNTER, val);
+    }
+    return SNMP_ERR_NOERROR;
+}
@@ -0,0 +1,48 @@
+#ifndef _AGENTX_MASTER_STATS_H
+#define _AGENTX_MASTER_STATS_H
+
+config_belongs_in(agent_module)
+
+#ifdef __cplusplus
+extern          "C" {
+#endif
+
+    void            init_master_stats(void);
+
+    void            agentx_stats_open(netsnmp_session *session,
+                                      netsnmp_session *sp);
+    void            agentx_stats_close(netsnmp_session *session,
+                                       int sessid);
+    void            agentx_stats_set_timeout(netsnmp_session *session);
+    void            agentx_stats_sent(netsnmp_session *session,
+                                      long reqid);
+    void            agentx_stats_update(int operation,
+                                        netsnmp_session *session,
+                                        long reqid);
+
+    Netsnmp_Node_Handler nsAgentxStatsTable_handler;
+    Netsnmp_First_Data_Point nsAgentxStatsTable_get_first_data_point;
+    Netsnmp_Next_Data_Point nsAgentxStatsTable_get_next_data_point;
+
+#ifdef __cplusplus
+}
+#endif
+
+/*
+ * column number definitions for table nsAgentxStatsTable
+ */
+#define COLUMN_NSAGENTXSESSIONID		1
+#define COLUMN_NSAGENTXSESSIONDESCR		2
+#define COLUMN_NSAGENTXREQUESTS			3
+#define COLUMN_NSAGENTXRESPONSES		4
+#define COLUMN_NSAGENTXTIMEOUTS			5
+#define COLUMN_NSAGENTXOUTSTANDING		6
+#define COLUMN_NSAGENTXROUNDTRIPTIME		7
+#define COLUMN_NSAGENTXTIMEOUT			8
+#define COLUMN_NSAGENTXLATENCYUNDER1MS		9
+#define COLUMN_NSAGENTXLATENCYUNDER10MS		10
+#define COLUMN_NSAGENTXLATENCYUNDER100MS	11
+#define COLUMN_NSAGENTXLATENCYUNDER1S		12
+#define COLUMN_NSAGENTXLATENCYOVER1S		13
+
+#endif                          /* _AGENTX_MASTER_STATS_H */
@@ -73,6 +73,7 @@ int             subagent_open_master_session(void);
 
 typedef struct _net_snmpsubagent_magic_s {
     int             original_command;
+    long            non_repeaters;
     netsnmp_session *session;
     netsnmp_variable_list *ovars;
 } ns_subagent_magic;
@@ -384,11 +385,10 @@ handle_agentx_packet(int operation, netsnmp_session * session, int reqid,
         break;
 
     case AGENTX_MSG_GETBULK:
-        /*
-         * WWWXXX 
-         */
-        DEBUGMSGTL(("agentx/subagent", "  -> getbulk\n"));
+        DEBUGMSGTL(("agentx/subagent", "  -> getbulk (N=%ld, M=%ld)\n",
+                    pdu->non_repeaters, pdu->max_repetitions));
         pdu->command = SNMP_MSG_GETBULK;
+        smagic->non_repeaters = pdu->non_repeaters;
 
         /*
          * We have to save a copy of the original variable list here because
@@ -540,13 +540,90 @@ _invalid_op_and_magic(int op, ns_subagent_magic *smagic)
     return invalid;
 }
 
+/*
+ * Apply the search range the master agent asked for (kept in the value
+ * of the original varbind u) to the answer v.  Returns 1 if v was out
+ * of scope and has been turned into endOfMibView.
+ */
+static int
+_scope_varbind(netsnmp_variable_list *u, netsnmp_variable_list *v)
+{
+    int             rc;
+
+    if (snmp_oid_compare
+        (u->val.objid, u->val_len / sizeof(oid), nullOid,
+         nullOidLen/sizeof(oid)) == 0) {
+        DEBUGMSGTL(("agentx/subagent", "unscoped var\n"));
+        return 0;
+    }
+
+    /*
+     * The master agent requested scoping for this variable.  
+     */
+    rc = snmp_oid_compare(v->name, v->name_length,
+                          u->val.objid, u->val_len / sizeof(oid));
+    DEBUGMSGTL(("agentx/subagent", "result "));
+    DEBUGMSGOID(("agentx/subagent", v->name, v->name_length));
+    DEBUGMSG(("agentx/subagent", " scope to "));
+    DEBUGMSGOID(("agentx/subagent",
+                 u->val.objid, u->val_len / sizeof(oid)));
+    DEBUGMSG(("agentx/subagent", " result %d\n", rc));
+
+    if (rc < 0)
+        return 0;
+
+    /*
+     * The varbind is out of scope.  From RFC2741, p. 66: "If
+     * the subagent cannot locate an appropriate variable,
+     * v.name is set to the starting OID, and the VarBind is
+     * set to `endOfMibView'".  
+     */
+    snmp_set_var_objid(v, u->name, u->name_length);
+    snmp_set_var_typed_value(v, SNMP_ENDOFMIBVIEW, NULL, 0);
+    DEBUGMSGTL(("agentx/subagent",
+                "scope violation -- return endOfMibView\n"));
+    return 1;
+}
+
+/*
+ * Scope a GetBulk answer.  The response holds one answer for each of
+ * the non_repeaters, followed by rows of one answer per repeater, so
+ * each of the R repeaters owns every R'th varbind from there on.  Once a repeater
+ * has left its search range, the rest of its column is endOfMibView
+ * as well.
+ */
+static void
+_scope_bulk_varbinds(netsnmp_variable_list *ovars, long non_repeaters,
+                     netsnmp_variable_list *vars)
+{
+    netsnmp_variable_list *u, *v, *col;
+    int             i, repeaters, done;
+
+    for (u = ovars, v = vars; u != NULL && v != NULL && non_repeaters > 0;
+         u = u->next_variable, v = v->next_variable, non_repeaters--)
+        _scope_varbind(u, v);
+
+    repeaters = count_varbinds(u);
+    for (col = v; u != NULL && col != NULL;
+         u = u->next_variable, col = col->next_variable) {
+        for (v = col, done = 0; v != NULL; ) {
+            if (done) {
+                snmp_set_var_objid(v, u->name, u->name_length);
+                snmp_set_var_typed_value(v, SNMP_ENDOFMIBVIEW, NULL, 0);
+            } else if (v->type == SNMP_ENDOFMIBVIEW || _scope_varbind(u, v))
+                done = 1;
+            for (i = 0; v != NULL && i < repeaters; i++)
+                v = v->next_variable;
+        }
+    }
+}
+
 int
 handle_subagent_response(int op, netsnmp_session * session, int reqid,
                          netsnmp_pdu *pdu, void *magic)
 {
     ns_subagent_magic *smagic = (ns_subagent_magic *) magic;
     netsnmp_variable_list *u = NULL, *v = NULL;
-    int             rc = 0;
 
     if (_invalid_op_and_magic(op, magic)) {
         return 1;
@@ -576,45 +653,16 @@ handle_subagent_response(int op, netsnmp_session * session, int reqid,
                     pdu->variables));
         for (u = smagic->ovars, v = pdu->variables; u != NULL && v != NULL;
              u = u->next_variable, v = v->next_variable) {
-            if (snmp_oid_compare
-                (u->val.objid, u->val_len / sizeof(oid), nullOid,
-                 nullOidLen/sizeof(oid)) != 0) {
-                /*
-                 * The master agent requested scoping for this variable.  
-                 */
-                rc = snmp_oid_compare(v->name, v->name_length,
-                                      u->val.objid,
-                                      u->val_len / sizeof(oid));
-                DEBUGMSGTL(("agentx/subagent", "result "));
-                DEBUGMSGOID(("agentx/subagent", v->name, v->name_length));
-                DEBUGMSG(("agentx/subagent", " scope to "));
-                DEBUGMSGOID(("agentx/subagent",
-                             u->val.objid, u->val_len / sizeof(oid)));
-                DEBUGMSG(("agentx/subagent", " result %d\n", rc));
-
-                if (rc >= 0) {
-                    /*
-                     * The varbind is out of scope.  From RFC2741, p. 66: "If
-                     * the subagent cannot locate an appropriate variable,
-                     * v.name is set to the starting OID, and the VarBind is
-                     * set to `endOfMibView'".  
-                     */
-                    snmp_set_var_objid(v, u->name, u->name_length);
-                    snmp_set_var_typed_value(v, SNMP_ENDOFMIBVIEW, NULL, 0);
-                    DEBUGMSGTL(("agentx/subagent",
-                                "scope violation -- return endOfMibView\n"));
-                }
-            } else {
-                DEBUGMSGTL(("agentx/subagent", "unscoped var\n"));
-            }
+            _scope_varbind(u, v);
         }
+    } else if (smagic->original_command == AGENTX_MSG_GETBULK) {
+        DEBUGMSGTL(("agentx/subagent",
+                    "do getBulk scope processing %p %p\n", smagic->ovars,
+                    pdu->variables));
+        _scope_bulk_varbinds(smagic->ovars, smagic->non_repeaters,
+                             pdu->variables);
     }
 
-    /*
-     * XXXJBPN: similar for GETBULK but the varbinds can get re-ordered I
-     * think which makes it er more difficult.  
-     */
-
     if (smagic->ovars != NULL) {
         snmp_free_varbind(smagic->ovars);
     }
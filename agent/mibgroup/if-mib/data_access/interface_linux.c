@@ -101,14 +101,14 @@ typedef __u8 u8;           /* ditto */
 #define SIOCGMIIREG 0x8948
 #endif
 
-#ifdef NETSNMP_ENABLE_IPV6
 #if defined(HAVE_LINUX_RTNETLINK_H)
 #include <linux/rtnetlink.h>
+#ifdef NETSNMP_ENABLE_IPV6
 #ifdef RTMGRP_IPV6_PREFIX
 #define SUPPORT_PREFIX_FLAGS 1
 #endif  /* RTMGRP_IPV6_PREFIX */
-#endif  /* HAVE_LINUX_RTNETLINK_H */
 #endif  /* NETSNMP_ENABLE_IPV6 */
+#endif  /* HAVE_LINUX_RTNETLINK_H */
 unsigned long long
 netsnmp_linux_interface_get_if_speed(int fd, const char *name,
         unsigned long long defaultspeed);
@@ -472,6 +472,60 @@ _arch_interface_flags_v6_get(netsnmp_interface_entry *entry)
 }
 #endif /* NETSNMP_ENABLE_IPV6 */
 
+/*
+ * interface counters, from /proc/net/dev or netlink
+ */
+struct _if_counters {
+    uintmax_t       rec_pkt, rec_oct, rec_err, rec_drop, rec_mcast;
+    uintmax_t       snd_pkt, snd_oct, snd_err, snd_drop, coll;
+};
+
+/**
+ * @internal
+ */
+static void
+_set_stats(netsnmp_interface_entry *entry, struct _if_counters *c)
+{
+    entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_ACTIVE;
+    
+    /*
+     * linux previous to 1.3.~13 may miss transmitted loopback pkts: 
+     */
+    if (!strcmp(entry->name, "lo") && c->rec_pkt > 0 && !c->snd_pkt)
+        c->snd_pkt = c->rec_pkt;
+    
+    /*
+     * subtract out multicast packets from rec_pkt before
+     * we store it as unicast counter.
+     */
+    entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_CALCULATE_UCAST;
+    entry->stats.ibytes.low = c->rec_oct & 0xffffffff;
+    entry->stats.iall.low = c->rec_pkt & 0xffffffff;
+    entry->stats.imcast.low = c->rec_mcast & 0xffffffff;
+    entry->stats.obytes.low = c->snd_oct & 0xffffffff;
+    entry->stats.oucast.low = c->snd_pkt & 0xffffffff;
+    entry->stats.ibytes.high = c->rec_oct >> 32;
+    entry->stats.iall.high = c->rec_pkt >> 32;
+    entry->stats.imcast.high = c->rec_mcast >> 32;
+    entry->stats.obytes.high = c->snd_oct >> 32;
+    entry->stats.oucast.high = c->snd_pkt >> 32;
+    entry->stats.ierrors   = c->rec_err;
+    entry->stats.idiscards = c->rec_drop;
+    entry->stats.oerrors   = c->snd_err;
+    entry->stats.odiscards = c->snd_drop;
+    entry->stats.collisions = c->coll;
+    
+    /*
+     * calculated stats.
+     *
+     *  we have imcast, but not ibcast.
+     */
+    entry->stats.inucast = entry->stats.imcast.low +
+        entry->stats.ibcast.low;
+    entry->stats.onucast = entry->stats.omcast.low +
+        entry->stats.obcast.low;
+}
+
 /**
  * @internal
  */
@@ -485,8 +539,7 @@ _parse_stats(netsnmp_interface_entry *entry, char *stats, int expected)
      *  [               OUT                               ]
      *   byte pkts errs drop fifo colls carrier compressed
      */
-    uintmax_t       rec_pkt, rec_oct, rec_err, rec_drop, rec_mcast;
-    uintmax_t       snd_pkt, snd_oct, snd_err, snd_drop, coll;
+    struct _if_counters c;
     const char     *scan_line_2_2 =
         "%"   SCNuMAX " %"  SCNuMAX " %"  SCNuMAX " %"  SCNuMAX
         " %*" SCNuMAX " %*" SCNuMAX " %*" SCNuMAX " %"  SCNuMAX
@@ -520,13 +573,12 @@ _parse_stats(netsnmp_interface_entry *entry, char *stats, int expected)
      *      data structure accordingly.
      * Use the entry flags field to indicate which counters are valid
      */
-    rec_pkt = rec_oct = rec_err = rec_drop = rec_mcast = 0;
-    snd_pkt = snd_oct = snd_err = snd_drop = coll = 0;
+    memset(&c, 0, sizeof(c));
     if (scan_line_to_use == scan_line_2_2) {
         scan_count = sscanf(stats, scan_line_to_use,
-                            &rec_oct, &rec_pkt, &rec_err, &rec_drop, &rec_mcast,
-                            &snd_oct, &snd_pkt, &snd_err, &snd_drop,
-                            &coll);
+                            &c.rec_oct, &c.rec_pkt, &c.rec_err, &c.rec_drop,
+                            &c.rec_mcast, &c.snd_oct, &c.snd_pkt, &c.snd_err,
+                            &c.snd_drop, &c.coll);
         if (scan_count == expected) {
             entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_HAS_BYTES;
             entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_HAS_DROPS;
@@ -540,12 +592,12 @@ _parse_stats(netsnmp_interface_entry *entry, char *stats, int expected)
         }
     } else {
         scan_count = sscanf(stats, scan_line_to_use,
-                            &rec_pkt, &rec_err,
-                            &snd_pkt, &snd_err, &coll);
+                            &c.rec_pkt, &c.rec_err,
+                            &c.snd_pkt, &c.snd_err, &c.coll);
         if (scan_count == expected) {
             entry->ns_flags &= ~NETSNMP_INTERFACE_FLAGS_HAS_MCAST_PKTS;
-            rec_oct = rec_drop = 0;
-            snd_oct = snd_drop = 0;
+            c.rec_oct = c.rec_drop = 0;
+            c.snd_oct = c.snd_drop = 0;
         }
     }
     if(scan_count != expected) {
@@ -554,48 +606,181 @@ _parse_stats(netsnmp_interface_entry *entry, char *stats, int expected)
                  expected, scan_count);
         return scan_count;
     }
-    entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_ACTIVE;
-    
-    /*
-     * linux previous to 1.3.~13 may miss transmitted loopback pkts: 
-     */
-    if (!strcmp(entry->name, "lo") && rec_pkt > 0 && !snd_pkt)
-        snd_pkt = rec_pkt;
-    
-    /*
-     * subtract out multicast packets from rec_pkt before
-     * we store it as unicast counter.
-     */
-    entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_CALCULATE_UCAST;
-    entry->stats.ibytes.low = rec_oct & 0xffffffff;
-    entry->stats.iall.low = rec_pkt & 0xffffffff;
-    entry->stats.imcast.low = rec_mcast & 0xffffffff;
-    entry->stats.obytes.low = snd_oct & 0xffffffff;
-    entry->stats.oucast.low = snd_pkt & 0xffffffff;
-    entry->stats.ibytes.high = rec_oct >> 32;
-    entry->stats.iall.high = rec_pkt >> 32;
-    entry->stats.imcast.high = rec_mcast >> 32;
-    entry->stats.obytes.high = snd_oct >> 32;
-    entry->stats.oucast.high = snd_pkt >> 32;
-    entry->stats.ierrors   = rec_err;
-    entry->stats.idiscards = rec_drop;
-    entry->stats.oerrors   = snd_err;
-    entry->stats.odiscards = snd_drop;
-    entry->stats.collisions = coll;
-    
-    /*
-     * calculated stats.
-     *
-     *  we have imcast, but not ibcast.
-     */
-    entry->stats.inucast = entry->stats.imcast.low +
-        entry->stats.ibcast.low;
-    entry->stats.onucast = entry->stats.omcast.low +
-        entry->stats.obcast.low;
-    
+    _set_stats(entry, &c);
+
     return 0;
 }
 
+/*
+ * one interface from a netlink link dump
+ */
+struct _link_info {
+    char                name[IFNAMSIZ];
+    oid                 index;
+    int                 has_stats;
+    struct _if_counters counters;
+};
+
+#ifdef HAVE_LINUX_RTNETLINK_H
+#define NETSNMP_LINK_NETLINK_BUFSIZE 32768
+
+/**
+ * @internal
+ * get the interfaces and their counters with a RTM_GETLINK dump,
+ * instead of parsing /proc/net/dev.
+ *
+ * @retval >=0 number of interfaces in *links_ptr (to be freed by caller)
+ * @retval  -1 netlink not available or the dump failed
+ */
+static int
+_load_links_netlink(struct _link_info **links_ptr)
+{
+    struct {
+        struct nlmsghdr  n;
+        struct ifinfomsg i;
+    } req;
+    struct _link_info *links = NULL, *link, *tmp;
+    struct nlmsghdr *h;
+    struct ifinfomsg *ifi;
+    struct rtattr  *rta;
+    struct rtnl_link_stats64 stats64;
+    struct rtnl_link_stats stats;
+    char           *buf;
+    int             fd, len, attrlen, done = 0, rc = 0, count = 0, max = 0;
+
+    fd = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_ROUTE);
+    if (fd < 0) {
+        DEBUGMSGTL(("access:interface:container:arch",
+                    "no netlink socket\n"));
+        return -1;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+    req.n.nlmsg_type = RTM_GETLINK;
+    req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.i.ifi_family = AF_UNSPEC;
+    if (send(fd, &req, req.n.nlmsg_len, 0) < 0) {
+        DEBUGMSGTL(("access:interface:container:arch",
+                    "netlink send failed\n"));
+        close(fd);
+        return -1;
+    }
+
+    buf = (char *) malloc(NETSNMP_LINK_NETLINK_BUFSIZE);
+    if (NULL == buf) {
+        close(fd);
+        return -1;
+    }
+
+    while (!done) {
+        len = recv(fd, buf, NETSNMP_LINK_NETLINK_BUFSIZE, 0);
+        if (len < 0 && EINTR == errno)
+            continue;
+        if (len <= 0) {
+            snmp_log_perror("interface_linux: netlink receive failed");
+            rc = -1;
+            break;
+        }
+        for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, len);
+             h = NLMSG_NEXT(h, len)) {
+            if (NLMSG_DONE == h->nlmsg_type) {
+                done = 1;
+                break;
+            }
+            if (NLMSG_ERROR == h->nlmsg_type) {
+                snmp_log(LOG_ERR,
+                         "interface_linux: netlink link dump failed\n");
+                rc = -1;
+                done = 1;
+                break;
+            }
+            if (RTM_NEWLINK != h->nlmsg_type)
+                continue;
+
+            if (count == max) {
+                max = max ? max * 2 : 16;
+                tmp = (struct _link_info *)
+                    realloc(links, max * sizeof(*links));
+                if (NULL == tmp) {
+                    rc = -1;
+                    done = 1;
+                    break;
+                }
+                links = tmp;
+            }
+            link = &links[count];
+            memset(link, 0, sizeof(*link));
+
+            ifi = (struct ifinfomsg *) NLMSG_DATA(h);
+            link->index = ifi->ifi_index;
+            attrlen = IFLA_PAYLOAD(h);
+            for (rta = IFLA_RTA(ifi); RTA_OK(rta, attrlen);
+                 rta = RTA_NEXT(rta, attrlen)) {
+                switch (rta->rta_type) {
+                case IFLA_IFNAME:
+                    strlcpy(link->name, (char *) RTA_DATA(rta),
+                            sizeof(link->name));
+                    break;
+                case IFLA_STATS64:
+                    memset(&stats64, 0, sizeof(stats64));
+                    memcpy(&stats64, RTA_DATA(rta),
+                           SNMP_MIN(RTA_PAYLOAD(rta), sizeof(stats64)));
+                    /*
+                     * same sums as /proc/net/dev
+                     */
+                    link->counters.rec_oct = stats64.rx_bytes;
+                    link->counters.rec_pkt = stats64.rx_packets;
+                    link->counters.rec_err = stats64.rx_errors;
+                    link->counters.rec_drop = stats64.rx_dropped +
+                        stats64.rx_missed_errors;
+                    link->counters.rec_mcast = stats64.multicast;
+                    link->counters.snd_oct = stats64.tx_bytes;
+                    link->counters.snd_pkt = stats64.tx_packets;
+                    link->counters.snd_err = stats64.tx_errors;
+                    link->counters.snd_drop = stats64.tx_dropped;
+                    link->counters.coll = stats64.collisions;
+                    link->has_stats = 1;
+                    break;
+                case IFLA_STATS:
+                    if (link->has_stats)
+                        break; /* prefer the 64 bit counters */
+                    memset(&stats, 0, sizeof(stats));
+                    memcpy(&stats, RTA_DATA(rta),
+                           SNMP_MIN(RTA_PAYLOAD(rta), sizeof(stats)));
+                    link->counters.rec_oct = stats.rx_bytes;
+                    link->counters.rec_pkt = stats.rx_packets;
+                    link->counters.rec_err = stats.rx_errors;
+                    link->counters.rec_drop = stats.rx_dropped +
+                        stats.rx_missed_errors;
+                    link->counters.rec_mcast = stats.multicast;
+                    link->counters.snd_oct = stats.tx_bytes;
+                    link->counters.snd_pkt = stats.tx_packets;
+                    link->counters.snd_err = stats.tx_errors;
+                    link->counters.snd_drop = stats.tx_dropped;
+                    link->counters.coll = stats.collisions;
+                    link->has_stats = 1;
+                    break;
+                }
+            }
+            if (0 != link->name[0] && 0 != link->index)
+                ++count;
+        }
+    }
+
+    free(buf);
+    close(fd);
+    if (rc < 0) {
+        free(links);
+        return rc;
+    }
+    DEBUGMSGTL(("access:interface:container:arch",
+                "netlink found %d interfaces\n", count));
+    *links_ptr = links;
+    return count;
+}
+#endif /* HAVE_LINUX_RTNETLINK_H */
+
 /*
  *
  * @retval  0 success
@@ -607,13 +792,15 @@ int
 netsnmp_arch_interface_container_load(netsnmp_container* container,
                                       u_int load_flags)
 {
-    FILE           *devin;
+    FILE           *devin = NULL;
     char            line[256];
     netsnmp_interface_entry *entry = NULL;
     static char     scan_expected = 0;
     int             fd;
     int             interfaces = 0;
     struct ifconf   ifc;
+    struct _link_info *links = NULL, *link = NULL;
+    int             link_count = -1, link_next = 0;
 #ifdef NETSNMP_ENABLE_IPV6
     netsnmp_container *addr_container;
 #endif
@@ -626,7 +813,14 @@ netsnmp_arch_interface_container_load(netsnmp_container* container,
         return -1;
     }
 
-    if (!(devin = fopen("/proc/net/dev", "r"))) {
+#ifdef HAVE_LINUX_RTNETLINK_H
+    /*
+     * a netlink dump gives us the names, indexes and 64 bit counters
+     * without parsing /proc/net/dev.
+     */
+    link_count = _load_links_netlink(&links);
+#endif
+    if (link_count < 0 && !(devin = fopen("/proc/net/dev", "r"))) {
         DEBUGMSGTL(("access:interface",
                     "Failed to load Interface Table (linux1)\n"));
         snmp_log_perror("interface_linux: cannot open /proc/net/dev");
@@ -639,7 +833,9 @@ netsnmp_arch_interface_container_load(netsnmp_container* container,
     fd = socket(AF_INET, SOCK_DGRAM, 0);
     if(fd < 0) {
         snmp_log_perror("interface_linux: could not create socket");
-        fclose(devin);
+        if (devin)
+            fclose(devin);
+        free(links);
         return -2;
     }
 
@@ -650,34 +846,38 @@ netsnmp_arch_interface_container_load(netsnmp_container* container,
     addr_container = netsnmp_access_ipaddress_container_load(NULL, 0);
 #endif
 
-    /*
-     * Read the first two lines of the file, containing the header
-     * This indicates which version of the kernel we're working with,
-     * and hence which statistics are actually available.
-     *
-     * Wes originally suggested parsing the field names in this header
-     * to detect the position of individual fields directly,
-     * but I suspect this is probably more trouble than it's worth.
-     */
-    NETSNMP_IGNORE_RESULT(fgets(line, sizeof(line), devin));
-    NETSNMP_IGNORE_RESULT(fgets(line, sizeof(line), devin));
-
-    if( 0 == scan_expected ) {
-        if (strstr(line, "compressed")) {
-            scan_expected = 10;
-            DEBUGMSGTL(("access:interface",
-                        "using linux 2.2 kernel /proc/net/dev\n"));
-        } else {
-            scan_expected = 5;
-            DEBUGMSGTL(("access:interface",
-                        "using linux 2.0 kernel /proc/net/dev\n"));
+    if (devin) {
+        /*
+         * Read the first two lines of the file, containing the header
+         * This indicates which version of the kernel we're working with,
+         * and hence which statistics are actually available.
+         *
+         * Wes originally suggested parsing the field names in this header
+         * to detect the position of individual fields directly,
+         * but I suspect this is probably more trouble than it's worth.
+         */
+        NETSNMP_IGNORE_RESULT(fgets(line, sizeof(line), devin));
+        NETSNMP_IGNORE_RESULT(fgets(line, sizeof(line), devin));
+
+        if( 0 == scan_expected ) {
+            if (strstr(line, "compressed")) {
+                scan_expected = 10;
+                DEBUGMSGTL(("access:interface",
+                            "using linux 2.2 kernel /proc/net/dev\n"));
+            } else {
+                scan_expected = 5;
+                DEBUGMSGTL(("access:interface",
+                            "using linux 2.0 kernel /proc/net/dev\n"));
+            }
         }
     }
 
     interfaces = netsnmp_access_ipaddress_ioctl_get_interface_count(fd, &ifc);
     if (interfaces < 0) {
         snmp_log(LOG_ERR,"get interface count failed\n");
-        fclose(devin);
+        if (devin)
+            fclose(devin);
+        free(links);
         close(fd);
         return -2;
     }
@@ -689,37 +889,54 @@ netsnmp_arch_interface_container_load(netsnmp_container* container,
      * Read in each line in turn, isolate the interface name
      *   and retrieve (or create) the corresponding data structure.
      */
-    while (fgets(line, sizeof(line), devin)) {
-        char           *stats, *ifstart = line;
+    for (;;) {
+        char           *stats = NULL, *ifstart = line;
         u_int           flags;
-        oid             if_index;
+        oid             if_index = 0;
 
         flags = 0;
-        if (line[strlen(line) - 1] == '\n')
-            line[strlen(line) - 1] = '\0';
+        if (link_count >= 0) {
+            /*
+             * the next interface from the netlink dump
+             */
+            if (link_next == link_count)
+                break;
+            link = &links[link_next++];
+            ifstart = link->name;
+            if_index = link->index;
+            DEBUGMSGTL(("9:access:ifcontainer", "processing '%s'\n",
+                        ifstart));
+        } else {
+            if (!fgets(line, sizeof(line), devin))
+                break;
+            if (line[strlen(line) - 1] == '\n')
+                line[strlen(line) - 1] = '\0';
 
-        while (*ifstart && *ifstart == ' ')
-            ifstart++;
+            while (*ifstart && *ifstart == ' ')
+                ifstart++;
 
-        if ((!*ifstart) || ((stats = strrchr(ifstart, ':')) == NULL)) {
-            snmp_log(LOG_ERR,
-                     "interface data format error 1, line ==|%s|\n", line);
-            continue;
-        }
-        if ((scan_expected == 10) && ((stats - line) < 6)) {
-            snmp_log(LOG_ERR,
-                     "interface data format error 2 (%d < 6), line ==|%s|\n",
-                     (int)(stats - line), line);
-        }
+            if ((!*ifstart) || ((stats = strrchr(ifstart, ':')) == NULL)) {
+                snmp_log(LOG_ERR,
+                         "interface data format error 1, line ==|%s|\n",
+                         line);
+                continue;
+            }
+            if ((scan_expected == 10) && ((stats - line) < 6)) {
+                snmp_log(LOG_ERR,
+                         "interface data format error 2 (%d < 6), line ==|%s|\n",
+                         (int)(stats - line), line);
+            }
 
-        DEBUGMSGTL(("9:access:ifcontainer", "processing '%s'\n", ifstart));
+            DEBUGMSGTL(("9:access:ifcontainer", "processing '%s'\n",
+                        ifstart));
 
-        /*
-         * get index via ioctl.
-         * If we've met this interface before, use the same index.
-         * Otherwise find an unused index value and use that.
-         */
-        *stats++ = 0; /* null terminate name */
+            /*
+             * get index via ioctl.
+             * If we've met this interface before, use the same index.
+             * Otherwise find an unused index value and use that.
+             */
+            *stats++ = 0; /* null terminate name */
+        }
 
 	if (!netsnmp_access_interface_include(ifstart))
 		continue;
@@ -734,7 +951,8 @@ netsnmp_arch_interface_container_load(netsnmp_container* container,
          * knows a better way, put it here!
          */
 #ifdef NETSNMP_ENABLE_IPV6
-        if_index = netsnmp_arch_interface_index_find(ifstart);
+        if (0 == if_index)
+            if_index = netsnmp_arch_interface_index_find(ifstart);
         _arch_interface_has_ipv6(if_index, &flags, addr_container);
 #endif
         netsnmp_access_interface_ioctl_has_ipv4(fd, ifstart, 0, &flags, &ifc);
@@ -752,14 +970,16 @@ netsnmp_arch_interface_container_load(netsnmp_container* container,
             continue;
         }
 
-        entry = netsnmp_access_interface_entry_create(ifstart, 0);
+        entry = netsnmp_access_interface_entry_create(ifstart, if_index);
         if(NULL == entry) {
 #ifdef NETSNMP_ENABLE_IPV6
             netsnmp_access_ipaddress_container_free(addr_container, 0);
 #endif
             netsnmp_access_interface_container_free(container,
                                                     NETSNMP_ACCESS_INTERFACE_FREE_NOFLAGS);
-            fclose(devin);
+            if (devin)
+                fclose(devin);
+            free(links);
             close(fd);
             free(ifc.ifc_buf);
             return -3;
@@ -908,8 +1128,19 @@ netsnmp_arch_interface_container_load(netsnmp_container* container,
 
         netsnmp_access_interface_entry_overrides(entry);
 
-        if (! (load_flags & NETSNMP_ACCESS_INTERFACE_LOAD_NO_STATS))
-            _parse_stats(entry, stats, scan_expected);
+        if (! (load_flags & NETSNMP_ACCESS_INTERFACE_LOAD_NO_STATS)) {
+            if (NULL == link)
+                _parse_stats(entry, stats, scan_expected);
+            else if (link->has_stats) {
+                entry->ns_flags |= NETSNMP_INTERFACE_FLAGS_HAS_BYTES |
+                    NETSNMP_INTERFACE_FLAGS_HAS_DROPS |
+                    NETSNMP_INTERFACE_FLAGS_HAS_MCAST_PKTS |
+                    NETSNMP_INTERFACE_FLAGS_HAS_HIGH_SPEED |
+                    NETSNMP_INTERFACE_FLAGS_HAS_HIGH_BYTES |
+                    NETSNMP_INTERFACE_FLAGS_HAS_HIGH_PACKETS;
+                _set_stats(entry, &link->counters);
+            }
+        }
 
         if (flags & NETSNMP_INTERFACE_FLAGS_HAS_IPV4)
             _arch_interface_flags_v4_get(entry);
@@ -927,7 +1158,9 @@ netsnmp_arch_interface_container_load(netsnmp_container* container,
 #ifdef NETSNMP_ENABLE_IPV6
     netsnmp_access_ipaddress_container_free(addr_container, 0);
 #endif
-    fclose(devin);
+    if (devin)
+        fclose(devin);
+    free(links);
     close(fd);
     free(ifc.ifc_buf);
     return 0;
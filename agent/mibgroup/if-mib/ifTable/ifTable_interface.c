@@ -53,6 +53,7 @@ netsnmp_feature_child_of(ifTable_external_access, libnetsnmpmibs);
 netsnmp_feature_require(row_merge);
 netsnmp_feature_require(baby_steps);
 netsnmp_feature_require(check_all_requests_error);
+netsnmp_feature_require(table_container_hash_index);
 netsnmp_feature_child_of(iftable_container_get, ifTable_external_access);
 netsnmp_feature_child_of(ifxtable_shutdown_interface, netsnmp_unused);
 netsnmp_feature_child_of(ifXTable_container_size, ifXTable_external_access);
@@ -1969,6 +1970,10 @@ _ifTable_container_init(ifTable_interface_ctx * if_ctx)
     }
 
     if_ctx->container->container_name = strdup("ifTable container");
+    /*
+     * pollers mostly GET known rows; look those up by hash
+     */
+    (void) netsnmp_container_table_add_hash_index(if_ctx->container);
     if (NULL != if_ctx->cache)
         if_ctx->cache->magic = (void *) if_ctx->container;
 }                               /* _ifTable_container_init */
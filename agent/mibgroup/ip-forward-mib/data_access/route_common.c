@@ -176,6 +176,18 @@ netsnmp_access_route_entry_set(netsnmp_route_entry * entry)
     return rc;
 }
 
+/**
+ * have a cache of routes expire when the system reports a route change
+ *
+ * @retval  0 : cache registered
+ * @retval -1 : not supported on this platform
+ */
+int
+netsnmp_access_route_watch(netsnmp_cache *cache)
+{
+    return netsnmp_arch_route_watch(cache);
+}
+
 /**
  * copy an  route_entry
  *
@@ -18,6 +18,14 @@
 #include "route.h"
 #include "route_private.h"
 
+#include <errno.h>
+#if defined(HAVE_LINUX_RTNETLINK_H)
+#include <linux/rtnetlink.h>
+
+/* large enough for the biggest message the kernel sends in a dump */
+#define NETSNMP_ROUTE_NETLINK_BUFSIZE 65536
+#endif
+
 static int
 _type_from_flags(unsigned int flags)
 {
@@ -338,6 +346,266 @@ _load_ipv6(netsnmp_container* container, u_long *index )
 }
 #endif
 
+#if defined(HAVE_LINUX_RTNETLINK_H)
+static int
+_type_from_netlink(const struct rtmsg *rtm, int has_gateway, unsigned flags)
+{
+    switch (rtm->rtm_type) {
+    case RTN_UNREACHABLE:
+    case RTN_PROHIBIT:
+        return INETCIDRROUTETYPE_REJECT;
+    case RTN_BLACKHOLE:
+        return INETCIDRROUTETYPE_BLACKHOLE;
+    }
+    if (flags & RTNH_F_DEAD)
+        return 0; /* route not up */
+    return has_gateway ? INETCIDRROUTETYPE_REMOTE : INETCIDRROUTETYPE_LOCAL;
+}
+
+static int
+_proto_from_netlink(const struct rtmsg *rtm)
+{
+    switch (rtm->rtm_protocol) {
+    case RTPROT_REDIRECT:
+        return IANAIPROUTEPROTOCOL_ICMP;
+    case RTPROT_STATIC:
+        return IANAIPROUTEPROTOCOL_NETMGMT;
+#ifdef RTPROT_BGP
+    case RTPROT_BGP:
+        return IANAIPROUTEPROTOCOL_BGP;
+    case RTPROT_ISIS:
+        return IANAIPROUTEPROTOCOL_ISIS;
+    case RTPROT_OSPF:
+        return IANAIPROUTEPROTOCOL_OSPF;
+    case RTPROT_RIP:
+        return IANAIPROUTEPROTOCOL_RIP;
+#endif
+    default:
+        return IANAIPROUTEPROTOCOL_LOCAL;
+    }
+}
+
+/*
+ * convert one RTM_NEWROUTE message into a route entry
+ *
+ * @retval NULL if the route is not one we report (or out of memory)
+ */
+static netsnmp_route_entry *
+_entry_from_netlink(struct nlmsghdr *nlmp, u_long *index)
+{
+    struct rtmsg   *rtm = (struct rtmsg *) NLMSG_DATA(nlmp);
+    struct rtattr  *rta, *nha;
+    struct rtnexthop *nh;
+    netsnmp_route_entry *entry;
+    const void     *dest = NULL, *nexthop = NULL;
+    uint32_t        table = rtm->rtm_table;
+    unsigned        flags = rtm->rtm_flags;
+    int             len, nhlen, addr_len, if_index = 0;
+    int32_t         metric = 0;
+
+    if (rtm->rtm_family == AF_INET)
+        addr_len = 4;
+#ifdef NETSNMP_ENABLE_IPV6
+    else if (rtm->rtm_family == AF_INET6)
+        addr_len = 16;
+#endif
+    else
+        return NULL;
+
+    len = RTM_PAYLOAD(nlmp);
+    for (rta = RTM_RTA(rtm); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        switch (rta->rta_type) {
+        case RTA_DST:
+            if (RTA_PAYLOAD(rta) == addr_len)
+                dest = RTA_DATA(rta);
+            break;
+        case RTA_GATEWAY:
+            if (RTA_PAYLOAD(rta) == addr_len)
+                nexthop = RTA_DATA(rta);
+            break;
+        case RTA_OIF:
+            if_index = *(int *) RTA_DATA(rta);
+            break;
+        case RTA_PRIORITY:
+            metric = *(int32_t *) RTA_DATA(rta);
+            break;
+        case RTA_TABLE:
+            table = *(uint32_t *) RTA_DATA(rta);
+            break;
+        case RTA_MULTIPATH:
+            /*
+             * like /proc/net/route, only report the first next hop
+             */
+            nh = (struct rtnexthop *) RTA_DATA(rta);
+            if (!RTNH_OK(nh, (int)RTA_PAYLOAD(rta)))
+                break;
+            if_index = nh->rtnh_ifindex;
+            flags |= nh->rtnh_flags;
+            nhlen = nh->rtnh_len - sizeof(*nh);
+            for (nha = RTNH_DATA(nh); RTA_OK(nha, nhlen);
+                 nha = RTA_NEXT(nha, nhlen))
+                if (nha->rta_type == RTA_GATEWAY &&
+                    RTA_PAYLOAD(nha) == addr_len)
+                    nexthop = RTA_DATA(nha);
+            break;
+        }
+    }
+
+    /*
+     * /proc/net/route only lists the main table, without broadcast
+     * and multicast routes; /proc/net/ipv6_route lists all tables.
+     */
+    if (rtm->rtm_flags & RTM_F_CLONED)
+        return NULL;
+    if (AF_INET == rtm->rtm_family &&
+        (table != RT_TABLE_MAIN || rtm->rtm_type == RTN_BROADCAST ||
+         rtm->rtm_type == RTN_MULTICAST))
+        return NULL;
+
+    entry = netsnmp_access_route_entry_create();
+    if (NULL == entry)
+        return NULL;
+
+    entry->if_index = if_index;
+    entry->rt_metric1 = metric;
+
+    /*
+     * arbitrary index
+     */
+    entry->ns_rt_index = ++(*index);
+
+    entry->rt_dest_type = (4 == addr_len) ?
+        INETADDRESSTYPE_IPV4 : INETADDRESSTYPE_IPV6;
+    entry->rt_dest_len = addr_len;
+    if (dest)
+        memcpy(entry->rt_dest, dest, addr_len);
+
+    entry->rt_nexthop_type = entry->rt_dest_type;
+    entry->rt_nexthop_len = addr_len;
+    if (nexthop)
+        memcpy(entry->rt_nexthop, nexthop, addr_len);
+
+    entry->rt_pfx_len = rtm->rtm_dst_len;
+
+#ifdef USING_IP_FORWARD_MIB_IPCIDRROUTETABLE_IPCIDRROUTETABLE_MODULE
+    if (4 == addr_len) {
+        uint32_t mask = rtm->rtm_dst_len ?
+            htonl(0xffffffff << (32 - rtm->rtm_dst_len)) : 0;
+        memcpy(&entry->rt_mask, &mask, 4);
+    }
+#endif
+
+#ifdef USING_IP_FORWARD_MIB_INETCIDRROUTETABLE_INETCIDRROUTETABLE_MODULE
+    /*
+     * distinguish between otherwise identical routes, as the /proc
+     * loaders do: by interface for ipv4 direct routes, and by our
+     * arbitrary index for ipv6.
+     */
+    if (4 != addr_len || NULL == nexthop) {
+        entry->rt_policy = calloc(3, sizeof(oid));
+        if (entry->rt_policy) {
+            entry->rt_policy[2] = (4 == addr_len) ?
+                entry->if_index : entry->ns_rt_index;
+            entry->rt_policy_len = sizeof(oid)*3;
+        }
+    }
+#endif
+
+    entry->rt_type = _type_from_netlink(rtm, NULL != nexthop, flags);
+    entry->rt_proto = _proto_from_netlink(rtm);
+
+    return entry;
+}
+
+/*
+ * load the routes for one address family from an RTM_GETROUTE dump.
+ * This is much cheaper than parsing /proc for large routing tables.
+ *
+ * @retval  0 success
+ * @retval -2 error reading from netlink
+ * @retval -3 netlink not available (use /proc instead)
+ */
+static int
+_load_netlink(netsnmp_container* container, u_long *index, int family)
+{
+    struct {
+        struct nlmsghdr n;
+        struct rtmsg    r;
+    } req;
+    struct nlmsghdr *h;
+    netsnmp_route_entry *entry;
+    char           *buf;
+    int             fd, len, done = 0, rc = 0, count = 0;
+
+    DEBUGMSGTL(("access:route:container",
+                "route_container_arch_load netlink (family %d)\n", family));
+
+    fd = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_ROUTE);
+    if (fd < 0) {
+        DEBUGMSGTL(("access:route:container", "no netlink socket\n"));
+        return -3;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+    req.n.nlmsg_type = RTM_GETROUTE;
+    req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.r.rtm_family = family;
+    if (send(fd, &req, req.n.nlmsg_len, 0) < 0) {
+        DEBUGMSGTL(("access:route:container", "netlink send failed\n"));
+        close(fd);
+        return -3;
+    }
+
+    buf = (char *) malloc(NETSNMP_ROUTE_NETLINK_BUFSIZE);
+    if (NULL == buf) {
+        close(fd);
+        return -2;
+    }
+
+    while (!done) {
+        len = recv(fd, buf, NETSNMP_ROUTE_NETLINK_BUFSIZE, 0);
+        if (len < 0 && EINTR == errno)
+            continue;
+        if (len <= 0) {
+            snmp_log_perror("route_linux: netlink receive failed");
+            rc = -2;
+            break;
+        }
+        for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, len);
+             h = NLMSG_NEXT(h, len)) {
+            if (NLMSG_DONE == h->nlmsg_type) {
+                done = 1;
+                break;
+            }
+            if (NLMSG_ERROR == h->nlmsg_type) {
+                snmp_log(LOG_ERR, "route_linux: netlink route dump failed\n");
+                rc = -2;
+                done = 1;
+                break;
+            }
+            if (RTM_NEWROUTE != h->nlmsg_type)
+                continue;
+
+            entry = _entry_from_netlink(h, index);
+            if (NULL == entry)
+                continue;
+            if (CONTAINER_INSERT(container, entry) < 0) {
+                DEBUGMSGTL(("access:route:container", "error with route_entry: insert into container failed.\n"));
+                netsnmp_access_route_entry_free(entry);
+                continue;
+            }
+            ++count;
+        }
+    }
+
+    DEBUGMSGTL(("access:route:container", "loaded %d routes\n", count));
+    free(buf);
+    close(fd);
+    return rc;
+}
+#endif /* HAVE_LINUX_RTNETLINK_H */
+
 /** arch specific load
  * @internal
  *
@@ -360,7 +628,11 @@ netsnmp_access_route_container_arch_load(netsnmp_container* container,
         return -1;
     }
 
-    rc = _load_ipv4(container, &count);
+#if defined(HAVE_LINUX_RTNETLINK_H)
+    rc = _load_netlink(container, &count, AF_INET);
+    if (-3 == rc)
+#endif
+        rc = _load_ipv4(container, &count);
     
 #ifdef NETSNMP_ENABLE_IPV6
     if((0 != rc) || (load_flags & NETSNMP_ACCESS_ROUTE_LOAD_IPV4_ONLY))
@@ -370,7 +642,11 @@ netsnmp_access_route_container_arch_load(netsnmp_container* container,
      * load ipv6. ipv6 module might not be loaded,
      * so ignore -2 err (file not found)
      */
-    rc = _load_ipv6(container, &count);
+#if defined(HAVE_LINUX_RTNETLINK_H)
+    rc = _load_netlink(container, &count, AF_INET6);
+    if (-3 == rc)
+#endif
+        rc = _load_ipv6(container, &count);
     if (-2 == rc)
         rc = 0;
 #endif
@@ -412,4 +688,160 @@ netsnmp_arch_route_delete(netsnmp_route_entry *entry)
     return _netsnmp_ioctl_route_delete_v4(entry);
 }
 
+#if defined(HAVE_LINUX_RTNETLINK_H)
+/*
+ * With "routeWatch yes", listen for routing (and link) changes from the
+ * kernel and expire the caches holding routes when one is reported,
+ * instead of reloading the whole routing table every cache timeout.
+ * The timeout is lengthened, but kept as a safety net.
+ */
+#define ROUTE_WATCH_TIMEOUT 600
+
+typedef struct route_watcher_s {
+    netsnmp_cache          *cache;
+    struct route_watcher_s *next;
+} route_watcher;
+
+static route_watcher *_route_watchers = NULL;
+static int            _route_watch_fd = -1;
+
+static void
+_route_watch_read(int fd, void *data)
+{
+    char            buf[16384];
+    struct nlmsghdr *h;
+    struct rtmsg   *rtm;
+    route_watcher  *watcher;
+    int             len, changed = 0;
+
+    for (;;) {
+        len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len < 0) {
+            if (EINTR == errno)
+                continue;
+            if (ENOBUFS == errno) {
+                /* some events were lost: reload to be safe */
+                changed = 1;
+                continue;
+            }
+            if (EAGAIN != errno)
+                snmp_log_perror("route_linux: netlink receive failed");
+            break;
+        }
+        if (0 == len)
+            break;
+
+        for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, len);
+             h = NLMSG_NEXT(h, len)) {
+            switch (h->nlmsg_type) {
+            case RTM_NEWROUTE:
+            case RTM_DELROUTE:
+                rtm = (struct rtmsg *) NLMSG_DATA(h);
+                if ((rtm->rtm_flags & RTM_F_CLONED) ||
+                    (AF_INET == rtm->rtm_family &&
+                     RT_TABLE_MAIN != rtm->rtm_table))
+                    break;
+                changed = 1;
+                break;
+            case RTM_NEWLINK:
+            case RTM_DELLINK:
+                changed = 1;
+                break;
+            }
+        }
+    }
+
+    if (!changed)
+        return;
+    DEBUGMSGTL(("access:route:watch", "routes changed\n"));
+    for (watcher = _route_watchers; watcher; watcher = watcher->next)
+        watcher->cache->expired = 1;
+}
+
+static void
+_route_watch_timeout(netsnmp_cache *cache)
+{
+    if (cache->timeout > 0 && cache->timeout < ROUTE_WATCH_TIMEOUT)
+        cache->timeout = ROUTE_WATCH_TIMEOUT;
+}
+
+static int
+_route_watch_start(int majorID, int minorID, void *serverarg,
+                   void *clientarg)
+{
+    struct sockaddr_nl sa;
+    route_watcher  *watcher;
+    int             fd;
+
+    if (_route_watch_fd >= 0 ||
+        !netsnmp_ds_get_boolean(NETSNMP_DS_APPLICATION_ID,
+                                NETSNMP_DS_AGENT_ROUTE_WATCH))
+        return SNMPERR_SUCCESS;
+
+    fd = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_ROUTE);
+    if (fd < 0) {
+        snmp_log_perror("route_linux: could not open netlink socket");
+        return SNMPERR_SUCCESS;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    sa.nl_groups = RTMGRP_IPV4_ROUTE | RTMGRP_LINK;
+#ifdef NETSNMP_ENABLE_IPV6
+    sa.nl_groups |= RTMGRP_IPV6_ROUTE;
+#endif
+    if (bind(fd, (struct sockaddr *) &sa, sizeof(sa)) < 0) {
+        snmp_log_perror("route_linux: netlink bind failed");
+        close(fd);
+        return SNMPERR_SUCCESS;
+    }
+    if (register_readfd(fd, _route_watch_read, NULL) != 0) {
+        snmp_log(LOG_ERR, "route_linux: error registering netlink socket\n");
+        close(fd);
+        return SNMPERR_SUCCESS;
+    }
+    _route_watch_fd = fd;
+
+    for (watcher = _route_watchers; watcher; watcher = watcher->next)
+        _route_watch_timeout(watcher->cache);
+    DEBUGMSGTL(("access:route:watch", "watching for route changes\n"));
+    return SNMPERR_SUCCESS;
+}
+
+int
+netsnmp_arch_route_watch(netsnmp_cache *cache)
+{
+    route_watcher  *watcher;
+
+    if (NULL == cache)
+        return -1;
+
+    if (NULL == _route_watchers) {
+        netsnmp_ds_register_config(ASN_BOOLEAN,
+                                   netsnmp_ds_get_string(NETSNMP_DS_LIBRARY_ID,
+                                                         NETSNMP_DS_LIB_APPTYPE),
+                                   "routeWatch", NETSNMP_DS_APPLICATION_ID,
+                                   NETSNMP_DS_AGENT_ROUTE_WATCH);
+        snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                               SNMP_CALLBACK_POST_READ_CONFIG,
+                               _route_watch_start, NULL);
+    }
 
+    watcher = SNMP_MALLOC_TYPEDEF(route_watcher);
+    if (NULL == watcher)
+        return -1;
+    watcher->cache = cache;
+    watcher->next = _route_watchers;
+    _route_watchers = watcher;
+
+    if (_route_watch_fd >= 0)
+        _route_watch_timeout(cache);
+    return 0;
+}
+#else /* HAVE_LINUX_RTNETLINK_H */
+int
+netsnmp_arch_route_watch(netsnmp_cache *cache)
+{
+    return -1;
+}
+#endif /* HAVE_LINUX_RTNETLINK_H */
@@ -254,3 +254,12 @@ static int _load_v6(netsnmp_container *container)
     }
     return 0;
 }
+
+/*
+ * no notification of route changes on this platform
+ */
+int
+netsnmp_arch_route_watch(netsnmp_cache *cache)
+{
+    return -1;
+}
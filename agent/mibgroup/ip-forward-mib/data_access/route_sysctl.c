@@ -443,3 +443,12 @@ _delete_ipv6(netsnmp_route_entry *entry)
     return 0;
 }
 #endif /* defined(freebsd7) || defined(netbsd) || defined(openbsd) */
+
+/*
+ * no notification of route changes on this platform
+ */
+int
+netsnmp_arch_route_watch(netsnmp_cache *cache)
+{
+    return -1;
+}
@@ -8,6 +8,7 @@
  * standard Net-SNMP includes 
  */
 #include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-features.h>
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
 
@@ -19,6 +20,8 @@
 
 #include "inetCidrRouteTable_data_access.h"
 
+netsnmp_feature_require(table_container_sync);
+
 /** @ingroup interface 
  * @addtogroup data_access data_access: Routines to access data
  *
@@ -130,19 +133,23 @@ inetCidrRouteTable_container_init(netsnmp_container **container_ptr_ptr,
      * cache->enabled to 0.
      */
     cache->timeout = INETCIDRROUTETABLE_CACHE_TIMEOUT;  /* seconds */
+    cache->flags |= NETSNMP_CACHE_DONT_FREE_BEFORE_LOAD
+        | NETSNMP_CACHE_BACKGROUND_RELOAD;
+
+    /*
+     * reload when the routes change, if configured to
+     */
+    netsnmp_access_route_watch(cache);
 }                               /* inetCidrRouteTable_container_init */
 
 /**
- * check entry for update
+ * set the table index of an entry
  */
-static void
-_snarf_route_entry(netsnmp_route_entry *route_entry,
-                   netsnmp_container *container)
+static int
+_route_entry_index(void *item, netsnmp_index *oid_idx, void *context)
 {
-    inetCidrRouteTable_rowreq_ctx *rowreq_ctx;
-
-    netsnmp_assert(NULL != route_entry);
-    netsnmp_assert(NULL != container);
+    netsnmp_route_entry *route_entry = (netsnmp_route_entry *) item;
+    inetCidrRouteTable_mib_index tbl_idx;
 
     /*
      * per  inetCidrRouteType:
@@ -153,13 +160,48 @@ _snarf_route_entry(netsnmp_route_entry *route_entry,
      */
     if (route_entry->rt_type == 0) {    /* set when route not up */
         DEBUGMSGT(("verbose:inetCidrRouteTable:inetCidrRouteTable_cache_load", "skipping route\n"));
-        netsnmp_access_route_entry_free(route_entry);
-        return;
+        return MFD_SKIP;
     }
 
+    if (MFD_SUCCESS != inetCidrRouteTable_indexes_set_tbl_idx
+        (&tbl_idx, route_entry->rt_dest_type,
+         (char *) route_entry->rt_dest, route_entry->rt_dest_len,
+         route_entry->rt_pfx_len,
+         route_entry->rt_policy, route_entry->rt_policy_len,
+         route_entry->rt_nexthop_type,
+         (char *) route_entry->rt_nexthop, route_entry->rt_nexthop_len))
+        return MFD_ERROR;
+
+    return inetCidrRouteTable_index_to_oid(oid_idx, &tbl_idx);
+}
+
+/**
+ * update existing entry
+ */
+static void
+_update_route_entry(void *row, void *item, void *context)
+{
+    inetCidrRouteTable_rowreq_ctx *rowreq_ctx =
+        (inetCidrRouteTable_rowreq_ctx *) row;
+    netsnmp_route_entry *route_entry = (netsnmp_route_entry *) item;
+
+    netsnmp_access_route_entry_copy(rowreq_ctx->data, route_entry);
+    netsnmp_access_route_entry_free(route_entry);
+}
+
+/**
+ * add new entry
+ */
+static void    *
+_snarf_route_entry(void *item, void *context)
+{
+    netsnmp_route_entry *route_entry = (netsnmp_route_entry *) item;
+    inetCidrRouteTable_rowreq_ctx *rowreq_ctx;
+
+    netsnmp_assert(NULL != route_entry);
+
     /*
-     * allocate an row context and set the index(es), then add it to
-     * the container
+     * allocate an row context and set the index(es)
      */
     rowreq_ctx = inetCidrRouteTable_allocate_rowreq_ctx(route_entry, NULL);
     if ((NULL != rowreq_ctx) &&
@@ -170,18 +212,47 @@ _snarf_route_entry(netsnmp_route_entry *route_entry,
           route_entry->rt_policy, route_entry->rt_policy_len,
           route_entry->rt_nexthop_type,
           (char *) route_entry->rt_nexthop, route_entry->rt_nexthop_len))) {
-        CONTAINER_INSERT(container, rowreq_ctx);
         rowreq_ctx->row_status = ROWSTATUS_ACTIVE;
-    } else {
-        if (rowreq_ctx) {
-            snmp_log(LOG_ERR, "error setting index while loading "
-                     "inetCidrRoute cache.\n");
-            inetCidrRouteTable_release_rowreq_ctx(rowreq_ctx);
-        } else
-            netsnmp_access_route_entry_free(route_entry);
+        return rowreq_ctx;
     }
+
+    if (rowreq_ctx) {
+        snmp_log(LOG_ERR, "error setting index while loading "
+                 "inetCidrRoute cache.\n");
+        inetCidrRouteTable_release_rowreq_ctx(rowreq_ctx);
+    } else
+        netsnmp_access_route_entry_free(route_entry);
+    return NULL;
+}
+
+/**
+ * release removed entry
+ */
+static void
+_release_route_entry(void *row, void *context)
+{
+    inetCidrRouteTable_release_rowreq_ctx((inetCidrRouteTable_rowreq_ctx *)
+                                          row);
 }
 
+/**
+ * free skipped entry
+ */
+static void
+_free_route_entry(void *item, void *context)
+{
+    netsnmp_access_route_entry_free((netsnmp_route_entry *) item);
+}
+
+static const netsnmp_container_table_sync_ops _route_entry_sync = {
+    _route_entry_index,
+    _update_route_entry,
+    _snarf_route_entry,
+    _release_route_entry,
+    _free_route_entry,
+    MAX_inetCidrRouteTable_IDX_LEN
+};
+
 /**
  * container shutdown
  *
@@ -216,8 +287,9 @@ inetCidrRouteTable_container_shutdown(netsnmp_container *container_ptr)
  *
  * TODO:350:M: Implement inetCidrRouteTable data load
  * This function will also be called by the cache helper to load
- * the container again (after the container free function has been
- * called to free the previous contents).
+ * the container again. The rows already in the container are updated
+ * in place, rows for deleted routes are removed and rows for new
+ * routes are added.
  *
  * @param container container to which items should be inserted
  *
@@ -270,11 +342,15 @@ inetCidrRouteTable_container_load(netsnmp_container *container)
                "%d records\n", (int)CONTAINER_SIZE(route_container)));
 
     /*
-     * we just got a fresh copy of route data. snarf data
+     * we just got a fresh copy of route data. merge it into the
+     * existing rows.
      */
-    CONTAINER_FOR_EACH(route_container,
-                       (netsnmp_container_obj_func *) _snarf_route_entry,
-                       container);
+    if (netsnmp_container_table_sync(container, route_container,
+                                     &_route_entry_sync, NULL) < 0) {
+        netsnmp_access_route_container_free(route_container,
+                                            NETSNMP_ACCESS_ROUTE_FREE_NOFLAGS);
+        return MFD_ERROR;
+    }
 
     /*
      * free the container. we've either claimed each ifentry, or released it,
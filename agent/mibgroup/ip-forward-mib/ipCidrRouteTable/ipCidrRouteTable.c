@@ -25,6 +25,7 @@
 #include <net-snmp/agent/mib_modules.h>
 
 #include "ipCidrRouteTable_interface.h"
+#include "ip-forward-mib/inetCidrRouteTable/inetCidrRouteTable_constants.h"
 
 const oid       ipCidrRouteTable_oid[] = { IPCIDRROUTETABLE_OID };
 const int       ipCidrRouteTable_oid_size =
@@ -509,6 +510,9 @@ ipCidrRouteType_get(ipCidrRouteTable_rowreq_ctx * rowreq_ctx,
      * copy (* ipCidrRouteType_val_ptr ) from rowreq_ctx->data
      */
     (*ipCidrRouteType_val_ptr) = rowreq_ctx->data->rt_type;
+    /* inetCidrRouteType blackhole(5) has no ipCidrRouteType equivalent */
+    if (INETCIDRROUTETYPE_BLACKHOLE == rowreq_ctx->data->rt_type)
+        (*ipCidrRouteType_val_ptr) = IPCIDRROUTETYPE_REJECT;
 
     return MFD_SUCCESS;
 }                               /* ipCidrRouteType_get */
@@ -132,6 +132,11 @@ ipCidrRouteTable_container_init(netsnmp_container **container_ptr_ptr,
      * cache->enabled to 0.
      */
     cache->timeout = IPCIDRROUTETABLE_CACHE_TIMEOUT;    /* seconds */
+
+    /*
+     * reload when the routes change, if configured to
+     */
+    netsnmp_access_route_watch(cache);
 }                               /* ipCidrRouteTable_container_init */
 
 /**
@@ -29,23 +29,24 @@ netsnmp_feature_child_of(ipaddress_arch_entry_copy, ipaddress_common);
 netsnmp_feature_require(ipaddress_ioctl_entry_copy);
 #endif /* NETSNMP_FEATURE_REQUIRE_IPADDRESS_ARCH_ENTRY_COPY */
 
-#if defined (NETSNMP_ENABLE_IPV6)
 #include <linux/types.h>
 #include <asm/types.h>
 #if defined(HAVE_LINUX_RTNETLINK_H)
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
-#ifdef RTMGRP_IPV6_PREFIX
+#if defined (NETSNMP_ENABLE_IPV6) && defined(RTMGRP_IPV6_PREFIX)
 #define SUPPORT_PREFIX_FLAGS 1
 #endif /* RTMGRP_IPV6_PREFIX */
 #endif /* HAVE_LINUX_RTNETLINK_H */
-#endif
 
 #include "ipaddress.h"
 #include "ipaddress_ioctl.h"
 #include "ipaddress_private.h"
 
 int _load_v6(netsnmp_container *container, int idx_offset);
+#ifdef HAVE_LINUX_RTNETLINK_H
+static int _load_v4_netlink(netsnmp_container *container, int idx_offset);
+#endif
 
 #ifdef HAVE_LINUX_RTNETLINK_H
 int
@@ -171,7 +172,12 @@ netsnmp_arch_ipaddress_container_load(netsnmp_container *container,
     int rc = 0, idx_offset = 0;
 
     if (0 == (load_flags & NETSNMP_ACCESS_IPADDRESS_LOAD_IPV6_ONLY)) {
-        rc = _netsnmp_ioctl_ipaddress_container_load_v4(container, idx_offset);
+#ifdef HAVE_LINUX_RTNETLINK_H
+        rc = _load_v4_netlink(container, idx_offset);
+        if (-3 == rc)
+#endif
+            rc = _netsnmp_ioctl_ipaddress_container_load_v4(container,
+                                                            idx_offset);
         if(rc < 0) {
             u_int flags = NETSNMP_ACCESS_IPADDRESS_FREE_KEEP_CONTAINER;
             netsnmp_access_ipaddress_container_free(container, flags);
@@ -208,6 +214,240 @@ netsnmp_arch_ipaddress_container_load(netsnmp_container *container,
     return rc;
 }
 
+#ifdef HAVE_LINUX_RTNETLINK_H
+#define NETSNMP_IPADDRESS_NETLINK_BUFSIZE 16384
+
+/*
+ * build the entry (and, if the address has one, its broadcast entry)
+ * for one RTM_NEWADDR message, and add them to the container.
+ *
+ * @retval the new idx_offset
+ * @retval -3 out of memory
+ */
+static int
+_v4_entry_from_netlink(netsnmp_container *container, struct nlmsghdr *nlmp,
+                       int idx_offset)
+{
+    struct ifaddrmsg        *ifa = (struct ifaddrmsg *) NLMSG_DATA(nlmp);
+    struct rtattr           *rta;
+    int                      rtalen;
+    struct in_addr          *local = NULL, *address = NULL, *bcast = NULL;
+    const char              *label = NULL;
+    char                     if_name[IFNAMSIZ];
+    int                      anycast = 0;
+    netsnmp_ipaddress_entry *entry, *bcastentry = NULL;
+    _ioctl_extras           *extras;
+    in_addr_t                ipval;
+
+    if (AF_INET != ifa->ifa_family)
+        return idx_offset;
+
+    rtalen = IFA_PAYLOAD(nlmp);
+    for (rta = IFA_RTA(ifa); RTA_OK(rta, rtalen);
+         rta = RTA_NEXT(rta, rtalen)) {
+        switch (rta->rta_type) {
+        case IFA_LOCAL:
+            local = (struct in_addr *) RTA_DATA(rta);
+            break;
+        case IFA_ADDRESS:
+            address = (struct in_addr *) RTA_DATA(rta);
+            break;
+        case IFA_BROADCAST:
+            bcast = (struct in_addr *) RTA_DATA(rta);
+            break;
+        case IFA_ANYCAST:
+            anycast = 1;
+            break;
+        case IFA_LABEL:
+            label = (const char *) RTA_DATA(rta);
+            break;
+        }
+    }
+    /*
+     * IFA_LOCAL is the interface's own address; IFA_ADDRESS is the peer
+     * address on point-to-point links.  SIOCGIFCONF reports the former.
+     */
+    if (NULL == local)
+        local = address;
+    if (NULL == local)
+        return idx_offset;
+
+    /*
+     * the label carries the alias name (eth0:1), like SIOCGIFCONF
+     */
+    if (NULL == label)
+        label = if_indextoname(ifa->ifa_index, if_name);
+    if (NULL == label)
+        return idx_offset;
+    strlcpy(if_name, label, sizeof(if_name));
+
+    DEBUGMSGTL(("access:ipaddress:container", " interface %d, %s\n",
+                ifa->ifa_index, if_name));
+
+    if (!netsnmp_access_interface_include(if_name))
+        return idx_offset;
+
+    if (netsnmp_access_interface_max_reached(if_name))
+        /* we may need to stop tracking ifaces if a max was set */
+        return idx_offset;
+
+    entry = netsnmp_access_ipaddress_entry_create();
+    if (NULL == entry)
+        return -3;
+    entry->ns_ia_index = ++idx_offset;
+
+    extras = netsnmp_ioctl_ipaddress_extras_get(entry);
+    memcpy(extras->name, if_name, sizeof(extras->name));
+    extras->flags = ifa->ifa_flags;
+    if (NULL != strchr(if_name, ':'))
+        entry->flags |= NETSNMP_ACCESS_IPADDRESS_ISALIAS;
+
+    entry->ia_address_len = sizeof(local->s_addr);
+    memcpy(entry->ia_address, &local->s_addr, entry->ia_address_len);
+    ipval = local->s_addr;
+    entry->if_index = ifa->ifa_index;
+    entry->ia_prefix_len = ifa->ifa_prefixlen;
+    entry->ia_type = anycast ? IPADDRESSTYPE_ANYCAST : IPADDRESSTYPE_UNICAST;
+
+    /*
+     * per the MIB:
+     *   In the absence of other information, an IPv4 address is
+     *   always preferred(1).
+     */
+    entry->ia_status = IPADDRESSSTATUSTC_PREFERRED;
+
+    /*
+     * can we figure out if an address is from DHCP?
+     * use manual until then...
+     */
+    entry->ia_origin = IS_APIPA(ipval) ? IPADDRESSORIGINTC_RANDOM :
+        IPADDRESSORIGINTC_MANUAL;
+
+#if defined (NETSNMP_ENABLE_IPV6)
+    /*
+     * broadcast addresses are only reported in IPv6 builds, as by the
+     * ioctl loader
+     */
+    if (NULL != bcast) {
+        bcastentry = netsnmp_access_ipaddress_entry_create();
+        if (NULL == bcastentry) {
+            netsnmp_access_ipaddress_entry_free(entry);
+            return -3;
+        }
+        bcastentry->ns_ia_index = ++idx_offset;
+        bcastentry->if_index = entry->if_index;
+        bcastentry->ia_address_len = sizeof(bcast->s_addr);
+        memcpy(bcastentry->ia_address, &bcast->s_addr,
+               bcastentry->ia_address_len);
+        bcastentry->ia_prefix_len = entry->ia_prefix_len;
+        bcastentry->ia_type = IPADDRESSTYPE_BROADCAST;
+        bcastentry->ia_status = IPADDRESSSTATUSTC_PREFERRED;
+        bcastentry->ia_origin = entry->ia_origin;
+        /* several addresses of an interface may share one */
+        if (CONTAINER_INSERT(container, bcastentry) < 0)
+            netsnmp_access_ipaddress_entry_free(bcastentry);
+    }
+#endif
+
+    DEBUGIF("access:ipaddress:container") {
+        DEBUGMSGT_NC(("access:ipaddress:container",
+                      " if %" NETSNMP_PRIo "u: addr %d.%d.%d.%d/%d, flags 0x%x\n",
+                      entry->if_index,
+                      entry->ia_address[0], entry->ia_address[1],
+                      entry->ia_address[2], entry->ia_address[3],
+                      entry->ia_prefix_len, extras->flags));
+    }
+
+    if (CONTAINER_INSERT(container, entry) < 0) {
+        DEBUGMSGTL(("access:ipaddress:container","error with ipaddress_entry: insert into container failed.\n"));
+        NETSNMP_LOGONCE((LOG_ERR, "Duplicate IPv4 address detected, some interfaces may not be visible in IP-MIB\n"));
+        netsnmp_access_ipaddress_entry_free(entry);
+    }
+    return idx_offset;
+}
+
+/*
+ * load the IPv4 addresses from an RTM_GETADDR dump, which also carries
+ * each address's prefix length and broadcast address; the ioctl loader
+ * needs several ioctls per address and a netlink dump per interface.
+ *
+ * @retval >=0 the new idx_offset
+ * @retval -2 error reading from netlink
+ * @retval -3 netlink not available (use the ioctls instead)
+ */
+static int
+_load_v4_netlink(netsnmp_container *container, int idx_offset)
+{
+    struct {
+        struct nlmsghdr  n;
+        struct ifaddrmsg r;
+    } req;
+    struct nlmsghdr *h;
+    char           *buf;
+    int             fd, len, done = 0, rc = 0;
+
+    fd = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_ROUTE);
+    if (fd < 0) {
+        DEBUGMSGTL(("access:ipaddress:container", "no netlink socket\n"));
+        return -3;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+    req.n.nlmsg_type = RTM_GETADDR;
+    req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.r.ifa_family = AF_INET;
+    if (send(fd, &req, req.n.nlmsg_len, 0) < 0) {
+        DEBUGMSGTL(("access:ipaddress:container", "netlink send failed\n"));
+        close(fd);
+        return -3;
+    }
+
+    buf = (char *) malloc(NETSNMP_IPADDRESS_NETLINK_BUFSIZE);
+    if (NULL == buf) {
+        close(fd);
+        return -3;
+    }
+
+    while (!done) {
+        len = recv(fd, buf, NETSNMP_IPADDRESS_NETLINK_BUFSIZE, 0);
+        if (len < 0 && EINTR == errno)
+            continue;
+        if (len <= 0) {
+            snmp_log_perror("ipaddress_linux: netlink receive failed");
+            rc = -2;
+            break;
+        }
+        for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, len);
+             h = NLMSG_NEXT(h, len)) {
+            if (NLMSG_DONE == h->nlmsg_type) {
+                done = 1;
+                break;
+            }
+            if (NLMSG_ERROR == h->nlmsg_type) {
+                snmp_log(LOG_ERR,
+                         "ipaddress_linux: netlink address dump failed\n");
+                rc = -2;
+                done = 1;
+                break;
+            }
+            if (RTM_NEWADDR != h->nlmsg_type)
+                continue;
+            idx_offset = _v4_entry_from_netlink(container, h, idx_offset);
+            if (idx_offset < 0) {
+                rc = idx_offset;
+                done = 1;
+                break;
+            }
+        }
+    }
+
+    free(buf);
+    close(fd);
+    return rc < 0 ? rc : idx_offset;
+}
+#endif /* HAVE_LINUX_RTNETLINK_H */
+
 #if defined (NETSNMP_ENABLE_IPV6)
 /**
  */
@@ -53,6 +53,7 @@ netsnmp_feature_require(row_merge);
 netsnmp_feature_require(baby_steps);
 netsnmp_feature_require(table_container_row_insert);
 netsnmp_feature_require(check_all_requests_error);
+netsnmp_feature_require(table_container_hash_index);
 
 
 netsnmp_feature_child_of(ipAddressTable_container_size, ipAddressTable_external_access);
@@ -2042,6 +2043,10 @@ _ipAddressTable_container_init(ipAddressTable_interface_ctx * if_ctx)
         return;
     }
 
+    /*
+     * pollers mostly GET known rows; look those up by hash
+     */
+    (void) netsnmp_container_table_add_hash_index(if_ctx->container);
     if (NULL != if_ctx->cache)
         if_ctx->cache->magic = (void *) if_ctx->container;
 }                               /* _ipAddressTable_container_init */
@@ -350,7 +350,7 @@ init_system_mib(void)
             netsnmp_create_handler_registration(
                 "mibII/sysUpTime", handle_sysUpTime,
                 sysUpTime_oid, OID_LENGTH(sysUpTime_oid),
-                HANDLER_CAN_RONLY));
+                HANDLER_CAN_RONLY | HANDLER_CAN_THREAD_SAFE));
     }
     {
         const oid sysContact_oid[] = { 1, 3, 6, 1, 2, 1, 1, 4 };
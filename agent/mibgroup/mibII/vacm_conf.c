@@ -206,9 +206,9 @@ vacm_parse_group(const char *token, char *param)
         config_perror("failed to create group entry");
         return;
     }
-    strlcpy(gp->groupName, group, sizeof(gp->groupName));
+    vacm_setGroupName(gp, group, strlen(group));
     gp->storageType = SNMP_STORAGE_PERMANENT;
-    gp->status = SNMP_ROW_ACTIVE;
+    vacm_setGroupStatus(gp, SNMP_ROW_ACTIVE);
     free(gp->reserved);
     gp->reserved = NULL;
 }
@@ -485,12 +485,12 @@ vacm_parse_authaccess(const char *token, char *confline)
 
     for (i = 0; i < VACM_MAX_VIEWS; i++) {
         if (viewtypes & (1 << i)) {
-            strlcpy(ap->views[i], view, sizeof(ap->views[i]));
+            vacm_setAccessView(ap, i, view, strlen(view));
         }
     }
-    ap->contextMatch = prefix;
+    vacm_setAccessContextMatch(ap, prefix);
     ap->storageType  = SNMP_STORAGE_PERMANENT;
-    ap->status       = SNMP_ROW_ACTIVE;
+    vacm_setAccessStatus(ap, SNMP_ROW_ACTIVE);
     if (ap->reserved)
         free(ap->reserved);
     ap->reserved = NULL;
@@ -547,10 +547,10 @@ vacm_parse_setaccess(const char *token, char *param)
         return;
     }
 
-    strlcpy(ap->views[viewnum], viewval, sizeof(ap->views[viewnum]));
-    ap->contextMatch = iprefix;
+    vacm_setAccessView(ap, viewnum, viewval, strlen(viewval));
+    vacm_setAccessContextMatch(ap, iprefix);
     ap->storageType = SNMP_STORAGE_PERMANENT;
-    ap->status = SNMP_ROW_ACTIVE;
+    vacm_setAccessStatus(ap, SNMP_ROW_ACTIVE);
     free(ap->reserved);
     ap->reserved = NULL;
 }
@@ -603,15 +603,12 @@ vacm_parse_access(const char *token, char *param)
         config_perror("failed to create access entry");
         return;
     }
-    strlcpy(ap->views[VACM_VIEW_READ], readView,
-            sizeof(ap->views[VACM_VIEW_READ]));
-    strlcpy(ap->views[VACM_VIEW_WRITE], writeView,
-            sizeof(ap->views[VACM_VIEW_WRITE]));
-    strlcpy(ap->views[VACM_VIEW_NOTIFY], notify,
-            sizeof(ap->views[VACM_VIEW_NOTIFY]));
-    ap->contextMatch = iprefix;
+    vacm_setAccessView(ap, VACM_VIEW_READ, readView, strlen(readView));
+    vacm_setAccessView(ap, VACM_VIEW_WRITE, writeView, strlen(writeView));
+    vacm_setAccessView(ap, VACM_VIEW_NOTIFY, notify, strlen(notify));
+    vacm_setAccessContextMatch(ap, iprefix);
     ap->storageType = SNMP_STORAGE_PERMANENT;
-    ap->status = SNMP_ROW_ACTIVE;
+    vacm_setAccessStatus(ap, SNMP_ROW_ACTIVE);
     free(ap->reserved);
     ap->reserved = NULL;
 }
@@ -693,11 +690,10 @@ vacm_parse_view(const char *token, char *param)
         config_perror("failed to create view entry");
         return;
     }
-    memcpy(vp->viewMask, viewMask, sizeof(viewMask));
-    vp->viewMaskLen = mask_len;
-    vp->viewType = inclexcl;
+    vacm_setViewMask(vp, viewMask, mask_len);
+    vacm_setViewType(vp, inclexcl);
     vp->viewStorageType = SNMP_STORAGE_PERMANENT;
-    vp->viewStatus = SNMP_ROW_ACTIVE;
+    vacm_setViewStatus(vp, SNMP_ROW_ACTIVE);
     free(vp->reserved);
     vp->reserved = NULL;
 }
@@ -1273,6 +1269,7 @@ vacm_check_view_contents(netsnmp_pdu *pdu, oid * name, size_t namelen,
 #endif
     const char     *sn = NULL;
     char           *vn;
+    int             rc;
 
     /*
      * len defined by the vacmContextName object 
@@ -1439,18 +1436,17 @@ vacm_check_view_contents(netsnmp_pdu *pdu, oid * name, size_t namelen,
 
     DEBUGMSGTL(("mibII/vacm_vars", "vacm_in_view: sn=%s", sn));
 
-    gp = vacm_getGroupEntry(pdu->securityModel, sn);
+    rc = vacm_getAccessForRequest(pdu->securityModel, sn, contextNameIndex,
+                                  pdu->securityLevel, &gp, &ap);
     if (gp == NULL) {
         DEBUGMSG(("mibII/vacm_vars", "\n"));
         return VACM_NOGROUP;
     }
     DEBUGMSG(("mibII/vacm_vars", ", gn=%s", gp->groupName));
 
-    ap = vacm_getAccessEntry(gp->groupName, contextNameIndex,
-                             pdu->securityModel, pdu->securityLevel);
-    if (ap == NULL) {
+    if (rc != VACM_SUCCESS) {
         DEBUGMSG(("mibII/vacm_vars", "\n"));
-        return VACM_NOACCESS;
+        return rc;
     }
 
     if (name == NULL) { /* only check the setup of the vacm for the request */
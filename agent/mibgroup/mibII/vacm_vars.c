@@ -778,10 +778,9 @@ write_vacmGroupName(int action,
         } else {
             resetOnFail = 1;
             memcpy(string, geptr->groupName, VACMSTRINGLEN);
-            memcpy(geptr->groupName, var_val, var_val_len);
-            geptr->groupName[var_val_len] = 0;
+            vacm_setGroupName(geptr, (char *) var_val, var_val_len);
             if (geptr->status == RS_NOTREADY) {
-                geptr->status = RS_NOTINSERVICE;
+                vacm_setGroupStatus(geptr, RS_NOTINSERVICE);
             }
         }
     } else if (action == FREE) {
@@ -790,7 +789,8 @@ write_vacmGroupName(int action,
          */
         if ((geptr = sec2group_parse_groupEntry(name, name_len)) != NULL &&
             resetOnFail) {
-            memcpy(geptr->groupName, string, VACMSTRINGLEN);
+            vacm_setGroupName(geptr, (char *) string,
+                              strlen((char *) string));
         }
     }
     return SNMP_ERR_NOERROR;
@@ -914,7 +914,7 @@ write_vacmSecurityToGroupStatus(int action,
                  * Set defaults.  
                  */
                 geptr->storageType = ST_NONVOLATILE;
-                geptr->status = RS_NOTREADY;
+                vacm_setGroupStatus(geptr, RS_NOTREADY);
             }
         }
         free(newName);
@@ -935,14 +935,14 @@ write_vacmSecurityToGroupStatus(int action,
                     free(newName);
                     return SNMP_ERR_INCONSISTENTVALUE;
                 }
-                geptr->status = RS_ACTIVE;
+                vacm_setGroupStatus(geptr, RS_ACTIVE);
             } else if (long_ret == RS_CREATEANDWAIT) {
                 if (geptr->groupName[0] != 0) {
-                    geptr->status = RS_NOTINSERVICE;
+                    vacm_setGroupStatus(geptr, RS_NOTINSERVICE);
                 }
             } else if (long_ret == RS_NOTINSERVICE) {
                 if (geptr->status == RS_ACTIVE) {
-                    geptr->status = RS_NOTINSERVICE;
+                    vacm_setGroupStatus(geptr, RS_NOTINSERVICE);
                 } else if (geptr->status == RS_NOTREADY) {
                     free(newName);
                     return SNMP_ERR_INCONSISTENTVALUE;
@@ -1163,9 +1163,10 @@ write_vacmAccessStatus(int action,
                 /*
                  * Set defaults.  
                  */
-                aptr->contextMatch = 1; /*  exact(1) is the DEFVAL  */
+                /*  exact(1) is the DEFVAL  */
+                vacm_setAccessContextMatch(aptr, 1);
                 aptr->storageType = ST_NONVOLATILE;
-                aptr->status = RS_NOTREADY;
+                vacm_setAccessStatus(aptr, RS_NOTREADY);
             }
         }
         free(newGroupName);
@@ -1182,12 +1183,12 @@ write_vacmAccessStatus(int action,
 
         if (aptr != NULL) {
             if (long_ret == RS_CREATEANDGO || long_ret == RS_ACTIVE) {
-                aptr->status = RS_ACTIVE;
+                vacm_setAccessStatus(aptr, RS_ACTIVE);
             } else if (long_ret == RS_CREATEANDWAIT) {
-                aptr->status = RS_NOTINSERVICE;
+                vacm_setAccessStatus(aptr, RS_NOTINSERVICE);
             } else if (long_ret == RS_NOTINSERVICE) {
                 if (aptr->status == RS_ACTIVE) {
-                    aptr->status = RS_NOTINSERVICE;
+                    vacm_setAccessStatus(aptr, RS_NOTINSERVICE);
                 } else if (aptr->status == RS_NOTREADY) {
                     free(newGroupName);
                     free(newContextPrefix);
@@ -1317,7 +1318,7 @@ write_vacmAccessContextMatch(int action,
         }
         long_ret = *((long *) var_val);
         if (long_ret == CM_EXACT || long_ret == CM_PREFIX) {
-            aptr->contextMatch = long_ret;
+            vacm_setAccessContextMatch(aptr, long_ret);
         } else {
             return SNMP_ERR_WRONGVALUE;
         }
@@ -1354,8 +1355,8 @@ write_vacmAccessReadViewName(int action,
         } else {
             resetOnFail = 1;
             memcpy(string, aptr->views[VACM_VIEW_READ], VACMSTRINGLEN);
-            memcpy(aptr->views[VACM_VIEW_READ], var_val, var_val_len);
-            aptr->views[VACM_VIEW_READ][var_val_len] = 0;
+            vacm_setAccessView(aptr, VACM_VIEW_READ, (char *) var_val,
+                               var_val_len);
         }
     } else if (action == FREE) {
         /*
@@ -1363,7 +1364,8 @@ write_vacmAccessReadViewName(int action,
          */
         if ((aptr = access_parse_accessEntry(name, name_len)) != NULL &&
             resetOnFail) {
-            memcpy(aptr->views[VACM_VIEW_READ], string, var_val_len);
+            vacm_setAccessView(aptr, VACM_VIEW_READ, (char *) string,
+                               strlen((char *) string));
         }
     }
     return SNMP_ERR_NOERROR;
@@ -1398,8 +1400,8 @@ write_vacmAccessWriteViewName(int action,
         } else {
             resetOnFail = 1;
             memcpy(string, aptr->views[VACM_VIEW_WRITE], VACMSTRINGLEN);
-            memcpy(aptr->views[VACM_VIEW_WRITE], var_val, var_val_len);
-            aptr->views[VACM_VIEW_WRITE][var_val_len] = 0;
+            vacm_setAccessView(aptr, VACM_VIEW_WRITE, (char *) var_val,
+                               var_val_len);
         }
     } else if (action == FREE) {
         /*
@@ -1407,7 +1409,8 @@ write_vacmAccessWriteViewName(int action,
          */
         if ((aptr = access_parse_accessEntry(name, name_len)) != NULL &&
             resetOnFail) {
-            memcpy(aptr->views[VACM_VIEW_WRITE], string, var_val_len);
+            vacm_setAccessView(aptr, VACM_VIEW_WRITE, (char *) string,
+                               strlen((char *) string));
         }
     }
     return SNMP_ERR_NOERROR;
@@ -1442,8 +1445,8 @@ write_vacmAccessNotifyViewName(int action,
         } else {
             resetOnFail = 1;
             memcpy(string, aptr->views[VACM_VIEW_NOTIFY], VACMSTRINGLEN);
-            memcpy(aptr->views[VACM_VIEW_NOTIFY], var_val, var_val_len);
-            aptr->views[VACM_VIEW_NOTIFY][var_val_len] = 0;
+            vacm_setAccessView(aptr, VACM_VIEW_NOTIFY, (char *) var_val,
+                               var_val_len);
         }
     } else if (action == FREE) {
         /*
@@ -1451,7 +1454,8 @@ write_vacmAccessNotifyViewName(int action,
          */
         if ((aptr = access_parse_accessEntry(name, name_len)) != NULL &&
             resetOnFail) {
-            memcpy(aptr->views[VACM_VIEW_NOTIFY], string, var_val_len);
+            vacm_setAccessView(aptr, VACM_VIEW_NOTIFY, (char *) string,
+                               strlen((char *) string));
         }
     }
     return SNMP_ERR_NOERROR;
@@ -1629,8 +1633,8 @@ write_vacmViewStatus(int action,
                  * Set defaults.  
                  */
                 vptr->viewStorageType = ST_NONVOLATILE;
-                vptr->viewStatus = RS_NOTREADY;
-                vptr->viewType = SNMP_VIEW_INCLUDED;
+                vacm_setViewStatus(vptr, RS_NOTREADY);
+                vacm_setViewType(vptr, SNMP_VIEW_INCLUDED);
             }
         }
         free(newViewName);
@@ -1646,12 +1650,12 @@ write_vacmViewStatus(int action,
 
         if (vptr != NULL) {
             if (long_ret == RS_CREATEANDGO || long_ret == RS_ACTIVE) {
-                vptr->viewStatus = RS_ACTIVE;
+                vacm_setViewStatus(vptr, RS_ACTIVE);
             } else if (long_ret == RS_CREATEANDWAIT) {
-                vptr->viewStatus = RS_NOTINSERVICE;
+                vacm_setViewStatus(vptr, RS_NOTINSERVICE);
             } else if (long_ret == RS_NOTINSERVICE) {
                 if (vptr->viewStatus == RS_ACTIVE) {
-                    vptr->viewStatus = RS_NOTINSERVICE;
+                    vacm_setViewStatus(vptr, RS_NOTINSERVICE);
                 } else if (vptr->viewStatus == RS_NOTREADY) {
                     free(newViewName);
                     free(newViewSubtree);
@@ -1766,13 +1770,11 @@ write_vacmViewMask(int action,
         } else {
             memcpy(string, vptr->viewMask, vptr->viewMaskLen);
             length = vptr->viewMaskLen;
-            memcpy(vptr->viewMask, var_val, var_val_len);
-            vptr->viewMaskLen = var_val_len;
+            vacm_setViewMask(vptr, var_val, var_val_len);
         }
     } else if (action == FREE) {
         if ((vptr = view_parse_viewEntry(name, name_len)) != NULL) {
-            memcpy(vptr->viewMask, string, length);
-            vptr->viewMaskLen = length;
+            vacm_setViewMask(vptr, string, length);
         }
     }
     return SNMP_ERR_NOERROR;
@@ -1804,11 +1806,11 @@ write_vacmViewType(int action,
             return SNMP_ERR_INCONSISTENTNAME;
         } else {
             oldValue = vptr->viewType;
-            vptr->viewType = newValue;
+            vacm_setViewType(vptr, newValue);
         }
     } else if (action == UNDO) {
         if ((vptr = view_parse_viewEntry(name, name_len)) != NULL) {
-            vptr->viewType = oldValue;
+            vacm_setViewType(vptr, oldValue);
         }
     }
 
@@ -64,6 +64,7 @@
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
 #include <net-snmp/library/tools.h>
+#include <net-snmp/library/fd_event_manager.h>
 
 #include "smux.h"
 #include "snmpd.h"
@@ -276,6 +277,8 @@ real_init_smux(void)
         return;
     }
 
+    netsnmp_event_loop_watch_fd(smux_listen_sd, NETSNMP_EVENT_LOOP_READ);
+
     DEBUGMSGTL(("smux_init",
                 "[smux_init] done; smux listen sd is %d, smux port is %d\n",
                 smux_listen_sd, ntohs(lo_socket.sin_port)));
@@ -2181,6 +2184,7 @@ int smux_snmp_select_list_add(int sd)
    if (sdlen < NUM_SOCKETS)
    {
       sdlist[sdlen++] = sd;
+      netsnmp_event_loop_watch_fd(sd, NETSNMP_EVENT_LOOP_READ);
       return(1);
    }
    return(0);
@@ -2202,6 +2206,7 @@ int smux_snmp_select_list_del(int sd)
    if (found)
    {
       sdlen--;
+      netsnmp_event_loop_forget_fd(sd);
       return(1);
    }
    return(0);
@@ -652,6 +652,7 @@ usmDHUserAuthKeyChange_undo(usmDHUserKeyTable_rowreq_ctx * rowreq_ctx)
     undouser = rowreq_ctx->undo;
 
     undouser->authKeyLen = rowreq_ctx->data->authKeyLen;
+    sc_forget_key(rowreq_ctx->data->authKey, rowreq_ctx->data->authKeyLen);
     SNMP_FREE(rowreq_ctx->data->authKey);
     rowreq_ctx->data->authKey = undouser->authKey;
     undouser->authKey = NULL;
@@ -1038,6 +1039,7 @@ usmDHUserPrivKeyChange_undo(usmDHUserKeyTable_rowreq_ctx * rowreq_ctx)
 
     /** uncopy priv key */
     undouser->privKeyLen = rowreq_ctx->data->privKeyLen;
+    sc_forget_key(rowreq_ctx->data->privKey, rowreq_ctx->data->privKeyLen);
     SNMP_FREE(rowreq_ctx->data->privKey);
     rowreq_ctx->data->privKey = undouser->privKey;
     undouser->privKey = NULL;
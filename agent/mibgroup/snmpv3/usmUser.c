@@ -880,9 +880,11 @@ write_usmUserAuthKeyChange(int action,
         }
         uptr->authKeyLen = buflen;
     } else if (action == COMMIT) {
+        sc_forget_key(oldkey, oldkeylen);
         SNMP_FREE(oldkey);
     } else if (action == UNDO) {
         if ((uptr = usm_parse_user(name, name_len)) != NULL && resetOnFail) {
+            sc_forget_key(uptr->authKey, uptr->authKeyLen);
             SNMP_FREE(uptr->authKey);
             uptr->authKey = oldkey;
             uptr->authKeyLen = oldkeylen;
@@ -1127,9 +1129,11 @@ write_usmUserPrivKeyChange(int action,
             return res;
         resetOnFail = 1;
     } else if (action == COMMIT) {
+        sc_forget_key(oldkey, oldkeylen);
         SNMP_FREE(oldkey);
     } else if (action == UNDO) {
         if ((uptr = usm_parse_user(name, name_len)) != NULL && resetOnFail) {
+            sc_forget_key(uptr->privKey, uptr->privKeyLen);
             SNMP_FREE(uptr->privKey);
             uptr->privKey = oldkey;
             uptr->privKeyLen = oldkeylen;
@@ -6,6 +6,8 @@
 #define EXECPROC 2
 #define PASSTHRU 3
 #define PASSTHRU_PERSIST 4
+#define PASSTHRU_PERSIST_TAGGED 5
+#define PASSTHRU_THREADED 6
 #define MIBMAX 30
 
 struct extensible {
@@ -12,6 +12,15 @@
 #include "tcp-mib/tcpConnectionTable/tcpConnectionTable_constants.h"
 #include "tcp-mib/data_access/tcpConn_private.h"
 #include "mibgroup/util_funcs/get_pid_from_inode.h"
+
+#if defined(HAVE_LINUX_SOCK_DIAG_H) && defined(HAVE_LINUX_INET_DIAG_H)
+#include <errno.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#define NETSNMP_TCPCONN_SOCK_DIAG 1
+#endif
+
 static int
 linux_states[12] = { 1, 5, 3, 4, 6, 7, 11, 1, 8, 9, 2, 10 };
 
@@ -19,6 +28,9 @@ static int _load4(netsnmp_container *container, u_int flags);
 #if defined (NETSNMP_ENABLE_IPV6)
 static int _load6(netsnmp_container *container, u_int flags);
 #endif
+#ifdef NETSNMP_TCPCONN_SOCK_DIAG
+static int _load_diag(netsnmp_container *container, u_int flags, int family);
+#endif
 
 /*
  * initialize arch specific storage
@@ -92,7 +104,15 @@ netsnmp_arch_tcpconn_container_load(netsnmp_container *container,
         return -1;
     }
 
-    rc = _load4(container, load_flags);
+#ifdef NETSNMP_TCPCONN_SOCK_DIAG
+    /*
+     * ask the kernel for binary socket records, rather than parsing
+     * /proc/net/tcp. Fall back to /proc if sock_diag isn't available.
+     */
+    rc = _load_diag(container, load_flags, AF_INET);
+    if (-4 == rc)
+#endif
+        rc = _load4(container, load_flags);
 
 #if defined (NETSNMP_ENABLE_IPV6)
     if((0 != rc) || (load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_IPV4_ONLY))
@@ -102,7 +122,11 @@ netsnmp_arch_tcpconn_container_load(netsnmp_container *container,
      * load ipv6. ipv6 module might not be loaded,
      * so ignore -2 err (file not found)
      */
-    rc = _load6(container, load_flags);
+#ifdef NETSNMP_TCPCONN_SOCK_DIAG
+    rc = _load_diag(container, load_flags, AF_INET6);
+    if (-4 == rc)
+#endif
+        rc = _load6(container, load_flags);
     if (-2 == rc)
         rc = 0;
 #endif
@@ -400,3 +424,135 @@ _load6(netsnmp_container *container, u_int load_flags)
     return 0;
 }
 #endif /* NETSNMP_ENABLE_IPV6 */
+
+#ifdef NETSNMP_TCPCONN_SOCK_DIAG
+/**
+ * load the sockets of one address family with a NETLINK_SOCK_DIAG dump.
+ * The listen/non-listen choice is passed to the kernel as a state
+ * filter, so sockets we don't want are never copied to us.
+ *
+ * @retval  0 no errors
+ * @retval -3 out of memory
+ * @retval -4 sock_diag not available (use /proc instead)
+ * @retval -5 error reading from the kernel
+ */
+static int
+_load_diag(netsnmp_container *container, u_int load_flags, int family)
+{
+    struct {
+        struct nlmsghdr         n;
+        struct inet_diag_req_v2 r;
+    } req;
+    struct sockaddr_nl  sa;
+    struct nlmsghdr    *h;
+    struct inet_diag_msg *msg;
+    netsnmp_tcpconn_entry *entry;
+    char               *buf;
+    int                 fd, len, addr_len, done = 0, rc = 0, count = 0;
+    enum                { bufsize = 65536 };
+
+    netsnmp_assert(NULL != container);
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_SOCK_DIAG);
+    if (fd < 0) {
+        DEBUGMSGTL(("access:tcpconn:container", "no sock_diag socket\n"));
+        return -4;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.n.nlmsg_len = sizeof(req);
+    req.n.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.r.sdiag_family = family;
+    req.r.sdiag_protocol = IPPROTO_TCP;
+    if (load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_ONLYLISTEN)
+        req.r.idiag_states = 1 << 10;           /* TCP_LISTEN */
+    else if (load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_NOLISTEN)
+        req.r.idiag_states = ~(1U << 10);
+    else
+        req.r.idiag_states = ~0U;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    if (sendto(fd, &req, sizeof(req), 0, (struct sockaddr *) &sa,
+               sizeof(sa)) < 0) {
+        DEBUGMSGTL(("access:tcpconn:container", "sock_diag send failed\n"));
+        close(fd);
+        return -4;
+    }
+
+    buf = (char *) malloc(bufsize);
+    if (NULL == buf) {
+        close(fd);
+        return -3;
+    }
+
+    addr_len = (AF_INET == family) ? 4 : 16;
+    while (!done) {
+        len = recv(fd, buf, bufsize, 0);
+        if (len < 0 && EINTR == errno)
+            continue;
+        if (len <= 0) {
+            snmp_log_perror("tcp:_load_diag: receive failed");
+            rc = -5;
+            break;
+        }
+        for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, len);
+             h = NLMSG_NEXT(h, len)) {
+            if (NLMSG_DONE == h->nlmsg_type) {
+                done = 1;
+                break;
+            }
+            if (NLMSG_ERROR == h->nlmsg_type) {
+                struct nlmsgerr *err = (struct nlmsgerr *) NLMSG_DATA(h);
+                /*
+                 * an error before any socket means the kernel doesn't
+                 * do sock_diag for this family (module not loaded)
+                 */
+                DEBUGMSGTL(("access:tcpconn:container",
+                            "sock_diag error %d (family %d)\n",
+                            -err->error, family));
+                rc = (0 == count) ? -4 : -5;
+                done = 1;
+                break;
+            }
+            if (SOCK_DIAG_BY_FAMILY != h->nlmsg_type ||
+                h->nlmsg_len < NLMSG_LENGTH(sizeof(*msg)))
+                continue;
+            msg = (struct inet_diag_msg *) NLMSG_DATA(h);
+
+            entry = netsnmp_access_tcpconn_entry_create();
+            if (NULL == entry) {
+                rc = -3;
+                done = 1;
+                break;
+            }
+
+            entry->loc_port = ntohs(msg->id.idiag_sport);
+            entry->rmt_port = ntohs(msg->id.idiag_dport);
+            entry->tcpConnState = (msg->idiag_state < 12) ?
+                linux_states[msg->idiag_state] : 2;
+            entry->pid = netsnmp_get_pid_from_inode(msg->idiag_inode);
+
+            /** addresses are in network order already */
+            memcpy(entry->loc_addr, msg->id.idiag_src, addr_len);
+            entry->loc_addr_len = addr_len;
+            memcpy(entry->rmt_addr, msg->id.idiag_dst, addr_len);
+            entry->rmt_addr_len = addr_len;
+
+            /*
+             * add entry to container
+             */
+            entry->arbitrary_index = CONTAINER_SIZE(container) + 1;
+            CONTAINER_INSERT(container, entry);
+            ++count;
+        }
+    }
+
+    DEBUGMSGTL(("access:tcpconn:container",
+                "sock_diag loaded %d sockets (family %d)\n", count, family));
+    free(buf);
+    close(fd);
+    return rc;
+}
+#endif /* NETSNMP_TCPCONN_SOCK_DIAG */
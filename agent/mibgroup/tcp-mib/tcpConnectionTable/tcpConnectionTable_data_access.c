@@ -8,6 +8,7 @@
  * standard Net-SNMP includes 
  */
 #include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-features.h>
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
 
@@ -19,6 +20,8 @@
 
 #include "tcpConnectionTable_data_access.h"
 
+netsnmp_feature_require(table_container_sync);
+
 /** @ingroup interface 
  * @addtogroup data_access data_access: Routines to access data
  *
@@ -130,7 +133,9 @@ tcpConnectionTable_container_init(netsnmp_container **container_ptr_ptr,
      * cache->enabled to 0.
      */
     cache->timeout = TCPCONNECTIONTABLE_CACHE_TIMEOUT;  /* seconds */
-    cache->flags |= NETSNMP_CACHE_DONT_INVALIDATE_ON_SET;
+    cache->flags |= NETSNMP_CACHE_DONT_INVALIDATE_ON_SET
+        | NETSNMP_CACHE_DONT_FREE_BEFORE_LOAD
+        | NETSNMP_CACHE_BACKGROUND_RELOAD;
 }                               /* tcpConnectionTable_container_init */
 
 /**
@@ -163,18 +168,56 @@ tcpConnectionTable_container_shutdown(netsnmp_container *container_ptr)
 }                               /* tcpConnectionTable_container_shutdown */
 
 /**
- * add new entry
+ * set the table index of an entry
+ */
+static int
+_connection_index(void *item, netsnmp_index *oid_idx, void *context)
+{
+    netsnmp_tcpconn_entry *entry = (netsnmp_tcpconn_entry *) item;
+    tcpConnectionTable_mib_index tbl_idx;
+
+    if (MFD_SUCCESS !=
+        tcpConnectionTable_indexes_set_tbl_idx(&tbl_idx,
+                                               entry->loc_addr_len,
+                                               entry->loc_addr,
+                                               entry->loc_addr_len,
+                                               entry->loc_port,
+                                               entry->rmt_addr_len,
+                                               entry->rmt_addr,
+                                               entry->rmt_addr_len,
+                                               entry->rmt_port))
+        return MFD_ERROR;
+
+    return tcpConnectionTable_index_to_oid(oid_idx, &tbl_idx);
+}
+
+/**
+ * update existing entry
  */
 static void
-_add_connection(netsnmp_tcpconn_entry *entry, netsnmp_container *container)
+_update_connection(void *row, void *item, void *context)
 {
+    tcpConnectionTable_rowreq_ctx *rowreq_ctx =
+        (tcpConnectionTable_rowreq_ctx *) row;
+    netsnmp_tcpconn_entry *entry = (netsnmp_tcpconn_entry *) item;
+
+    netsnmp_access_tcpconn_entry_update(rowreq_ctx->data, entry);
+    netsnmp_access_tcpconn_entry_free(entry);
+}
+
+/**
+ * add new entry
+ */
+static void    *
+_add_connection(void *item, void *context)
+{
+    netsnmp_tcpconn_entry *entry = (netsnmp_tcpconn_entry *) item;
     tcpConnectionTable_rowreq_ctx *rowreq_ctx;
 
     DEBUGMSGTL(("tcpConnectionTable:access", "creating new entry\n"));
 
     /*
-     * allocate an row context and set the index(es), then add it to
-     * the container
+     * allocate an row context and set the index(es)
      */
     rowreq_ctx = tcpConnectionTable_allocate_rowreq_ctx(entry, NULL);
     if ((NULL != rowreq_ctx) &&
@@ -186,33 +229,57 @@ _add_connection(netsnmp_tcpconn_entry *entry, netsnmp_container *container)
                                                        entry->rmt_addr_len,
                                                        entry->rmt_addr,
                                                        entry->rmt_addr_len,
-                                                       entry->rmt_port))) {
-        if (CONTAINER_INSERT(container, rowreq_ctx)) {
-            NETSNMP_LOGONCE((LOG_DEBUG,
-                    "Error inserting entry to tcpConnectionTable,"\
-                    " entry already exists.\n"));
-            tcpConnectionTable_release_rowreq_ctx(rowreq_ctx);
-        }
+                                                       entry->rmt_port)))
+        return rowreq_ctx;
+
+    if (rowreq_ctx) {
+        snmp_log(LOG_ERR, "error setting index while loading "
+                 "tcpConnectionTable cache.\n");
+        tcpConnectionTable_release_rowreq_ctx(rowreq_ctx);
     } else {
-        if (rowreq_ctx) {
-            snmp_log(LOG_ERR, "error setting index while loading "
-                     "tcpConnectionTable cache.\n");
-            tcpConnectionTable_release_rowreq_ctx(rowreq_ctx);
-        } else {
-            snmp_log(LOG_ERR, "memory allocation failed while loading "
-                     "tcpConnectionTable cache.\n");
-            netsnmp_access_tcpconn_entry_free(entry);
-        }
+        snmp_log(LOG_ERR, "memory allocation failed while loading "
+                 "tcpConnectionTable cache.\n");
+        netsnmp_access_tcpconn_entry_free(entry);
     }
+    return NULL;
 }
 
+/**
+ * release removed entry
+ */
+static void
+_release_connection(void *row, void *context)
+{
+    tcpConnectionTable_release_rowreq_ctx((tcpConnectionTable_rowreq_ctx *)
+                                          row);
+}
+
+/**
+ * free skipped entry
+ */
+static void
+_free_connection(void *item, void *context)
+{
+    netsnmp_access_tcpconn_entry_free((netsnmp_tcpconn_entry *) item);
+}
+
+static const netsnmp_container_table_sync_ops _connection_sync = {
+    _connection_index,
+    _update_connection,
+    _add_connection,
+    _release_connection,
+    _free_connection,
+    MAX_tcpConnectionTable_IDX_LEN
+};
+
 /**
  * load initial data
  *
  * TODO:350:M: Implement tcpConnectionTable data load
  * This function will also be called by the cache helper to load
- * the container again (after the container free function has been
- * called to free the previous contents).
+ * the container again. The rows already in the container are updated
+ * in place, rows for closed connections are removed and rows for new
+ * connections are added.
  *
  * @param container container to which items should be inserted
  *
@@ -252,10 +319,14 @@ tcpConnectionTable_container_load(netsnmp_container *container)
         return MFD_RESOURCE_UNAVAILABLE;        /* msg already logged */
 
     /*
-     * got all the connections. pull out the active ones.
+     * got all the connections. merge them into the existing rows.
      */
-    CONTAINER_FOR_EACH(raw_data, (netsnmp_container_obj_func *)
-                       _add_connection, container);
+    if (netsnmp_container_table_sync(container, raw_data,
+                                     &_connection_sync, NULL) < 0) {
+        netsnmp_access_tcpconn_container_free(raw_data,
+                                              NETSNMP_ACCESS_TCPCONN_FREE_NOFLAGS);
+        return MFD_ERROR;
+    }
 
     /*
      * free the container. we've either claimed each entry, or released it,
@@ -8,6 +8,7 @@
  * standard Net-SNMP includes 
  */
 #include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-features.h>
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
 
@@ -19,6 +20,8 @@
 
 #include "tcpListenerTable_data_access.h"
 
+netsnmp_feature_require(table_container_sync);
+
 /** @ingroup interface 
  * @addtogroup data_access data_access: Routines to access data
  *
@@ -131,7 +134,9 @@ tcpListenerTable_container_init(netsnmp_container **container_ptr_ptr,
      * cache->enabled to 0.
      */
     cache->timeout = TCPLISTENERTABLE_CACHE_TIMEOUT;    /* seconds */
-    cache->flags |= NETSNMP_CACHE_DONT_INVALIDATE_ON_SET;
+    cache->flags |= NETSNMP_CACHE_DONT_INVALIDATE_ON_SET
+        | NETSNMP_CACHE_DONT_FREE_BEFORE_LOAD
+        | NETSNMP_CACHE_BACKGROUND_RELOAD;
 }                               /* tcpListenerTable_container_init */
 
 /**
@@ -164,18 +169,52 @@ tcpListenerTable_container_shutdown(netsnmp_container *container_ptr)
 }                               /* tcpListenerTable_container_shutdown */
 
 /**
- * add new entry
+ * set the table index of an entry
+ */
+static int
+_listener_index(void *item, netsnmp_index *oid_idx, void *context)
+{
+    netsnmp_tcpconn_entry *entry = (netsnmp_tcpconn_entry *) item;
+    tcpListenerTable_mib_index tbl_idx;
+
+    if (MFD_SUCCESS !=
+        tcpListenerTable_indexes_set_tbl_idx(&tbl_idx,
+                                             entry->loc_addr_len,
+                                             (char *) entry->loc_addr,
+                                             entry->loc_addr_len,
+                                             entry->loc_port))
+        return MFD_ERROR;
+
+    return tcpListenerTable_index_to_oid(oid_idx, &tbl_idx);
+}
+
+/**
+ * update existing entry
  */
 static void
-_add_connection(netsnmp_tcpconn_entry *entry, netsnmp_container *container)
+_update_listener(void *row, void *item, void *context)
 {
+    tcpListenerTable_rowreq_ctx *rowreq_ctx =
+        (tcpListenerTable_rowreq_ctx *) row;
+    netsnmp_tcpconn_entry *entry = (netsnmp_tcpconn_entry *) item;
+
+    netsnmp_access_tcpconn_entry_update(rowreq_ctx->data, entry);
+    netsnmp_access_tcpconn_entry_free(entry);
+}
+
+/**
+ * add new entry
+ */
+static void    *
+_add_listener(void *item, void *context)
+{
+    netsnmp_tcpconn_entry *entry = (netsnmp_tcpconn_entry *) item;
     tcpListenerTable_rowreq_ctx *rowreq_ctx;
 
     DEBUGMSGTL(("tcpListenerTable:access", "creating new entry\n"));
 
     /*
-     * allocate an row context and set the index(es), then add it to
-     * the container
+     * allocate an row context and set the index(es)
      */
     rowreq_ctx = tcpListenerTable_allocate_rowreq_ctx(entry, NULL);
     if ((NULL != rowreq_ctx) &&
@@ -183,28 +222,56 @@ _add_connection(netsnmp_tcpconn_entry *entry, netsnmp_container *container)
                                                      entry->loc_addr_len,
                                                      (char *) entry->loc_addr,
                                                      entry->loc_addr_len,
-                                                     entry->loc_port))) {
-        CONTAINER_INSERT(container, rowreq_ctx);
+                                                     entry->loc_port)))
+        return rowreq_ctx;
+
+    if (rowreq_ctx) {
+        snmp_log(LOG_ERR, "error setting index while loading "
+                 "tcpListenerTable cache.\n");
+        tcpListenerTable_release_rowreq_ctx(rowreq_ctx);
     } else {
-        if (rowreq_ctx) {
-            snmp_log(LOG_ERR, "error setting index while loading "
-                     "tcpListenerTable cache.\n");
-            tcpListenerTable_release_rowreq_ctx(rowreq_ctx);
-        } else {
-            snmp_log(LOG_ERR, "memory allocation failed while loading "
-                     "tcpListenerTable cache.\n");
-            netsnmp_access_tcpconn_entry_free(entry);
-        }
+        snmp_log(LOG_ERR, "memory allocation failed while loading "
+                 "tcpListenerTable cache.\n");
+        netsnmp_access_tcpconn_entry_free(entry);
     }
+    return NULL;
 }
 
+/**
+ * release removed entry
+ */
+static void
+_release_listener(void *row, void *context)
+{
+    tcpListenerTable_release_rowreq_ctx((tcpListenerTable_rowreq_ctx *) row);
+}
+
+/**
+ * free skipped entry
+ */
+static void
+_free_listener(void *item, void *context)
+{
+    netsnmp_access_tcpconn_entry_free((netsnmp_tcpconn_entry *) item);
+}
+
+static const netsnmp_container_table_sync_ops _listener_sync = {
+    _listener_index,
+    _update_listener,
+    _add_listener,
+    _release_listener,
+    _free_listener,
+    MAX_tcpListenerTable_IDX_LEN
+};
+
 /**
  * load initial data
  *
  * TODO:350:M: Implement tcpListenerTable data load
  * This function will also be called by the cache helper to load
- * the container again (after the container free function has been
- * called to free the previous contents).
+ * the container again. The rows already in the container are updated
+ * in place, rows for closed listeners are removed and rows for new
+ * listeners are added.
  *
  * @param container container to which items should be inserted
  *
@@ -245,10 +312,14 @@ tcpListenerTable_container_load(netsnmp_container *container)
         return MFD_RESOURCE_UNAVAILABLE;        /* msg already logged */
 
     /*
-     * got all the connections. pull out the active ones.
+     * got all the listeners. merge them into the existing rows.
      */
-    CONTAINER_FOR_EACH(raw_data, (netsnmp_container_obj_func *)
-                       _add_connection, container);
+    if (netsnmp_container_table_sync(container, raw_data,
+                                     &_listener_sync, NULL) < 0) {
+        netsnmp_access_tcpconn_container_free(raw_data,
+                                              NETSNMP_ACCESS_TCPCONN_FREE_NOFLAGS);
+        return MFD_ERROR;
+    }
 
     /*
      * free the container. we've either claimed each entry, or released it,
@@ -36,6 +36,7 @@
 #include "pass_common.h"
 #include "extensible.h"
 #include "util_funcs.h"
+#include "utilities/execute.h"
 
 netsnmp_feature_require(get_exten_instance);
 netsnmp_feature_require(parse_miboid);
@@ -54,6 +55,8 @@ struct variable2 extensible_passthru_variables[] = {
      var_extensible_pass, 0, {MIBINDEX}},
 };
 
+static Netsnmp_Node_Handler pass_threaded_handler;
+
 
 
 void
@@ -67,8 +70,9 @@ void
 pass_parse_config(const char *token, char *cptr)
 {
     struct extensible **ppass = &passthrus, **etmp, *ptmp;
+    netsnmp_handler_registration *reginfo;
     char           *tcptr, *endopt;
-    int             i;
+    int             i, threaded = 0;
     unsigned long   priority;
 
     /*
@@ -94,6 +98,12 @@ pass_parse_config(const char *token, char *cptr)
 	cptr = endopt;
 	cptr = skip_white(cptr);
 	break;
+      case 'T':
+	/* the command may run on agent worker threads */
+	threaded = 1;
+	cptr++;
+	cptr = skip_white(cptr);
+	break;
       default:
 	config_perror("unknown option for pass directive");
 	return;
@@ -116,7 +126,7 @@ pass_parse_config(const char *token, char *cptr)
     *ppass = calloc(1, sizeof(**ppass));
     if (*ppass == NULL)
         return;
-    (*ppass)->type = PASSTHRU;
+    (*ppass)->type = threaded ? PASSTHRU_THREADED : PASSTHRU;
     (*ppass)->mibpriority = priority;
 
     (*ppass)->miblen = parse_miboid(cptr, (*ppass)->miboid);
@@ -142,7 +152,19 @@ pass_parse_config(const char *token, char *cptr)
     strlcpy((*ppass)->name, (*ppass)->command, sizeof((*ppass)->name));
     (*ppass)->next = NULL;
 
-    register_mib_priority("pass",
+    if (threaded) {
+        reginfo = netsnmp_create_handler_registration("pass",
+                                  pass_threaded_handler, (*ppass)->miboid,
+                                  (*ppass)->miblen,
+                                  HANDLER_CAN_RWRITE |
+                                  HANDLER_CAN_THREAD_SAFE);
+        if (reginfo) {
+            reginfo->priority = (*ppass)->mibpriority;
+            reginfo->handler->myvoid = *ppass;
+            netsnmp_register_handler(reginfo);
+        }
+    } else
+        register_mib_priority("pass",
                  (struct variable *) extensible_passthru_variables,
                  sizeof(struct variable2), 1, (*ppass)->miboid,
                  (*ppass)->miblen, (*ppass)->mibpriority);
@@ -205,6 +227,8 @@ var_extensible_pass(struct variable *vp,
 
     for (i = 1; i <= numpassthrus; i++) {
         passthru = get_exten_instance(passthrus, i);
+        if (passthru->type == PASSTHRU_THREADED)
+            continue;           /* has its own registration */
         rtest = snmp_oidtree_compare(name, *length,
                                      passthru->miboid, passthru->miblen);
         if ((exact && rtest == 0) || (!exact && rtest <= 0)) {
@@ -286,6 +310,8 @@ setPass(int action, u_char * var_val, u_char var_val_type,
 
     for (i = 1; i <= numpassthrus; i++) {
         passthru = get_exten_instance(passthrus, i);
+        if (passthru->type == PASSTHRU_THREADED)
+            continue;
         rtest = snmp_oidtree_compare(name, name_len,
                                      passthru->miboid, passthru->miblen);
         if (rtest <= 0) {
@@ -320,6 +346,112 @@ setPass(int action, u_char * var_val, u_char var_val_type,
     return SNMP_ERR_NOSUCHNAME;
 }
 
+/*
+ * Handler for "pass -T" entries.  Unlike var_extensible_pass() it keeps all
+ * of its state on the stack and runs the command without the shared exec
+ * cache, so that requests can be processed on agent worker threads.
+ */
+static int
+pass_threaded_handler(netsnmp_mib_handler *handler,
+                      netsnmp_handler_registration *reginfo,
+                      netsnmp_agent_request_info *reqinfo,
+                      netsnmp_request_info *requests)
+{
+    struct extensible *passthru = handler->myvoid;
+    netsnmp_request_info *request;
+    netsnmp_variable_list *var;
+    netsnmp_pass_value value;
+    oid             newname[MAX_OID_LEN];
+    char            buf[SNMP_MAXBUF], buf2[SNMP_MAXBUF];
+    char            output[SNMP_MAXBUF * 2], *command, *line, *next;
+    char           *lines[3];
+    u_char         *val, type;
+    size_t          val_len;
+    int             out_len, rtest, newlen, n, exact;
+
+    for (request = requests; request; request = request->next) {
+        if (request->processed)
+            continue;
+        var = request->requestvb;
+        rtest = snmp_oidtree_compare(var->name, var->name_length,
+                                     passthru->miboid, passthru->miblen);
+        if (passthru->miblen >= var->name_length || rtest < 0)
+            sprint_mib_oid(buf, passthru->miboid, passthru->miblen);
+        else
+            sprint_mib_oid(buf, var->name, var->name_length);
+
+        switch (reqinfo->mode) {
+        case MODE_GET:
+        case MODE_GETNEXT:
+            exact = (reqinfo->mode == MODE_GET);
+            if (asprintf(&command, "%s %s %s", passthru->name,
+                         exact ? "-g" : "-n", buf) < 0)
+                return SNMP_ERR_GENERR;
+            DEBUGMSGTL(("ucd-snmp/pass", "pass-running:  %s\n", command));
+            out_len = sizeof(output);
+            output[0] = '\0';
+            run_exec_command(command, NULL, output, &out_len);
+            free(command);
+
+            /*
+             * the OID, the type and the value, one per line
+             */
+            for (n = 0, line = output; n < 3 && line && *line; n++) {
+                lines[n] = line;
+                next = strchr(line, '\n');
+                if (next)
+                    *next++ = '\0';
+                line = next;
+            }
+            if (n < 3 || (newlen = parse_miboid(lines[0], newname)) == 0) {
+                if (exact)
+                    netsnmp_set_request_error(reqinfo, request,
+                                              SNMP_NOSUCHINSTANCE);
+                continue;       /* getnext: try the next registration */
+            }
+            strlcpy(buf, lines[1], sizeof(buf));
+            snprintf(buf2, sizeof(buf2), "%s\n", lines[2]);
+            val = netsnmp_internal_pass_parse_value(buf, buf2, &val_len,
+                                                    &type, &value);
+            if (NULL == val) {
+                if (exact)
+                    netsnmp_set_request_error(reqinfo, request,
+                                              SNMP_NOSUCHINSTANCE);
+                continue;
+            }
+            if (!exact)
+                snmp_set_var_objid(var, newname, newlen);
+            snmp_set_var_typed_value(var, type, val, val_len);
+            break;
+
+#ifndef NETSNMP_NO_WRITE_SUPPORT
+        case MODE_SET_ACTION:
+            /*
+             * like setPass(), the command only runs in the action phase
+             */
+            netsnmp_internal_pass_set_format(buf2, var->val.string,
+                                             var->type, var->val_len);
+            if (asprintf(&command, "%s -s %s %s", passthru->name, buf,
+                         buf2) < 0)
+                return SNMP_ERR_GENERR;
+            DEBUGMSGTL(("ucd-snmp/pass", "pass-running:  %s", command));
+            out_len = sizeof(output);
+            output[0] = '\0';
+            run_exec_command(command, NULL, output, &out_len);
+            free(command);
+            n = netsnmp_internal_pass_str_to_errno(output);
+            if (n != SNMP_ERR_NOERROR)
+                netsnmp_set_request_error(reqinfo, request, n);
+            break;
+#endif /* !NETSNMP_NO_WRITE_SUPPORT */
+
+        default:
+            break;
+        }
+    }
+    return SNMP_ERR_NOERROR;
+}
+
 int
 pass_compare(const void *a, const void *b)
 {
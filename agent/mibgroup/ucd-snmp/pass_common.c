@@ -106,16 +106,17 @@ netsnmp_internal_pass_str_to_errno(const char *buf)
     return SNMP_ERR_NOERROR;
 }
 
+/*
+ * Parses the type (in buf) and value (in buf2) returned by a pass script.
+ * Numeric values are stored in *value; string values are converted in place
+ * in buf2.  Returns a pointer to the value, or NULL.
+ */
 unsigned char *
-netsnmp_internal_pass_parse(char * buf,
-                            char * buf2,
-                            size_t * var_len,
-                            struct variable *vp)
+netsnmp_internal_pass_parse_value(char *buf, char *buf2, size_t *var_len,
+                                  u_char *type, netsnmp_pass_value *value)
 {
-    static long     long_ret;
-    static in_addr_t addr_ret;
     int             newlen;
-    static oid      objid[MAX_OID_LEN];
+    oid             objid[MAX_OID_LEN];
 
     /*
      * buf contains the return type, and buf2 contains the data
@@ -125,68 +126,66 @@ netsnmp_internal_pass_parse(char * buf,
         if (buf2[strlen(buf2) - 1] == '\r')
             buf2[strlen(buf2) - 1] = 0; /* zap the carriage-return */
         *var_len = strlen(buf2);
-        vp->type = ASN_OCTET_STR;
+        *type = ASN_OCTET_STR;
         return ((unsigned char *) buf2);
     }
 #ifdef NETSNMP_WITH_OPAQUE_SPECIAL_TYPES
     else if (!strncasecmp(buf, "integer64", 9)) {
-        static struct counter64 c64;
         uint64_t v64 = strtoull(buf2, NULL, 10);
-        c64.high = (unsigned long)(v64 >> 32);
-        c64.low  = (unsigned long)(v64 & 0xffffffff);
-        *var_len = sizeof(c64);
-        vp->type = ASN_OPAQUE_I64;
-        return ((unsigned char *) &c64);
+        value->c64.high = (unsigned long)(v64 >> 32);
+        value->c64.low  = (unsigned long)(v64 & 0xffffffff);
+        *var_len = sizeof(value->c64);
+        *type = ASN_OPAQUE_I64;
+        return ((unsigned char *) &value->c64);
     }
 #endif
     else if (!strncasecmp(buf, "integer", 7)) {
-        *var_len = sizeof(long_ret);
-        long_ret = strtol(buf2, NULL, 10);
-        vp->type = ASN_INTEGER;
-        return ((unsigned char *) &long_ret);
+        *var_len = sizeof(value->l);
+        value->l = strtol(buf2, NULL, 10);
+        *type = ASN_INTEGER;
+        return ((unsigned char *) &value->l);
     } else if (!strncasecmp(buf, "unsigned", 8)) {
-        *var_len = sizeof(long_ret);
-        long_ret = strtoul(buf2, NULL, 10);
-        vp->type = ASN_UNSIGNED;
-        return ((unsigned char *) &long_ret);
+        *var_len = sizeof(value->l);
+        value->l = strtoul(buf2, NULL, 10);
+        *type = ASN_UNSIGNED;
+        return ((unsigned char *) &value->l);
     }
     else if (!strncasecmp(buf, "counter64", 9)) {
-        static struct counter64 c64;
         uint64_t v64 = strtoull(buf2, NULL, 10);
-        c64.high = (unsigned long)(v64 >> 32);
-        c64.low  = (unsigned long)(v64 & 0xffffffff);
-        *var_len = sizeof(c64);
-        vp->type = ASN_COUNTER64;
-        return ((unsigned char *) &c64);
+        value->c64.high = (unsigned long)(v64 >> 32);
+        value->c64.low  = (unsigned long)(v64 & 0xffffffff);
+        *var_len = sizeof(value->c64);
+        *type = ASN_COUNTER64;
+        return ((unsigned char *) &value->c64);
     }
     else if (!strncasecmp(buf, "counter", 7)) {
-        *var_len = sizeof(long_ret);
-        long_ret = strtoul(buf2, NULL, 10);
-        vp->type = ASN_COUNTER;
-        return ((unsigned char *) &long_ret);
+        *var_len = sizeof(value->l);
+        value->l = strtoul(buf2, NULL, 10);
+        *type = ASN_COUNTER;
+        return ((unsigned char *) &value->l);
     } else if (!strncasecmp(buf, "octet", 5)) {
         *var_len = netsnmp_internal_asc2bin(buf2);
-        vp->type = ASN_OCTET_STR;
+        *type = ASN_OCTET_STR;
         return ((unsigned char *) buf2);
     } else if (!strncasecmp(buf, "opaque", 6)) {
         *var_len = netsnmp_internal_asc2bin(buf2);
-        vp->type = ASN_OPAQUE;
+        *type = ASN_OPAQUE;
         return ((unsigned char *) buf2);
     } else if (!strncasecmp(buf, "gauge", 5)) {
-        *var_len = sizeof(long_ret);
-        long_ret = strtoul(buf2, NULL, 10);
-        vp->type = ASN_GAUGE;
-        return ((unsigned char *) &long_ret);
+        *var_len = sizeof(value->l);
+        value->l = strtoul(buf2, NULL, 10);
+        *type = ASN_GAUGE;
+        return ((unsigned char *) &value->l);
     } else if (!strncasecmp(buf, "objectid", 8)) {
-        newlen = parse_miboid(buf2, objid);
+        newlen = parse_miboid(buf2, value->objid);
         *var_len = newlen * sizeof(oid);
-        vp->type = ASN_OBJECT_ID;
-        return ((unsigned char *) objid);
+        *type = ASN_OBJECT_ID;
+        return ((unsigned char *) value->objid);
     } else if (!strncasecmp(buf, "timetick", 8)) {
-        *var_len = sizeof(long_ret);
-        long_ret = strtoul(buf2, NULL, 10);
-        vp->type = ASN_TIMETICKS;
-        return ((unsigned char *) &long_ret);
+        *var_len = sizeof(value->l);
+        value->l = strtoul(buf2, NULL, 10);
+        *type = ASN_TIMETICKS;
+        return ((unsigned char *) &value->l);
     } else if (!strncasecmp(buf, "ipaddress", 9)) {
         newlen = parse_miboid(buf2, objid);
         if (newlen != 4) {
@@ -194,18 +193,34 @@ netsnmp_internal_pass_parse(char * buf,
             *var_len = 0;
             return (NULL);
         }
-        addr_ret =
+        value->addr =
             (objid[0] << (8 * 3)) + (objid[1] << (8 * 2)) +
             (objid[2] << 8) + objid[3];
-        addr_ret = htonl(addr_ret);
-        *var_len = sizeof(addr_ret);
-        vp->type = ASN_IPADDRESS;
-        return ((unsigned char *) &addr_ret);
+        value->addr = htonl(value->addr);
+        *var_len = sizeof(value->addr);
+        *type = ASN_IPADDRESS;
+        return ((unsigned char *) &value->addr);
     }
     *var_len = 0;
     return (NULL);
 }
 
+unsigned char *
+netsnmp_internal_pass_parse(char * buf,
+                            char * buf2,
+                            size_t * var_len,
+                            struct variable *vp)
+{
+    static netsnmp_pass_value value;
+    unsigned char  *ret;
+    u_char          type = vp->type;
+
+    ret = netsnmp_internal_pass_parse_value(buf, buf2, var_len, &type,
+                                            &value);
+    vp->type = type;
+    return ret;
+}
+
 void
 netsnmp_internal_pass_set_format(char *buf,
                                  const u_char *var_val,
@@ -6,9 +6,20 @@
  * or disappear at any time
  */
 
+typedef union netsnmp_pass_value_u {
+    long            l;
+    in_addr_t       addr;
+    struct counter64 c64;
+    oid             objid[MAX_OID_LEN];
+} netsnmp_pass_value;
+
 int
 netsnmp_internal_pass_str_to_errno(const char *buf);
 
+unsigned char *
+netsnmp_internal_pass_parse_value(char *buf, char *buf2, size_t *var_len,
+                                  u_char *type, netsnmp_pass_value *value);
+
 unsigned char *
 netsnmp_internal_pass_parse(char *buf, char *buf2, size_t *var_len,
                             struct variable *vp);
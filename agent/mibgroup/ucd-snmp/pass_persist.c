@@ -45,20 +45,59 @@
 netsnmp_feature_require(get_exten_instance);
 netsnmp_feature_require(parse_miboid);
 
+/*
+ * Seconds a tagged request may wait for its reply before the helper is
+ * considered hung and restarted.
+ */
+#define PERSIST_TAG_TIMEOUT     10
+
+/*
+ * Largest amount of unparsed reply data held for a tagged helper.
+ */
+#define PERSIST_TAG_MAX_BUF     (1024 * 1024)
+
+#define PERSIST_VERB_GET        1
+#define PERSIST_VERB_GETNEXT    2
+#define PERSIST_VERB_GETBULK    3
+#define PERSIST_VERB_SET        4
+
+/*
+ * A request sent to a tagged helper and still waiting for its reply.
+ */
+struct persist_request {
+    struct persist_request *next;
+    unsigned int    tag;
+    int             verb;
+    int             rows;       /* rows asked for by getbulk */
+    time_t          sent;
+    netsnmp_delegated_cache *dcache;
+};
+
 struct extensible *persistpassthrus = NULL;
 int             numpersistpassthrus = 0;
 struct persist_pipe_type {
     FILE           *fIn;
     int             fdOut;
     netsnmp_pid_t   pid;
+    /*
+     * tagged protocol only
+     */
+    int             fdIn;
+    char           *buf;        /* reply data not parsed yet */
+    size_t          buf_len;
+    size_t          buf_size;
+    unsigned int    next_tag;
+    struct persist_request *pending;
 }              *persist_pipes = (struct persist_pipe_type *) NULL;
 static unsigned pipe_check_alarm_id;
 static int      init_persist_pipes(void);
 static void     close_persist_pipe(int iindex);
 static int      open_persist_pipe(int iindex, char *command);
+static int      open_tagged_persist_pipe(int iindex, char *command);
 static void     check_persist_pipes(unsigned clientreg, void *clientarg);
 static void     destruct_persist_pipes(void);
 static int      write_persist_pipe(int iindex, const char *data);
+static Netsnmp_Node_Handler handle_tagged_pass_persist;
 
 /*
  * the relocatable extensible commands variables 
@@ -133,8 +172,9 @@ pass_persist_parse_config(const char *token, char *cptr)
 {
     struct extensible **ppass = &persistpassthrus, **etmp, *ptmp;
     char           *tcptr, *endopt;
-    int             i;
+    int             i, tagged = 0;
     long int        priority;
+    netsnmp_handler_registration *reginfo;
 
     /*
      * options
@@ -159,6 +199,17 @@ pass_persist_parse_config(const char *token, char *cptr)
 	cptr = endopt;
 	cptr = skip_white(cptr);
 	break;
+      case 't':
+	/* use the tagged protocol */
+#ifdef WIN32
+	config_perror("the tagged pass_persist protocol is not supported on this platform");
+	return;
+#else
+	tagged = 1;
+	cptr++;
+	cptr = skip_white(cptr);
+	break;
+#endif
       default:
 	config_perror("unknown option for pass directive");
 	return;
@@ -181,7 +232,7 @@ pass_persist_parse_config(const char *token, char *cptr)
     *ppass = calloc(1, sizeof(**ppass));
     if (*ppass == NULL)
         return;
-    (*ppass)->type = PASSTHRU_PERSIST;
+    (*ppass)->type = tagged ? PASSTHRU_PERSIST_TAGGED : PASSTHRU_PERSIST;
     (*ppass)->mibpriority = priority;
 
     (*ppass)->miblen = parse_miboid(cptr, (*ppass)->miboid);
@@ -207,7 +258,18 @@ pass_persist_parse_config(const char *token, char *cptr)
     strlcpy((*ppass)->name, (*ppass)->command, sizeof((*ppass)->name));
     (*ppass)->next = NULL;
 
-    register_mib_priority("pass_persist",
+    if (tagged) {
+        reginfo = netsnmp_create_handler_registration("pass_persist",
+                      handle_tagged_pass_persist, (*ppass)->miboid,
+                      (*ppass)->miblen,
+                      HANDLER_CAN_RWRITE | HANDLER_CAN_GETBULK);
+        if (reginfo) {
+            reginfo->priority = (*ppass)->mibpriority;
+            reginfo->handler->myvoid = *ppass;
+            netsnmp_register_handler(reginfo);
+        }
+    } else
+        register_mib_priority("pass_persist",
                  (struct variable *) extensible_persist_passthru_variables,
                  sizeof(struct variable2), 1, (*ppass)->miboid,
                  (*ppass)->miblen, (*ppass)->mibpriority);
@@ -306,6 +368,8 @@ var_extensible_pass_persist(struct variable *vp,
 
     for (i = 1; i <= numpersistpassthrus; i++) {
         persistpassthru = get_exten_instance(persistpassthrus, i);
+        if (persistpassthru->type != PASSTHRU_PERSIST)
+            continue;
         rtest = snmp_oidtree_compare(name, *length,
                                      persistpassthru->miboid,
                                      persistpassthru->miblen);
@@ -426,6 +490,8 @@ setPassPersist(int action,
 
     for (i = 1; i <= numpersistpassthrus; i++) {
         persistpassthru = get_exten_instance(persistpassthrus, i);
+        if (persistpassthru->type != PASSTHRU_PERSIST)
+            continue;
         rtest = snmp_oidtree_compare(name, name_len,
                                      persistpassthru->miboid,
                                      persistpassthru->miblen);
@@ -486,6 +552,436 @@ setPassPersist(int action,
     return SNMP_ERR_NOSUCHNAME;
 }
 
+/*
+ * The tagged protocol (pass_persist -t).  Each request carries a tag, the
+ * requests for all the varbinds in a PDU are written to the helper at
+ * once, and the varbinds are delegated until the replies (which may come
+ * back in any order) are read from the pipe.  GETBULK repetitions are
+ * asked for with a single getbulk request.
+ */
+
+static int
+persist_pipe_index(struct extensible *persistpassthru)
+{
+    struct extensible *ptmp;
+    int             i;
+
+    for (i = 1, ptmp = persistpassthrus; ptmp != NULL;
+         ptmp = ptmp->next, i++)
+        if (ptmp == persistpassthru)
+            return i;
+    return 0;
+}
+
+/*
+ * Returns the line starting at *cp and moves *cp past it, or NULL if the
+ * whole line has not arrived yet.
+ */
+static char *
+tagged_next_line(char **cp, char *end)
+{
+    char           *line = *cp, *nl;
+
+    if (line >= end || (nl = memchr(line, '\n', end - line)) == NULL)
+        return NULL;
+    *cp = nl + 1;
+    return line;
+}
+
+/*
+ * Answer a request the helper could not (or did not) reply to, the same
+ * way the untagged protocol treats a NONE or a broken pipe.
+ */
+static void
+tagged_request_none(struct persist_request *preq)
+{
+    netsnmp_delegated_cache *dcache;
+
+    dcache = netsnmp_handler_check_cache(preq->dcache);
+    if (dcache) {
+        if (preq->verb == PERSIST_VERB_GET)
+            netsnmp_set_request_error(dcache->reqinfo, dcache->requests,
+                                      SNMP_NOSUCHINSTANCE);
+        else if (preq->verb == PERSIST_VERB_SET)
+            netsnmp_set_request_error(dcache->reqinfo, dcache->requests,
+                                      SNMP_ERR_NOTWRITABLE);
+        dcache->requests->delegated = 0;
+    }
+    netsnmp_free_delegated_cache(preq->dcache);
+    free(preq);
+}
+
+/*
+ * Returns the length of the reply to preq at the start of buf (the tag
+ * line already skipped), or 0 if it has not all arrived yet.
+ */
+static size_t
+tagged_reply_len(struct persist_request *preq, char *buf, char *end)
+{
+    char           *cp = buf, *line;
+
+    if (preq->verb == PERSIST_VERB_SET)
+        return tagged_next_line(&cp, end) ? cp - buf : 0;
+
+    for (;;) {
+        if ((line = tagged_next_line(&cp, end)) == NULL)
+            return 0;
+        if (!strncmp(line, "NONE", 4))
+            break;
+        if (tagged_next_line(&cp, end) == NULL ||
+            tagged_next_line(&cp, end) == NULL)
+            return 0;
+        if (preq->verb != PERSIST_VERB_GETBULK)
+            break;
+    }
+    return cp - buf;
+}
+
+/*
+ * Copy the reply to preq (between cp and end) into its varbind and
+ * hand the request back to the agent.
+ */
+static void
+tagged_reply(struct persist_request *preq, char *cp, char *end)
+{
+    netsnmp_delegated_cache *dcache;
+    netsnmp_request_info *request;
+    netsnmp_variable_list *var;
+    struct variable vp;
+    oid             newname[MAX_OID_LEN];
+    char           *line, *type, *value, buf[SNMP_MAXBUF];
+    u_char         *val;
+    size_t          var_len, len;
+    int             newlen, rows = 0, done = 0, rc;
+
+    dcache = netsnmp_handler_check_cache(preq->dcache);
+    if (!dcache) {
+        DEBUGMSGTL(("ucd-snmp/pass_persist", "reply to stale tag %u\n",
+                    preq->tag));
+        netsnmp_free_delegated_cache(preq->dcache);
+        free(preq);
+        return;
+    }
+    request = dcache->requests;
+
+    if (preq->verb == PERSIST_VERB_SET) {
+        rc = netsnmp_internal_pass_str_to_errno(cp);
+        if (rc != SNMP_ERR_NOERROR)
+            netsnmp_set_request_error(dcache->reqinfo, request, rc);
+    } else {
+        while ((line = tagged_next_line(&cp, end)) != NULL &&
+               strncmp(line, "NONE", 4)) {
+            type = tagged_next_line(&cp, end);
+            value = tagged_next_line(&cp, end);
+            if (done)
+                continue;
+
+            /*
+             * netsnmp_internal_pass_parse() wants the value line with its
+             * newline, as fgets() would return it.
+             */
+            len = cp - value;
+            if (len >= sizeof(buf))
+                len = sizeof(buf) - 1;
+            memcpy(buf, value, len);
+            buf[len] = '\0';
+            newlen = parse_miboid(line, newname);
+            val = newlen ? netsnmp_internal_pass_parse(type, buf, &var_len,
+                                                       &vp) : NULL;
+            if (val == NULL) {
+                done = 1;
+                continue;
+            }
+
+            var = request->requestvb;
+            if (preq->verb != PERSIST_VERB_GET) {
+                /*
+                 * a helper going backwards would have the agent ask
+                 * it the same thing forever
+                 */
+                rc = snmp_oid_compare(newname, newlen, var->name,
+                                      var->name_length);
+                if (rc < 0 || (rc == 0 && (rows > 0 || !request->inclusive))) {
+                    done = 1;
+                    continue;
+                }
+            }
+            if (rows > 0) {
+                /*
+                 * further getbulk rows fill the following repetitions
+                 */
+                if (request->repeat <= 0 || var->next_variable == NULL ||
+                    snmp_oid_compare(var->name, var->name_length,
+                                     request->range_end,
+                                     request->range_end_len) >= 0) {
+                    done = 1;
+                    continue;
+                }
+                request->repeat--;
+                request->requestvb = var = var->next_variable;
+                if (2 == request->inclusive)
+                    request->inclusive = 0;
+            }
+            if (preq->verb != PERSIST_VERB_GET)
+                snmp_set_var_objid(var, newname, newlen);
+            snmp_set_var_typed_value(var, vp.type, val, var_len);
+            rows++;
+        }
+
+        var = request->requestvb;
+        if (preq->verb == PERSIST_VERB_GET && rows == 0) {
+            netsnmp_set_request_error(dcache->reqinfo, request,
+                                      SNMP_NOSUCHINSTANCE);
+        } else if (rows > 0 && request->repeat > 0 &&
+                   var->next_variable != NULL &&
+                   snmp_oid_compare(var->name, var->name_length,
+                                    request->range_end,
+                                    request->range_end_len) < 0) {
+            /*
+             * Repetitions are left over: ask again from the last row,
+             * or go straight on to the next subtree if the helper said
+             * it had no more.
+             */
+            request->repeat--;
+            request->requestvb = var->next_variable;
+            snmp_set_var_objid(request->requestvb, var->name,
+                               var->name_length);
+            request->requestvb->type = (done || rows >= preq->rows) ?
+                ASN_PRIV_RETRY : ASN_NULL;
+            if (2 == request->inclusive)
+                request->inclusive = 0;
+        }
+    }
+
+    request->delegated = 0;
+    netsnmp_free_delegated_cache(preq->dcache);
+    free(preq);
+}
+
+/*
+ * Answer every complete reply in the pipe's buffer.
+ * Returns -1 if the helper does not follow the protocol.
+ */
+static int
+tagged_parse_replies(struct persist_pipe_type *pp)
+{
+    struct persist_request **ppreq, *preq;
+    char           *cp, *end, *line, *ep;
+    unsigned long   tag;
+    size_t          len;
+
+    for (;;) {
+        cp = pp->buf;
+        end = pp->buf + pp->buf_len;
+        if ((line = tagged_next_line(&cp, end)) == NULL)
+            return 0;
+
+        /*
+         * the reply to the PING sent when the helper was started
+         */
+        if (strncmp(line, "PONG", 4)) {
+            tag = strtoul(line, &ep, 10);
+            if (ep == line || (*ep != '\n' && !isspace((unsigned char)*ep)))
+                return -1;
+            for (ppreq = &pp->pending; *ppreq; ppreq = &(*ppreq)->next)
+                if ((*ppreq)->tag == tag)
+                    break;
+            if ((preq = *ppreq) == NULL)
+                return -1;
+            len = tagged_reply_len(preq, cp, end);
+            if (len == 0)
+                return 0;
+            *ppreq = preq->next;
+            tagged_reply(preq, cp, cp + len);
+            cp += len;
+        }
+
+        pp->buf_len = end - cp;
+        memmove(pp->buf, cp, pp->buf_len);
+    }
+}
+
+static void
+tagged_persist_readable(int fd, void *data)
+{
+    struct persist_pipe_type *pp = (struct persist_pipe_type *) data;
+    int             iindex = pp - persist_pipes;
+    char           *newbuf;
+    ssize_t         n;
+
+    if (pp->buf_size - pp->buf_len < SNMP_MAXBUF) {
+        if (pp->buf_len + SNMP_MAXBUF > PERSIST_TAG_MAX_BUF) {
+            snmp_log(LOG_ERR, "pass_persist[%d]: reply too long\n", iindex);
+            close_persist_pipe(iindex);
+            return;
+        }
+        newbuf = realloc(pp->buf, pp->buf_len + SNMP_MAXBUF);
+        if (newbuf == NULL) {
+            close_persist_pipe(iindex);
+            return;
+        }
+        pp->buf = newbuf;
+        pp->buf_size = pp->buf_len + SNMP_MAXBUF;
+    }
+
+    n = read(fd, pp->buf + pp->buf_len, pp->buf_size - pp->buf_len);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN))
+        return;
+    if (n <= 0) {
+        DEBUGMSGTL(("ucd-snmp/pass_persist",
+                    "tagged pipe %d closed by the helper\n", iindex));
+        close_persist_pipe(iindex);
+        return;
+    }
+    DEBUGMSGTL(("ucd-snmp/pass_persist", "persistpass-received:\n%.*s",
+                (int) n, pp->buf + pp->buf_len));
+    pp->buf_len += n;
+
+    if (tagged_parse_replies(pp) < 0) {
+        snmp_log(LOG_ERR,
+                 "pass_persist[%d]: unexpected reply from helper - closing pipe\n",
+                 iindex);
+        close_persist_pipe(iindex);
+    }
+}
+
+static int
+handle_tagged_pass_persist(netsnmp_mib_handler *handler,
+                           netsnmp_handler_registration *reginfo,
+                           netsnmp_agent_request_info *reqinfo,
+                           netsnmp_request_info *requests)
+{
+    struct extensible *persistpassthru =
+        (struct extensible *) handler->myvoid;
+    struct persist_pipe_type *pp;
+    struct persist_request *preq, **tail;
+    netsnmp_request_info *request;
+    netsnmp_variable_list *var;
+    u_char         *batch = NULL;
+    size_t          batch_size = 0, batch_len = 0;
+    char            buf[SNMP_MAXBUF], buf2[SNMP_MAXBUF], *cmd;
+    int             pipe_idx, verb, rc;
+
+    switch (reqinfo->mode) {
+    case MODE_GET:
+        verb = PERSIST_VERB_GET;
+        break;
+    case MODE_GETNEXT:
+    case MODE_GETBULK:
+        verb = PERSIST_VERB_GETNEXT;
+        break;
+#ifndef NETSNMP_NO_WRITE_SUPPORT
+    case MODE_SET_ACTION:
+        verb = PERSIST_VERB_SET;
+        break;
+#endif /* !NETSNMP_NO_WRITE_SUPPORT */
+    default:
+        return SNMP_ERR_NOERROR;
+    }
+
+    /*
+     * Make sure that our basic pipe structure is malloced 
+     */
+    init_persist_pipes();
+
+    pipe_idx = persist_pipe_index(persistpassthru);
+#ifdef USING_SINGLE_COMMON_PASSPERSIST_INSTANCE
+    {
+        int             i = pipe_idx;
+
+        pipe_idx = get_exten_group_id(persistpassthru->passpersist_inst, i);
+        if (pipe_idx != i)
+            persistpassthru = persistpassthru->passpersist_inst;
+    }
+#endif /* USING_SINGLE_COMMON_PASSPERSIST_INSTANCE */
+
+    if (!persist_pipes || pipe_idx == 0 ||
+        !open_tagged_persist_pipe(pipe_idx, persistpassthru->name)) {
+        for (request = requests; request; request = request->next) {
+            if (verb == PERSIST_VERB_GET)
+                netsnmp_set_request_error(reqinfo, request,
+                                          SNMP_NOSUCHINSTANCE);
+            else if (verb == PERSIST_VERB_SET)
+                netsnmp_set_request_error(reqinfo, request,
+                                          SNMP_ERR_NOTWRITABLE);
+        }
+        return SNMP_ERR_NOERROR;
+    }
+    pp = &persist_pipes[pipe_idx];
+    for (tail = &pp->pending; *tail; tail = &(*tail)->next)
+        ;
+
+    for (request = requests; request; request = request->next) {
+        var = request->requestvb;
+        if (reginfo->rootoid_len >= var->name_length ||
+            snmp_oidtree_compare(var->name, var->name_length,
+                                 reginfo->rootoid, reginfo->rootoid_len) < 0)
+            sprint_mib_oid(buf, reginfo->rootoid, reginfo->rootoid_len);
+        else
+            sprint_mib_oid(buf, var->name, var->name_length);
+
+        preq = calloc(1, sizeof(*preq));
+        if (preq == NULL) {
+            netsnmp_set_request_error(reqinfo, request, SNMP_ERR_GENERR);
+            continue;
+        }
+        preq->tag = pp->next_tag++;
+        preq->verb = verb;
+        if (reqinfo->mode == MODE_GETBULK && request->repeat > 0) {
+            preq->verb = PERSIST_VERB_GETBULK;
+            preq->rows = request->repeat + 1;
+        }
+
+        switch (preq->verb) {
+        case PERSIST_VERB_GET:
+            rc = asprintf(&cmd, "get %u\n%s\n", preq->tag, buf);
+            break;
+        case PERSIST_VERB_GETNEXT:
+            rc = asprintf(&cmd, "getnext %u\n%s\n", preq->tag, buf);
+            break;
+        case PERSIST_VERB_GETBULK:
+            rc = asprintf(&cmd, "getbulk %u %d\n%s\n", preq->tag,
+                          preq->rows, buf);
+            break;
+        default:
+            netsnmp_internal_pass_set_format(buf2, var->val.string,
+                                             var->type, var->val_len);
+            /* buf2 ends in a newline already */
+            rc = asprintf(&cmd, "set %u\n%s\n%s", preq->tag, buf, buf2);
+            break;
+        }
+        if (rc < 0 || !snmp_cstrcat(&batch, &batch_size, &batch_len, 1,
+                                    cmd)) {
+            if (rc >= 0)
+                free(cmd);
+            free(preq);
+            netsnmp_set_request_error(reqinfo, request, SNMP_ERR_GENERR);
+            continue;
+        }
+        free(cmd);
+
+        preq->dcache = netsnmp_create_delegated_cache(handler, reginfo,
+                                                      reqinfo, request,
+                                                      NULL);
+        preq->sent = time(NULL);
+        request->delegated = 1;
+        *tail = preq;
+        tail = &preq->next;
+    }
+
+    if (batch) {
+        DEBUGMSGTL(("ucd-snmp/pass_persist", "persistpass-sending:\n%s",
+                    batch));
+        /*
+         * if the write fails, closing the pipe answers the requests
+         */
+        if (!write_persist_pipe(pipe_idx, (char *) batch))
+            close_persist_pipe(pipe_idx);
+        free(batch);
+    }
+    return SNMP_ERR_NOERROR;
+}
+
 int
 pass_persist_compare(const void *a, const void *b)
 {
@@ -523,6 +1019,12 @@ init_persist_pipes(void)
         persist_pipes[i].fIn = NULL;
         persist_pipes[i].fdOut = -1;
         persist_pipes[i].pid = NETSNMP_NO_SUCH_PROCESS;
+        persist_pipes[i].fdIn = -1;
+        persist_pipes[i].buf = NULL;
+        persist_pipes[i].buf_len = 0;
+        persist_pipes[i].buf_size = 0;
+        persist_pipes[i].next_tag = 0;
+        persist_pipes[i].pending = NULL;
     }
     return 1;
 }
@@ -560,6 +1062,11 @@ static void check_persist_pipes(unsigned clientreg, void *clientarg)
         if (process_stopped(i)) {
             snmp_log(LOG_INFO, "pass_persist[%d]: child process stopped - closing pipe\n", i);
             close_persist_pipe(i);
+        } else if (persist_pipes[i].pending &&
+                   persist_pipes[i].pending->sent + PERSIST_TAG_TIMEOUT <
+                   time(NULL)) {
+            snmp_log(LOG_WARNING, "pass_persist[%d]: no reply from child process - closing pipe\n", i);
+            close_persist_pipe(i);
         }
     }
 }
@@ -671,6 +1178,48 @@ open_persist_pipe(int iindex, char *command)
     return 1;
 }
 
+/*
+ * Start the helper for a tagged pipe if it isn't running.
+ * returns 0 on failure, 1 on success
+ */
+static int
+open_tagged_persist_pipe(int iindex, char *command)
+{
+    struct persist_pipe_type *pp = &persist_pipes[iindex];
+    int             fdIn, fdOut;
+    netsnmp_pid_t   pid;
+
+    if (pp->pid != NETSNMP_NO_SUCH_PROCESS)
+        return 1;
+
+    DEBUGMSGTL(("ucd-snmp/pass_persist", "open_tagged_persist_pipe(%d,'%s')\n",
+                iindex, command));
+    if ((0 == get_exec_pipes(command, &fdIn, &fdOut, &pid)) ||
+        (pid == NETSNMP_NO_SUCH_PROCESS)) {
+        DEBUGMSGTL(("ucd-snmp/pass_persist",
+                    "open_tagged_persist_pipe: pid == -1\n"));
+        return 0;
+    }
+    pp->pid = pid;
+    pp->fdOut = fdOut;
+    pp->fdIn = fdIn;
+    if (register_readfd(fdIn, tagged_persist_readable, pp) !=
+        FD_REGISTERED_OK) {
+        close_persist_pipe(iindex);
+        return 0;
+    }
+
+    /*
+     * The PONG is skipped over along with the replies, so requests don't
+     * wait for it.
+     */
+    if (!write_persist_pipe(iindex, "PING\n")) {
+        close_persist_pipe(iindex);
+        return 0;
+    }
+    return 1;
+}
+
 static int
 write_persist_pipe(int iindex, const char *data)
 {
@@ -712,9 +1261,20 @@ write_persist_pipe(int iindex, const char *data)
 static void
 close_persist_pipe(int iindex)
 {
+    struct persist_request *preq;
+
     /*
      * Check and nix every item 
      */
+    if (persist_pipes[iindex].fdIn != -1) {
+        unregister_readfd(persist_pipes[iindex].fdIn);
+        close(persist_pipes[iindex].fdIn);
+        persist_pipes[iindex].fdIn = -1;
+    }
+    free(persist_pipes[iindex].buf);
+    persist_pipes[iindex].buf = NULL;
+    persist_pipes[iindex].buf_len = 0;
+    persist_pipes[iindex].buf_size = 0;
     if (persist_pipes[iindex].fdOut != -1) {
         close(persist_pipes[iindex].fdOut);
         persist_pipes[iindex].fdOut = -1;
@@ -743,4 +1303,11 @@ close_persist_pipe(int iindex)
         persist_pipes[iindex].pid = NETSNMP_NO_SUCH_PROCESS;
     }
 
+    /*
+     * Tagged requests still waiting will get no reply now
+     */
+    while ((preq = persist_pipes[iindex].pending) != NULL) {
+        persist_pipes[iindex].pending = preq->next;
+        tagged_request_none(preq);
+    }
 }
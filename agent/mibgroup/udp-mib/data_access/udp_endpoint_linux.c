@@ -20,14 +20,28 @@
 #include <fcntl.h>
 #include <stdint.h>
 
+#if defined(HAVE_LINUX_SOCK_DIAG_H) && defined(HAVE_LINUX_INET_DIAG_H)
+#include <errno.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#define NETSNMP_UDP_ENDPOINT_SOCK_DIAG 1
+#endif
+
 netsnmp_feature_require(text_utils);
 netsnmp_feature_child_of(udp_endpoint_all, libnetsnmpmibs);
 netsnmp_feature_child_of(udp_endpoint_writable, udp_endpoint_all);
+#ifdef NETSNMP_UDP_ENDPOINT_SOCK_DIAG
+netsnmp_feature_require(udp_endpoint_entry_create);
+#endif
 
 static int _load4(netsnmp_container *container, u_int flags);
 #if defined (NETSNMP_ENABLE_IPV6)
 static int _load6(netsnmp_container *container, u_int flags);
 #endif
+#ifdef NETSNMP_UDP_ENDPOINT_SOCK_DIAG
+static int _load_diag(netsnmp_container *container, int family);
+#endif
 
 /*
  * initialize arch specific storage
@@ -94,7 +108,15 @@ netsnmp_arch_udp_endpoint_container_load(netsnmp_container *container,
     /* Setup the pid_from_inode table, and fill it.*/
     netsnmp_get_pid_from_inode_init();
 
-    rc = _load4(container, load_flags);
+#ifdef NETSNMP_UDP_ENDPOINT_SOCK_DIAG
+    /*
+     * ask the kernel for binary socket records, rather than parsing
+     * /proc/net/udp. Fall back to /proc if sock_diag isn't available.
+     */
+    rc = _load_diag(container, AF_INET);
+    if (-4 == rc)
+#endif
+        rc = _load4(container, load_flags);
     if(rc < 0) {
         u_int flags = NETSNMP_ACCESS_UDP_ENDPOINT_FREE_KEEP_CONTAINER;
         netsnmp_access_udp_endpoint_container_free(container, flags);
@@ -102,7 +124,11 @@ netsnmp_arch_udp_endpoint_container_load(netsnmp_container *container,
     }
 
 #if defined (NETSNMP_ENABLE_IPV6)
-    rc = _load6(container, load_flags);
+#ifdef NETSNMP_UDP_ENDPOINT_SOCK_DIAG
+    rc = _load_diag(container, AF_INET6);
+    if (-4 == rc)
+#endif
+        rc = _load6(container, load_flags);
     if(rc < 0) {
         u_int flags = NETSNMP_ACCESS_UDP_ENDPOINT_FREE_KEEP_CONTAINER;
         netsnmp_access_udp_endpoint_container_free(container, flags);
@@ -311,3 +337,127 @@ _load6(netsnmp_container *container, u_int load_flags)
     return (NULL == container);
 }
 #endif /* NETSNMP_ENABLE_IPV6 */
+
+#ifdef NETSNMP_UDP_ENDPOINT_SOCK_DIAG
+/**
+ * load the sockets of one address family with a NETLINK_SOCK_DIAG dump.
+ *
+ * @retval  0 no errors
+ * @retval -3 out of memory
+ * @retval -4 sock_diag not available (use /proc instead)
+ * @retval -5 error reading from the kernel
+ */
+static int
+_load_diag(netsnmp_container *container, int family)
+{
+    struct {
+        struct nlmsghdr         n;
+        struct inet_diag_req_v2 r;
+    } req;
+    struct sockaddr_nl  sa;
+    struct nlmsghdr    *h;
+    struct inet_diag_msg *msg;
+    netsnmp_udp_endpoint_entry *ep;
+    char               *buf;
+    int                 fd, len, addr_len, done = 0, rc = 0, count = 0;
+    enum                { bufsize = 65536 };
+
+    if (NULL == container)
+        return -1;
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_SOCK_DIAG);
+    if (fd < 0) {
+        DEBUGMSGTL(("access:udp_endpoint", "no sock_diag socket\n"));
+        return -4;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.n.nlmsg_len = sizeof(req);
+    req.n.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.r.sdiag_family = family;
+    req.r.sdiag_protocol = IPPROTO_UDP;
+    req.r.idiag_states = ~0U;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    if (sendto(fd, &req, sizeof(req), 0, (struct sockaddr *) &sa,
+               sizeof(sa)) < 0) {
+        DEBUGMSGTL(("access:udp_endpoint", "sock_diag send failed\n"));
+        close(fd);
+        return -4;
+    }
+
+    buf = (char *) malloc(bufsize);
+    if (NULL == buf) {
+        close(fd);
+        return -3;
+    }
+
+    addr_len = (AF_INET == family) ? 4 : 16;
+    while (!done) {
+        len = recv(fd, buf, bufsize, 0);
+        if (len < 0 && EINTR == errno)
+            continue;
+        if (len <= 0) {
+            snmp_log_perror("udp:_load_diag: receive failed");
+            rc = -5;
+            break;
+        }
+        for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, len);
+             h = NLMSG_NEXT(h, len)) {
+            if (NLMSG_DONE == h->nlmsg_type) {
+                done = 1;
+                break;
+            }
+            if (NLMSG_ERROR == h->nlmsg_type) {
+                /*
+                 * an error before any socket means the kernel doesn't
+                 * do sock_diag for udp (module not loaded)
+                 */
+                DEBUGMSGTL(("access:udp_endpoint",
+                            "sock_diag error (family %d)\n", family));
+                rc = (0 == count) ? -4 : -5;
+                done = 1;
+                break;
+            }
+            if (SOCK_DIAG_BY_FAMILY != h->nlmsg_type ||
+                h->nlmsg_len < NLMSG_LENGTH(sizeof(*msg)))
+                continue;
+            msg = (struct inet_diag_msg *) NLMSG_DATA(h);
+
+            ep = netsnmp_access_udp_endpoint_entry_create();
+            if (NULL == ep) {
+                rc = -3;
+                done = 1;
+                break;
+            }
+
+            /** addresses are in network order already */
+            memcpy(ep->loc_addr, msg->id.idiag_src, addr_len);
+            ep->loc_addr_len = addr_len;
+            ep->loc_port = ntohs(msg->id.idiag_sport);
+            memcpy(ep->rmt_addr, msg->id.idiag_dst, addr_len);
+            ep->rmt_addr_len = addr_len;
+            ep->rmt_port = ntohs(msg->id.idiag_dport);
+            ep->state = msg->idiag_state;
+
+            /*
+             * Use inode as instance value.
+             */
+            ep->instance = msg->idiag_inode;
+            ep->pid = netsnmp_get_pid_from_inode(msg->idiag_inode);
+
+            ep->index = CONTAINER_SIZE(container);
+            CONTAINER_INSERT(container, ep);
+            ++count;
+        }
+    }
+
+    DEBUGMSGTL(("access:udp_endpoint",
+                "sock_diag loaded %d sockets (family %d)\n", count, family));
+    free(buf);
+    close(fd);
+    return rc;
+}
+#endif /* NETSNMP_UDP_ENDPOINT_SOCK_DIAG */
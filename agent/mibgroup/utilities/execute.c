@@ -25,7 +25,10 @@
 #if HAVE_SYS_WAIT_H
 #include <sys/wait.h>
 #endif
-#if HAVE_SYS_SELECT_H
+#if defined(HAVE_POLL) && defined(HAVE_SYS_POLL_H)
+#include <sys/poll.h>
+#define EXECUTE_USE_POLL 1
+#elif HAVE_SYS_SELECT_H
 #include <sys/select.h>
 #endif
 
@@ -186,6 +189,38 @@ tokenize_exec_command(const char *command, int *argc)
 
     return argv;
 }
+
+/*
+ * Replace the current (child) process with the given command,
+ * either run directly or through the shell.  Never returns.
+ */
+static void
+exec_child_command(const char *command, int use_shell)
+{
+    char **argv;
+    int    argc, i;
+
+    if (use_shell) {
+        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+        snmp_log_perror("/bin/sh");
+        exit(1);
+    }
+
+    /*
+     * Set up the argv array and execute it
+     * This is being run in the child process,
+     *   so will release resources when it terminates.
+     */
+    argv = tokenize_exec_command(command, &argc);
+    if (!argv)
+        exit(1);
+    execv(argv[0], argv);
+    snmp_log_perror(argv[0]);
+    for (i = 0; i < argc; i++)
+        free(argv[i]);
+    free(argv);
+    exit(1);        /* End of child */
+}
 #endif
 
 /**
@@ -210,8 +245,6 @@ run_exec_command(const char *command, const char *input,
     int i;
     int pid;
     int result;
-    char **argv;
-    int argc;
 
     DEBUGMSGTL(("run:exec", "running '%s'\n", command));
     if (pipe(ipipe) < 0) {
@@ -253,29 +286,26 @@ run_exec_command(const char *command, const char *input,
         }
 
         netsnmp_close_fds(2);
+        exec_child_command(command, 0);
+        exit(1);        /* not reached */
 
-        /*
-         * Set up the argv array and execute it
-         * This is being run in the child process,
-         *   so will release resources when it terminates.
-         */
-        argv = tokenize_exec_command(command, &argc);
-        if (!argv)
-            exit(1);
-        execv(argv[0], argv);
-        snmp_log_perror(argv[0]);
-        for (i = 0; i < argc; i++)
-            free(argv[i]);
-        free(argv);
-        exit(1);        /* End of child */
 
     } else if (pid > 0) {
         char            cache[NETSNMP_MAXCACHESIZE];
         char           *cache_ptr;
         ssize_t         count, cache_size, offset = 0;
-        int             waited = 0, numfds;
+        int             waited = 0;
+#ifdef EXECUTE_USE_POLL
+        /*
+         * this may run on agent worker threads, where the descriptor can
+         * be well beyond FD_SETSIZE
+         */
+        struct pollfd   pfd;
+#else
+        int             numfds;
         fd_set          readfds;
         struct timeval  timeout;
+#endif
 
         /*
          * Parent process
@@ -316,9 +346,19 @@ run_exec_command(const char *command, const char *input,
          * routine for both to use.
          */
         DEBUGMSGTL(("verbose:run:exec","  waiting for child %d...\n", pid));
+#ifndef EXECUTE_USE_POLL
         numfds = opipe[0] + 1;
+#endif
         i = NETSNMP_MAXREADCOUNT;
         for (; i; --i) {
+#ifdef EXECUTE_USE_POLL
+            pfd.fd = opipe[0];
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+
+            DEBUGMSGTL(("verbose:run:exec", "    calling poll\n"));
+            count = poll(&pfd, 1, 1000);
+#else
             /*
              * set up data for select
              */
@@ -329,6 +369,7 @@ run_exec_command(const char *command, const char *input,
 
             DEBUGMSGTL(("verbose:run:exec", "    calling select\n"));
             count = select(numfds, &readfds, NULL, NULL, &timeout);
+#endif
             if (count == -1) {
                 if (EAGAIN == errno) {
                     continue;
@@ -343,7 +384,11 @@ run_exec_command(const char *command, const char *input,
                 continue;
             }
 
+#ifdef EXECUTE_USE_POLL
+            if (!(pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+#else
             if (!FD_ISSET(opipe[0], &readfds)) {
+#endif
                 DEBUGMSGTL(("verbose:run:exec", "    fd not ready!\n"));
                 continue;
             }
@@ -451,3 +496,85 @@ run_exec_command(const char *command, const char *input,
     return run_shell_command( command, input, output, out_len );
 #endif
 }
+
+/**
+ * Start a command without waiting for it to finish.
+ *
+ * @command:   Command to run.
+ * @input:     Data to send to stdin. May be NULL.
+ * @use_shell: Run the command via "/bin/sh -c" rather than execv().
+ * @out_fd:    Set to the non-blocking read end of a pipe carrying the
+ *             command's stdout and stderr.
+ *
+ * The caller must read *@out_fd until end-of-file, close it, and reap the
+ * command with waitpid().
+ *
+ * @return the process ID of the command; -1 if it could not be started.
+ */
+int
+start_exec_command(const char *command, const char *input, int use_shell,
+                   int *out_fd)
+{
+#if HAVE_EXECV
+    int ipipe[2];
+    int opipe[2];
+    int pid;
+
+    if (!command || !out_fd)
+        return -1;
+    DEBUGMSGTL(("run:exec", "starting '%s'\n", command));
+    if (pipe(ipipe) < 0) {
+        snmp_log_perror("pipe");
+        return -1;
+    }
+    if (pipe(opipe) < 0) {
+        snmp_log_perror("pipe");
+        close(ipipe[0]);
+        close(ipipe[1]);
+        return -1;
+    }
+    if ((pid = fork()) == 0) {
+        /*
+         * Child process: stdin/out/err use the pipes
+         */
+        if (dup2(ipipe[0], STDIN_FILENO) < 0 ||
+            dup2(opipe[1], STDOUT_FILENO) < 0 ||
+            dup2(STDOUT_FILENO, STDERR_FILENO) < 0) {
+            snmp_log_perror("dup2");
+            exit(1);
+        }
+        close(ipipe[0]);
+        close(ipipe[1]);
+        close(opipe[0]);
+        close(opipe[1]);
+        netsnmp_close_fds(2);
+        exec_child_command(command, use_shell);
+        exit(1);        /* not reached */
+    }
+
+    close(ipipe[0]);
+    close(opipe[1]);
+    if (pid < 0) {
+        snmp_log_perror("fork");
+        close(ipipe[1]);
+        close(opipe[0]);
+        return -1;
+    }
+
+    /*
+     * The input is at most a few hundred bytes, so fits in the pipe.
+     */
+    if (input && write(ipipe[1], input, strlen(input)) < 0)
+        snmp_log_perror("write() to input pipe");
+    close(ipipe[1]);
+
+#ifdef O_NONBLOCK
+    fcntl(opipe[0], F_SETFL, fcntl(opipe[0], F_GETFL) | O_NONBLOCK);
+#endif
+    *out_fd = opipe[0];
+    DEBUGMSGTL(("run:exec", "  started child %d\n", pid));
+    return pid;
+#else
+    return -1;
+#endif
+}
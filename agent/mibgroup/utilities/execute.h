@@ -5,6 +5,8 @@ config_belongs_in(agent_module)
 
 int run_shell_command(const char *command, const char *input,
                       char *output, int *out_len);
+int start_exec_command(const char *command, const char *input,
+                       int use_shell, int *out_fd);
 int run_exec_command(const char *command, const char *input,
                      char *output, int *out_len);
 
@@ -84,6 +84,7 @@ SOFTWARE.
 #include <net-snmp/library/large_fd_set.h>
 #include <net-snmp/library/snmp_assert.h>
 #include "agent_global_vars.h"
+#include "agent_workers.h"
 
 #if HAVE_SYSLOG_H
 #include <syslog.h>
@@ -811,7 +812,7 @@ agent_check_and_process(int block)
     netsnmp_external_event_info2(&numfds, &readfds, &writefds, &exceptfds);
 #endif /* NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER */
 
-    count = netsnmp_large_fd_set_select(numfds, &readfds, &writefds, &exceptfds, tvp);
+    count = netsnmp_event_loop_wait2(numfds, &readfds, &writefds, &exceptfds, tvp);
 
     if (count > 0) {
         /*
@@ -1453,9 +1454,6 @@ init_master_agent(void)
     char           *buf = NULL;
     char           *st;
 
-    /* default to a default cache size */
-    netsnmp_set_lookup_cache_size(-1);
-
     if (netsnmp_ds_get_boolean(NETSNMP_DS_APPLICATION_ID, 
 			       NETSNMP_DS_AGENT_ROLE) != MASTER_AGENT) {
         DEBUGMSGTL(("snmp_agent",
@@ -1611,6 +1609,12 @@ free_agent_snmp_session(netsnmp_agent_session *asp)
     DEBUGMSGTL(("snmp_agent","agent_session %8p released\n", asp));
 
     netsnmp_remove_from_delegated(asp);
+
+    /*
+     * worker threads may still be using it; they'll free it when done
+     */
+    if (netsnmp_agent_workers_release(asp))
+        return;
     
     DEBUGMSGTL(("verbose:asp", "asp %p reqinfo %p freed\n",
                 asp, asp->reqinfo));
@@ -3009,8 +3013,12 @@ handle_var_requests(netsnmp_agent_session *asp)
          */
         if(NULL != asp->treecache[i].subtree->reginfo) {
             reginfo = asp->treecache[i].subtree->reginfo;
-            status = netsnmp_call_handlers(reginfo, asp->reqinfo,
-                                           asp->treecache[i].requests_begin);
+            if (netsnmp_agent_workers_dispatch(asp, reginfo,
+                                               asp->treecache[i].requests_begin))
+                status = SNMP_ERR_NOERROR;
+            else
+                status = netsnmp_call_handlers(reginfo, asp->reqinfo,
+                                               asp->treecache[i].requests_begin);
         }
         else
             status = SNMP_ERR_GENERR;
@@ -1172,6 +1172,7 @@ receive(void)
     netsnmp_large_fd_set readfds, writefds, exceptfds;
     struct timeval  timeout, *tvp = &timeout;
     int             count, block, i;
+    int             ready[256], nready = 0, use_ready, sets_clean = 0;
 #ifdef	USING_SMUX_MODULE
     int             sd;
 #endif                          /* USING_SMUX_MODULE */
@@ -1221,10 +1222,30 @@ receive(void)
         tvp->tv_usec = 0;
 
         numfds = 0;
+        block = 0;
+        /*
+         * When epoll watches every descriptor, it reports the ready ones
+         * and only those are handed on: no descriptor sets are collected
+         * from all sessions, and the sets only ever hold the bits of the
+         * last wakeup, which are cleared again below.
+         */
+        use_ready = netsnmp_event_loop_can_wait_ready();
+        if (use_ready) {
+            if (!sets_clean) {
+                NETSNMP_LARGE_FD_ZERO(&readfds);
+                NETSNMP_LARGE_FD_ZERO(&writefds);
+                NETSNMP_LARGE_FD_ZERO(&exceptfds);
+                sets_clean = 1;
+            }
+            snmp_select_timeout(tvp, &block);
+            if (block == 1)
+                tvp = NULL;     /* block without timeout */
+            goto reselect;
+        }
+        sets_clean = 0;
         NETSNMP_LARGE_FD_ZERO(&readfds);
         NETSNMP_LARGE_FD_ZERO(&writefds);
         NETSNMP_LARGE_FD_ZERO(&exceptfds);
-        block = 0;
         snmp_select_info2(&numfds, &readfds, tvp, &block);
         if (block == 1) {
             tvp = NULL;         /* block without timeout */
@@ -1266,8 +1287,14 @@ receive(void)
         if (tvp)
             DEBUGMSGTL(("timer", "tvp %ld.%ld\n", (long) tvp->tv_sec,
                         (long) tvp->tv_usec));
-        count = netsnmp_large_fd_set_select(numfds, &readfds, &writefds, &exceptfds,
-				     tvp);
+        if (use_ready)
+            count = netsnmp_event_loop_wait_ready(ready, sizeof(ready) /
+                                                  sizeof(ready[0]), &nready,
+                                                  &readfds, &writefds,
+                                                  &exceptfds, tvp);
+        else
+            count = netsnmp_event_loop_wait2(numfds, &readfds, &writefds,
+                                             &exceptfds, tvp);
         DEBUGMSGTL(("snmpd/select", "returned, count = %d\n", count));
 
         if (count > 0) {
@@ -1303,7 +1330,11 @@ receive(void)
 #endif /* NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER */
 
             /* If there are still events leftover, process them */
-            if (count > 0) {
+            if (count > 0 && use_ready) {
+                for (i = 0; i < nready; i++)
+                    if (NETSNMP_LARGE_FD_ISSET(ready[i], &readfds))
+                        snmp_read_fd(ready[i], &readfds);
+            } else if (count > 0) {
               snmp_read2(&readfds);
             }
         } else
@@ -1331,6 +1362,15 @@ receive(void)
                 return -1;
             }                   /* endif -- count>0 */
 
+        if (use_ready) {
+            for (i = 0; i < nready; i++) {
+                NETSNMP_LARGE_FD_CLR(ready[i], &readfds);
+                NETSNMP_LARGE_FD_CLR(ready[i], &writefds);
+                NETSNMP_LARGE_FD_CLR(ready[i], &exceptfds);
+            }
+            nready = 0;
+        }
+
         /*
          * see if persistent store needs to be saved
          */
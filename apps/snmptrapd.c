@@ -96,6 +96,7 @@ SOFTWARE.
 
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/large_fd_set.h>
 #include <net-snmp/library/fd_event_manager.h>
 #include <net-snmp/agent/netsnmp_close_fds.h>
 #include "../snmplib/snmp_syslog.h"
@@ -108,6 +109,7 @@ SOFTWARE.
 #include "snmptrapd_log.h"
 #include "snmptrapd_auth.h"
 #include "snmptrapd_sql.h"
+#include "snmptrapd_shards.h"
 #include "notification-log-mib/notification_log.h"
 #include "tlstm-mib/snmpTlstmCertToTSNTable/snmpTlstmCertToTSNTable.h"
 #include "mibII/vacm_conf.h"
@@ -510,9 +512,12 @@ static void
 snmptrapd_main_loop(void)
 {
     int             count, numfds, block;
-    fd_set          readfds,writefds,exceptfds;
+    netsnmp_large_fd_set readfds, writefds, exceptfds;
     struct timeval  timeout;
-    NETSNMP_SELECT_TIMEVAL timeout2;
+
+    netsnmp_large_fd_set_init(&readfds, FD_SETSIZE);
+    netsnmp_large_fd_set_init(&writefds, FD_SETSIZE);
+    netsnmp_large_fd_set_init(&exceptfds, FD_SETSIZE);
 
     while (netsnmp_running) {
         if (reconfig) {
@@ -529,32 +534,31 @@ snmptrapd_main_loop(void)
             if (trap1_fmt_str_remember) {
                 parse_format( NULL, trap1_fmt_str_remember );
             }
+            snmptrapd_shards_reconfig();
             reconfig = 0;
         }
         numfds = 0;
-        FD_ZERO(&readfds);
-        FD_ZERO(&writefds);
-        FD_ZERO(&exceptfds);
+        NETSNMP_LARGE_FD_ZERO(&readfds);
+        NETSNMP_LARGE_FD_ZERO(&writefds);
+        NETSNMP_LARGE_FD_ZERO(&exceptfds);
         block = 0;
         timerclear(&timeout);
         timeout.tv_sec = 5;
-        snmp_select_info(&numfds, &readfds, &timeout, &block);
+        snmp_select_info2(&numfds, &readfds, &timeout, &block);
 #ifndef NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER
-        netsnmp_external_event_info(&numfds, &readfds, &writefds, &exceptfds);
+        netsnmp_external_event_info2(&numfds, &readfds, &writefds, &exceptfds);
 #endif /* NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER */
-        timeout2.tv_sec = timeout.tv_sec;
-        timeout2.tv_usec = timeout.tv_usec;
-        count = select(numfds, &readfds, &writefds, &exceptfds,
-                       !block ? &timeout2 : NULL);
+        count = netsnmp_event_loop_wait2(numfds, &readfds, &writefds,
+                                         &exceptfds, !block ? &timeout : NULL);
         if (count > 0) {
 #ifndef NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER
-            netsnmp_dispatch_external_events(&count, &readfds, &writefds,
-                                             &exceptfds);
+            netsnmp_dispatch_external_events2(&count, &readfds, &writefds,
+                                              &exceptfds);
 #endif /* NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER */
             /* If there are any more events after external events, then
              * try SNMP events. */
             if (count > 0) {
-                snmp_read(&readfds);
+                snmp_read2(&readfds);
             }
         } else {
             switch (count) {
@@ -574,6 +578,10 @@ snmptrapd_main_loop(void)
 	}
 	run_alarms();
     }
+
+    netsnmp_large_fd_set_cleanup(&readfds);
+    netsnmp_large_fd_set_cleanup(&writefds);
+    netsnmp_large_fd_set_cleanup(&exceptfds);
 }
 
 /*******************************************************************-o-******
@@ -605,8 +613,10 @@ main(int argc, char *argv[])
 #endif
         ;
     netsnmp_session *sess_list = NULL, *ss = NULL;
+    netsnmp_session *shard_list[SNMPTRAPD_SHARDS_MAX];
     netsnmp_transport *transport = NULL;
     int             arg, i = 0;
+    int             shards = 1, shard = 0;
     int             uid = 0, gid = 0;
     int             exit_code = 1;
     char           *cp, *listen_ports = NULL;
@@ -685,6 +695,10 @@ main(int argc, char *argv[])
                             parse_config_addForwarderInfo, NULL,
                             "(1|yes|true|0|no|false)");
 
+    netsnmp_ds_register_config(ASN_INTEGER, "snmptrapd", "receiverShards",
+                               NETSNMP_DS_APPLICATION_ID,
+                               NETSNMP_DS_APP_RECEIVER_SHARDS);
+
 #ifndef NETSNMP_FEATURE_REMOVE_LOGGING_SYSLOG
 #ifdef WIN32
     snmp_log_syslogname(app_name_long);
@@ -1123,6 +1137,22 @@ main(int argc, char *argv[])
 #endif /* NETSNMP_FEATURE_REMOVE_LOGGING_SYSLOG */
     }
 
+#if defined(USING_AGENTX_SUBAGENT_MODULE) && !defined(NETSNMP_SNMPTRAPD_DISABLE_AGENTX)
+    if (agentx_subagent &&
+        netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                           NETSNMP_DS_APP_RECEIVER_SHARDS) > 1) {
+        /*
+         * The AgentX session cannot be shared between processes.
+         */
+        snmp_log(LOG_WARNING, "receiverShards requires -X; "
+                 "using a single receiver\n");
+        netsnmp_ds_set_int(NETSNMP_DS_APPLICATION_ID,
+                           NETSNMP_DS_APP_RECEIVER_SHARDS, 1);
+    }
+#endif
+    memset(shard_list, 0, sizeof(shard_list));
+    shards = snmptrapd_shards_init();
+
     if (listen_ports)
         cp = listen_ports;
     else
@@ -1157,6 +1187,27 @@ main(int argc, char *argv[])
             }
         }
 
+        /*
+         * Every further receiver shard gets its own socket for a datagram
+         * address; stream listeners are served by the first one only.
+         */
+        for (i = 1; i < shards &&
+                 !(transport->flags & NETSNMP_TRANSPORT_FLAG_STREAM); i++) {
+            netsnmp_transport *t = netsnmp_transport_open_server("snmptrap", cp);
+
+            ss = t ? snmptrapd_add_session(t) : NULL;
+            if (ss == NULL) {
+                snmp_log(LOG_ERR, "couldn't open %s for receiver shard %d\n",
+                         cp, i);
+                snmptrapd_close_sessions(sess_list);
+                for (i = 1; i < shards; i++)
+                    snmptrapd_close_sessions(shard_list[i]);
+                goto sock_cleanup;
+            }
+            ss->next = shard_list[i];
+            shard_list[i] = ss;
+        }
+
         /*
          * Process next listen address, if there is one.  
          */
@@ -1288,6 +1339,23 @@ main(int argc, char *argv[])
     trapd_status = SNMPTRAPD_RUNNING;
 #endif
 
+    if (shards > 1 && netsnmp_running) {
+        /*
+         * Each receiver keeps the sessions of its own shard; the output
+         * stage does not receive any notifications itself.
+         */
+        shard_list[0] = sess_list;
+        if (snmptrapd_shards_start(shards, &shard) < 0) {
+            for (i = 0; i < shards; i++)
+                snmptrapd_close_sessions(shard_list[i]);
+            goto sock_cleanup;
+        }
+        for (i = 0; i < shards; i++)
+            if (i != shard)
+                snmptrapd_close_sessions(shard_list[i]);
+        sess_list = shard >= 0 ? shard_list[shard] : NULL;
+    }
+
     snmptrapd_main_loop();
 
     if (snmp_get_do_logging()) {
@@ -1301,7 +1369,8 @@ main(int argc, char *argv[])
                  tm->tm_min, tm->tm_sec, netsnmp_get_version());
     }
     snmp_log(LOG_INFO, "Stopping snmptrapd\n");
-    
+    snmptrapd_shards_stop();
+
 #ifdef NETSNMP_EMBEDDED_PERL
     shutdown_perl();
 #endif
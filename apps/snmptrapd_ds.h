@@ -16,4 +16,11 @@
  *     If this definition is changed, it should be updated there too.
  */
 
+/* integers
+ *
+ * WARNING: These must not conflict with the agent's DS integers
+ * (see <agent/ds_agent.h>) */
+
+#define NETSNMP_DS_APP_RECEIVER_SHARDS  19
+
 #endif /* SNMPTRAPD_DS_H */
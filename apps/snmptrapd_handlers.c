@@ -39,6 +39,7 @@
 #include "snmptrapd_handlers.h"
 #include "snmptrapd_auth.h"
 #include "snmptrapd_log.h"
+#include "snmptrapd_shards.h"
 #include "notification-log-mib/notification_log.h"
 
 netsnmp_feature_child_of(add_default_traphandler, snmptrapd);
@@ -859,7 +860,8 @@ int   command_handler( netsnmp_pdu           *pdu,
         /*
          *  and pass this formatted string to the command specified
          */
-        run_shell_command(handler->token, (char*)rbuf, NULL, NULL);   /* Not interested in output */
+        if (!snmptrapd_shard_exec(handler->token, (char*)rbuf))
+            run_shell_command(handler->token, (char*)rbuf, NULL, NULL);   /* Not interested in output */
         netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID, 
                                NETSNMP_DS_LIB_QUICK_PRINT, oldquick);
         if (pdu->command == SNMP_MSG_TRAP)
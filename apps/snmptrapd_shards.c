@@ -0,0 +1,587 @@
+/*
+ * snmptrapd_shards.c - spread notification processing over several processes
+ *
+ * With "receiverShards N" snmptrapd opens every UDP listening address N
+ * times with SO_REUSEPORT, so that the kernel distributes the incoming
+ * notifications over the sockets, and forks N receiver processes.  Each
+ * receiver owns one set of sockets and runs the complete parse,
+ * authorization and handler chain for the notifications arriving on them.
+ *
+ * The original process becomes the output stage.  The receivers send the
+ * lines they log and the traphandle commands they want to run to it over
+ * a socket pair.  It writes the log lines one record at a time in the
+ * order they arrive, so they are never interleaved and only one process
+ * writes to the log files, and starts the commands without waiting for
+ * them, so that a slow command doesn't hold up the other receivers.
+ */
+#include <net-snmp/net-snmp-config.h>
+
+#include <stdio.h>
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#if HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <sys/types.h>
+#if HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#if HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+#if HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+#include <signal.h>
+#include <errno.h>
+
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include "../agent_global_vars.h"
+#include "utilities/execute.h"
+#include "snmptrapd_ds.h"
+#include "snmptrapd_shards.h"
+
+#if defined(NETSNMP_TRANSPORT_UDP_DOMAIN) && defined(HAVE_FORK) && \
+    defined(SOCK_SEQPACKET) && !defined(WIN32)
+
+#include <net-snmp/library/snmpUDPBaseDomain.h>
+
+#define SHARD_RECORD_LOG        1
+#define SHARD_RECORD_EXEC       2
+
+/*
+ * Largest record exchanged with the output stage; longer command input
+ * is truncated.
+ */
+#define SHARD_RECORD_MAX        65536
+
+/*
+ * Records drained from one receiver per wakeup of the output stage.
+ */
+#define SHARD_READ_BATCH        64
+
+/*
+ * traphandle commands the output stage runs at the same time; beyond
+ * that, it waits for each further command to finish.
+ */
+#define SHARD_EXEC_MAX          32
+
+struct shard_record {
+    int             type;       /* SHARD_RECORD_* */
+    int             priority;   /* log priority */
+    int             cmdlen;     /* command length including the NUL */
+};
+
+struct shard_exec {
+    pid_t           pid;        /* 0: slot unused */
+    int             fd;         /* command output, -1 once closed */
+    unsigned int    reap_id;    /* alarm polling for its exit */
+};
+
+/* output stage */
+static int      shard_count;
+static pid_t    shard_pid[SNMPTRAPD_SHARDS_MAX];
+static int      shard_sock[SNMPTRAPD_SHARDS_MAX];
+static struct shard_exec shard_exec[SHARD_EXEC_MAX];
+
+/* receiver */
+static int      shard_self = -1;
+static int      shard_fd = -1;
+static char     shard_logbuf[4096];
+static size_t   shard_loglen;
+static int      shard_logpri;
+
+static int
+_shard_send(int type, int priority, const char *command, const char *text)
+{
+    struct shard_record hdr;
+    struct iovec    iov[3];
+    struct msghdr   msg;
+    size_t          cmdlen = command ? strlen(command) + 1 : 0;
+    size_t          textlen = strlen(text);
+    ssize_t         rc;
+
+    if (shard_fd < 0 || sizeof(hdr) + cmdlen >= SHARD_RECORD_MAX)
+        return -1;
+    if (sizeof(hdr) + cmdlen + textlen > SHARD_RECORD_MAX)
+        textlen = SHARD_RECORD_MAX - sizeof(hdr) - cmdlen;
+
+    hdr.type = type;
+    hdr.priority = priority;
+    hdr.cmdlen = cmdlen;
+    iov[0].iov_base = (void *) &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = NETSNMP_REMOVE_CONST(void *, command);
+    iov[1].iov_len = cmdlen;
+    iov[2].iov_base = NETSNMP_REMOVE_CONST(void *, text);
+    iov[2].iov_len = textlen;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 3;
+
+    do {
+        rc = sendmsg(shard_fd, &msg, 0);
+    } while (rc < 0 && errno == EINTR);
+    return rc < 0 ? -1 : 0;
+}
+
+static void
+_shard_flush_log(void)
+{
+    if (shard_loglen == 0)
+        return;
+    _shard_send(SHARD_RECORD_LOG, shard_logpri, NULL, shard_logbuf);
+    shard_loglen = 0;
+    shard_logbuf[0] = '\0';
+}
+
+/*
+ * SNMP_CALLBACK_LOGGING callback of a receiver.  Messages are collected
+ * until a line is complete so that the output stage never interleaves
+ * partial lines of different receivers.
+ */
+static int
+_shard_log(int majorID, int minorID, void *serverarg, void *clientarg)
+{
+    struct snmp_log_message *slm = (struct snmp_log_message *) serverarg;
+    size_t          len = strlen(slm->msg);
+
+    if (shard_loglen + len >= sizeof(shard_logbuf))
+        _shard_flush_log();
+    if (len >= sizeof(shard_logbuf)) {
+        _shard_send(SHARD_RECORD_LOG, slm->priority, NULL, slm->msg);
+        return SNMP_ERR_NOERROR;
+    }
+    memcpy(shard_logbuf + shard_loglen, slm->msg, len + 1);
+    shard_loglen += len;
+    shard_logpri = slm->priority;
+    if (len > 0 && slm->msg[len - 1] == '\n')
+        _shard_flush_log();
+    return SNMP_ERR_NOERROR;
+}
+
+/*
+ * Route all logging of a receiver through _shard_log().
+ */
+static void
+_shard_redirect_log(void)
+{
+    snmp_disable_log();
+    snmp_enable_calllog();
+}
+
+/*
+ * The receiver end of the socket pair only becomes readable when the
+ * output stage went away; there is no point in carrying on then.
+ */
+static void
+_shard_parent_gone(int fd, void *data)
+{
+    char            c;
+    ssize_t         rc;
+
+    rc = recv(fd, &c, sizeof(c), MSG_DONTWAIT);
+    if (rc < 0 && (errno == EINTR || errno == EAGAIN))
+        return;
+    unregister_readfd(fd);
+    close(fd);
+    shard_fd = -1;
+    netsnmp_running = 0;
+}
+
+#ifdef USING_UTILITIES_EXECUTE_MODULE
+/*
+ * Reap a traphandle command that has closed its output.  Polled from an
+ * alarm until it has exited.
+ */
+static void
+_shard_exec_reap(unsigned int clientreg, void *clientarg)
+{
+    struct shard_exec *ex = (struct shard_exec *) clientarg;
+    int             status, rc;
+
+    rc = waitpid(ex->pid, &status, WNOHANG);
+    if (rc == 0)
+        return;
+    if (rc < 0)
+        snmp_log_perror("traphandle: waitpid");
+    else
+        DEBUGMSGTL(("snmptrapd:shards", "traphandle pid %d exited (%d)\n",
+                    (int) ex->pid, status));
+    if (ex->reap_id)
+        snmp_alarm_unregister(ex->reap_id);
+    ex->reap_id = 0;
+    ex->pid = 0;
+}
+
+/*
+ * The output of a traphandle command is discarded; end-of-file means it
+ * has (almost) finished.
+ */
+static void
+_shard_exec_read(int fd, void *data)
+{
+    struct shard_exec *ex = (struct shard_exec *) data;
+    struct timeval  poll = { 0, 100000 };
+    char            buf[4096];
+    ssize_t         count;
+
+    count = read(fd, buf, sizeof(buf));
+    if (count > 0 || (count < 0 && (errno == EAGAIN || errno == EINTR)))
+        return;
+    unregister_readfd(fd);
+    close(fd);
+    ex->fd = -1;
+    _shard_exec_reap(0, ex);
+    if (ex->pid)
+        ex->reap_id = snmp_alarm_register_hr(poll, SA_REPEAT,
+                                             _shard_exec_reap, ex);
+}
+
+/*
+ * Start a traphandle command without waiting for it, or run it to the end
+ * when too many are running already or it can't be started that way.
+ */
+static void
+_shard_exec(const char *command, const char *input)
+{
+    struct shard_exec *ex = NULL;
+    int             i, fd, status;
+    pid_t           pid;
+
+    for (i = 0; i < SHARD_EXEC_MAX && !ex; i++)
+        if (shard_exec[i].pid == 0)
+            ex = &shard_exec[i];
+    if (ex == NULL) {
+        DEBUGMSGTL(("snmptrapd:shards", "%d traphandle commands running; "
+                    "waiting for %s\n", SHARD_EXEC_MAX, command));
+        run_shell_command(command, input, NULL, NULL);
+        return;
+    }
+
+    pid = start_exec_command(command, input, 1, &fd);
+    if (pid < 0) {
+        run_shell_command(command, input, NULL, NULL);
+        return;
+    }
+    if (register_readfd(fd, _shard_exec_read, ex) != FD_REGISTERED_OK) {
+        close(fd);
+        waitpid(pid, &status, 0);
+        return;
+    }
+    ex->pid = pid;
+    ex->fd = fd;
+    ex->reap_id = 0;
+}
+
+/*
+ * Wait for the traphandle commands that are still running.
+ */
+static void
+_shard_exec_wait(void)
+{
+    struct shard_exec *ex;
+    int             i, status;
+
+    for (i = 0; i < SHARD_EXEC_MAX; i++) {
+        ex = &shard_exec[i];
+        if (ex->pid == 0)
+            continue;
+        if (ex->fd >= 0) {
+            unregister_readfd(ex->fd);
+            close(ex->fd);
+            ex->fd = -1;
+        }
+        if (ex->reap_id)
+            snmp_alarm_unregister(ex->reap_id);
+        ex->reap_id = 0;
+        waitpid(ex->pid, &status, 0);
+        ex->pid = 0;
+    }
+}
+#else
+#define _shard_exec_wait()
+#endif /* USING_UTILITIES_EXECUTE_MODULE */
+
+static void
+_shard_output_record(char *buf, ssize_t len)
+{
+    struct shard_record hdr;
+    char           *text;
+
+    if (len < (ssize_t) sizeof(hdr))
+        return;
+    memcpy(&hdr, buf, sizeof(hdr));
+    buf[len] = '\0';
+    text = buf + sizeof(hdr);
+
+    switch (hdr.type) {
+    case SHARD_RECORD_LOG:
+        snmp_log(hdr.priority, "%s", text);
+        break;
+    case SHARD_RECORD_EXEC:
+        if (hdr.cmdlen <= 0 || hdr.cmdlen > len - (ssize_t) sizeof(hdr) ||
+            text[hdr.cmdlen - 1] != '\0')
+            break;
+#ifdef USING_UTILITIES_EXECUTE_MODULE
+        _shard_exec(text, text + hdr.cmdlen);
+#endif
+        break;
+    }
+}
+
+static void
+_shard_close(int i)
+{
+    int             status;
+
+    unregister_readfd(shard_sock[i]);
+    close(shard_sock[i]);
+    shard_sock[i] = -1;
+    if (waitpid(shard_pid[i], &status, 0) == shard_pid[i])
+        snmp_log(LOG_INFO, "receiver shard %d (pid %d) exited\n", i,
+                 (int) shard_pid[i]);
+    shard_pid[i] = -1;
+}
+
+/*
+ * Output stage: handle up to max records sent by receiver i.  Returns -1
+ * once the receiver has closed its end.
+ */
+static int
+_shard_read(int i, int max, int flags)
+{
+    static char     buf[SHARD_RECORD_MAX + 1];
+    ssize_t         rc;
+
+    while (max-- > 0) {
+        rc = recv(shard_sock[i], buf, SHARD_RECORD_MAX, flags);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc < 0 && errno == EAGAIN)
+            return 0;
+        if (rc <= 0) {
+            _shard_close(i);
+            return -1;
+        }
+        _shard_output_record(buf, rc);
+    }
+    return 0;
+}
+
+static void
+_shard_output(int fd, void *data)
+{
+    int             i = (int) (intptr_t) data, live;
+
+    if (_shard_read(i, SHARD_READ_BATCH, MSG_DONTWAIT) == 0)
+        return;
+
+    for (i = live = 0; i < shard_count; i++)
+        if (shard_sock[i] >= 0)
+            live++;
+    if (live == 0) {
+        snmp_log(LOG_ERR, "all receiver shards exited\n");
+        netsnmp_running = 0;
+    }
+}
+
+/*
+ * Returns the number of receivers configured with receiverShards and, if
+ * that is more than one, makes the UDP listening sockets opened from now
+ * on share their port.  Returns 1 if sharding is not configured or not
+ * possible.
+ */
+int
+snmptrapd_shards_init(void)
+{
+    int             count;
+
+    count = netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                               NETSNMP_DS_APP_RECEIVER_SHARDS);
+    if (count <= 1)
+        return 1;
+    if (count > SNMPTRAPD_SHARDS_MAX) {
+        snmp_log(LOG_WARNING, "receiverShards: limited to %d\n",
+                 SNMPTRAPD_SHARDS_MAX);
+        count = SNMPTRAPD_SHARDS_MAX;
+    }
+    if (netsnmp_udp_set_reuseport(1) < 0) {
+        snmp_log(LOG_WARNING, "receiverShards: SO_REUSEPORT is not "
+                 "supported; using a single receiver\n");
+        return 1;
+    }
+    return count;
+}
+
+/*
+ * Forks count receivers.  On success 0 is returned and *shard is set to
+ * the number of the receiver (0 .. count - 1) in the receivers and to -1
+ * in the output stage.
+ */
+int
+snmptrapd_shards_start(int count, int *shard)
+{
+    int             i, j, sv[2];
+    pid_t           pid;
+
+    netsnmp_udp_set_reuseport(0);
+
+    for (i = 0; i < count; i++) {
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0) {
+            snmp_log_perror("receiverShards: socketpair");
+            goto fail;
+        }
+        pid = fork();
+        if (pid < 0) {
+            snmp_log_perror("receiverShards: fork");
+            close(sv[0]);
+            close(sv[1]);
+            goto fail;
+        }
+        if (pid == 0) {
+            for (j = 0; j < i; j++)
+                close(shard_sock[j]);
+            close(sv[0]);
+            shard_count = 0;
+            shard_self = i;
+            shard_fd = sv[1];
+            register_readfd(shard_fd, _shard_parent_gone, NULL);
+            snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                                   SNMP_CALLBACK_LOGGING, _shard_log, NULL);
+            _shard_redirect_log();
+            DEBUGMSGTL(("snmptrapd:shards", "receiver %d running as pid %d\n",
+                        i, (int) getpid()));
+            *shard = i;
+            return 0;
+        }
+        close(sv[1]);
+        shard_pid[i] = pid;
+        shard_sock[i] = sv[0];
+        shard_count = i + 1;
+    }
+
+    /*
+     * Only register the receiver sockets now, so that no receiver
+     * inherits the registrations of its siblings.
+     */
+    for (i = 0; i < shard_count; i++)
+        register_readfd(shard_sock[i], _shard_output, (void *) (intptr_t) i);
+    snmp_log(LOG_INFO, "started %d receiver shards\n", shard_count);
+    *shard = -1;
+    return 0;
+
+  fail:
+    snmptrapd_shards_stop();
+    return -1;
+}
+
+/*
+ * Called after the configuration has been re-read: the output stage
+ * passes the SIGHUP on to the receivers, which in turn must not start
+ * writing to the log files again themselves.
+ */
+void
+snmptrapd_shards_reconfig(void)
+{
+    int             i;
+
+    if (shard_self >= 0) {
+        _shard_redirect_log();
+        return;
+    }
+    for (i = 0; i < shard_count; i++)
+        if (shard_pid[i] > 0)
+            kill(shard_pid[i], SIGHUP);
+}
+
+/*
+ * Stops the receivers after writing out whatever they still send and
+ * waiting for the traphandle commands they asked for, or, in a receiver,
+ * flushes the last log line to the output stage.  Only the
+ * output stage saves the persistent state on shutdown; the receivers
+ * would otherwise all rewrite snmptrapd.conf at the same time.
+ */
+void
+snmptrapd_shards_stop(void)
+{
+    int             i;
+
+    if (shard_self >= 0) {
+        netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_DONT_PERSIST_STATE, 1);
+        _shard_flush_log();
+        if (shard_fd >= 0) {
+            unregister_readfd(shard_fd);
+            close(shard_fd);
+            shard_fd = -1;
+        }
+        return;
+    }
+
+    for (i = 0; i < shard_count; i++)
+        if (shard_pid[i] > 0)
+            kill(shard_pid[i], SIGTERM);
+    for (i = 0; i < shard_count; i++)
+        while (shard_sock[i] >= 0 && _shard_read(i, 1, 0) == 0)
+            ;
+    shard_count = 0;
+    _shard_exec_wait();
+}
+
+/*
+ * Hands a traphandle command over to the output stage.  Returns 1 if it
+ * was sent and 0 if the caller should run it itself.
+ */
+int
+snmptrapd_shard_exec(const char *command, const char *input)
+{
+    if (shard_fd < 0)
+        return 0;
+    _shard_flush_log();
+    return _shard_send(SHARD_RECORD_EXEC, LOG_INFO, command, input) == 0;
+}
+
+#else /* sharding not supported */
+
+int
+snmptrapd_shards_init(void)
+{
+    if (netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                           NETSNMP_DS_APP_RECEIVER_SHARDS) > 1)
+        snmp_log(LOG_WARNING, "receiverShards: not supported on this "
+                 "platform; using a single receiver\n");
+    return 1;
+}
+
+int
+snmptrapd_shards_start(int count, int *shard)
+{
+    *shard = 0;
+    return 0;
+}
+
+void
+snmptrapd_shards_reconfig(void)
+{
+}
+
+void
+snmptrapd_shards_stop(void)
+{
+}
+
+int
+snmptrapd_shard_exec(const char *command, const char *input)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef SNMPTRAPD_SHARDS_H
+#define SNMPTRAPD_SHARDS_H
+
+/*
+ * Receiver sharding: several snmptrapd processes share the listening UDP
+ * ports through SO_REUSEPORT and send their output to the parent process.
+ */
+
+#define SNMPTRAPD_SHARDS_MAX    64
+
+int  snmptrapd_shards_init(void);
+int  snmptrapd_shards_start(int count, int *shard);
+void snmptrapd_shards_reconfig(void);
+void snmptrapd_shards_stop(void);
+int  snmptrapd_shard_exec(const char *command, const char *input);
+
+#endif /* SNMPTRAPD_SHARDS_H */
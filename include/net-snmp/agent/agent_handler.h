@@ -32,6 +32,9 @@ struct netsnmp_handler_registration_s;
 #define MIB_HANDLER_AUTO_NEXT                   0x00000001
 #define MIB_HANDLER_AUTO_NEXT_OVERRIDE_ONCE     0x00000002
 #define MIB_HANDLER_INSTANCE                    0x00000004
+/* may be called by several threads at once in GET and GETNEXT mode: it
+   changes neither its own handler nor any other shared state */
+#define MIB_HANDLER_REENTRANT                   0x00000008
 
 #define MIB_HANDLER_CUSTOM4                     0x10000000
 #define MIB_HANDLER_CUSTOM3                     0x20000000
@@ -87,6 +90,7 @@ typedef struct netsnmp_mib_handler_s {
 #define HANDLER_CAN_NOT_CREATE        0x08         /* auto set if ! CAN_SET */
 #define HANDLER_CAN_BABY_STEP         0x10
 #define HANDLER_CAN_STASH             0x20
+#define HANDLER_CAN_THREAD_SAFE       0x40 /* may run on worker threads */
 
 
 #define HANDLER_CAN_RONLY   (HANDLER_CAN_GETANDGETNEXT)
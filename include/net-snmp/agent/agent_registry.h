@@ -51,6 +51,7 @@ typedef struct subtree_context_cache_s {
     const char				*context_name;
     struct netsnmp_subtree_s		*first_subtree;
     struct subtree_context_cache_s	*next;
+    struct netsnmp_subtree_index_s	*index;	/* private */
 } subtree_context_cache;
 
 
@@ -79,8 +80,9 @@ netsnmp_session *get_session_for_oid	   (const oid *, size_t,
 
 subtree_context_cache *get_top_context_cache(void);
 
-void netsnmp_set_lookup_cache_size(int newsize);
-int netsnmp_get_lookup_cache_size(void);
+/* deprecated; the subtree index replaced the lookup cache */
+void netsnmp_set_lookup_cache_size(int newsize) NETSNMP_ATTRIBUTE_DEPRECATED;
+int netsnmp_get_lookup_cache_size(void) NETSNMP_ATTRIBUTE_DEPRECATED;
 
 #define MIB_REGISTERED_OK		 0
 #define MIB_DUPLICATE_REGISTRATION	-1
@@ -19,6 +19,8 @@ netsnmp_mib_handler *netsnmp_get_bulk_to_next_handler(void);
 void            netsnmp_init_bulk_to_next_helper(void);
 void            netsnmp_bulk_to_next_fix_requests(netsnmp_request_info
                                                   *requests);
+int             netsnmp_bulk_to_next_fix_request(netsnmp_request_info
+                                                 *request);
 
 Netsnmp_Node_Handler netsnmp_bulk_to_next_helper;
 
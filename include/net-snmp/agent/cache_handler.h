@@ -44,6 +44,7 @@ extern          "C" {
         int      timeout;	/* Length of time the cache is valid (in s) */
         marker_t timestampM;	/* When the cache was last loaded */
         u_long   timer_id;      /* periodic timer id */
+        u_long   reload_id;     /* pending background reload */
 
         NetsnmpCacheLoad *load_cache;
         NetsnmpCacheFree *free_cache;
@@ -120,6 +121,7 @@ extern          "C" {
 #define NETSNMP_CACHE_PRELOAD                               0x0010
 #define NETSNMP_CACHE_AUTO_RELOAD                           0x0020
 #define NETSNMP_CACHE_RESET_TIMER_ON_USE                    0x0040
+#define NETSNMP_CACHE_BACKGROUND_RELOAD                     0x0080
 
 #define NETSNMP_CACHE_HINT_HANDLER_ARGS                     0x1000
 
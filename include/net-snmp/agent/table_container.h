@@ -28,6 +28,7 @@ extern          "C" {
     
 #define TABLE_CONTAINER_ROW       "table_container:row"
 #define TABLE_CONTAINER_CONTAINER "table_container:container"
+#define TABLE_CONTAINER_HASH_INDEX "table_container:hash"
     
 #define TABLE_CONTAINER_KEY_NETSNMP_INDEX         1 /* default */
 #define TABLE_CONTAINER_KEY_VARBIND_INDEX         2
@@ -55,6 +56,34 @@ extern          "C" {
     int            
     netsnmp_container_table_unregister(netsnmp_handler_registration *reginfo);
     
+    /** attach a hash index for exact (GET/SET) row lookups */
+    netsnmp_container *
+    netsnmp_container_table_add_hash_index(netsnmp_container *container);
+
+    /*
+     * incremental reload of a table container from freshly loaded data
+     */
+    typedef struct netsnmp_container_table_sync_ops_s {
+        /** set the table index for an item; non-zero to skip the item */
+        int    (*index)(void *item, netsnmp_index *index, void *context);
+        /** bring a row up to date from an item (takes over the item) */
+        void   (*update)(void *row, void *item, void *context);
+        /** make a new row from an item (takes over the item) */
+        void  *(*create)(void *item, void *context);
+        /** release a row that is no longer in the data */
+        void   (*release)(void *row, void *context);
+        /** release an item that is skipped */
+        void   (*item_free)(void *item, void *context);
+        /** maximum length of an index, in sub-identifiers */
+        size_t   max_index_len;
+    } netsnmp_container_table_sync_ops;
+
+    int
+    netsnmp_container_table_sync(netsnmp_container *container,
+                                 netsnmp_container *items,
+                                 const netsnmp_container_table_sync_ops *ops,
+                                 void *context);
+
     /** retrieve the container used by the table_container helper */
     netsnmp_container*
     netsnmp_container_table_container_extract(netsnmp_request_info *request);
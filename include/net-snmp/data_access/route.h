@@ -130,6 +130,13 @@ netsnmp_access_route_entry_copy(netsnmp_route_entry *lhs,
 int
 netsnmp_access_route_entry_set(netsnmp_route_entry * entry);
 
+/*
+ * expire a cache of routes when the system reports a route change
+ * (only if enabled by the "routeWatch" configuration token)
+ */
+int
+netsnmp_access_route_watch(netsnmp_cache *cache);
+
 /*
  * route flags
  *   upper bits for internal use
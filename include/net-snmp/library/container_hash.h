@@ -0,0 +1,42 @@
+/*
+ * container_hash.h
+ *
+ * An unordered container kept in a hash table, with O(1) expected
+ * insert, remove and find.  Mostly useful as a secondary index.
+ */
+#ifndef NETSNMP_CONTAINER_HASH_H
+#define NETSNMP_CONTAINER_HASH_H
+
+
+#include <net-snmp/library/container.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+    /*
+     * function returning the hash value of an object
+     */
+    typedef u_int (netsnmp_container_hash_func)(const void *data);
+
+    NETSNMP_IMPORT
+    netsnmp_container *netsnmp_container_get_hash(void);
+    netsnmp_factory   *netsnmp_container_get_hash_factory(void);
+
+    NETSNMP_IMPORT
+    int netsnmp_container_hash_set_func(netsnmp_container *c,
+                                        netsnmp_container_hash_func *f);
+
+    /** first data element is a 'netsnmp_index' (the default) */
+    NETSNMP_IMPORT
+    u_int netsnmp_hash_netsnmp_index(const void *data);
+
+    NETSNMP_IMPORT
+    void netsnmp_container_hash_init(void);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /** NETSNMP_CONTAINER_HASH_H */
@@ -0,0 +1,28 @@
+/*
+ * container_skiplist.h
+ *
+ * A sorted container kept in a skip list, with O(log n) expected
+ * insert, remove, find and find_next.
+ */
+#ifndef NETSNMP_CONTAINER_SKIPLIST_H
+#define NETSNMP_CONTAINER_SKIPLIST_H
+
+
+#include <net-snmp/library/container.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+    netsnmp_container *netsnmp_container_get_skiplist(void);
+    netsnmp_factory   *netsnmp_container_get_skiplist_factory(void);
+
+    NETSNMP_IMPORT
+    void netsnmp_container_skiplist_init(void);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /** NETSNMP_CONTAINER_SKIPLIST_H */
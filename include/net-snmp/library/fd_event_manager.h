@@ -128,6 +128,65 @@ void netsnmp_dispatch_external_events2(int *count,
                                        netsnmp_large_fd_set *readfds,
                                        netsnmp_large_fd_set *writefds,
                                        netsnmp_large_fd_set *exceptfds);
+
+/*
+ * Event Loop Backend
+ *
+ * Description:
+ *   netsnmp_event_loop_wait2() is a drop-in replacement for
+ *   netsnmp_large_fd_set_select() for use by the main event loop of an
+ *   application.  Depending on the "eventLoopBackend" snmp.conf token it
+ *   either calls select() or, where available, keeps a persistent epoll
+ *   interest set and only reports the descriptors that are ready.  Since
+ *   the epoll interest set is per process, it must only be called from a
+ *   single event loop.
+ *
+ *   The epoll interest set is updated when descriptors come and go, not
+ *   from the descriptor sets passed in, which only select what is
+ *   reported.  Session sockets and descriptors registered with
+ *   register_readfd() and friends are watched automatically; any other
+ *   descriptor an application adds to the sets must be announced with
+ *   netsnmp_event_loop_watch_fd() and withdrawn with
+ *   netsnmp_event_loop_unwatch_fd() or netsnmp_event_loop_forget_fd().
+ *
+ *   While netsnmp_event_loop_can_wait_ready() returns 1, an event loop can
+ *   skip collecting the descriptor sets altogether and call
+ *   netsnmp_event_loop_wait_ready() instead, which returns the list of
+ *   ready descriptors; see snmp_select_timeout() and snmp_read_fd() for
+ *   the session side of this.
+ */
+#define NETSNMP_EVENT_BACKEND_SELECT    0
+#define NETSNMP_EVENT_BACKEND_EPOLL     1
+
+#define NETSNMP_EVENT_LOOP_READ         0x01
+#define NETSNMP_EVENT_LOOP_WRITE        0x02
+#define NETSNMP_EVENT_LOOP_EXCEPT       0x04
+
+NETSNMP_IMPORT
+int  netsnmp_event_loop_backend(void);
+NETSNMP_IMPORT
+int  netsnmp_event_loop_wait2(int numfds,
+                              netsnmp_large_fd_set *readfds,
+                              netsnmp_large_fd_set *writefds,
+                              netsnmp_large_fd_set *exceptfds,
+                              struct timeval *timeout);
+NETSNMP_IMPORT
+int  netsnmp_event_loop_can_wait_ready(void);
+NETSNMP_IMPORT
+int  netsnmp_event_loop_wait_ready(int *fds, int max, int *nfds,
+                                   netsnmp_large_fd_set *readfds,
+                                   netsnmp_large_fd_set *writefds,
+                                   netsnmp_large_fd_set *exceptfds,
+                                   struct timeval *timeout);
+NETSNMP_IMPORT
+void netsnmp_event_loop_watch_fd(int fd, int events);
+NETSNMP_IMPORT
+void netsnmp_event_loop_unwatch_fd(int fd, int events);
+NETSNMP_IMPORT
+void netsnmp_event_loop_forget_fd(int fd);
+NETSNMP_IMPORT
+void netsnmp_event_loop_shutdown(void);
+
 #ifdef __cplusplus
 }
 #endif
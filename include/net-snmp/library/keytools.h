@@ -35,6 +35,62 @@ extern          "C" {
                                  const u_char * Ku, size_t ku_len,
                                  u_char * Kul, size_t * kul_len);
 
+    NETSNMP_IMPORT
+    int             netsnmp_generate_kul_from_passphrase(const oid * hashtype,
+                                                         u_int hashtype_len,
+                                                         const u_char * engineID,
+                                                         size_t engineID_len,
+                                                         const u_char * P,
+                                                         size_t pplen,
+                                                         u_char * Kul,
+                                                         size_t * kul_len);
+
+    /*
+     * Cache of derived keys
+     */
+#define NETSNMP_KEYCACHE_AUTHKEY        0
+#define NETSNMP_KEYCACHE_PRIVKEY        1
+
+    NETSNMP_IMPORT
+    void            netsnmp_keycache_prefetch(const char *name, int which,
+                                              const oid * hashtype,
+                                              u_int hashtype_len,
+                                              const u_char * engineID,
+                                              size_t engineID_len,
+                                              const u_char * P,
+                                              size_t pplen);
+    NETSNMP_IMPORT
+    int             netsnmp_keycache_prefetch_run(int threads);
+    NETSNMP_IMPORT
+    int             netsnmp_keycache_get_kul(const char *name, int which,
+                                             const oid * hashtype,
+                                             u_int hashtype_len,
+                                             const u_char * engineID,
+                                             size_t engineID_len,
+                                             const u_char * P,
+                                             size_t pplen,
+                                             u_char * Kul,
+                                             size_t * kul_len);
+    NETSNMP_IMPORT
+    void            netsnmp_keycache_save_kul(const char *name, int which,
+                                              const oid * hashtype,
+                                              u_int hashtype_len,
+                                              const u_char * engineID,
+                                              size_t engineID_len,
+                                              const u_char * P,
+                                              size_t pplen,
+                                              const u_char * Kul,
+                                              size_t kul_len);
+    NETSNMP_IMPORT
+    void            netsnmp_keycache_parse(const char *token, char *line);
+    NETSNMP_IMPORT
+    void            netsnmp_keycache_store(const char *token,
+                                           const char *type);
+    NETSNMP_IMPORT
+    void            netsnmp_keycache_clear_saved(void);
+    NETSNMP_IMPORT
+    void            netsnmp_keycache_clear(void);
+
     NETSNMP_IMPORT
     int netsnmp_extend_kul(u_int needKeyLen, oid *hashoid, u_int hashoid_len,
                            int privType, u_char *engineID, u_int engineIDLen,
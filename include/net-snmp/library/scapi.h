@@ -127,6 +127,8 @@ typedef struct netsnmp_priv_alg_info_s {
     NETSNMP_IMPORT
     int             sc_shutdown(int majorID, int minorID, void *serverarg,
                                 void *clientarg);
+    NETSNMP_IMPORT
+    void            sc_forget_key(const u_char * key, size_t keylen);
 
     NETSNMP_IMPORT
     int             sc_random(u_char * buf, size_t * buflen);
@@ -19,6 +19,7 @@ extern          "C" {
  * Prototypes
  */
     void _netsnmp_udp_sockopt_set(int fd, int local);
+    int netsnmp_udp_set_reuseport(int onoff);
     int netsnmp_udpbase_recv(netsnmp_transport *t, void *buf, int size,
                              void **opaque, int *olength);
     int netsnmp_udpbase_send(netsnmp_transport *t, const void *buf, int size,
@@ -34,6 +35,17 @@ extern          "C" {
                                const void *data, int len);
 #endif
 
+#if defined(HAVE_IP_PKTINFO) && !defined(WIN32)
+#ifdef HAVE_RECVMMSG
+    int netsnmp_udpbase_recv_batch(netsnmp_transport *t,
+                                   netsnmp_transport_msg *msgs, int count);
+#endif
+#ifdef HAVE_SENDMMSG
+    int netsnmp_udpbase_send_batch(netsnmp_transport *t,
+                                   netsnmp_transport_msg *msgs, int count);
+#endif
+#endif
+
 #ifdef __cplusplus
 }
 #endif
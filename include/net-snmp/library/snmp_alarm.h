@@ -39,7 +39,10 @@ extern          "C" {
         struct timeval  t_nextM;
         void           *clientarg;
         SNMPAlarmCallback *thecallback;
+        /** Next alarm in the same hash bucket. */
         struct snmp_alarm *next;
+        /** Position in the alarm heap [internal]. */
+        size_t          heap_pos;
     };
 
     /*
@@ -71,6 +74,8 @@ extern          "C" {
                                            void *clientarg);
     void            sa_update_entry(struct snmp_alarm *alrm);
     struct snmp_alarm *sa_find_next(void);
+    NETSNMP_IMPORT
+    struct snmp_alarm *sa_find_specific(unsigned int clientreg);
     NETSNMP_IMPORT void run_alarms(void);
     RETSIGTYPE      alarm_handler(int a);
     void            set_an_alarm(void);
@@ -139,6 +139,7 @@ typedef struct request_list {
     NETSNMP_IMPORT void     snmp_set_detail(const char *);
 
 #define SNMP_MAX_RCV_MSG_SIZE      65536
+#define NETSNMP_DGRAM_BATCH_DEFAULT 16  /* datagrams read per wakeup */
 #define SNMP_MAX_MSG_SIZE          1472 /* ethernet MTU minus IP/UDP header */
 #define SNMP_MAX_MSG_V3_HDRS       (4+3+4+7+7+3+7+16)   /* fudge factor=16 */
 #define SNMP_MAX_ENG_SIZE          32
@@ -315,6 +316,28 @@ typedef struct request_list {
 
     NETSNMP_IMPORT void snmp_free_var_internals(netsnmp_variable_list *);     /* frees contents only */
 
+    /*
+     * PDU and varbind allocation.  Objects released with snmp_free_pdu()
+     * and snmp_free_var() are kept on per-thread free lists for reuse
+     * unless the library was configured with --disable-pdu-pool.  The
+     * statistics and netsnmp_pdu_pool_clear() apply to the calling thread.
+     */
+    typedef struct netsnmp_pdu_pool_stats_s {
+        u_long          pdu_allocs;     /* PDUs allocated */
+        u_long          pdu_hits;       /* ... of which came from the pool */
+        u_long          pdu_frees;      /* PDUs freed */
+        u_long          pdu_cached;     /* PDUs currently in the pool */
+        u_long          var_allocs;     /* varbinds allocated */
+        u_long          var_hits;       /* ... of which came from the pool */
+        u_long          var_frees;      /* varbinds freed */
+        u_long          var_cached;     /* varbinds currently in the pool */
+    } netsnmp_pdu_pool_stats;
+
+    NETSNMP_IMPORT netsnmp_pdu *netsnmp_pdu_alloc(void);
+    NETSNMP_IMPORT netsnmp_variable_list *netsnmp_varbind_alloc(void);
+    NETSNMP_IMPORT void netsnmp_pdu_pool_get_stats(netsnmp_pdu_pool_stats *);
+    NETSNMP_IMPORT void netsnmp_pdu_pool_clear(void);
+
 
     /*
      * This routine must be supplied by the application:
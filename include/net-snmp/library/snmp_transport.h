@@ -46,6 +46,10 @@ extern          "C" {
 #define	NETSNMP_STREAM_QUEUE_LEN	5
 #endif
 
+#ifndef NETSNMP_TRANSPORT_BATCH_MAX
+#define NETSNMP_TRANSPORT_BATCH_MAX	64	/* messages per batched call */
+#endif
+
 /*  Some transport-type flags.  */
 
 #define		NETSNMP_TRANSPORT_FLAG_STREAM	 0x01
@@ -127,6 +131,20 @@ typedef struct netsnmp_tdomain_spec_s {
     struct netsnmp_container_s *transport_config; /* extra config */
 } netsnmp_tdomain_spec;
 
+/*  One datagram for the batched receive and send callbacks.  When
+    receiving, packet and length describe the buffer on entry and length
+    is set to the number of bytes received, opaque and olength are set as
+    for f_recv.  When sending, the fields are the arguments of f_send.  */
+
+typedef struct netsnmp_transport_msg_s {
+    void           *packet;
+    int             length;
+    void           *opaque;
+    int             olength;
+} netsnmp_transport_msg;
+
+struct netsnmp_transport_sendq_s;
+
 /*  Structure which defines the transport-independent API.  */
 
 struct snmp_session;
@@ -217,6 +235,19 @@ typedef struct netsnmp_transport_s {
     void           (*f_get_taddr)(struct netsnmp_transport_s *t,
                                   void **addr, size_t *addr_len);
 
+    /*  Optional callbacks for datagram transports that can receive or
+        send several messages with a single system call.  They return the
+        number of messages handled, or -1 if none could be.  Transports
+        that wrap another one must clear them.  */
+
+    int             (*f_recv_batch)(struct netsnmp_transport_s *,
+                                    netsnmp_transport_msg *, int);
+    int             (*f_send_batch)(struct netsnmp_transport_s *,
+                                    netsnmp_transport_msg *, int);
+
+    /*  Outgoing messages held back by netsnmp_transport_batch_begin()  */
+    struct netsnmp_transport_sendq_s *sendq;
+
 } netsnmp_transport;
 
 typedef struct netsnmp_transport_list_s {
@@ -261,6 +292,11 @@ int netsnmp_transport_send(netsnmp_transport *t, const void *data, int len,
                            void **opaque, int *olength);
 int netsnmp_transport_recv(netsnmp_transport *t, void *data, int len,
                            void **opaque, int *olength);
+int netsnmp_transport_recv_batch(netsnmp_transport *t,
+                                 netsnmp_transport_msg *msgs, int count);
+void netsnmp_transport_batch_begin(netsnmp_transport *t, int count);
+int  netsnmp_transport_batch_end(netsnmp_transport *t);
+int  netsnmp_transport_batch_flush(netsnmp_transport *t);
 
 int netsnmp_transport_add_to_list(netsnmp_transport_list **transport_list,
 				  netsnmp_transport *transport);
@@ -82,9 +82,12 @@ extern          "C" {
         void           *usmDHUserPrivKeyChange;
         struct usmUser *next;
         struct usmUser *prev;
+        struct usmUser *hashNext;       /* chain in the user hash table */
     };
 
 #define USMUSER_FLAG_KEEP_MASTER_KEY             0x01
+#define USMUSER_FLAG_KEYS_PENDING                0x02 /* createUser keys
+                                                       * not derived yet */
 
 
     /*
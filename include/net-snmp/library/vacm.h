@@ -236,6 +236,45 @@ extern          "C" {
     NETSNMP_IMPORT
     int             vacm_is_configured(void);
 
+    /*
+     * Change a field of an existing entry that takes part in access
+     * decisions.  These must be used instead of writing the fields
+     * directly, so that compiled views and cached access decisions are
+     * discarded.
+     */
+    NETSNMP_IMPORT
+    void            vacm_setGroupName(struct vacm_groupEntry *,
+                                      const char *, size_t);
+    NETSNMP_IMPORT
+    void            vacm_setGroupStatus(struct vacm_groupEntry *, int);
+    NETSNMP_IMPORT
+    void            vacm_setAccessContextMatch(struct vacm_accessEntry *,
+                                               int);
+    NETSNMP_IMPORT
+    void            vacm_setAccessView(struct vacm_accessEntry *, int,
+                                       const char *, size_t);
+    NETSNMP_IMPORT
+    void            vacm_setAccessStatus(struct vacm_accessEntry *, int);
+    NETSNMP_IMPORT
+    void            vacm_setViewMask(struct vacm_viewEntry *,
+                                     const u_char *, size_t);
+    NETSNMP_IMPORT
+    void            vacm_setViewType(struct vacm_viewEntry *, int);
+    NETSNMP_IMPORT
+    void            vacm_setViewStatus(struct vacm_viewEntry *, int);
+
+    NETSNMP_IMPORT
+    int             vacm_getAccessForRequest(int securityModel,
+                                             const char *securityName,
+                                             const char *contextName,
+                                             int securityLevel,
+                                             struct vacm_groupEntry **group,
+                                             struct vacm_accessEntry **access);
+    /*
+     * Returns VACM_SUCCESS, VACM_NOGROUP or VACM_NOACCESS, setting *group
+     * and *access to the entries that apply (or NULL).
+     */
+
     void            vacm_save(const char *token, const char *type);
     void            vacm_save_view(struct vacm_viewEntry *view,
                                    const char *token, const char *type);
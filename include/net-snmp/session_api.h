@@ -122,6 +122,15 @@ extern          "C" {
     NETSNMP_IMPORT
     void            snmp_read2(netsnmp_large_fd_set *);
 
+    /*
+     * snmp_read_fd() reads only from the session owning the given ready
+     * descriptor.  Together with snmp_select_timeout() it is for event
+     * loops that get the ready descriptors from
+     * netsnmp_event_loop_wait_ready() instead of scanning descriptor sets.
+     */
+    NETSNMP_IMPORT
+    void            snmp_read_fd(int, netsnmp_large_fd_set *);
+
 
     NETSNMP_IMPORT
     int             snmp_synch_response(netsnmp_session *, netsnmp_pdu *,
@@ -167,6 +176,13 @@ extern          "C" {
     int             snmp_select_info2(int *, netsnmp_large_fd_set *,
                                       struct timeval *, int *);
 
+    /*
+     * snmp_select_timeout() works out the timeout and block flag like
+     * snmp_select_info2(), without filling in a descriptor set.
+     */
+    NETSNMP_IMPORT
+    int             snmp_select_timeout(struct timeval *, int *);
+
 #define NETSNMP_SELECT_NOFLAGS  0x00
 #define NETSNMP_SELECT_NOALARMS 0x01
     NETSNMP_IMPORT
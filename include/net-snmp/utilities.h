@@ -51,6 +51,8 @@
 #include <net-snmp/library/container.h>
 #include <net-snmp/library/container_binary_array.h>
 #include <net-snmp/library/container_list_ssll.h>
+#include <net-snmp/library/container_skiplist.h>
+#include <net-snmp/library/container_hash.h>
 #include <net-snmp/library/container_iterator.h>
 
 #include <net-snmp/library/snmp_assert.h>
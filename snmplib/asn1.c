@@ -210,6 +210,10 @@ SOFTWARE.
 #   define INT32_MIN (0 - INT32_MAX - 1)
 #endif
 
+/*
+ * A word with the high bit of every byte set.
+ */
+#define ASN_WORD_BIT8 ((~0UL / 0xff) * ASN_BIT8)
 
 #define CHECK_OVERFLOW_S(x,y) do {                                      \
         if (x > INT32_MAX) {                                            \
@@ -570,11 +574,8 @@ asn_parse_int(u_char * data,
     static const char *errpre = "parse int";
     register u_char *bufp = data;
     u_long          asn_length;
-    int             i;
-    union {
-        long          l;
-        unsigned char b[sizeof(long)];
-    } value;
+    u_long          uvalue;
+    long            value;
 
     if (NULL == data || NULL == datalength || NULL == type || NULL == intp) {
         ERROR_MSG("parse int: NULL pointer");
@@ -613,20 +614,19 @@ asn_parse_int(u_char * data,
 
     DEBUGDUMPSETUP("recv", data, bufp - data + asn_length);
 
-    memset(&value.b, *bufp & 0x80 ? 0xff : 0, sizeof(value.b));
-    if (NETSNMP_BIGENDIAN) {
-        for (i = sizeof(long) - asn_length; asn_length--; i++)
-            value.b[i] = *bufp++;
-    } else {
-        for (i = asn_length - 1; asn_length--; i--)
-            value.b[i] = *bufp++;
-    }
+    /*
+     * Sign-extend from the first byte and shift in the rest.
+     */
+    uvalue = *bufp & 0x80 ? ~0UL : 0;
+    while (asn_length--)
+        uvalue = (uvalue << 8) | *bufp++;
+    value = (long) uvalue;
 
-    CHECK_OVERFLOW_S(value.l, 1);
+    CHECK_OVERFLOW_S(value, 1);
 
-    DEBUGMSG(("dumpv_recv", "  Integer:\t%ld (0x%.2lX)\n", value.l, value.l));
+    DEBUGMSG(("dumpv_recv", "  Integer:\t%ld (0x%.2lX)\n", value, value));
 
-    *intp = value.l;
+    *intp = value;
     return bufp;
 }
 
@@ -1421,6 +1421,36 @@ asn_build_length(u_char * data, size_t * datalength, size_t length)
 
 }
 
+/*
+ * Returns the number of bytes at the start of p, which must hold at least
+ * sizeof(u_long) bytes, that have the high bit clear.  Each of them is a
+ * complete single-byte sub-identifier.  All bytes of a word are checked
+ * at once.
+ */
+NETSNMP_STATIC_INLINE size_t
+_asn_short_subids(const u_char * p)
+{
+    u_long          word;
+
+    memcpy(&word, p, sizeof(word));
+    word &= ASN_WORD_BIT8;
+    if (word == 0)
+        return sizeof(word);
+#ifdef __GNUC__
+    if (!NETSNMP_BIGENDIAN)
+        return __builtin_ctzl(word) / 8;
+    return __builtin_clzl(word) / 8;
+#else
+    {
+        size_t          n = 0;
+
+        while (!(p[n] & ASN_BIT8))
+            n++;
+        return n;
+    }
+#endif
+}
+
 /**
  * @internal
  * asn_parse_objid - pulls an object indentifier out of an ASN object identifier type.
@@ -1464,6 +1494,7 @@ asn_parse_objid(u_char * data,
     register long   length;
     u_long          asn_length;
     size_t          original_length = *objidlength;
+    size_t          i, n;
 
     if (NULL == data || NULL == datalength || NULL == type || NULL == objid) {
         ERROR_MSG("parse objid: NULL pointer");
@@ -1500,7 +1531,27 @@ asn_parse_objid(u_char * data,
     length = asn_length;
     (*objidlength)--;           /* account for expansion of first byte */
 
-    while (length > 0 && (*objidlength)-- > 0) {
+    while (length > 0 && *objidlength > 0) {
+        /*
+         * Most sub-identifiers are below 128 and take a single byte.  Copy
+         * the run of those at the start of the next word out directly.
+         */
+        if ((u_long) length >= sizeof(u_long)) {
+            n = _asn_short_subids(bufp);
+            if (n > *objidlength)
+                n = *objidlength;
+            if (n > 0) {
+                for (i = 0; i < n; i++)
+                    oidp[i] = bufp[i];
+                oidp += n;
+                bufp += n;
+                length -= n;
+                *objidlength -= n;
+                continue;
+            }
+        }
+
+        (*objidlength)--;
         subidentifier = 0;
         do {                    /* shift and add in low order 7 bits */
             subidentifier =
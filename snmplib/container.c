@@ -19,6 +19,8 @@
 #include <net-snmp/library/container.h>
 #include <net-snmp/library/container_binary_array.h>
 #include <net-snmp/library/container_list_ssll.h>
+#include <net-snmp/library/container_skiplist.h>
+#include <net-snmp/library/container_hash.h>
 #include <net-snmp/library/container_null.h>
 
 #include <stdint.h>
@@ -97,6 +99,12 @@ netsnmp_container_init_list(void)
 #ifndef NETSNMP_FEATURE_REMOVE_CONTAINER_LINKED_LIST
     netsnmp_container_ssll_init();
 #endif /* NETSNMP_FEATURE_REMOVE_CONTAINER_LINKED_LIST */
+#ifndef NETSNMP_FEATURE_REMOVE_CONTAINER_SKIPLIST
+    netsnmp_container_skiplist_init();
+#endif /* NETSNMP_FEATURE_REMOVE_CONTAINER_SKIPLIST */
+#ifndef NETSNMP_FEATURE_REMOVE_CONTAINER_HASH
+    netsnmp_container_hash_init();
+#endif /* NETSNMP_FEATURE_REMOVE_CONTAINER_HASH */
 #ifndef NETSNMP_FEATURE_REMOVE_CONTAINER_NULL
     netsnmp_container_null_init();
 #endif /* NETSNMP_FEATURE_REMOVE_CONTAINER_NULL */
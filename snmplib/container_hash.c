@@ -0,0 +1,643 @@
+/*
+ * container_hash.c
+ *
+ * An unordered container kept in a chained hash table, giving O(1)
+ * expected insert, remove and find.  find_next and the iterators visit
+ * the entries in hash order, not key order, so it is meant to be used as
+ * a secondary index for exact lookups next to a sorted primary container
+ * (see netsnmp_container_add_index()).
+ *
+ * By default entries are hashed as netsnmp_index structures, to match
+ * the default netsnmp_compare_netsnmp_index compare routine.  Containers
+ * with another compare routine need a matching hash routine set with
+ * netsnmp_container_hash_set_func().
+ */
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-features.h>
+
+#include <stdio.h>
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#if HAVE_MALLOC_H
+#include <malloc.h>
+#endif
+#include <sys/types.h>
+#if HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/types.h>
+#include <net-snmp/library/snmp_api.h>
+#include <net-snmp/library/container.h>
+#include <net-snmp/library/tools.h>
+#include <net-snmp/library/snmp_assert.h>
+
+#include <net-snmp/library/container_hash.h>
+
+netsnmp_feature_child_of(container_hash, container_types);
+
+#ifndef NETSNMP_FEATURE_REMOVE_CONTAINER_HASH
+
+#define HASH_MIN_BUCKETS  16
+
+typedef struct hash_node_s {
+    void               *data;
+    u_int               hash;
+    struct hash_node_s *next;
+} hash_node;
+
+typedef struct hash_container_s {
+    netsnmp_container   c;
+
+    size_t              count;
+    size_t              nbuckets;  /* always a power of two */
+    hash_node         **buckets;
+    netsnmp_container_hash_func *hash;
+} hash_container;
+
+typedef struct hash_iterator_s {
+    netsnmp_iterator    base;
+
+    size_t              bucket;
+    hash_node          *pos;
+    int                 pending;   /* pos was already advanced by remove */
+} hash_iterator;
+
+static netsnmp_iterator *_hash_iterator_get(netsnmp_container *c);
+
+/**********************************************************************
+ *
+ * hash table
+ *
+ */
+
+/** hash the index oids of a netsnmp_index (FNV-1a) */
+u_int
+netsnmp_hash_netsnmp_index(const void *data)
+{
+    const netsnmp_index *idx = (const netsnmp_index *)data;
+    u_int                h = 2166136261U;
+    size_t               i;
+
+    for (i = 0; i < idx->len; ++i) {
+        h ^= (u_int)idx->oids[i];
+        h *= 16777619U;
+    }
+    return h ^ (u_int)idx->len;
+}
+
+static int
+_hash_resize(hash_container *hc, size_t nbuckets)
+{
+    hash_node **buckets, *n, *next;
+    size_t      i;
+
+    buckets = (hash_node **)calloc(nbuckets, sizeof(hash_node *));
+    if (NULL == buckets)
+        return -1;
+    for (i = 0; i < hc->nbuckets; ++i) {
+        for (n = hc->buckets[i]; n; n = next) {
+            next = n->next;
+            n->next = buckets[n->hash & (nbuckets - 1)];
+            buckets[n->hash & (nbuckets - 1)] = n;
+        }
+    }
+    free(hc->buckets);
+    hc->buckets = buckets;
+    hc->nbuckets = nbuckets;
+    return 0;
+}
+
+/*
+ * Find the link pointing at the node for a key.  An entry which is the
+ * key itself is preferred over one which only compares equal, so that
+ * removing an entry from a table allowing duplicate keys removes that
+ * entry from the index as well.
+ */
+static hash_node **
+_hash_lookup(hash_container *hc, const void *key, u_int h)
+{
+    hash_node **link, **match = NULL;
+
+    for (link = &hc->buckets[h & (hc->nbuckets - 1)]; *link;
+         link = &(*link)->next) {
+        if ((*link)->hash != h)
+            continue;
+        if ((*link)->data == key)
+            return link;
+        if (NULL == match && hc->c.compare((*link)->data, key) == 0) {
+            if (!(hc->c.flags & CONTAINER_KEY_ALLOW_DUPLICATES))
+                return link;
+            match = link;
+        }
+    }
+    return match;
+}
+
+static hash_node *
+_hash_first_from(hash_container *hc, size_t bucket, size_t *where)
+{
+    for (; bucket < hc->nbuckets; ++bucket) {
+        if (hc->buckets[bucket]) {
+            if (where)
+                *where = bucket;
+            return hc->buckets[bucket];
+        }
+    }
+    return NULL;
+}
+
+/**********************************************************************
+ *
+ * container
+ *
+ */
+static void
+_hash_clear(netsnmp_container *c, netsnmp_container_obj_func *f,
+            void *context)
+{
+    hash_container *hc = (hash_container *)c;
+    hash_node      *n, *next;
+    size_t          i;
+
+    if (NULL == c)
+        return;
+
+    for (i = 0; i < hc->nbuckets; ++i) {
+        for (n = hc->buckets[i]; n; n = next) {
+            next = n->next;
+            if (NULL != f)
+                (*f) (n->data, context);
+            /*
+             * free our node structure, but not the data
+             */
+            free(n);
+        }
+        hc->buckets[i] = NULL;
+    }
+    hc->count = 0;
+    ++c->sync;
+}
+
+static int
+_hash_free(netsnmp_container *c)
+{
+    hash_container *hc = (hash_container *)c;
+
+    if (NULL == c)
+        return 0;
+
+    _hash_clear(c, NULL, NULL);
+    free(hc->buckets);
+    free(c);
+    return 0;
+}
+
+static void *
+_hash_find(netsnmp_container *c, const void *key)
+{
+    hash_container *hc = (hash_container *)c;
+    hash_node     **link;
+
+    if ((NULL == c) || (NULL == key))
+        return NULL;
+
+    link = _hash_lookup(hc, key, hc->hash(key));
+    return link ? (*link)->data : NULL;
+}
+
+/*
+ * the next entry in hash order; only useful for walking the container
+ */
+static void *
+_hash_find_next(netsnmp_container *c, const void *key)
+{
+    hash_container *hc = (hash_container *)c;
+    hash_node     **link, *n;
+    u_int           h;
+
+    if (NULL == c)
+        return NULL;
+
+    if (NULL == key) {
+        n = _hash_first_from(hc, 0, NULL);
+        return n ? n->data : NULL;
+    }
+
+    h = hc->hash(key);
+    link = _hash_lookup(hc, key, h);
+    if (NULL == link)
+        return NULL;
+    n = (*link)->next;
+    if (NULL == n)
+        n = _hash_first_from(hc, (h & (hc->nbuckets - 1)) + 1, NULL);
+    return n ? n->data : NULL;
+}
+
+static int
+_hash_insert(netsnmp_container *c, const void *data)
+{
+    hash_container *hc = (hash_container *)c;
+    hash_node      *n;
+    u_int           h;
+
+    if ((NULL == c) || (NULL == data))
+        return -1;
+
+    h = hc->hash(data);
+    if (!(c->flags & CONTAINER_KEY_ALLOW_DUPLICATES) &&
+        _hash_lookup(hc, data, h)) {
+        DEBUGMSGTL(("container","not inserting duplicate key\n"));
+        return -1;
+    }
+
+    if (hc->count >= hc->nbuckets)
+        (void)_hash_resize(hc, hc->nbuckets * 2); /* still usable if not */
+
+    n = SNMP_MALLOC_TYPEDEF(hash_node);
+    if (NULL == n)
+        return -1;
+    n->data = NETSNMP_REMOVE_CONST(void *, data);
+    n->hash = h;
+    n->next = hc->buckets[h & (hc->nbuckets - 1)];
+    hc->buckets[h & (hc->nbuckets - 1)] = n;
+
+    ++hc->count;
+    ++c->sync;
+    return 0;
+}
+
+static int
+_hash_remove(netsnmp_container *c, const void *data)
+{
+    hash_container *hc = (hash_container *)c;
+    hash_node     **link, *n;
+
+    if ((NULL == c) || (NULL == data))
+        return -1;
+
+    link = _hash_lookup(hc, data, hc->hash(data));
+    if (NULL == link)
+        return -1;
+
+    n = *link;
+    *link = n->next;
+    free(n);
+    --hc->count;
+    ++c->sync;
+    return 0;
+}
+
+static size_t
+_hash_size(netsnmp_container *c)
+{
+    hash_container *hc = (hash_container *)c;
+
+    if (NULL == c)
+        return 0;
+
+    return hc->count;
+}
+
+static void
+_hash_for_each(netsnmp_container *c, netsnmp_container_obj_func *f,
+               void *context)
+{
+    hash_container *hc = (hash_container *)c;
+    hash_node      *n, *next;
+    size_t          i;
+
+    if (NULL == c)
+        return;
+
+    for (i = 0; i < hc->nbuckets; ++i) {
+        for (n = hc->buckets[i]; n; n = next) {
+            next = n->next;
+            (*f) (n->data, context);
+        }
+    }
+}
+
+static int
+_hash_options(netsnmp_container *c, int set, u_int flags)
+{
+    if (set) {
+        if ((flags & CONTAINER_KEY_ALLOW_DUPLICATES) == flags)
+            c->flags = flags;
+        else
+            flags = (u_int)-1; /* unsupported flag */
+    }
+    else
+        return ((c->flags & flags) == flags);
+    return flags;
+}
+
+static netsnmp_container *
+_hash_duplicate(netsnmp_container *c, void *ctx, u_int flags)
+{
+    hash_container *hc = (hash_container *)c, *dup;
+    hash_node      *n, *copy;
+    size_t          i;
+
+    if (flags) {
+        snmp_log(LOG_ERR, "hash duplicate does not support flags yet\n");
+        return NULL;
+    }
+
+    dup = (hash_container *)netsnmp_container_get_hash();
+    if (NULL == dup) {
+        snmp_log(LOG_ERR, "no memory for hash duplicate\n");
+        return NULL;
+    }
+    if ((netsnmp_container_data_dup((netsnmp_container *)dup, c) != 0) ||
+        (_hash_resize(dup, hc->nbuckets) != 0)) {
+        _hash_free((netsnmp_container *)dup);
+        return NULL;
+    }
+    dup->hash = hc->hash;
+
+    /*
+     * shallow copy
+     */
+    for (i = 0; i < hc->nbuckets; ++i) {
+        for (n = hc->buckets[i]; n; n = n->next) {
+            copy = SNMP_MALLOC_TYPEDEF(hash_node);
+            if (NULL == copy) {
+                snmp_log(LOG_ERR, "no memory for hash duplicate\n");
+                _hash_free((netsnmp_container *)dup);
+                return NULL;
+            }
+            copy->data = n->data;
+            copy->hash = n->hash;
+            copy->next = dup->buckets[i];
+            dup->buckets[i] = copy;
+            ++dup->count;
+        }
+    }
+
+    return (netsnmp_container *)dup;
+}
+
+/**
+ * Set the routine used to hash the entries of a hash container.  Entries
+ * which are equal according to the container's compare routine must get
+ * the same hash value.  Must be called while the container is empty.
+ */
+int
+netsnmp_container_hash_set_func(netsnmp_container *c,
+                                netsnmp_container_hash_func *f)
+{
+    hash_container *hc = (hash_container *)c;
+
+    if ((NULL == c) || (NULL == f) || hc->count) {
+        snmp_log(LOG_ERR, "can't set hash function\n");
+        return -1;
+    }
+    hc->hash = f;
+    return 0;
+}
+
+netsnmp_container *
+netsnmp_container_get_hash(void)
+{
+    /*
+     * allocate memory
+     */
+    hash_container *hc = SNMP_MALLOC_TYPEDEF(hash_container);
+    if (NULL == hc) {
+        snmp_log(LOG_ERR, "couldn't allocate memory\n");
+        return NULL;
+    }
+    if (_hash_resize(hc, HASH_MIN_BUCKETS) != 0) {
+        snmp_log(LOG_ERR, "couldn't allocate memory\n");
+        free(hc);
+        return NULL;
+    }
+    hc->hash = netsnmp_hash_netsnmp_index;
+
+    netsnmp_init_container((netsnmp_container *)hc, NULL, _hash_free,
+                           _hash_size, NULL, _hash_insert, _hash_remove,
+                           _hash_find);
+    hc->c.find_next = _hash_find_next;
+    hc->c.get_subset = NULL;
+    hc->c.get_iterator = _hash_iterator_get;
+    hc->c.for_each = _hash_for_each;
+    hc->c.clear = _hash_clear;
+    hc->c.options = _hash_options;
+    hc->c.duplicate = _hash_duplicate;
+
+    return (netsnmp_container *)hc;
+}
+
+netsnmp_factory *
+netsnmp_container_get_hash_factory(void)
+{
+    static netsnmp_factory f = { "hash",
+                                 (netsnmp_factory_produce_f*)
+                                 netsnmp_container_get_hash };
+
+    return &f;
+}
+
+void
+netsnmp_container_hash_init(void)
+{
+    netsnmp_container_register("hash", netsnmp_container_get_hash_factory());
+}
+
+/**********************************************************************
+ *
+ * iterator
+ *
+ */
+NETSNMP_STATIC_INLINE hash_container *
+_hash_it2cont(hash_iterator *it)
+{
+    if(NULL == it) {
+        netsnmp_assert(NULL != it);
+        return NULL;
+    }
+
+    if(NULL == it->base.container) {
+        netsnmp_assert(NULL != it->base.container);
+        return NULL;
+    }
+
+    if(it->base.container->sync != it->base.sync) {
+        DEBUGMSGTL(("container:iterator", "out of sync\n"));
+        return NULL;
+    }
+
+    return (hash_container *)it->base.container;
+}
+
+static void *
+_hash_iterator_curr(hash_iterator *it)
+{
+    hash_container *hc = _hash_it2cont(it);
+    if ((NULL == hc) || (NULL == it->pos) || it->pending)
+        return NULL;
+
+    return it->pos->data;
+}
+
+static void *
+_hash_iterator_first(hash_iterator *it)
+{
+    hash_container *hc = _hash_it2cont(it);
+    hash_node      *n;
+
+    if (NULL == hc)
+        return NULL;
+
+    n = _hash_first_from(hc, 0, NULL);
+    return n ? n->data : NULL;
+}
+
+static void *
+_hash_iterator_next(hash_iterator *it)
+{
+    hash_container *hc = _hash_it2cont(it);
+    if ((NULL == hc) || (NULL == it->pos))
+        return NULL;
+
+    if (it->pending)
+        it->pending = 0;
+    else if (it->pos->next)
+        it->pos = it->pos->next;
+    else
+        it->pos = _hash_first_from(hc, it->bucket + 1, &it->bucket);
+    if (NULL == it->pos)
+        return NULL;
+
+    return it->pos->data;
+}
+
+static void *
+_hash_iterator_last(hash_iterator *it)
+{
+    hash_container *hc = _hash_it2cont(it);
+    hash_node      *n;
+    size_t          i;
+
+    if (NULL == hc)
+        return NULL;
+
+    for (i = hc->nbuckets; i > 0; --i) {
+        for (n = hc->buckets[i - 1]; n && n->next; n = n->next)
+            ;
+        if (n)
+            return n->data;
+    }
+    return NULL;
+}
+
+static int
+_hash_iterator_remove(hash_iterator *it)
+{
+    hash_container *hc = _hash_it2cont(it);
+    hash_node     **link, *n;
+
+    if ((NULL == hc) || (NULL == it->pos) || it->pending)
+        return -1;
+
+    for (link = &hc->buckets[it->bucket]; *link != it->pos;
+         link = &(*link)->next)
+        ;
+    n = *link;
+
+    /*
+     * move to the following entry now, and have next return it without
+     * advancing again.
+     */
+    if (n->next)
+        it->pos = n->next;
+    else
+        it->pos = _hash_first_from(hc, it->bucket + 1, &it->bucket);
+    it->pending = 1;
+
+    *link = n->next;
+    free(n);
+    --hc->count;
+    ++hc->c.sync;
+
+    /*
+     * since this iterator was used for the remove, keep it in sync with
+     * the container.
+     */
+    it->base.sync = hc->c.sync;
+
+    return 0;
+}
+
+static int
+_hash_iterator_reset(hash_iterator *it)
+{
+    hash_container *hc;
+
+    /** can't use it2cont cuz we might be out of sync */
+    if(NULL == it) {
+        netsnmp_assert(NULL != it);
+        return -1;
+    }
+
+    if(NULL == it->base.container) {
+        netsnmp_assert(NULL != it->base.container);
+        return -1;
+    }
+    hc = (hash_container *)it->base.container;
+
+    it->bucket = 0;
+    it->pos = _hash_first_from(hc, 0, &it->bucket);
+    it->pending = 0;
+
+    /*
+     * save sync count, to make sure container doesn't change while
+     * iterator is in use.
+     */
+    it->base.sync = it->base.container->sync;
+
+    return 0;
+}
+
+static int
+_hash_iterator_release(netsnmp_iterator *it)
+{
+    free(it);
+
+    return 0;
+}
+
+static netsnmp_iterator *
+_hash_iterator_get(netsnmp_container *c)
+{
+    hash_iterator* it;
+
+    if(NULL == c)
+        return NULL;
+
+    it = SNMP_MALLOC_TYPEDEF(hash_iterator);
+    if(NULL == it)
+        return NULL;
+
+    it->base.container = c;
+
+    it->base.first = (netsnmp_iterator_rtn*)_hash_iterator_first;
+    it->base.next = (netsnmp_iterator_rtn*)_hash_iterator_next;
+    it->base.curr = (netsnmp_iterator_rtn*)_hash_iterator_curr;
+    it->base.last = (netsnmp_iterator_rtn*)_hash_iterator_last;
+    it->base.remove = (netsnmp_iterator_rc*)_hash_iterator_remove;
+    it->base.reset = (netsnmp_iterator_rc*)_hash_iterator_reset;
+    it->base.release = (netsnmp_iterator_rc*)_hash_iterator_release;
+
+    (void)_hash_iterator_reset(it);
+
+    return (netsnmp_iterator *)it;
+}
+#else /* NETSNMP_FEATURE_REMOVE_CONTAINER_HASH */
+netsnmp_feature_unused(container_hash);
+#endif /* NETSNMP_FEATURE_REMOVE_CONTAINER_HASH */
@@ -0,0 +1,648 @@
+/*
+ * container_skiplist.c
+ *
+ * A sorted container kept in a skip list: a sorted linked list with
+ * additional express lanes, giving O(log n) expected insert, remove, find
+ * and find_next without ever moving the stored pointers around.  Use it
+ * instead of the binary_array for large tables which change often, where
+ * the binary array's memmove on every sorted insert or remove becomes
+ * quadratic.
+ */
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-features.h>
+
+#include <stdio.h>
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#if HAVE_MALLOC_H
+#include <malloc.h>
+#endif
+#include <sys/types.h>
+#if HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/types.h>
+#include <net-snmp/library/snmp_api.h>
+#include <net-snmp/library/container.h>
+#include <net-snmp/library/tools.h>
+#include <net-snmp/library/snmp_assert.h>
+
+#include <net-snmp/library/container_skiplist.h>
+
+netsnmp_feature_child_of(container_skiplist, container_types);
+
+#ifndef NETSNMP_FEATURE_REMOVE_CONTAINER_SKIPLIST
+
+/*
+ * Each level holds about a quarter of the nodes of the level below it,
+ * so 16 levels are enough for several billion entries.
+ */
+#define SKIPLIST_MAX_LEVEL  16
+
+typedef struct sk_node_s {
+    void              *data;
+    struct sk_node_s  *prev;       /* previous node on level 0 */
+    int                level;      /* number of entries in next[] */
+    struct sk_node_s  *next[1];    /* allocated with 'level' entries */
+} sk_node;
+
+typedef struct sk_container_s {
+    netsnmp_container  c;
+
+    size_t             count;
+    int                level;      /* highest level currently in use */
+    u_int              seed;       /* for picking node levels */
+    sk_node           *tail;       /* last node on level 0 */
+    sk_node           *head;       /* sentinel, SKIPLIST_MAX_LEVEL high */
+} sk_container;
+
+typedef struct sk_iterator_s {
+    netsnmp_iterator   base;
+
+    sk_node           *pos;
+    int                at_head;    /* backed up before the first node */
+} sk_iterator;
+
+static netsnmp_iterator *_sk_iterator_get(netsnmp_container *c);
+
+/**********************************************************************
+ *
+ * skip list
+ *
+ */
+static sk_node *
+_sk_node_alloc(int level)
+{
+    sk_node *node;
+
+    node = (sk_node *)calloc(1, sizeof(sk_node) +
+                             (level - 1) * sizeof(sk_node *));
+    if (node)
+        node->level = level;
+    return node;
+}
+
+static int
+_sk_random_level(sk_container *sk)
+{
+    int level = 1;
+
+    /*
+     * xorshift; two bits per level, for a branching factor of four
+     */
+    sk->seed ^= sk->seed << 13;
+    sk->seed ^= sk->seed >> 17;
+    sk->seed ^= sk->seed << 5;
+    while (level < SKIPLIST_MAX_LEVEL &&
+           (sk->seed >> (2 * level - 2) & 3) == 0)
+        ++level;
+    return level;
+}
+
+/*
+ * Find the first node whose data is greater than (after != 0) or not
+ * less than (after == 0) the key, filling in update[] with the last node
+ * before it on every level when update is not NULL.
+ */
+static sk_node *
+_sk_search(sk_container *sk, netsnmp_container_compare *cmp,
+           const void *key, int after, sk_node **update)
+{
+    sk_node *x = sk->head, *n;
+    int      i;
+
+    for (i = sk->level - 1; i >= 0; --i) {
+        for (n = x->next[i]; n; x = n, n = x->next[i]) {
+            int rc = cmp(n->data, key);
+            if (rc > 0 || (rc == 0 && !after))
+                break;
+        }
+        if (update)
+            update[i] = x;
+    }
+    return x->next[0];
+}
+
+static void
+_sk_unlink(sk_container *sk, sk_node *node, sk_node **update)
+{
+    int i;
+
+    for (i = 0; i < node->level; ++i)
+        update[i]->next[i] = node->next[i];
+    if (node->next[0])
+        node->next[0]->prev = node->prev;
+    else
+        sk->tail = node->prev;
+    while (sk->level > 1 && NULL == sk->head->next[sk->level - 1])
+        --sk->level;
+    free(node);
+    --sk->count;
+    ++sk->c.sync;
+}
+
+/*
+ * Add a node after all entries with an equal key, so that entries with
+ * duplicate keys keep their insertion order.
+ */
+static int
+_sk_link(sk_container *sk, const void *data)
+{
+    sk_node *update[SKIPLIST_MAX_LEVEL], *node;
+    int      i, level;
+
+    _sk_search(sk, sk->c.compare, data, 1, update);
+    if (update[0] != sk->head &&
+        !(sk->c.flags & CONTAINER_KEY_ALLOW_DUPLICATES) &&
+        sk->c.compare(update[0]->data, data) == 0) {
+        DEBUGMSGTL(("container","not inserting duplicate key\n"));
+        return -1;
+    }
+
+    level = _sk_random_level(sk);
+    node = _sk_node_alloc(level);
+    if (NULL == node)
+        return -1;
+    node->data = NETSNMP_REMOVE_CONST(void *, data);
+
+    for (i = sk->level; i < level; ++i)
+        update[i] = sk->head;
+    if (level > sk->level)
+        sk->level = level;
+    for (i = 0; i < level; ++i) {
+        node->next[i] = update[i]->next[i];
+        update[i]->next[i] = node;
+    }
+    node->prev = (update[0] == sk->head) ? NULL : update[0];
+    if (node->next[0])
+        node->next[0]->prev = node;
+    else
+        sk->tail = node;
+
+    ++sk->count;
+    ++sk->c.sync;
+    return 0;
+}
+
+static void
+_sk_clear(netsnmp_container *c, netsnmp_container_obj_func *f,
+          void *context)
+{
+    sk_container *sk = (sk_container *)c;
+    sk_node      *curr, *next;
+    int           i;
+
+    if (NULL == c)
+        return;
+
+    for (curr = sk->head->next[0]; curr; curr = next) {
+        next = curr->next[0];
+        if (NULL != f)
+            (*f) (curr->data, context);
+        /*
+         * free our node structure, but not the data
+         */
+        free(curr);
+    }
+    for (i = 0; i < SKIPLIST_MAX_LEVEL; ++i)
+        sk->head->next[i] = NULL;
+    sk->level = 1;
+    sk->tail = NULL;
+    sk->count = 0;
+    ++c->sync;
+}
+
+/**********************************************************************
+ *
+ * container
+ *
+ */
+static int
+_sk_free(netsnmp_container *c)
+{
+    sk_container *sk = (sk_container *)c;
+
+    if (NULL == c)
+        return 0;
+
+    _sk_clear(c, NULL, NULL);
+    free(sk->head);
+    free(c);
+    return 0;
+}
+
+static void *
+_sk_find(netsnmp_container *c, const void *key)
+{
+    sk_container *sk = (sk_container *)c;
+    sk_node      *n;
+
+    if ((NULL == c) || (NULL == key))
+        return NULL;
+
+    n = _sk_search(sk, c->compare, key, 0, NULL);
+    if (n && c->compare(n->data, key) == 0)
+        return n->data;
+    return NULL;
+}
+
+static void *
+_sk_find_next(netsnmp_container *c, const void *key)
+{
+    sk_container *sk = (sk_container *)c;
+    sk_node      *n;
+
+    if (NULL == c)
+        return NULL;
+
+    if (NULL == key)
+        n = sk->head->next[0];
+    else
+        n = _sk_search(sk, c->compare, key, 1, NULL);
+    return n ? n->data : NULL;
+}
+
+static int
+_sk_insert(netsnmp_container *c, const void *data)
+{
+    if ((NULL == c) || (NULL == data))
+        return -1;
+
+    return _sk_link((sk_container *)c, data);
+}
+
+static int
+_sk_remove(netsnmp_container *c, const void *data)
+{
+    sk_container *sk = (sk_container *)c;
+    sk_node      *update[SKIPLIST_MAX_LEVEL], *n;
+
+    if ((NULL == c) || (NULL == data))
+        return -1;
+
+    n = _sk_search(sk, c->compare, data, 0, update);
+    if ((NULL == n) || c->compare(n->data, data) != 0)
+        return -1;
+
+    _sk_unlink(sk, n, update);
+    return 0;
+}
+
+static size_t
+_sk_size(netsnmp_container *c)
+{
+    sk_container *sk = (sk_container *)c;
+
+    if (NULL == c)
+        return 0;
+
+    return sk->count;
+}
+
+static void
+_sk_for_each(netsnmp_container *c, netsnmp_container_obj_func *f,
+             void *context)
+{
+    sk_container *sk = (sk_container *)c;
+    sk_node      *curr, *next;
+
+    if (NULL == c)
+        return;
+
+    for (curr = sk->head->next[0]; curr; curr = next) {
+        next = curr->next[0];
+        (*f) (curr->data, context);
+    }
+}
+
+static netsnmp_void_array *
+_sk_get_subset(netsnmp_container *c, void *key)
+{
+    sk_container       *sk = (sk_container *)c;
+    netsnmp_void_array *va;
+    sk_node            *start, *n;
+    size_t              len = 0;
+
+    if ((NULL == c) || (NULL == key))
+        return NULL;
+
+    netsnmp_assert(c->ncompare);
+    if (NULL == c->ncompare)
+        return NULL;
+
+    start = _sk_search(sk, c->ncompare, key, 0, NULL);
+    for (n = start; n && c->ncompare(n->data, key) == 0; n = n->next[0])
+        ++len;
+    if (0 == len)
+        return NULL;
+
+    va = SNMP_MALLOC_TYPEDEF(netsnmp_void_array);
+    if (NULL == va)
+        return NULL;
+    va->array = (void **)malloc(len * sizeof(void *));
+    if (NULL == va->array) {
+        free(va);
+        return NULL;
+    }
+    va->size = len;
+    for (n = start, len = 0; len < va->size; n = n->next[0])
+        va->array[len++] = n->data;
+
+    return va;
+}
+
+static int
+_sk_options(netsnmp_container *c, int set, u_int flags)
+{
+    if (set) {
+        if ((flags & CONTAINER_KEY_ALLOW_DUPLICATES) == flags)
+            c->flags = flags;
+        else
+            flags = (u_int)-1; /* unsupported flag */
+    }
+    else
+        return ((c->flags & flags) == flags);
+    return flags;
+}
+
+static netsnmp_container *
+_sk_duplicate(netsnmp_container *c, void *ctx, u_int flags)
+{
+    sk_container *sk = (sk_container *)c, *dup;
+    sk_node      *last[SKIPLIST_MAX_LEVEL], *n, *node;
+    int           i;
+
+    if (flags) {
+        snmp_log(LOG_ERR, "skiplist duplicate does not support flags yet\n");
+        return NULL;
+    }
+
+    dup = (sk_container *)netsnmp_container_get_skiplist();
+    if (NULL == dup) {
+        snmp_log(LOG_ERR, "no memory for skiplist duplicate\n");
+        return NULL;
+    }
+    if (netsnmp_container_data_dup((netsnmp_container *)dup, c) != 0) {
+        _sk_free((netsnmp_container *)dup);
+        return NULL;
+    }
+
+    /*
+     * shallow copy; the data is already sorted, so just append
+     */
+    for (i = 0; i < SKIPLIST_MAX_LEVEL; ++i)
+        last[i] = dup->head;
+    for (n = sk->head->next[0]; n; n = n->next[0]) {
+        node = _sk_node_alloc(n->level);
+        if (NULL == node) {
+            snmp_log(LOG_ERR, "no memory for skiplist duplicate\n");
+            _sk_free((netsnmp_container *)dup);
+            return NULL;
+        }
+        node->data = n->data;
+        node->prev = dup->tail;
+        for (i = 0; i < node->level; ++i) {
+            last[i]->next[i] = node;
+            last[i] = node;
+        }
+        dup->tail = node;
+        ++dup->count;
+    }
+    dup->level = sk->level;
+
+    return (netsnmp_container *)dup;
+}
+
+netsnmp_container *
+netsnmp_container_get_skiplist(void)
+{
+    /*
+     * allocate memory
+     */
+    sk_container *sk = SNMP_MALLOC_TYPEDEF(sk_container);
+    if (NULL == sk) {
+        snmp_log(LOG_ERR, "couldn't allocate memory\n");
+        return NULL;
+    }
+    sk->head = _sk_node_alloc(SKIPLIST_MAX_LEVEL);
+    if (NULL == sk->head) {
+        snmp_log(LOG_ERR, "couldn't allocate memory\n");
+        free(sk);
+        return NULL;
+    }
+    sk->level = 1;
+    sk->seed = 0x9e3779b9 ^ (u_int)(u_long)sk;
+    if (0 == sk->seed)
+        sk->seed = 0x9e3779b9;
+
+    netsnmp_init_container((netsnmp_container *)sk, NULL, _sk_free,
+                           _sk_size, NULL, _sk_insert, _sk_remove,
+                           _sk_find);
+    sk->c.find_next = _sk_find_next;
+    sk->c.get_subset = _sk_get_subset;
+    sk->c.get_iterator = _sk_iterator_get;
+    sk->c.for_each = _sk_for_each;
+    sk->c.clear = _sk_clear;
+    sk->c.options = _sk_options;
+    sk->c.duplicate = _sk_duplicate;
+
+    return (netsnmp_container *)sk;
+}
+
+netsnmp_factory *
+netsnmp_container_get_skiplist_factory(void)
+{
+    static netsnmp_factory f = { "skiplist",
+                                 (netsnmp_factory_produce_f*)
+                                 netsnmp_container_get_skiplist };
+
+    return &f;
+}
+
+void
+netsnmp_container_skiplist_init(void)
+{
+    netsnmp_container_register("skiplist",
+                               netsnmp_container_get_skiplist_factory());
+}
+
+/**********************************************************************
+ *
+ * iterator
+ *
+ */
+NETSNMP_STATIC_INLINE sk_container *
+_sk_it2cont(sk_iterator *it)
+{
+    if(NULL == it) {
+        netsnmp_assert(NULL != it);
+        return NULL;
+    }
+
+    if(NULL == it->base.container) {
+        netsnmp_assert(NULL != it->base.container);
+        return NULL;
+    }
+
+    if(it->base.container->sync != it->base.sync) {
+        DEBUGMSGTL(("container:iterator", "out of sync\n"));
+        return NULL;
+    }
+
+    return (sk_container *)it->base.container;
+}
+
+static void *
+_sk_iterator_curr(sk_iterator *it)
+{
+    sk_container *sk = _sk_it2cont(it);
+    if ((NULL == sk) || (NULL == it->pos))
+        return NULL;
+
+    return it->pos->data;
+}
+
+static void *
+_sk_iterator_first(sk_iterator *it)
+{
+    sk_container *sk = _sk_it2cont(it);
+    if ((NULL == sk) || (NULL == sk->head->next[0]))
+        return NULL;
+
+    return sk->head->next[0]->data;
+}
+
+static void *
+_sk_iterator_next(sk_iterator *it)
+{
+    sk_container *sk = _sk_it2cont(it);
+    if (NULL == sk)
+        return NULL;
+
+    if (it->at_head) {
+        it->at_head = 0;
+        it->pos = sk->head->next[0];
+    } else if (it->pos)
+        it->pos = it->pos->next[0];
+    if (NULL == it->pos)
+        return NULL;
+
+    return it->pos->data;
+}
+
+static void *
+_sk_iterator_last(sk_iterator *it)
+{
+    sk_container *sk = _sk_it2cont(it);
+    if ((NULL == sk) || (NULL == sk->tail))
+        return NULL;
+
+    return sk->tail->data;
+}
+
+static int
+_sk_iterator_remove(sk_iterator *it)
+{
+    sk_container *sk = _sk_it2cont(it);
+    sk_node      *update[SKIPLIST_MAX_LEVEL], *n, *prev;
+    int           i;
+
+    if ((NULL == sk) || (NULL == it->pos))
+        return -1;
+
+    /*
+     * find the predecessors of this exact node, which may be one of
+     * several with the same key
+     */
+    n = _sk_search(sk, sk->c.compare, it->pos->data, 0, update);
+    for (; n && n != it->pos; n = n->next[0])
+        for (i = 0; i < n->level; ++i)
+            update[i] = n;
+    if (NULL == n)
+        return -1;
+
+    /*
+     * since this iterator was used for the remove, keep it in sync with
+     * the container. Also, back up one so that next will be the node
+     * after the one that was just removed.
+     */
+    prev = n->prev;
+    _sk_unlink(sk, n, update);
+    it->pos = prev;
+    it->at_head = (NULL == prev);
+    it->base.sync = sk->c.sync;
+
+    return 0;
+}
+
+static int
+_sk_iterator_reset(sk_iterator *it)
+{
+    sk_container *sk;
+
+    /** can't use it2cont cuz we might be out of sync */
+    if(NULL == it) {
+        netsnmp_assert(NULL != it);
+        return -1;
+    }
+
+    if(NULL == it->base.container) {
+        netsnmp_assert(NULL != it->base.container);
+        return -1;
+    }
+    sk = (sk_container *)it->base.container;
+
+    it->pos = sk->head->next[0];
+    it->at_head = 0;
+
+    /*
+     * save sync count, to make sure container doesn't change while
+     * iterator is in use.
+     */
+    it->base.sync = it->base.container->sync;
+
+    return 0;
+}
+
+static int
+_sk_iterator_release(netsnmp_iterator *it)
+{
+    free(it);
+
+    return 0;
+}
+
+static netsnmp_iterator *
+_sk_iterator_get(netsnmp_container *c)
+{
+    sk_iterator* it;
+
+    if(NULL == c)
+        return NULL;
+
+    it = SNMP_MALLOC_TYPEDEF(sk_iterator);
+    if(NULL == it)
+        return NULL;
+
+    it->base.container = c;
+
+    it->base.first = (netsnmp_iterator_rtn*)_sk_iterator_first;
+    it->base.next = (netsnmp_iterator_rtn*)_sk_iterator_next;
+    it->base.curr = (netsnmp_iterator_rtn*)_sk_iterator_curr;
+    it->base.last = (netsnmp_iterator_rtn*)_sk_iterator_last;
+    it->base.remove = (netsnmp_iterator_rc*)_sk_iterator_remove;
+    it->base.reset = (netsnmp_iterator_rc*)_sk_iterator_reset;
+    it->base.release = (netsnmp_iterator_rc*)_sk_iterator_release;
+
+    (void)_sk_iterator_reset(it);
+
+    return (netsnmp_iterator *)it;
+}
+#else /* NETSNMP_FEATURE_REMOVE_CONTAINER_SKIPLIST */
+netsnmp_feature_unused(container_skiplist);
+#endif /* NETSNMP_FEATURE_REMOVE_CONTAINER_SKIPLIST */
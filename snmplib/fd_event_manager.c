@@ -3,12 +3,21 @@
 #ifdef HAVE_SYS_SELECT
 #include <sys/select.h>
 #endif
+#include <errno.h>
+#include <limits.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/net-snmp-features.h>
 #include <net-snmp/library/snmp_api.h>
 #include <net-snmp/library/fd_event_manager.h>
 #include <net-snmp/library/snmp_logging.h>
 #include <net-snmp/library/large_fd_set.h>
+#include <net-snmp/library/default_store.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 
 netsnmp_feature_child_of(fd_event_manager, libnetsnmp);
 
@@ -37,6 +46,7 @@ register_readfd(int fd, void (*func) (int, void *), void *data)
         external_readfdfunc[external_readfdlen] = func;
         external_readfd_data[external_readfdlen] = data;
         external_readfdlen++;
+        netsnmp_event_loop_watch_fd(fd, NETSNMP_EVENT_LOOP_READ);
         DEBUGMSGTL(("fd_event_manager:register_readfd", "registered fd %d\n", fd));
         return FD_REGISTERED_OK;
     } else {
@@ -57,6 +67,7 @@ register_writefd(int fd, void (*func) (int, void *), void *data)
         external_writefdfunc[external_writefdlen] = func;
         external_writefd_data[external_writefdlen] = data;
         external_writefdlen++;
+        netsnmp_event_loop_watch_fd(fd, NETSNMP_EVENT_LOOP_WRITE);
         DEBUGMSGTL(("fd_event_manager:register_writefd", "registered fd %d\n", fd));
         return FD_REGISTERED_OK;
     } else {
@@ -78,6 +89,7 @@ register_exceptfd(int fd, void (*func) (int, void *), void *data)
         external_exceptfdfunc[external_exceptfdlen] = func;
         external_exceptfd_data[external_exceptfdlen] = data;
         external_exceptfdlen++;
+        netsnmp_event_loop_watch_fd(fd, NETSNMP_EVENT_LOOP_EXCEPT);
         DEBUGMSGTL(("fd_event_manager:register_exceptfd", "registered fd %d\n", fd));
         return FD_REGISTERED_OK;
     } else {
@@ -104,6 +116,7 @@ unregister_readfd(int fd)
                 external_readfd_data[j] = external_readfd_data[j + 1];
             }
             DEBUGMSGTL(("fd_event_manager:unregister_readfd", "unregistered fd %d\n", fd));
+            netsnmp_event_loop_unwatch_fd(fd, NETSNMP_EVENT_LOOP_READ);
             external_fd_unregistered = 1;
             return FD_UNREGISTERED_OK;
         }
@@ -128,6 +141,7 @@ unregister_writefd(int fd)
                 external_writefd_data[j] = external_writefd_data[j + 1];
             }
             DEBUGMSGTL(("fd_event_manager:unregister_writefd", "unregistered fd %d\n", fd));
+            netsnmp_event_loop_unwatch_fd(fd, NETSNMP_EVENT_LOOP_WRITE);
             external_fd_unregistered = 1;
             return FD_UNREGISTERED_OK;
         }
@@ -153,6 +167,7 @@ unregister_exceptfd(int fd)
             }
             DEBUGMSGTL(("fd_event_manager:unregister_exceptfd", "unregistered fd %d\n",
                         fd));
+            netsnmp_event_loop_unwatch_fd(fd, NETSNMP_EVENT_LOOP_EXCEPT);
             external_fd_unregistered = 1;
             return FD_UNREGISTERED_OK;
         }
@@ -295,3 +310,469 @@ void netsnmp_dispatch_external_events2(int *count,
 #else  /*  !NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER */
 netsnmp_feature_unused(fd_event_manager);
 #endif /*  !NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER */
+
+/*
+ * Event loop backends
+ *
+ * The select() backend simply hands the descriptor sets to the kernel on
+ * every iteration, which costs O(number of descriptors) per wakeup.  The
+ * epoll() backend keeps a persistent kernel interest set that is updated
+ * when a descriptor is registered, unregistered or closed, and rewrites the
+ * descriptor sets so that on return they only contain the descriptors that
+ * are actually ready.  The dispatch code (netsnmp_dispatch_external_events2()
+ * and snmp_read2()) therefore only touches ready descriptors, and nothing
+ * walks the full descriptor range while waiting.
+ */
+#ifdef HAVE_SYS_EPOLL_H
+
+#define EPOLL_MAX_EVENTS    256
+
+/*
+ * Per descriptor state: the NETSNMP_EVENT_LOOP_* bits that are wanted,
+ * plus whether the descriptor is in the kernel interest set and whether
+ * epoll refused it (e.g. a regular file).
+ */
+#define EPOLL_FD_WANTED     (NETSNMP_EVENT_LOOP_READ | NETSNMP_EVENT_LOOP_WRITE \
+                             | NETSNMP_EVENT_LOOP_EXCEPT)
+#define EPOLL_FD_ADDED      0x10
+#define EPOLL_FD_REFUSED    0x20
+
+static int      epoll_fd = -1;
+static pid_t    epoll_pid;
+static u_char  *epoll_state;            /* EPOLL_FD_* per fd */
+static int      epoll_state_len;
+static int      epoll_refused;          /* descriptors epoll cannot watch */
+
+static uint32_t
+_epoll_events(int wanted)
+{
+    uint32_t        events = 0;
+
+    if (wanted & NETSNMP_EVENT_LOOP_READ)
+        events |= EPOLLIN;
+    if (wanted & NETSNMP_EVENT_LOOP_WRITE)
+        events |= EPOLLOUT;
+    if (wanted & NETSNMP_EVENT_LOOP_EXCEPT)
+        events |= EPOLLPRI;
+    return events;
+}
+
+static int
+_epoll_grow(int fd)
+{
+    u_char         *tmp;
+    int             newlen;
+
+    if (fd < epoll_state_len)
+        return 0;
+    newlen = epoll_state_len ? epoll_state_len : FD_SETSIZE;
+    while (newlen <= fd)
+        newlen *= 2;
+    tmp = realloc(epoll_state, newlen);
+    if (NULL == tmp)
+        return -1;
+    memset(tmp + epoll_state_len, 0, newlen - epoll_state_len);
+    epoll_state = tmp;
+    epoll_state_len = newlen;
+    return 0;
+}
+
+/*
+ * Bring the kernel interest set in line with what is wanted for fd.
+ */
+static void
+_epoll_apply(int fd)
+{
+    struct epoll_event ev;
+    u_char          state = epoll_state[fd];
+    int             op;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = _epoll_events(state & EPOLL_FD_WANTED);
+    ev.data.fd = fd;
+
+    if (!ev.events) {
+        if (state & EPOLL_FD_ADDED)
+            (void)epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+        if (state & EPOLL_FD_REFUSED)
+            epoll_refused--;
+        epoll_state[fd] = 0;
+        return;
+    }
+
+    op = (state & EPOLL_FD_ADDED) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(epoll_fd, op, fd, &ev) < 0) {
+        /*
+         * The kernel silently drops descriptors from the interest set when
+         * they are closed, so a descriptor number may have been reused
+         * since we last saw it.  Retry with the complementary operation.
+         */
+        if ((op == EPOLL_CTL_MOD && errno == ENOENT) ||
+            (op == EPOLL_CTL_ADD && errno == EEXIST))
+            op = (op == EPOLL_CTL_MOD) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+        else
+            op = -1;
+        if (op < 0 || epoll_ctl(epoll_fd, op, fd, &ev) < 0) {
+            /*
+             * Not every descriptor type can be polled with epoll (e.g.
+             * regular files); select() copes with those.
+             */
+            if (!(state & EPOLL_FD_REFUSED)) {
+                snmp_log(LOG_WARNING, "epoll: cannot watch fd %d (%s),"
+                         " falling back to select()\n", fd, strerror(errno));
+                epoll_refused++;
+            }
+            epoll_state[fd] = (state & EPOLL_FD_WANTED) | EPOLL_FD_REFUSED;
+            return;
+        }
+    }
+    if (state & EPOLL_FD_REFUSED)
+        epoll_refused--;
+    DEBUGMSGTL(("9:fd_event_manager:epoll", "fd %d events 0x%x\n", fd,
+                (unsigned)ev.events));
+    epoll_state[fd] = (state & EPOLL_FD_WANTED) | EPOLL_FD_ADDED;
+}
+
+static int
+_epoll_active(void)
+{
+    return epoll_fd >= 0 && epoll_pid == getpid();
+}
+
+static int
+_epoll_open(void)
+{
+    int             fd;
+
+    if (_epoll_active())
+        return 0;
+
+    /*
+     * A forked child shares the interest set with its parent, so start
+     * over with a fresh epoll instance.
+     */
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+
+#ifdef EPOLL_CLOEXEC
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+#else
+    epoll_fd = epoll_create(EPOLL_MAX_EVENTS);
+#endif
+    if (epoll_fd < 0) {
+        snmp_log_perror("epoll_create");
+        return -1;
+    }
+    epoll_pid = getpid();
+    DEBUGMSGTL(("fd_event_manager:epoll", "created epoll fd %d\n", epoll_fd));
+
+    /*
+     * Descriptors may have been watched before the first wait, or by the
+     * parent process; add them to the new instance.
+     */
+    for (fd = 0; fd < epoll_state_len; fd++) {
+        epoll_state[fd] &= ~EPOLL_FD_ADDED;
+        if (epoll_state[fd] & EPOLL_FD_WANTED)
+            _epoll_apply(fd);
+    }
+    return 0;
+}
+
+static int
+_epoll_timeout_ms(const struct timeval *timeout)
+{
+    if (timeout == NULL)
+        return -1;
+    if (timeout->tv_sec >= INT_MAX / 1000)
+        return INT_MAX;
+    /* round up so we never wake up just before a timer is due */
+    return timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000;
+}
+
+/*
+ * A descriptor that was closed while a copy of it lived on (e.g. in a
+ * child process) stays in the kernel interest set and can no longer be
+ * removed by number.  Rebuild the interest set, or the level triggered
+ * event would keep waking us up.
+ */
+static void
+_epoll_drop_stale(int stale)
+{
+    DEBUGMSGTL(("fd_event_manager:epoll", "%d stale descriptors,"
+                " rebuilding the interest set\n", stale));
+    close(epoll_fd);
+    epoll_fd = -1;
+}
+
+static int
+_epoll_wait2(int numfds, netsnmp_large_fd_set *readfds,
+             netsnmp_large_fd_set *writefds,
+             netsnmp_large_fd_set *exceptfds, struct timeval *timeout)
+{
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    int             fd, i, n, count, timeout_ms, stale;
+    uint32_t        ready;
+
+    if (_epoll_open() < 0 || epoll_refused)
+        return netsnmp_large_fd_set_select(numfds, readfds, writefds,
+                                           exceptfds, timeout);
+
+    timeout_ms = _epoll_timeout_ms(timeout);
+    n = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, timeout_ms);
+    if (n < 0)
+        return -1;
+
+    /*
+     * Report the same way select() would: errors and hangups make a
+     * descriptor readable, only descriptors the caller asked for are
+     * reported, and the count is the number of set bits.
+     */
+    stale = 0;
+    for (i = 0; i < n; i++) {
+        fd = events[i].data.fd;
+        ready = 0;
+        if (fd < numfds) {
+            if (readfds && NETSNMP_LARGE_FD_ISSET(fd, readfds) &&
+                (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                ready |= NETSNMP_EVENT_LOOP_READ;
+            if (writefds && NETSNMP_LARGE_FD_ISSET(fd, writefds) &&
+                (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)))
+                ready |= NETSNMP_EVENT_LOOP_WRITE;
+            if (exceptfds && NETSNMP_LARGE_FD_ISSET(fd, exceptfds) &&
+                (events[i].events & EPOLLPRI))
+                ready |= NETSNMP_EVENT_LOOP_EXCEPT;
+        }
+        if (fd >= epoll_state_len || !(epoll_state[fd] & EPOLL_FD_WANTED))
+            stale++;
+        events[i].events = ready;
+    }
+
+    if (readfds)
+        NETSNMP_LARGE_FD_ZERO(readfds);
+    if (writefds)
+        NETSNMP_LARGE_FD_ZERO(writefds);
+    if (exceptfds)
+        NETSNMP_LARGE_FD_ZERO(exceptfds);
+
+    count = 0;
+    for (i = 0; i < n; i++) {
+        fd = events[i].data.fd;
+        if (events[i].events & NETSNMP_EVENT_LOOP_READ) {
+            NETSNMP_LARGE_FD_SET(fd, readfds);
+            count++;
+        }
+        if (events[i].events & NETSNMP_EVENT_LOOP_WRITE) {
+            NETSNMP_LARGE_FD_SET(fd, writefds);
+            count++;
+        }
+        if (events[i].events & NETSNMP_EVENT_LOOP_EXCEPT) {
+            NETSNMP_LARGE_FD_SET(fd, exceptfds);
+            count++;
+        }
+    }
+
+    if (stale)
+        _epoll_drop_stale(stale);
+    return count;
+}
+
+static int
+_epoll_wait_ready(int *fds, int max, int *nfds,
+                  netsnmp_large_fd_set *readfds,
+                  netsnmp_large_fd_set *writefds,
+                  netsnmp_large_fd_set *exceptfds, struct timeval *timeout)
+{
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    int             fd, i, n, count, stale, wanted;
+
+    *nfds = 0;
+    if (max > EPOLL_MAX_EVENTS)
+        max = EPOLL_MAX_EVENTS;
+    n = epoll_wait(epoll_fd, events, max, _epoll_timeout_ms(timeout));
+    if (n < 0)
+        return -1;
+
+    count = stale = 0;
+    for (i = 0; i < n; i++) {
+        fd = events[i].data.fd;
+        wanted = fd < epoll_state_len ? epoll_state[fd] & EPOLL_FD_WANTED :
+            0;
+        if (!wanted) {
+            stale++;
+            continue;
+        }
+        fds[(*nfds)++] = fd;
+        if ((wanted & NETSNMP_EVENT_LOOP_READ) &&
+            (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+            NETSNMP_LARGE_FD_SET(fd, readfds);
+            count++;
+        }
+        if ((wanted & NETSNMP_EVENT_LOOP_WRITE) &&
+            (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR))) {
+            NETSNMP_LARGE_FD_SET(fd, writefds);
+            count++;
+        }
+        if ((wanted & NETSNMP_EVENT_LOOP_EXCEPT) &&
+            (events[i].events & EPOLLPRI)) {
+            NETSNMP_LARGE_FD_SET(fd, exceptfds);
+            count++;
+        }
+    }
+
+    if (stale)
+        _epoll_drop_stale(stale);
+    return count;
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
+/*
+ * Returns the event loop backend selected by the eventLoopBackend token.
+ */
+int
+netsnmp_event_loop_backend(void)
+{
+    const char     *name;
+
+    name = netsnmp_ds_get_string(NETSNMP_DS_LIBRARY_ID,
+                                 NETSNMP_DS_LIB_EVENT_BACKEND);
+    if (name && strcasecmp(name, "select") == 0)
+        return NETSNMP_EVENT_BACKEND_SELECT;
+#ifdef HAVE_SYS_EPOLL_H
+    if (name == NULL || strcasecmp(name, "epoll") == 0)
+        return NETSNMP_EVENT_BACKEND_EPOLL;
+#endif
+    return NETSNMP_EVENT_BACKEND_SELECT;
+}
+
+/*
+ * Wait for activity on the descriptors in the given sets, using the
+ * configured event loop backend.  Same semantics as
+ * netsnmp_large_fd_set_select(): on return the sets contain the ready
+ * descriptors and the return value is their count, 0 on timeout or -1
+ * with errno set on error.
+ */
+int
+netsnmp_event_loop_wait2(int numfds, netsnmp_large_fd_set *readfds,
+                         netsnmp_large_fd_set *writefds,
+                         netsnmp_large_fd_set *exceptfds,
+                         struct timeval *timeout)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (netsnmp_event_loop_backend() == NETSNMP_EVENT_BACKEND_EPOLL)
+        return _epoll_wait2(numfds, readfds, writefds, exceptfds, timeout);
+#endif
+    return netsnmp_large_fd_set_select(numfds, readfds, writefds, exceptfds,
+                                       timeout);
+}
+
+/*
+ * Whether netsnmp_event_loop_wait_ready() can be used: the epoll backend
+ * is selected and watches every descriptor that is wanted.
+ */
+int
+netsnmp_event_loop_can_wait_ready(void)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    return netsnmp_event_loop_backend() == NETSNMP_EVENT_BACKEND_EPOLL &&
+        _epoll_open() == 0 && !epoll_refused;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Wait for activity on the watched descriptors, without collecting them in
+ * descriptor sets first.  On return fds[] holds the (at most max)
+ * descriptors that are ready, *nfds their number, and their bits are set
+ * in the given sets, which the caller must clear again before the next
+ * call.  The return value is the number of bits set, 0 on timeout or -1
+ * with errno set on error, as for netsnmp_event_loop_wait2().  Only to be
+ * used while netsnmp_event_loop_can_wait_ready() says so.
+ */
+int
+netsnmp_event_loop_wait_ready(int *fds, int max, int *nfds,
+                              netsnmp_large_fd_set *readfds,
+                              netsnmp_large_fd_set *writefds,
+                              netsnmp_large_fd_set *exceptfds,
+                              struct timeval *timeout)
+{
+#ifndef NETSNMP_FEATURE_REMOVE_FD_EVENT_MANAGER
+    /* as netsnmp_external_event_info2() would */
+    external_fd_unregistered = 0;
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+    if (_epoll_active())
+        return _epoll_wait_ready(fds, max, nfds, readfds, writefds,
+                                 exceptfds, timeout);
+#endif
+    *nfds = 0;
+    errno = EINVAL;
+    return -1;
+}
+
+/*
+ * Watch fd for the given NETSNMP_EVENT_LOOP_* events, in addition to the
+ * ones it is already watched for.  The kernel interest set is always
+ * updated, since a descriptor number may have been closed and reused.
+ */
+void
+netsnmp_event_loop_watch_fd(int fd, int events)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (fd < 0 || _epoll_grow(fd) < 0)
+        return;
+    epoll_state[fd] |= events & EPOLL_FD_WANTED;
+    if (_epoll_active())
+        _epoll_apply(fd);
+#endif
+}
+
+/*
+ * Stop watching fd for the given NETSNMP_EVENT_LOOP_* events.
+ */
+void
+netsnmp_event_loop_unwatch_fd(int fd, int events)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (fd < 0 || fd >= epoll_state_len || !epoll_state[fd])
+        return;
+    epoll_state[fd] &= ~(events & EPOLL_FD_WANTED);
+    if (_epoll_active())
+        _epoll_apply(fd);
+    else if (!(epoll_state[fd] & EPOLL_FD_WANTED)) {
+        if (epoll_state[fd] & EPOLL_FD_REFUSED)
+            epoll_refused--;
+        epoll_state[fd] = 0;
+    }
+#endif
+}
+
+/*
+ * Stop watching fd altogether.  Called before a descriptor is closed.
+ */
+void
+netsnmp_event_loop_forget_fd(int fd)
+{
+    netsnmp_event_loop_unwatch_fd(fd, NETSNMP_EVENT_LOOP_READ |
+                                  NETSNMP_EVENT_LOOP_WRITE |
+                                  NETSNMP_EVENT_LOOP_EXCEPT);
+}
+
+/*
+ * Release the resources held by the event loop backend.
+ */
+void
+netsnmp_event_loop_shutdown(void)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+    SNMP_FREE(epoll_state);
+    epoll_state_len = 0;
+    epoll_refused = 0;
+#endif
+}
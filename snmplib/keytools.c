@@ -40,12 +40,18 @@
 #endif
 
 #include <math.h>
+#include <signal.h>
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE) && !defined(WIN32)
+#include <pthread.h>
+#endif
 
 #include <net-snmp/types.h>
 #include <net-snmp/output_api.h>
 #include <net-snmp/utilities.h>
 
 #include <net-snmp/library/snmp_api.h>
+#include <net-snmp/library/mt_support.h>
+#include <net-snmp/config_api.h>
 #ifdef NETSNMP_USE_OPENSSL
 #	include <openssl/hmac.h>
 #else
@@ -76,7 +82,7 @@ netsnmp_feature_child_of(usm_keytools, usm_support);
 #ifndef NETSNMP_FEATURE_REMOVE_USM_KEYTOOLS
 
 /*******************************************************************-o-******
- * generate_Ku
+ * _generate_Ku
  *
  * Parameters:
  *	*hashtype	MIB OID for the transform type for hashing.
@@ -108,9 +114,9 @@ netsnmp_feature_child_of(usm_keytools, usm_support);
  *	 cause an error to be returned.
  *	 (Punt this check to the cmdline apps?  XXX)
  */
-int
-generate_Ku(const oid * hashtype, u_int hashtype_len,
-            const u_char * P, size_t pplen, u_char * Ku, size_t * kulen)
+static int
+_generate_Ku(const oid * hashtype, u_int hashtype_len,
+             const u_char * P, size_t pplen, u_char * Ku, size_t * kulen)
 #if defined(NETSNMP_USE_INTERNAL_MD5) || defined(NETSNMP_USE_OPENSSL) || defined(NETSNMP_USE_INTERNAL_CRYPTO)
 {
     int             rval = SNMPERR_SUCCESS,
@@ -347,6 +353,425 @@ generate_Ku(const oid * hashtype, u_int hashtype_len,
 #else
 _KEYTOOLS_NOT_AVAILABLE
 #endif                          /* internal or openssl */
+
+/*
+ * Derived key cache.
+ *
+ * Turning a passphrase into Ku hashes a megabyte of expanded passphrase,
+ * which dominates the start-up time of an agent with many createUser lines
+ * and the set-up of client sessions to many engines.  Derived keys are
+ * therefore remembered, indexed by the hash type and a salted fingerprint
+ * of the passphrase: master keys (Ku) without an engineID, localized keys
+ * (Kul) with the engineID they were localized to.  The salt is made up
+ * per process and the fingerprints never leave it, as they can be tested
+ * far faster than a key can be derived.
+ *
+ * Localized keys can also be saved to the persistent store, see
+ * netsnmp_keycache_store().  Those are indexed by the user they belong to
+ * and the engineID instead, just like the keys of stored usmUser lines,
+ * and come with a verifier of the passphrase they were derived from, so
+ * that a changed passphrase is noticed.  The verifier is PBKDF2 with a
+ * salt of its own, which takes as long to compute as the key (see
+ * _keycache_verifier_rounds()), so it is of no more use for guessing the
+ * passphrase than the saved key itself.
+ */
+#define KEYCACHE_BUCKETS        1024
+#define KEYCACHE_MAX_ENTRIES    65536
+#define KEYCACHE_FP_LEN         16
+#define KEYCACHE_SALT_LEN       16
+#define KEYCACHE_KEY_MAX        64
+#define KEYCACHE_MAX_THREADS    32
+
+struct keycache_entry {
+    struct keycache_entry *next;
+    int             auth_type;
+    u_char          fp[KEYCACHE_FP_LEN];    /* of the passphrase */
+    u_char         *engineID;               /* NULL for Ku */
+    size_t          engineIDLen;
+    u_char          key[KEYCACHE_KEY_MAX];
+    size_t          keyLen;
+};
+
+/*
+ * a localized key from, or for, the persistent store
+ */
+struct keycache_saved {
+    struct keycache_saved *next;
+    char           *name;                   /* of the user */
+    int             which;                  /* NETSNMP_KEYCACHE_*KEY */
+    int             auth_type;
+    u_char         *engineID;
+    size_t          engineIDLen;
+    int             rounds;                 /* of the verifier */
+    u_char          salt[KEYCACHE_SALT_LEN];
+    u_char          verifier[KEYCACHE_FP_LEN];
+    u_char          key[KEYCACHE_KEY_MAX];
+    size_t          keyLen;
+    u_char          fp[KEYCACHE_FP_LEN];    /* of the passphrase checked */
+    int             checked;                /* against the verifier */
+    int             used;                   /* to be stored */
+};
+
+static struct keycache_entry *keycache[KEYCACHE_BUCKETS];
+static int      keycache_count;
+static u_char   keycache_salt[KEYCACHE_SALT_LEN];
+static int      keycache_salt_set;
+static struct keycache_saved *keycache_saved[KEYCACHE_BUCKETS];
+static int      keycache_saved_count;
+
+/*
+ * Fingerprints a passphrase as H(salt | P), using the hash it is going to
+ * be turned into a key with.  Call with the cache locked.
+ */
+static int
+_keycache_fingerprint(int auth_type, const u_char * P, size_t pplen,
+                      u_char * fp)
+{
+    u_char          hash[KEYCACHE_KEY_MAX], *buf;
+    size_t          hashLen = sizeof(hash), len;
+    int             rval;
+
+    if (!keycache_salt_set) {
+        len = sizeof(keycache_salt);
+        if (sc_random(keycache_salt, &len) != SNMPERR_SUCCESS ||
+            len != sizeof(keycache_salt))
+            return SNMPERR_GENERR;
+        keycache_salt_set = 1;
+    }
+
+    buf = (u_char *) malloc(sizeof(keycache_salt) + pplen);
+    if (buf == NULL)
+        return SNMPERR_GENERR;
+    memcpy(buf, keycache_salt, sizeof(keycache_salt));
+    memcpy(buf + sizeof(keycache_salt), P, pplen);
+    rval = sc_hash_type(auth_type, buf, sizeof(keycache_salt) + pplen,
+                        hash, &hashLen);
+    memset(buf, 0, sizeof(keycache_salt) + pplen);
+    free(buf);
+
+    if (rval == SNMPERR_SUCCESS && hashLen < KEYCACHE_FP_LEN)
+        rval = SNMPERR_GENERR;
+    if (rval == SNMPERR_SUCCESS)
+        memcpy(fp, hash, KEYCACHE_FP_LEN);
+    memset(hash, 0, sizeof(hash));
+    return rval;
+}
+
+static struct keycache_entry **
+_keycache_bucket(const u_char * fp)
+{
+    return &keycache[(fp[0] | (fp[1] << 8)) % KEYCACHE_BUCKETS];
+}
+
+/*
+ * Finds the key derived from a passphrase, localized to engineID unless
+ * engineIDLen is 0.  With any_engine set, any key of that passphrase will
+ * do.
+ */
+static struct keycache_entry *
+_keycache_find(int auth_type, const u_char * fp, const u_char * engineID,
+               size_t engineIDLen, int any_engine)
+{
+    struct keycache_entry *e;
+
+    for (e = *_keycache_bucket(fp); e; e = e->next)
+        if (e->auth_type == auth_type &&
+            memcmp(e->fp, fp, KEYCACHE_FP_LEN) == 0 &&
+            (any_engine ||
+             (e->engineIDLen == engineIDLen &&
+              (engineIDLen == 0 ||
+               memcmp(e->engineID, engineID, engineIDLen) == 0))))
+            return e;
+    return NULL;
+}
+
+static void
+_keycache_add(int auth_type, const u_char * fp, const u_char * engineID,
+              size_t engineIDLen, const u_char * key, size_t keyLen)
+{
+    struct keycache_entry *e, **bucket;
+
+    if (keyLen > KEYCACHE_KEY_MAX)
+        return;
+
+    e = _keycache_find(auth_type, fp, engineID, engineIDLen, 0);
+    if (e == NULL) {
+        if (keycache_count >= KEYCACHE_MAX_ENTRIES)
+            return;
+        e = SNMP_MALLOC_STRUCT(keycache_entry);
+        if (e == NULL)
+            return;
+        if (engineIDLen) {
+            e->engineID = netsnmp_memdup(engineID, engineIDLen);
+            if (e->engineID == NULL) {
+                free(e);
+                return;
+            }
+            e->engineIDLen = engineIDLen;
+        }
+        e->auth_type = auth_type;
+        memcpy(e->fp, fp, KEYCACHE_FP_LEN);
+        bucket = _keycache_bucket(fp);
+        e->next = *bucket;
+        *bucket = e;
+        keycache_count++;
+    }
+    memcpy(e->key, key, keyLen);
+    e->keyLen = keyLen;
+}
+
+/*
+ * The number of PBKDF2 rounds of a verifier.  Each round runs the
+ * compression function of the hash twice, which adds up to as many runs
+ * as hashing the megabyte of expanded passphrase in _generate_Ku() takes.
+ */
+static int
+_keycache_verifier_rounds(int auth_type)
+{
+#ifdef NETSNMP_USE_OPENSSL
+    const EVP_MD   *hashfn = sc_get_openssl_hashfn(auth_type);
+
+    if (hashfn && EVP_MD_block_size(hashfn) > 0)
+        return USM_LENGTH_EXPANDED_PASSPHRASE /
+            (2 * EVP_MD_block_size(hashfn));
+#endif
+    return 0;
+}
+
+/*
+ * Computes the verifier of a passphrase with the given salt.  This needs
+ * OpenSSL; without it no keys are saved, and saved ones are not used.
+ */
+static int
+_keycache_verifier(int auth_type, const u_char * salt, int rounds,
+                   const u_char * P, size_t pplen, u_char * verifier)
+{
+#ifdef NETSNMP_USE_OPENSSL
+    const EVP_MD   *hashfn = sc_get_openssl_hashfn(auth_type);
+    int             min_rounds = _keycache_verifier_rounds(auth_type);
+
+    if (hashfn && min_rounds > 0 && rounds >= min_rounds &&
+        PKCS5_PBKDF2_HMAC((const char *) P, (int) pplen, salt,
+                          KEYCACHE_SALT_LEN, rounds, hashfn,
+                          KEYCACHE_FP_LEN, verifier) == 1)
+        return SNMPERR_SUCCESS;
+#endif
+    return SNMPERR_GENERR;
+}
+
+/*
+ * Makes up the salt of a new verifier.
+ */
+static int
+_keycache_new_salt(int auth_type, int *rounds, u_char * salt)
+{
+    size_t          len = KEYCACHE_SALT_LEN;
+
+    *rounds = _keycache_verifier_rounds(auth_type);
+    if (*rounds <= 0 || sc_random(salt, &len) != SNMPERR_SUCCESS ||
+        len != KEYCACHE_SALT_LEN)
+        return SNMPERR_GENERR;
+    return SNMPERR_SUCCESS;
+}
+
+static struct keycache_saved **
+_keycache_saved_bucket(const char *name, int which)
+{
+    u_int           h = (u_int) which;
+
+    while (*name)
+        h = h * 31 + (u_char) *name++;
+    return &keycache_saved[h % KEYCACHE_BUCKETS];
+}
+
+/*
+ * Finds the saved key of a user, localized to engineID.  Call with the
+ * cache locked.
+ */
+static struct keycache_saved *
+_keycache_saved_find(const char *name, int which, int auth_type,
+                     const u_char * engineID, size_t engineIDLen)
+{
+    struct keycache_saved *e;
+
+    for (e = *_keycache_saved_bucket(name, which); e; e = e->next)
+        if (e->which == which && e->auth_type == auth_type &&
+            strcmp(e->name, name) == 0 && e->engineIDLen == engineIDLen &&
+            memcmp(e->engineID, engineID, engineIDLen) == 0)
+            return e;
+    return NULL;
+}
+
+/*
+ * Adds a saved key, or replaces the one of the same user, key type,
+ * authentication type and engineID.  Call with the cache locked.
+ */
+static struct keycache_saved *
+_keycache_saved_add(const char *name, int which, int auth_type,
+                    const u_char * engineID, size_t engineIDLen,
+                    int rounds, const u_char * salt,
+                    const u_char * verifier, const u_char * key,
+                    size_t keyLen)
+{
+    struct keycache_saved *e, **bucket;
+
+    if (keyLen > KEYCACHE_KEY_MAX || engineIDLen == 0)
+        return NULL;
+
+    e = _keycache_saved_find(name, which, auth_type, engineID,
+                             engineIDLen);
+    if (e == NULL) {
+        if (keycache_saved_count >= KEYCACHE_MAX_ENTRIES)
+            return NULL;
+        e = SNMP_MALLOC_STRUCT(keycache_saved);
+        if (e == NULL)
+            return NULL;
+        e->name = strdup(name);
+        e->engineID = netsnmp_memdup(engineID, engineIDLen);
+        if (e->name == NULL || e->engineID == NULL) {
+            SNMP_FREE(e->name);
+            SNMP_FREE(e->engineID);
+            free(e);
+            return NULL;
+        }
+        e->engineIDLen = engineIDLen;
+        e->which = which;
+        e->auth_type = auth_type;
+        bucket = _keycache_saved_bucket(name, which);
+        e->next = *bucket;
+        *bucket = e;
+        keycache_saved_count++;
+    }
+    e->rounds = rounds;
+    memcpy(e->salt, salt, sizeof(e->salt));
+    memcpy(e->verifier, verifier, sizeof(e->verifier));
+    memcpy(e->key, key, keyLen);
+    e->keyLen = keyLen;
+    memset(e->fp, 0, sizeof(e->fp));
+    e->checked = 0;
+    return e;
+}
+
+/*
+ * Drops the saved key of a passphrase that has changed.  Call with the
+ * cache locked.
+ */
+static void
+_keycache_saved_drop(struct keycache_saved *e)
+{
+    struct keycache_saved **prevNext;
+
+    snmp_log(LOG_WARNING, "the %s passphrase of user %s has changed; "
+             "dropping its saved key\n",
+             e->which == NETSNMP_KEYCACHE_PRIVKEY ? "privacy" :
+             "authentication", e->name);
+    for (prevNext = _keycache_saved_bucket(e->name, e->which); *prevNext;
+         prevNext = &(*prevNext)->next) {
+        if (*prevNext == e) {
+            *prevNext = e->next;
+            keycache_saved_count--;
+            break;
+        }
+    }
+    SNMP_FREE(e->name);
+    SNMP_FREE(e->engineID);
+    memset(e, 0, sizeof(*e));
+    free(e);
+}
+
+/**
+ * Forgets the keys loaded from, or to be saved to, the persistent store.
+ */
+void
+netsnmp_keycache_clear_saved(void)
+{
+    struct keycache_saved *e;
+    int             i;
+
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    for (i = 0; i < KEYCACHE_BUCKETS; i++) {
+        while ((e = keycache_saved[i]) != NULL) {
+            keycache_saved[i] = e->next;
+            SNMP_FREE(e->name);
+            SNMP_FREE(e->engineID);
+            memset(e, 0, sizeof(*e));
+            free(e);
+        }
+    }
+    keycache_saved_count = 0;
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+}
+
+/**
+ * Forgets all derived and saved keys, and the salt the passphrases were
+ * fingerprinted with.
+ */
+void
+netsnmp_keycache_clear(void)
+{
+    struct keycache_entry *e;
+    int             i;
+
+    netsnmp_keycache_clear_saved();
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    for (i = 0; i < KEYCACHE_BUCKETS; i++) {
+        while ((e = keycache[i]) != NULL) {
+            keycache[i] = e->next;
+            SNMP_FREE(e->engineID);
+            memset(e, 0, sizeof(*e));
+            free(e);
+        }
+    }
+    keycache_count = 0;
+    memset(keycache_salt, 0, sizeof(keycache_salt));
+    keycache_salt_set = 0;
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+}
+
+/*******************************************************************-o-******
+ * generate_Ku
+ *
+ * Same as _generate_Ku() above, but returns a master key derived earlier
+ * from the same passphrase with the same hashtype from the cache.
+ */
+int
+generate_Ku(const oid * hashtype, u_int hashtype_len,
+            const u_char * P, size_t pplen, u_char * Ku, size_t * kulen)
+{
+    struct keycache_entry *e;
+    u_char          fp[KEYCACHE_FP_LEN];
+    int             auth_type, rval;
+
+    auth_type = hashtype ? sc_get_authtype(hashtype, hashtype_len) :
+        SNMPERR_GENERR;
+    if (auth_type < 0 || !P || pplen < USM_LENGTH_P_MIN || !Ku || !kulen)
+        return _generate_Ku(hashtype, hashtype_len, P, pplen, Ku, kulen);
+
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    if (_keycache_fingerprint(auth_type, P, pplen, fp) != SNMPERR_SUCCESS) {
+        snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+        return _generate_Ku(hashtype, hashtype_len, P, pplen, Ku, kulen);
+    }
+    e = _keycache_find(auth_type, fp, NULL, 0, 0);
+    if (e && e->keyLen <= *kulen) {
+        memcpy(Ku, e->key, e->keyLen);
+        *kulen = e->keyLen;
+        snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+        memset(fp, 0, sizeof(fp));
+        return SNMPERR_SUCCESS;
+    }
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+
+    rval = _generate_Ku(hashtype, hashtype_len, P, pplen, Ku, kulen);
+    if (rval == SNMPERR_SUCCESS) {
+        snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+        _keycache_add(auth_type, fp, NULL, 0, Ku, *kulen);
+        snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    }
+    memset(fp, 0, sizeof(fp));
+    return rval;
+}                               /* end generate_Ku() */
+
 /*******************************************************************-o-******
  * generate_kul
  *
@@ -459,6 +884,620 @@ generate_kul(const oid * hashtype, u_int hashtype_len,
 _KEYTOOLS_NOT_AVAILABLE
 #endif                          /* internal or openssl */
 
+/*******************************************************************-o-******
+ * netsnmp_generate_kul_from_passphrase
+ *
+ * Parameters:
+ *	*hashtype
+ *	 hashtype_len
+ *	*engineID
+ *	 engineID_len
+ *	*P		Passphrase.
+ *	 pplen		Length of passphrase.
+ *	*Kul		Localized key for a given user at engineID.
+ *	*kul_len	Length of Kul buffer (IN); Length of Kul key (OUT).
+ *
+ * Returns:
+ *	SNMPERR_SUCCESS			Success.
+ *	SNMPERR_GENERR			All errors.
+ *
+ *
+ * generate_Ku() followed by generate_kul(), but skips both when the
+ * localized key is in the key cache.
+ */
+int
+netsnmp_generate_kul_from_passphrase(const oid * hashtype,
+                                     u_int hashtype_len,
+                                     const u_char * engineID,
+                                     size_t engineID_len,
+                                     const u_char * P, size_t pplen,
+                                     u_char * Kul, size_t * kul_len)
+{
+    struct keycache_entry *e;
+    u_char          Ku[SNMP_MAXBUF_SMALL];
+    size_t          kuLen = sizeof(Ku);
+    u_char          fp[KEYCACHE_FP_LEN];
+    int             auth_type, rval, have_fp = 0;
+
+    auth_type = hashtype ? sc_get_authtype(hashtype, hashtype_len) :
+        SNMPERR_GENERR;
+    if (auth_type >= 0 && P && pplen >= USM_LENGTH_P_MIN && engineID &&
+        engineID_len > 0 && Kul && kul_len) {
+        snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+        have_fp = _keycache_fingerprint(auth_type, P, pplen, fp) ==
+            SNMPERR_SUCCESS;
+        e = have_fp ? _keycache_find(auth_type, fp, engineID, engineID_len,
+                                     0) : NULL;
+        if (e && e->keyLen <= *kul_len) {
+            memcpy(Kul, e->key, e->keyLen);
+            *kul_len = e->keyLen;
+            snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+            memset(fp, 0, sizeof(fp));
+            return SNMPERR_SUCCESS;
+        }
+        snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    }
+
+    rval = generate_Ku(hashtype, hashtype_len, P, pplen, Ku, &kuLen);
+    if (rval == SNMPERR_SUCCESS)
+        rval = generate_kul(hashtype, hashtype_len, engineID, engineID_len,
+                            Ku, kuLen, Kul, kul_len);
+    if (rval == SNMPERR_SUCCESS && have_fp) {
+        snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+        _keycache_add(auth_type, fp, engineID, engineID_len, Kul, *kul_len);
+        snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    }
+    memset(Ku, 0, sizeof(Ku));
+    memset(fp, 0, sizeof(fp));
+    return rval;
+}
+
+/**
+ * Looks up the saved key of a user, as loaded from the persistent store by
+ * netsnmp_keycache_parse() or recorded by netsnmp_keycache_save_kul(), and
+ * marks it to be stored again.  The key is only returned if P matches the
+ * verifier saved with it; if it doesn't, the passphrase has changed since
+ * the key was saved, and the key is dropped.
+ *
+ * @param name     the user
+ * @param which    NETSNMP_KEYCACHE_AUTHKEY or NETSNMP_KEYCACHE_PRIVKEY
+ *
+ * @return SNMPERR_SUCCESS if Kul holds the saved key.
+ */
+int
+netsnmp_keycache_get_kul(const char *name, int which, const oid * hashtype,
+                         u_int hashtype_len, const u_char * engineID,
+                         size_t engineID_len, const u_char * P,
+                         size_t pplen, u_char * Kul, size_t * kul_len)
+{
+    struct keycache_saved *e;
+    u_char          fp[KEYCACHE_FP_LEN], salt[KEYCACHE_SALT_LEN];
+    u_char          verifier[KEYCACHE_FP_LEN];
+    int             auth_type, rounds, rval = SNMPERR_GENERR;
+
+    auth_type = hashtype ? sc_get_authtype(hashtype, hashtype_len) :
+        SNMPERR_GENERR;
+    if (auth_type < 0 || !name || !engineID || engineID_len == 0 || !P ||
+        !Kul || !kul_len)
+        return SNMPERR_GENERR;
+
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    e = _keycache_saved_find(name, which, auth_type, engineID, engineID_len);
+    if (e && _keycache_fingerprint(auth_type, P, pplen, fp) !=
+        SNMPERR_SUCCESS)
+        e = NULL;
+    if (e && !e->checked) {
+        /*
+         * this takes as long as deriving the key, so don't hold up others
+         */
+        rounds = e->rounds;
+        memcpy(salt, e->salt, sizeof(salt));
+        snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+        rval = _keycache_verifier(auth_type, salt, rounds, P, pplen,
+                                  verifier);
+        snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+        e = _keycache_saved_find(name, which, auth_type, engineID,
+                                 engineID_len);
+        if (e && !e->checked && rval == SNMPERR_SUCCESS &&
+            e->rounds == rounds &&
+            memcmp(e->salt, salt, sizeof(salt)) == 0) {
+            if (memcmp(e->verifier, verifier, sizeof(verifier)) == 0) {
+                memcpy(e->fp, fp, sizeof(fp));
+                e->checked = 1;
+            } else {
+                _keycache_saved_drop(e);
+                e = NULL;
+            }
+        }
+        rval = SNMPERR_GENERR;
+    }
+    if (e && e->checked) {
+        if (memcmp(e->fp, fp, sizeof(fp)) != 0)
+            _keycache_saved_drop(e);
+        else if (e->keyLen <= *kul_len) {
+            memcpy(Kul, e->key, e->keyLen);
+            *kul_len = e->keyLen;
+            e->used = 1;
+            rval = SNMPERR_SUCCESS;
+        }
+    }
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    memset(fp, 0, sizeof(fp));
+    memset(verifier, 0, sizeof(verifier));
+    return rval;
+}
+
+/**
+ * Records the key of a user to be saved by netsnmp_keycache_store(),
+ * together with a new verifier of the passphrase P it was derived from.
+ */
+void
+netsnmp_keycache_save_kul(const char *name, int which, const oid * hashtype,
+                          u_int hashtype_len, const u_char * engineID,
+                          size_t engineID_len, const u_char * P,
+                          size_t pplen, const u_char * Kul, size_t kul_len)
+{
+    struct keycache_saved *e;
+    u_char          fp[KEYCACHE_FP_LEN], salt[KEYCACHE_SALT_LEN];
+    u_char          verifier[KEYCACHE_FP_LEN];
+    int             auth_type, rounds;
+
+    auth_type = hashtype ? sc_get_authtype(hashtype, hashtype_len) :
+        SNMPERR_GENERR;
+    if (auth_type < 0 || !name || !engineID || !P || !Kul)
+        return;
+
+    if (_keycache_new_salt(auth_type, &rounds, salt) != SNMPERR_SUCCESS ||
+        _keycache_verifier(auth_type, salt, rounds, P, pplen, verifier) !=
+        SNMPERR_SUCCESS)
+        return;
+
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    if (_keycache_fingerprint(auth_type, P, pplen, fp) == SNMPERR_SUCCESS) {
+        e = _keycache_saved_add(name, which, auth_type, engineID,
+                                engineID_len, rounds, salt, verifier, Kul,
+                                kul_len);
+        if (e) {
+            memcpy(e->fp, fp, sizeof(fp));
+            e->checked = 1;
+            e->used = 1;
+        }
+    }
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    memset(fp, 0, sizeof(fp));
+    memset(verifier, 0, sizeof(verifier));
+}
+
+/*
+ * Master keys to derive ahead of time, and saved keys to check, see
+ * netsnmp_keycache_prefetch().
+ */
+struct keycache_job {
+    char           *name;       /* NULL if no key is to be saved */
+    int             which;
+    const oid      *hashtype;
+    size_t          hashtype_len;
+    int             auth_type;
+    u_char         *engineID;
+    size_t          engineIDLen;
+    u_char         *P;
+    size_t          pplen;
+    u_char          fp[KEYCACHE_FP_LEN];
+    u_char          Ku[SNMP_MAXBUF_SMALL];
+    size_t          kuLen;
+    int             rval;
+    int             derive;     /* Ku is to be derived */
+    int             check;      /* the saved key is to be checked */
+    int             matched;    /* ... and P matches its verifier */
+    int             rounds;
+    u_char          salt[KEYCACHE_SALT_LEN];
+    u_char          verifier[KEYCACHE_FP_LEN];
+    int             save;       /* a new verifier is to be computed */
+    int             new_rounds;
+    u_char          new_salt[KEYCACHE_SALT_LEN];
+    u_char          new_verifier[KEYCACHE_FP_LEN];
+    int             new_rval;
+};
+
+static struct keycache_job *keycache_jobs;
+static int      keycache_njobs, keycache_maxjobs;
+
+struct keycache_worker {
+    int             first, step;
+};
+
+static void    *
+_keycache_worker(void *arg)
+{
+    struct keycache_worker *w = (struct keycache_worker *) arg;
+    struct keycache_job *job;
+    u_char          verifier[KEYCACHE_FP_LEN];
+    int             i;
+
+    for (i = w->first; i < keycache_njobs; i += w->step) {
+        job = &keycache_jobs[i];
+        if (job->check) {
+            job->matched =
+                _keycache_verifier(job->auth_type, job->salt, job->rounds,
+                                   job->P, job->pplen, verifier) ==
+                SNMPERR_SUCCESS &&
+                memcmp(verifier, job->verifier, sizeof(verifier)) == 0;
+            memset(verifier, 0, sizeof(verifier));
+            if (job->matched)
+                continue;
+            /*
+             * the passphrase has changed, so its key is needed after all
+             */
+            job->derive = 1;
+        }
+        if (job->derive) {
+            job->kuLen = sizeof(job->Ku);
+            job->rval = _generate_Ku(job->hashtype, job->hashtype_len,
+                                     job->P, job->pplen, job->Ku,
+                                     &job->kuLen);
+        }
+        if (job->save)
+            job->new_rval = _keycache_verifier(job->auth_type,
+                                               job->new_salt,
+                                               job->new_rounds, job->P,
+                                               job->pplen,
+                                               job->new_verifier);
+    }
+    return NULL;
+}
+
+/*
+ * Localizes the master key of a job, and records it to be saved with the
+ * job's new verifier.  Call with the cache locked.
+ */
+static void
+_keycache_job_save(struct keycache_job *job)
+{
+    struct keycache_entry *ku;
+    struct keycache_saved *e;
+    u_char          Kul[KEYCACHE_KEY_MAX];
+    size_t          kulLen = sizeof(Kul);
+
+    ku = _keycache_find(job->auth_type, job->fp, NULL, 0, 0);
+    if (ku == NULL ||
+        generate_kul(job->hashtype, job->hashtype_len, job->engineID,
+                     job->engineIDLen, ku->key, ku->keyLen, Kul,
+                     &kulLen) != SNMPERR_SUCCESS)
+        return;
+    e = _keycache_saved_add(job->name, job->which, job->auth_type,
+                            job->engineID, job->engineIDLen,
+                            job->new_rounds, job->new_salt,
+                            job->new_verifier, Kul, kulLen);
+    if (e) {
+        memcpy(e->fp, job->fp, sizeof(e->fp));
+        e->checked = 1;
+        e->used = 1;
+    }
+    memset(Kul, 0, sizeof(Kul));
+}
+
+/**
+ * Queues a passphrase, so that netsnmp_keycache_prefetch_run() derives its
+ * master key together with all others.  If name is not NULL, the key
+ * localized to engineID is to be saved for that user: a saved key is then
+ * checked against the passphrase instead, and a new verifier is computed
+ * for a key that is not saved yet.
+ */
+void
+netsnmp_keycache_prefetch(const char *name, int which,
+                          const oid * hashtype, u_int hashtype_len,
+                          const u_char * engineID, size_t engineID_len,
+                          const u_char * P, size_t pplen)
+{
+    struct keycache_job *job;
+    int             auth_type;
+
+    auth_type = hashtype ? sc_get_authtype(hashtype, hashtype_len) :
+        SNMPERR_GENERR;
+    if (auth_type < 0 || P == NULL || pplen < USM_LENGTH_P_MIN)
+        return;
+    if (engineID == NULL || engineID_len == 0)
+        name = NULL;
+
+    if (keycache_njobs == keycache_maxjobs) {
+        int             maxjobs = keycache_maxjobs ? 2 * keycache_maxjobs : 64;
+
+        job = (struct keycache_job *)
+            realloc(keycache_jobs, maxjobs * sizeof(*job));
+        if (job == NULL)
+            return;
+        keycache_jobs = job;
+        keycache_maxjobs = maxjobs;
+    }
+    job = &keycache_jobs[keycache_njobs];
+    memset(job, 0, sizeof(*job));
+    job->hashtype = sc_get_auth_oid(auth_type, &job->hashtype_len);
+    job->P = netsnmp_memdup(P, pplen);
+    if (name) {
+        job->name = strdup(name);
+        job->engineID = netsnmp_memdup(engineID, engineID_len);
+        job->engineIDLen = engineID_len;
+    }
+    if (job->hashtype == NULL || job->P == NULL ||
+        (name && (!job->name || !job->engineID))) {
+        SNMP_FREE(job->P);
+        SNMP_FREE(job->name);
+        SNMP_FREE(job->engineID);
+        return;
+    }
+    job->which = which;
+    job->auth_type = auth_type;
+    job->pplen = pplen;
+    keycache_njobs++;
+}
+
+/**
+ * Derives the master keys of all queued passphrases that are neither in
+ * the key cache yet nor match a saved key, checks the saved keys and
+ * computes the verifiers of keys to be saved, using up to threads threads
+ * (0: one per processor).  The master keys are added to the cache; saved
+ * keys that don't match their passphrase are replaced.
+ *
+ * @return the number of keys derived.
+ */
+int
+netsnmp_keycache_prefetch_run(int threads)
+{
+    struct keycache_worker workers[KEYCACHE_MAX_THREADS];
+    struct keycache_job *job;
+    struct keycache_saved *e;
+    int             i, j, todo = 0, done = 0;
+
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    for (i = 0; i < keycache_njobs; i++) {
+        job = &keycache_jobs[i];
+        if (_keycache_fingerprint(job->auth_type, job->P, job->pplen,
+                                  job->fp) != SNMPERR_SUCCESS)
+            continue;
+        if (job->name) {
+            e = _keycache_saved_find(job->name, job->which, job->auth_type,
+                                     job->engineID, job->engineIDLen);
+            if (e && e->checked)
+                continue;       /* netsnmp_keycache_get_kul() will do */
+            if (e) {
+                job->check = 1;
+                job->rounds = e->rounds;
+                memcpy(job->salt, e->salt, sizeof(job->salt));
+                memcpy(job->verifier, e->verifier, sizeof(job->verifier));
+            }
+            job->save = _keycache_new_salt(job->auth_type, &job->new_rounds,
+                                           job->new_salt) ==
+                SNMPERR_SUCCESS;
+        }
+        if (!job->check &&
+            !_keycache_find(job->auth_type, job->fp, NULL, 0, 1)) {
+            for (j = 0; j < i; j++)
+                if (keycache_jobs[j].derive &&
+                    keycache_jobs[j].auth_type == job->auth_type &&
+                    memcmp(keycache_jobs[j].fp, job->fp,
+                           KEYCACHE_FP_LEN) == 0)
+                    break;
+            job->derive = j == i;
+        }
+        if (job->check || job->derive || job->save)
+            todo++;
+    }
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+
+    if (threads <= 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if (threads <= 0)
+            threads = 1;
+    }
+    if (threads > KEYCACHE_MAX_THREADS)
+        threads = KEYCACHE_MAX_THREADS;
+    if (threads > todo)
+        threads = todo;
+
+    DEBUGMSGTL(("keycache", "%d of %d passphrases to work on with %d "
+                "threads\n", todo, keycache_njobs, threads));
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE) && !defined(WIN32)
+    if (threads > 1) {
+        pthread_t       tid[KEYCACHE_MAX_THREADS];
+        sigset_t        all, old;
+        int             started;
+
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &old);
+        for (started = 0; started < threads; started++) {
+            workers[started].first = started;
+            workers[started].step = threads;
+            if (pthread_create(&tid[started], NULL, _keycache_worker,
+                               &workers[started]) != 0)
+                break;
+        }
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        for (i = 0; i < started; i++)
+            pthread_join(tid[i], NULL);
+        /*
+         * whatever did not get a thread is done here
+         */
+        for (i = started; i < threads; i++) {
+            workers[i].first = i;
+            workers[i].step = threads;
+            _keycache_worker(&workers[i]);
+        }
+    } else
+#endif
+    if (todo) {
+        workers[0].first = 0;
+        workers[0].step = 1;
+        _keycache_worker(&workers[0]);
+    }
+
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    for (i = 0; i < keycache_njobs; i++) {
+        job = &keycache_jobs[i];
+        if (job->derive && job->rval == SNMPERR_SUCCESS) {
+            _keycache_add(job->auth_type, job->fp, NULL, 0, job->Ku,
+                          job->kuLen);
+            done++;
+        }
+        e = job->check ?
+            _keycache_saved_find(job->name, job->which, job->auth_type,
+                                 job->engineID, job->engineIDLen) : NULL;
+        if (e && (e->checked || e->rounds != job->rounds ||
+                  memcmp(e->salt, job->salt, sizeof(e->salt)) != 0))
+            e = NULL;           /* not the one that was checked */
+        if (e && job->matched) {
+            memcpy(e->fp, job->fp, sizeof(e->fp));
+            e->checked = 1;
+        } else {
+            if (e)
+                _keycache_saved_drop(e);
+            if (job->save && !job->matched &&
+                job->new_rval == SNMPERR_SUCCESS)
+                _keycache_job_save(job);
+        }
+        memset(job->P, 0, job->pplen);
+        free(job->P);
+        SNMP_FREE(job->name);
+        SNMP_FREE(job->engineID);
+        memset(job, 0, sizeof(*job));
+    }
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+
+    SNMP_FREE(keycache_jobs);
+    keycache_njobs = keycache_maxjobs = 0;
+    return done;
+}
+
+/**
+ * Reads a line written by netsnmp_keycache_store():
+ *
+ *   token USER auth|priv AUTHTYPE ENGINEID ROUNDS SALT VERIFIER KUL
+ */
+void
+netsnmp_keycache_parse(const char *token, char *line)
+{
+    char            word[SNMP_MAXBUF_SMALL];
+    u_char          name[SNMP_MAXBUF_SMALL], engineID[SNMP_MAXBUF_SMALL];
+    u_char          salt[KEYCACHE_SALT_LEN + 1];
+    u_char          verifier[KEYCACHE_FP_LEN + 1];
+    u_char          key[KEYCACHE_KEY_MAX + 1], *cp;
+    size_t          nameLen, engineIDLen, saltLen, verifierLen, keyLen;
+    int             which, auth_type, rounds;
+
+    cp = name;
+    nameLen = sizeof(name) - 1;
+    line = read_config_read_octet_string(line, &cp, &nameLen);
+    if (line == NULL || nameLen == 0 || memchr(name, 0, nameLen)) {
+        config_perror("invalid key cache entry");
+        return;
+    }
+    name[nameLen] = '\0';
+
+    line = copy_nword(line, word, sizeof(word));
+    if (strcmp(word, "auth") == 0)
+        which = NETSNMP_KEYCACHE_AUTHKEY;
+    else if (strcmp(word, "priv") == 0)
+        which = NETSNMP_KEYCACHE_PRIVKEY;
+    else {
+        config_perror("invalid key cache entry");
+        return;
+    }
+    if (line)
+        line = copy_nword(line, word, sizeof(word));
+    auth_type = usm_lookup_auth_type(word);
+    if (auth_type < 0 || line == NULL) {
+        config_perror("invalid key cache entry");
+        return;
+    }
+    cp = engineID;
+    engineIDLen = sizeof(engineID);
+    line = read_config_read_octet_string(line, &cp, &engineIDLen);
+    rounds = 0;
+    if (line) {
+        line = copy_nword(line, word, sizeof(word));
+        rounds = atoi(word);
+    }
+    cp = salt;
+    saltLen = sizeof(salt);
+    if (line)
+        line = read_config_read_octet_string(line, &cp, &saltLen);
+    cp = verifier;
+    verifierLen = sizeof(verifier);
+    if (line)
+        line = read_config_read_octet_string(line, &cp, &verifierLen);
+    cp = key;
+    keyLen = sizeof(key);
+    if (line)
+        read_config_read_octet_string(line, &cp, &keyLen);
+    if (line == NULL || engineIDLen == 0 || keyLen == 0 ||
+        keyLen > KEYCACHE_KEY_MAX || saltLen != KEYCACHE_SALT_LEN ||
+        verifierLen != KEYCACHE_FP_LEN) {
+        config_perror("invalid key cache entry");
+        return;
+    }
+    /*
+     * keys whose verifier is quicker to compute than the key are no
+     * better than the passphrase in clear
+     */
+    if (_keycache_verifier_rounds(auth_type) <= 0 ||
+        rounds < _keycache_verifier_rounds(auth_type)) {
+        config_perror("key cache entry with too few verifier rounds");
+        return;
+    }
+
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    _keycache_saved_add((char *) name, which, auth_type, engineID,
+                        engineIDLen, rounds, salt, verifier, key, keyLen);
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    memset(key, 0, sizeof(key));
+}
+
+/**
+ * Saves the keys of users that were looked up or recorded since they were
+ * loaded to the persistent store of type.
+ */
+void
+netsnmp_keycache_store(const char *token, const char *type)
+{
+    struct keycache_saved *e;
+    char            line[SNMP_MAXBUF];
+    char           *cptr;
+    int             i;
+
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    for (i = 0; i < KEYCACHE_BUCKETS; i++) {
+        for (e = keycache_saved[i]; e; e = e->next) {
+            if (!e->used || e->engineIDLen >= SNMP_MAXBUF_SMALL ||
+                strlen(e->name) >= SNMP_MAXBUF_SMALL)
+                continue;
+            snprintf(line, sizeof(line), "%s ", token);
+            cptr = &line[strlen(line)];
+            cptr = read_config_save_octet_string(cptr, (u_char *) e->name,
+                                                 strlen(e->name));
+            snprintf(cptr, line + sizeof(line) - cptr, " %s %s ",
+                     e->which == NETSNMP_KEYCACHE_PRIVKEY ? "priv" : "auth",
+                     usm_lookup_auth_str(e->auth_type));
+            cptr += strlen(cptr);
+            cptr = read_config_save_octet_string(cptr, e->engineID,
+                                                 e->engineIDLen);
+            snprintf(cptr, line + sizeof(line) - cptr, " %d ", e->rounds);
+            cptr += strlen(cptr);
+            cptr = read_config_save_octet_string(cptr, e->salt,
+                                                 sizeof(e->salt));
+            *cptr++ = ' ';
+            cptr = read_config_save_octet_string(cptr, e->verifier,
+                                                 sizeof(e->verifier));
+            *cptr++ = ' ';
+            read_config_save_octet_string(cptr, e->key, e->keyLen);
+            read_config_store(type, line);
+        }
+    }
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_KEYCACHE);
+    memset(line, 0, sizeof(line));
+}
+
 /*******************************************************************-o-******
  * _kul_extend_blumenthal
  *
@@ -71,6 +71,7 @@ netsnmp_feature_child_of(usm_scapi, usm_support);
 #include <net-snmp/library/snmpusm.h>
 #include <net-snmp/library/keytools.h>
 #include <net-snmp/library/scapi.h>
+#include <net-snmp/library/mt_support.h>
 #include <net-snmp/library/mib.h>
 #include <net-snmp/library/transform_oids.h>
 
@@ -84,6 +85,10 @@ netsnmp_feature_child_of(usm_scapi, usm_support);
 #ifdef NETSNMP_USE_OPENSSL
 #include <openssl/hmac.h>
 #include <openssl/evp.h>
+#ifdef HAVE_EVP_MAC_CTX_DUP
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#endif
 #include <openssl/rand.h>
 #include <openssl/des.h>
 #ifdef HAVE_AES
@@ -691,7 +696,337 @@ sc_get_openssl_privfn(int priv_type)
 
     return fn;
 }
+
+/*
+ * Prepared HMAC and cipher contexts, by algorithm and localized key.
+ *
+ * Setting up an HMAC key costs two hash compressions and an AES key a
+ * key schedule, which USM would otherwise pay for every message.  The
+ * contexts are kept in small direct-mapped tables looked up by the key
+ * itself; a changed key just misses, and the context it evicts is freed
+ * along with its copy of the old key.  The tables are shared by all
+ * threads, so they are only looked at with MT_LIB_SCAPI held, and each
+ * caller is handed its own copy of the prepared context to work on.
+ */
+#define SC_CTX_CACHE_SIZE       256     /* a power of two */
+#define SC_CTX_CACHE_MAXKEY     64
+
+typedef struct sc_ctx_cache_s {
+    int             type;
+    u_int           keylen;     /* 0 if the slot isn't in use */
+    u_char          key[SC_CTX_CACHE_MAXKEY];
+    void           *ctx;
+} sc_ctx_cache;
+
+#if defined(HAVE_EVP_MAC_CTX_DUP)
+#define SC_HMAC_CACHE 1
+typedef EVP_MAC_CTX sc_hmac_ctx;
+static EVP_MAC *sc_hmac_mac;
+#elif defined(HAVE_HMAC_CTX_NEW)
+#define SC_HMAC_CACHE 1
+typedef HMAC_CTX sc_hmac_ctx;
+#endif
+
+#ifdef SC_HMAC_CACHE
+static sc_ctx_cache sc_hmac_cache[SC_CTX_CACHE_SIZE];
+#endif
+#ifdef HAVE_AES
+static sc_ctx_cache sc_cipher_cache[SC_CTX_CACHE_SIZE];
+#endif
+
+/*
+ * returns the slot for type and key, and whether it already holds them
+ */
+static sc_ctx_cache *
+_sc_ctx_cache_slot(sc_ctx_cache *cache, int type, const u_char *key,
+                   u_int keylen, int *hit)
+{
+    sc_ctx_cache   *e;
+    u_int           h = 2166136261U ^ (u_int)type, i;
+
+    for (i = 0; i < keylen; i++) {
+        h ^= key[i];
+        h *= 16777619U;
+    }
+    e = &cache[h & (SC_CTX_CACHE_SIZE - 1)];
+    *hit = e->keylen == keylen && e->type == type &&
+        memcmp(e->key, key, keylen) == 0;
+    return e;
+}
+
+static void
+_sc_ctx_cache_set(sc_ctx_cache *e, int type, const u_char *key,
+                  u_int keylen)
+{
+    e->type = type;
+    e->keylen = keylen;
+    memcpy(e->key, key, keylen);
+}
+
+/*
+ * frees a slot's context and wipes its key
+ */
+static void
+_sc_ctx_cache_clear(sc_ctx_cache *e, void (*free_ctx)(void *))
+{
+    if (e->ctx)
+        free_ctx(e->ctx);
+    memset(e, 0, sizeof(*e));
+}
+
+/*
+ * clears the slots prepared from key; the cipher tables hold only as
+ * much of the key as the cipher uses
+ */
+static void
+_sc_ctx_cache_forget(sc_ctx_cache *cache, void (*free_ctx)(void *),
+                     const u_char *key, u_int keylen)
+{
+    int             i;
+
+    for (i = 0; i < SC_CTX_CACHE_SIZE; i++) {
+        if (cache[i].keylen && cache[i].keylen <= keylen &&
+            memcmp(cache[i].key, key, cache[i].keylen) == 0)
+            _sc_ctx_cache_clear(&cache[i], free_ctx);
+    }
+}
+
+static void
+_sc_ctx_cache_free(sc_ctx_cache *cache, void (*free_ctx)(void *))
+{
+    int             i;
+
+    for (i = 0; i < SC_CTX_CACHE_SIZE; i++)
+        _sc_ctx_cache_clear(&cache[i], free_ctx);
+}
+
+#ifdef SC_HMAC_CACHE
+#ifdef HAVE_EVP_MAC_CTX_DUP
+static sc_hmac_ctx *
+_sc_hmac_ctx_new(const EVP_MD *hashfn, const u_char *key, u_int keylen)
+{
+    EVP_MAC_CTX    *ctx;
+    OSSL_PARAM      params[2];
+    char            digest[32];
+
+    if (!sc_hmac_mac && (sc_hmac_mac = EVP_MAC_fetch(NULL, "HMAC",
+                                                     NULL)) == NULL)
+        return NULL;
+    if ((ctx = EVP_MAC_CTX_new(sc_hmac_mac)) == NULL)
+        return NULL;
+    strlcpy(digest, EVP_MD_get0_name(hashfn), sizeof(digest));
+    params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+                                                 digest, 0);
+    params[1] = OSSL_PARAM_construct_end();
+    if (!EVP_MAC_init(ctx, key, keylen, params)) {
+        EVP_MAC_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+static sc_hmac_ctx *
+_sc_hmac_ctx_dup(sc_hmac_ctx *ctx)
+{
+    return EVP_MAC_CTX_dup(ctx);
+}
+
+static int
+_sc_hmac_ctx_final(sc_hmac_ctx *ctx, const u_char *message, u_int msglen,
+                   u_char *buf, unsigned int *buf_len)
+{
+    size_t          len;
+
+    if (!EVP_MAC_update(ctx, message, msglen) ||
+        !EVP_MAC_final(ctx, buf, &len, *buf_len))
+        return 0;
+    *buf_len = len;
+    return 1;
+}
+
+static void
+_sc_free_hmac_ctx(void *ctx)
+{
+    EVP_MAC_CTX_free(ctx);
+}
+#else /* HAVE_HMAC_CTX_NEW */
+static sc_hmac_ctx *
+_sc_hmac_ctx_new(const EVP_MD *hashfn, const u_char *key, u_int keylen)
+{
+    HMAC_CTX       *ctx;
+
+    if ((ctx = HMAC_CTX_new()) == NULL)
+        return NULL;
+    if (!HMAC_Init_ex(ctx, key, keylen, hashfn, NULL)) {
+        HMAC_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+static sc_hmac_ctx *
+_sc_hmac_ctx_dup(sc_hmac_ctx *ctx)
+{
+    HMAC_CTX       *copy;
+
+    if ((copy = HMAC_CTX_new()) == NULL)
+        return NULL;
+    if (!HMAC_CTX_copy(copy, ctx)) {
+        HMAC_CTX_free(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+static int
+_sc_hmac_ctx_final(sc_hmac_ctx *ctx, const u_char *message, u_int msglen,
+                   u_char *buf, unsigned int *buf_len)
+{
+    return HMAC_Update(ctx, message, msglen) &&
+        HMAC_Final(ctx, buf, buf_len);
+}
+
+static void
+_sc_free_hmac_ctx(void *ctx)
+{
+    HMAC_CTX_free(ctx);
+}
+#endif /* HAVE_EVP_MAC_CTX_DUP */
+
+/*
+ * returns a copy of the HMAC context prepared for key, to be freed by the
+ * caller, or NULL to do without
+ */
+static sc_hmac_ctx *
+_sc_get_hmac_ctx(int auth_type, const EVP_MD *hashfn, const u_char *key,
+                 u_int keylen)
+{
+    sc_ctx_cache   *e;
+    sc_hmac_ctx    *ctx = NULL;
+    int             hit;
+
+    if (keylen > SC_CTX_CACHE_MAXKEY)
+        return NULL;
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_SCAPI);
+    e = _sc_ctx_cache_slot(sc_hmac_cache, auth_type, key, keylen, &hit);
+    if (!hit) {
+        _sc_ctx_cache_clear(e, _sc_free_hmac_ctx);
+        e->ctx = _sc_hmac_ctx_new(hashfn, key, keylen);
+        if (e->ctx)
+            _sc_ctx_cache_set(e, auth_type, key, keylen);
+    }
+    if (e->ctx)
+        ctx = _sc_hmac_ctx_dup(e->ctx);
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SCAPI);
+    return ctx;
+}
+#endif /* SC_HMAC_CACHE */
+
+#ifdef HAVE_AES
+static void
+_sc_free_cipher_ctx(void *ctx)
+{
+    EVP_CIPHER_CTX_free(ctx);
+}
+
+/*
+ * returns a cipher context set up for key and iv, to be freed by the
+ * caller, or NULL on error
+ */
+static EVP_CIPHER_CTX *
+_sc_get_cipher_ctx(int priv_type, const EVP_CIPHER *cipher, int enc,
+                   const u_char *key, const u_char *iv)
+{
+    sc_ctx_cache   *e;
+    EVP_CIPHER_CTX *ctx = NULL;
+    u_int           keylen = EVP_CIPHER_key_length(cipher);
+    int             hit, type = (priv_type << 1) | (enc ? 1 : 0);
+
+    if (keylen > SC_CTX_CACHE_MAXKEY)
+        return NULL;
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_SCAPI);
+    e = _sc_ctx_cache_slot(sc_cipher_cache, type, key, keylen, &hit);
+    if (!hit) {
+        _sc_ctx_cache_clear(e, _sc_free_cipher_ctx);
+        e->ctx = EVP_CIPHER_CTX_new();
+        if (e->ctx &&
+            EVP_CipherInit_ex(e->ctx, cipher, NULL, key, NULL, enc) != 1) {
+            EVP_CIPHER_CTX_free(e->ctx);
+            e->ctx = NULL;
+        }
+        if (e->ctx)
+            _sc_ctx_cache_set(e, type, key, keylen);
+    }
+    if (e->ctx && (ctx = EVP_CIPHER_CTX_new()) != NULL &&
+        EVP_CIPHER_CTX_copy(ctx, e->ctx) != 1) {
+        EVP_CIPHER_CTX_free(ctx);
+        ctx = NULL;
+    }
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SCAPI);
+
+    if (ctx && EVP_CipherInit_ex(ctx, NULL, NULL, NULL, iv, enc) != 1) {
+        EVP_CIPHER_CTX_free(ctx);
+        ctx = NULL;
+    }
+    return ctx;
+}
+#endif /* HAVE_AES */
+#endif /* openssl */
+
+/*******************************************************************-o-******
+ * sc_shutdown
+ *
+ * Returns:
+ *	SNMPERR_SUCCESS			Success.
+ *
+ * Frees the prepared HMAC and cipher contexts, and the keys kept with them.
+ */
+int
+sc_shutdown(int majorID, int minorID, void *serverarg, void *clientarg)
+{
+#ifdef NETSNMP_USE_OPENSSL
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_SCAPI);
+#ifdef SC_HMAC_CACHE
+    _sc_ctx_cache_free(sc_hmac_cache, _sc_free_hmac_ctx);
+#endif
+#ifdef HAVE_EVP_MAC_CTX_DUP
+    EVP_MAC_free(sc_hmac_mac);
+    sc_hmac_mac = NULL;
+#endif
+#ifdef HAVE_AES
+    _sc_ctx_cache_free(sc_cipher_cache, _sc_free_cipher_ctx);
+#endif
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SCAPI);
+#endif /* openssl */
+    return SNMPERR_SUCCESS;
+}
+
+/*******************************************************************-o-******
+ * sc_forget_key
+ *
+ * Parameters:
+ *	*key		Localized key that is no longer used.
+ *	 keylen		Length of key in bytes.
+ *
+ * Frees the HMAC and cipher contexts prepared from key, and the copies of
+ * the key kept with them.  Call it before freeing a user's key.
+ */
+void
+sc_forget_key(const u_char * key, size_t keylen)
+{
+#ifdef NETSNMP_USE_OPENSSL
+    if (!key || !keylen)
+        return;
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_SCAPI);
+#ifdef SC_HMAC_CACHE
+    _sc_ctx_cache_forget(sc_hmac_cache, _sc_free_hmac_ctx, key, keylen);
+#endif
+#ifdef HAVE_AES
+    _sc_ctx_cache_forget(sc_cipher_cache, _sc_free_cipher_ctx, key, keylen);
+#endif
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SCAPI);
 #endif /* openssl */
+}
 
 
 /*******************************************************************-o-******
@@ -737,6 +1072,9 @@ sc_generate_keyed_hash(const oid * authtypeOID, size_t authtypeOIDlen,
 #endif
 #ifdef NETSNMP_USE_OPENSSL
     const EVP_MD   *hashfn;
+#ifdef SC_HMAC_CACHE
+    sc_hmac_ctx    *hctx;
+#endif
 #elif defined(NETSNMP_USE_PKCS11)
     u_long          ck_type;
 #endif
@@ -781,6 +1119,18 @@ sc_generate_keyed_hash(const oid * authtypeOID, size_t authtypeOIDlen,
         QUITFUN(SNMPERR_GENERR, sc_generate_keyed_hash_quit);
     }
 
+#ifdef SC_HMAC_CACHE
+    hctx = _sc_get_hmac_ctx(auth_type, hashfn, key, keylen);
+    if (hctx) {
+        int             ok;
+
+        ok = _sc_hmac_ctx_final(hctx, message, msglen, buf, &buf_len);
+        _sc_free_hmac_ctx(hctx);
+        if (!ok) {
+            QUITFUN(SNMPERR_GENERR, sc_generate_keyed_hash_quit);
+        }
+    } else
+#endif
     HMAC(hashfn, key, keylen, message, msglen, buf, &buf_len);
     if (buf_len != properlength) {
         QUITFUN(rval, sc_generate_keyed_hash_quit);
@@ -1318,34 +1668,26 @@ sc_encrypt(const oid * privtype, size_t privtypelen,
         /*
          * encrypt the data 
          */
-        ctx = EVP_CIPHER_CTX_new();
+        ctx = _sc_get_cipher_ctx(pai->type, cipher, 1, key, my_iv);
         if (!ctx) {
-            DEBUGMSGTL(("scapi:encrypt", "openssl error: ctx_new\n"));
-            QUITFUN(SNMPERR_GENERR, sc_encrypt_quit);
-        }
-        rc = EVP_EncryptInit(ctx, cipher, key, my_iv);
-        if (rc != 1) {
             DEBUGMSGTL(("scapi:encrypt", "openssl error: init\n"));
-            EVP_CIPHER_CTX_free(ctx);
             QUITFUN(SNMPERR_GENERR, sc_encrypt_quit);
         }
         rc = EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, ptlen);
         if (rc != 1) {
             DEBUGMSGTL(("scapi:encrypt", "openssl error: update\n"));
-            EVP_CIPHER_CTX_free(ctx);
-            QUITFUN(SNMPERR_GENERR, sc_encrypt_quit);
+        } else {
+            enclen = len;
+            rc = EVP_EncryptFinal_ex(ctx, ciphertext + len, &len);
+            if (rc != 1)
+                DEBUGMSGTL(("scapi:encrypt", "openssl error: final\n"));
         }
-        enclen = len;
-        rc = EVP_EncryptFinal(ctx, ciphertext + len, &len);
+        EVP_CIPHER_CTX_free(ctx);
         if (rc != 1) {
-            DEBUGMSGTL(("scapi:encrypt", "openssl error: final\n"));
-            EVP_CIPHER_CTX_free(ctx);
             QUITFUN(SNMPERR_GENERR, sc_encrypt_quit);
         }
         enclen += len;
         ptlen = enclen;
-        /* Clean up */
-        EVP_CIPHER_CTX_free(ctx);
         *ctlen = ptlen;
     }
 #endif
@@ -1540,27 +1882,17 @@ sc_decrypt(const oid * privtype, size_t privtypelen,
         /*
          * decrypt the data
          */
-        ctx = EVP_CIPHER_CTX_new();
+        ctx = _sc_get_cipher_ctx(pai->type, cipher, 0, key, my_iv);
         if (!ctx) {
             QUITFUN(SNMPERR_GENERR, sc_decrypt_quit);
         }
-        rc = EVP_DecryptInit(ctx, cipher, key, my_iv);
-        if (rc != 1) {
-            EVP_CIPHER_CTX_free(ctx);
-            QUITFUN(SNMPERR_GENERR, sc_decrypt_quit);
-        }
         rc = EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ctlen);
+        if (rc == 1)
+            rc = EVP_DecryptFinal_ex(ctx, plaintext + len, &len);
+        EVP_CIPHER_CTX_free(ctx);
         if (rc != 1) {
-            EVP_CIPHER_CTX_free(ctx);
-            QUITFUN(SNMPERR_GENERR, sc_decrypt_quit);
-        }
-        rc = EVP_DecryptFinal(ctx, plaintext + len, &len);
-        if (rc != 1) {
-            EVP_CIPHER_CTX_free(ctx);
             QUITFUN(SNMPERR_GENERR, sc_decrypt_quit);
         }
-        /* Clean up */
-        EVP_CIPHER_CTX_free(ctx);
         *ptlen = ctlen;
     }
 #endif
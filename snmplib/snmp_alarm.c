@@ -53,10 +53,127 @@
 #include <net-snmp/library/callback.h>
 #include <net-snmp/library/snmp_alarm.h>
 
-static struct snmp_alarm *thealarms = NULL;
+/*
+ * The alarms are kept in a binary min-heap ordered by the time they fire
+ * next, so that finding the next alarm is O(1) and adding, rescheduling
+ * or removing one is O(log n).  An alarm being run by run_alarms() is
+ * taken out of the heap until it has been rescheduled.  Alarms are also
+ * kept in a hash table by clientreg, chained through their next field,
+ * for sa_find_specific() and snmp_alarm_unregister().
+ */
+static struct snmp_alarm **sa_heap = NULL;
+static size_t   sa_heap_len = 0, sa_heap_max = 0;
+static struct snmp_alarm **sa_hash = NULL;
+static size_t   sa_hash_size = 0, sa_count = 0;
 static int      start_alarms = 0;
 static unsigned int regnum = 1;
 
+#define SA_NOT_IN_HEAP ((size_t)-1)
+#define SA_HASH(clientreg) ((clientreg) & (sa_hash_size - 1))
+
+/*
+ * Alarms due at the same time fire in the order they were registered.
+ */
+static int
+sa_before(const struct snmp_alarm *a, const struct snmp_alarm *b)
+{
+    if (timercmp(&a->t_nextM, &b->t_nextM, !=))
+        return timercmp(&a->t_nextM, &b->t_nextM, <);
+    return a->clientreg < b->clientreg;
+}
+
+static void
+sa_heap_set(size_t pos, struct snmp_alarm *a)
+{
+    sa_heap[pos] = a;
+    a->heap_pos = pos;
+}
+
+static void
+sa_heap_sift(size_t pos)
+{
+    struct snmp_alarm *a = sa_heap[pos];
+    size_t          child;
+
+    while (pos > 0 && sa_before(a, sa_heap[(pos - 1) / 2])) {
+        sa_heap_set(pos, sa_heap[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    for (;;) {
+        child = 2 * pos + 1;
+        if (child >= sa_heap_len)
+            break;
+        if (child + 1 < sa_heap_len &&
+            sa_before(sa_heap[child + 1], sa_heap[child]))
+            ++child;
+        if (!sa_before(sa_heap[child], a))
+            break;
+        sa_heap_set(pos, sa_heap[child]);
+        pos = child;
+    }
+    sa_heap_set(pos, a);
+}
+
+static int
+sa_heap_insert(struct snmp_alarm *a)
+{
+    if (sa_heap_len == sa_heap_max) {
+        size_t          max = sa_heap_max ? 2 * sa_heap_max : 64;
+        struct snmp_alarm **heap = (struct snmp_alarm **)
+            realloc(sa_heap, max * sizeof(*heap));
+
+        if (heap == NULL)
+            return -1;
+        sa_heap = heap;
+        sa_heap_max = max;
+    }
+    sa_heap_set(sa_heap_len++, a);
+    sa_heap_sift(a->heap_pos);
+    return 0;
+}
+
+static void
+sa_heap_remove(struct snmp_alarm *a)
+{
+    size_t          pos = a->heap_pos;
+
+    if (pos == SA_NOT_IN_HEAP)
+        return;
+    a->heap_pos = SA_NOT_IN_HEAP;
+    if (pos != --sa_heap_len) {
+        sa_heap_set(pos, sa_heap[sa_heap_len]);
+        sa_heap_sift(pos);
+    }
+}
+
+static int
+sa_hash_insert(struct snmp_alarm *a)
+{
+    struct snmp_alarm **hash, *b, *next;
+    size_t          size, i;
+
+    if (sa_count >= sa_hash_size) {
+        size = sa_hash_size ? 2 * sa_hash_size : 64;
+        hash = (struct snmp_alarm **) calloc(size, sizeof(*hash));
+        if (hash == NULL)
+            return -1;
+        for (i = 0; i < sa_hash_size; i++) {
+            for (b = sa_hash[i]; b; b = next) {
+                next = b->next;
+                b->next = hash[b->clientreg & (size - 1)];
+                hash[b->clientreg & (size - 1)] = b;
+            }
+        }
+        free(sa_hash);
+        sa_hash = hash;
+        sa_hash_size = size;
+    }
+    a->next = sa_hash[SA_HASH(a->clientreg)];
+    sa_hash[SA_HASH(a->clientreg)] = a;
+    sa_count++;
+    return 0;
+}
+
 int
 init_alarm_post_config(int majorid, int minorid, void *serverarg,
                        void *clientarg)
@@ -121,16 +238,19 @@ sa_update_entry(struct snmp_alarm *a)
 void
 snmp_alarm_unregister(unsigned int clientreg)
 {
-    struct snmp_alarm *sa_ptr, **prevNext = &thealarms;
+    struct snmp_alarm *sa_ptr = NULL, **prevNext = NULL;
 
-    for (sa_ptr = thealarms;
-         sa_ptr != NULL && sa_ptr->clientreg != clientreg;
-         sa_ptr = sa_ptr->next) {
-        prevNext = &(sa_ptr->next);
+    if (sa_hash_size) {
+        for (prevNext = &sa_hash[SA_HASH(clientreg)];
+             (sa_ptr = *prevNext) != NULL && sa_ptr->clientreg != clientreg;
+             prevNext = &(sa_ptr->next))
+            ;
     }
 
     if (sa_ptr != NULL) {
         *prevNext = sa_ptr->next;
+        sa_count--;
+        sa_heap_remove(sa_ptr);
         DEBUGMSGTL(("snmp_alarm", "unregistered alarm %d\n", 
 		    sa_ptr->clientreg));
         /*
@@ -155,26 +275,25 @@ void
 snmp_alarm_unregister_all(void)
 {
   struct snmp_alarm *sa_ptr, *sa_tmp;
+  size_t i;
 
-  for (sa_ptr = thealarms; sa_ptr != NULL; sa_ptr = sa_tmp) {
-    sa_tmp = sa_ptr->next;
-    free(sa_ptr);
+  for (i = 0; i < sa_hash_size; i++) {
+    for (sa_ptr = sa_hash[i]; sa_ptr != NULL; sa_ptr = sa_tmp) {
+      sa_tmp = sa_ptr->next;
+      free(sa_ptr);
+    }
   }
   DEBUGMSGTL(("snmp_alarm", "ALL alarms unregistered\n"));
-  thealarms = NULL;
+  SNMP_FREE(sa_hash);
+  SNMP_FREE(sa_heap);
+  sa_hash_size = sa_count = 0;
+  sa_heap_len = sa_heap_max = 0;
 }  
 
 struct snmp_alarm *
 sa_find_next(void)
 {
-    struct snmp_alarm *a, *lowest = NULL;
-
-    for (a = thealarms; a != NULL; a = a->next)
-        if (!(a->flags & SA_FIRED)
-            && (lowest == NULL || timercmp(&a->t_nextM, &lowest->t_nextM, <)))
-            lowest = a;
-
-    return lowest;
+    return sa_heap_len ? sa_heap[0] : NULL;
 }
 
 NETSNMP_IMPORT struct snmp_alarm *sa_find_specific(unsigned int clientreg);
@@ -182,7 +301,11 @@ struct snmp_alarm *
 sa_find_specific(unsigned int clientreg)
 {
     struct snmp_alarm *sa_ptr;
-    for (sa_ptr = thealarms; sa_ptr != NULL; sa_ptr = sa_ptr->next) {
+
+    if (!sa_hash_size)
+        return NULL;
+    for (sa_ptr = sa_hash[SA_HASH(clientreg)]; sa_ptr != NULL;
+         sa_ptr = sa_ptr->next) {
         if (sa_ptr->clientreg == clientreg) {
             return sa_ptr;
         }
@@ -210,6 +333,7 @@ run_alarms(void)
 
         clientreg = a->clientreg;
         a->flags |= SA_FIRED;
+        sa_heap_remove(a);
         DEBUGMSGTL(("snmp_alarm", "run alarm %d\n", clientreg));
         (*(a->thecallback)) (clientreg, a->clientarg);
         DEBUGMSGTL(("snmp_alarm", "alarm %d completed\n", clientreg));
@@ -220,6 +344,16 @@ run_alarms(void)
             timerclear(&a->t_nextM);
             a->flags &= ~SA_FIRED;
             sa_update_entry(a);
+            /*
+             * put it back in the heap, unless it was a single shot alarm
+             * (removed by sa_update_entry)
+             */
+            a = sa_find_specific(clientreg);
+            if (a && sa_heap_insert(a) != 0) {
+                snmp_log(LOG_ERR, "could not reschedule alarm %d\n",
+                         clientreg);
+                snmp_alarm_unregister(clientreg);
+            }
         } else {
             DEBUGMSGTL(("snmp_alarm", "alarm %d deleted itself\n",
                         clientreg));
@@ -417,34 +551,41 @@ unsigned int
 snmp_alarm_register_hr(struct timeval t, unsigned int flags,
                        SNMPAlarmCallback * cb, void *cd)
 {
-    struct snmp_alarm **s = NULL;
-
-    for (s = &(thealarms); *s != NULL; s = &((*s)->next));
+    struct snmp_alarm *s;
 
-    *s = SNMP_MALLOC_STRUCT(snmp_alarm);
-    if (*s == NULL) {
+    s = SNMP_MALLOC_STRUCT(snmp_alarm);
+    if (s == NULL) {
         return 0;
     }
 
-    (*s)->t = t;
-    (*s)->flags = flags;
-    (*s)->clientarg = cd;
-    (*s)->thecallback = cb;
-    (*s)->clientreg = regnum++;
-    (*s)->next = NULL;
+    s->t = t;
+    s->flags = flags;
+    s->clientarg = cd;
+    s->thecallback = cb;
+    s->clientreg = regnum++;
+    s->heap_pos = SA_NOT_IN_HEAP;
 
-    sa_update_entry(*s);
+    sa_update_entry(s);
+
+    if (sa_hash_insert(s) != 0) {
+        free(s);
+        return 0;
+    }
+    if (sa_heap_insert(s) != 0) {
+        snmp_alarm_unregister(s->clientreg);
+        return 0;
+    }
 
     DEBUGMSGTL(("snmp_alarm",
                 "registered alarm %d, t = %ld.%03ld, flags=0x%02x\n",
-                (*s)->clientreg, (long) (*s)->t.tv_sec, (long)((*s)->t.tv_usec / 1000),
-                (*s)->flags));
+                s->clientreg, (long) s->t.tv_sec, (long)(s->t.tv_usec / 1000),
+                s->flags));
 
     if (start_alarms) {
         set_an_alarm();
     }
 
-    return (*s)->clientreg;
+    return s->clientreg;
 }
 
 /**
@@ -471,6 +612,8 @@ snmp_alarm_reset(unsigned int clientreg)
         a->t_nextM.tv_sec = 0;
         a->t_nextM.tv_usec = 0;
         NETSNMP_TIMERADD(&t_now, &a->t, &a->t_nextM);
+        if (a->heap_pos != SA_NOT_IN_HEAP)
+            sa_heap_sift(a->heap_pos);
         return 0;
     }
     DEBUGMSGTL(("snmp_alarm_reset", "alarm %d not found\n",
@@ -124,6 +124,7 @@ SOFTWARE.
 #include <net-snmp/library/container.h>
 #include <net-snmp/library/snmp_secmod.h>
 #include <net-snmp/library/large_fd_set.h>
+#include <net-snmp/library/fd_event_manager.h>
 #ifdef NETSNMP_SECMOD_USM
 #include <net-snmp/library/snmpusm.h>
 #endif
@@ -215,6 +216,16 @@ struct snmp_internal_session {
     size_t        obuf_size;    /* size of buffer for packet data */
     u_char       *opacket;      /* send packet data (within obuf) */
     size_t        opacket_len;  /* length of data */
+
+    u_char       *rbatch;       /* receive buffers for batched reads */
+    int           rbatch_count; /* number of buffers in rbatch */
+    int          *rbatch_alive; /* cleared if closed during a batch */
+
+    /* see snmp_read_fd() and snmp_select_timeout() */
+    int           listed;       /* in Sessions */
+    int           index_fd;     /* its slot in session_by_fd */
+    int           pending;      /* in sessions_pending */
+    struct session_list *next_pending;
 };
 
 /*
@@ -325,6 +336,17 @@ static long     Msgid = 0;      /* MT_LIB_MESSAGEID */
 static long     Sessid = 0;     /* MT_LIB_SESSIONID */
 static long     Transid = 0;    /* MT_LIB_TRANSID */
 int             snmp_errno = 0;
+
+/*
+ * So that event loops which know the ready descriptors don't have to walk
+ * all Sessions on every wakeup: the sessions by socket, and the ones with
+ * requests outstanding.  MT_LIB_SESSION
+ */
+static struct session_list **session_by_fd;
+static int      session_by_fd_len;
+static struct session_list *sessions_pending;
+static int      sessions_reap;          /* a read failed: look for closed */
+static time_t   sessions_reaped;        /* last look for closed sessions */
 /*
  * END MTCRITICAL_RESOURCE
  */
@@ -658,6 +680,224 @@ void netsnmp_srandom(unsigned int seed)
 #endif
 }
 
+/*
+ * PDU and varbind free lists.
+ *
+ * Every request allocates a PDU and one varbind per variable binding, and
+ * frees them again when it is done.  Freed PDUs and varbinds (including
+ * the inline buf[] value storage of a varbind) are kept on bounded free
+ * lists and handed out again by the next allocation.  The objects are still
+ * allocated one by one with malloc(), so code that allocates or frees them
+ * directly keeps working, and an object may be freed by another thread
+ * than the one that allocated it.  Each thread has free lists of its own,
+ * so no locking is needed; they are created by the first allocation after
+ * init_snmp() and freed when the thread exits.  Without thread support
+ * there is a single set of free lists.
+ */
+
+#define PDU_POOL_PDU_MAX        64
+#define PDU_POOL_VAR_MAX        1024
+
+#ifndef NETSNMP_NO_PDU_POOL
+typedef struct pdu_pool_s {
+    netsnmp_pdu_pool_stats stats;
+    netsnmp_pdu    *pdus[PDU_POOL_PDU_MAX];
+    netsnmp_variable_list *vars[PDU_POOL_VAR_MAX];
+} pdu_pool;
+
+static void
+_pdu_pool_empty(pdu_pool *pool)
+{
+    while (pool->stats.pdu_cached > 0)
+        free(pool->pdus[--pool->stats.pdu_cached]);
+    while (pool->stats.var_cached > 0)
+        free(pool->vars[--pool->stats.var_cached]);
+}
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE) && !defined(WIN32)
+#include <pthread.h>
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static pthread_key_t pool_key;
+static int      pool_key_ok;
+
+static void
+_pdu_pool_destroy(void *arg)
+{
+    _pdu_pool_empty(arg);
+    free(arg);
+}
+
+static void
+_pdu_pool_key_create(void)
+{
+    pool_key_ok = pthread_key_create(&pool_key, _pdu_pool_destroy) == 0;
+}
+
+static void
+_pdu_pool_init(void)
+{
+    pthread_once(&pool_once, _pdu_pool_key_create);
+}
+
+/*
+ * Returns the free lists of the calling thread, creating them if create is
+ * set.  Threads that only free objects don't get free lists of their own,
+ * which also keeps a key destructor that frees PDUs from creating them anew.
+ */
+static pdu_pool *
+_pdu_pool_get(int create)
+{
+    pdu_pool       *pool;
+
+    if (!pool_key_ok)
+        return NULL;
+    pool = pthread_getspecific(pool_key);
+    if (pool == NULL && create) {
+        pool = calloc(1, sizeof(*pool));
+        if (pool && pthread_setspecific(pool_key, pool) != 0) {
+            free(pool);
+            pool = NULL;
+        }
+    }
+    return pool;
+}
+#else
+static pdu_pool the_pool;
+static int      pool_inited;
+
+static void
+_pdu_pool_init(void)
+{
+    pool_inited = 1;
+}
+
+#define _pdu_pool_get(create) (pool_inited ? &the_pool : NULL)
+#endif
+#else /* NETSNMP_NO_PDU_POOL */
+#define _pdu_pool_init()
+#endif /* NETSNMP_NO_PDU_POOL */
+
+/**
+ * Allocates a zeroed PDU, reusing a freed one if possible.  The result
+ * must be released with snmp_free_pdu().
+ */
+netsnmp_pdu    *
+netsnmp_pdu_alloc(void)
+{
+#ifndef NETSNMP_NO_PDU_POOL
+    pdu_pool       *pool = _pdu_pool_get(1);
+
+    if (pool) {
+        pool->stats.pdu_allocs++;
+        if (pool->stats.pdu_cached > 0) {
+            netsnmp_pdu    *pdu = pool->pdus[--pool->stats.pdu_cached];
+            memset(pdu, 0, sizeof(*pdu));
+            pool->stats.pdu_hits++;
+            return pdu;
+        }
+    }
+#endif
+    return (netsnmp_pdu *) calloc(1, sizeof(netsnmp_pdu));
+}
+
+/**
+ * Allocates a zeroed varbind, reusing a freed one if possible.  The result
+ * must be released with snmp_free_var() or snmp_free_varbind().
+ */
+netsnmp_variable_list *
+netsnmp_varbind_alloc(void)
+{
+#ifndef NETSNMP_NO_PDU_POOL
+    pdu_pool       *pool = _pdu_pool_get(1);
+
+    if (pool) {
+        pool->stats.var_allocs++;
+        if (pool->stats.var_cached > 0) {
+            netsnmp_variable_list *var = pool->vars[--pool->stats.var_cached];
+            memset(var, 0, sizeof(*var));
+            pool->stats.var_hits++;
+            return var;
+        }
+    }
+#endif
+    return (netsnmp_variable_list *) calloc(1, sizeof(netsnmp_variable_list));
+}
+
+static void
+_pdu_pool_free_pdu(netsnmp_pdu *pdu)
+{
+#ifndef NETSNMP_NO_PDU_POOL
+    pdu_pool       *pool = _pdu_pool_get(0);
+
+    if (pool) {
+        pool->stats.pdu_frees++;
+        if (pool->stats.pdu_cached < PDU_POOL_PDU_MAX) {
+            pool->pdus[pool->stats.pdu_cached++] = pdu;
+            return;
+        }
+    }
+#endif
+    free(pdu);
+}
+
+static void
+_pdu_pool_free_var(netsnmp_variable_list *var)
+{
+#ifndef NETSNMP_NO_PDU_POOL
+    pdu_pool       *pool = _pdu_pool_get(0);
+
+    if (pool) {
+        pool->stats.var_frees++;
+        if (pool->stats.var_cached < PDU_POOL_VAR_MAX) {
+            pool->vars[pool->stats.var_cached++] = var;
+            return;
+        }
+    }
+#endif
+    free(var);
+}
+
+/**
+ * Copies the PDU and varbind allocation counters of the calling thread's
+ * free lists into stats (all zero if it has none).
+ */
+void
+netsnmp_pdu_pool_get_stats(netsnmp_pdu_pool_stats *stats)
+{
+#ifndef NETSNMP_NO_PDU_POOL
+    pdu_pool       *pool = _pdu_pool_get(0);
+#endif
+
+    if (!stats)
+        return;
+    memset(stats, 0, sizeof(*stats));
+#ifndef NETSNMP_NO_PDU_POOL
+    if (pool)
+        *stats = pool->stats;
+#endif
+}
+
+/**
+ * Frees everything held on the calling thread's PDU and varbind free lists.
+ */
+void
+netsnmp_pdu_pool_clear(void)
+{
+#ifndef NETSNMP_NO_PDU_POOL
+    pdu_pool       *pool = _pdu_pool_get(0);
+
+    if (pool == NULL)
+        return;
+    DEBUGMSGTL(("pdu_pool",
+                "pdus: %lu allocs, %lu reused, %lu frees; "
+                "varbinds: %lu allocs, %lu reused, %lu frees\n",
+                pool->stats.pdu_allocs, pool->stats.pdu_hits,
+                pool->stats.pdu_frees, pool->stats.var_allocs,
+                pool->stats.var_hits, pool->stats.var_frees));
+    _pdu_pool_empty(pool);
+#endif
+}
+
 /*
  * Primordial SNMP library initialization.
  * Initializes mutex locks.
@@ -821,6 +1061,9 @@ register_default_handlers(void)
     netsnmp_ds_register_config(ASN_INTEGER, "snmp", "sendMessageMaxSize",
                                NETSNMP_DS_LIBRARY_ID,
                                NETSNMP_DS_LIB_MSG_SEND_MAX);
+    netsnmp_ds_register_config(ASN_INTEGER, "snmp", "datagramBatchSize",
+                               NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_DGRAM_BATCH);
     netsnmp_ds_register_config(ASN_BOOLEAN, "snmp", "noPersistentLoad",
 		      NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD);
     netsnmp_ds_register_config(ASN_BOOLEAN, "snmp", "noPersistentSave",
@@ -835,6 +1078,8 @@ register_default_handlers(void)
 		               NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_RETRIES);
     netsnmp_ds_register_config(ASN_OCTET_STR, "snmp", "outputPrecision",
                                NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_OUTPUT_PRECISION);
+    netsnmp_ds_register_premib(ASN_OCTET_STR, "snmp", "eventLoopBackend",
+                               NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_EVENT_BACKEND);
 
 
     netsnmp_register_service_handlers();
@@ -859,6 +1104,7 @@ init_snmp(const char *type)
     }
 
     init_snmp_init_done = 1;
+    _pdu_pool_init();
 
     /*
      * make the type available everywhere else 
@@ -956,6 +1202,9 @@ snmp_shutdown(const char *type)
     shutdown_snmp_logging();
     snmp_alarm_unregister_all();
     snmp_close_sessions();
+    SNMP_FREE(session_by_fd);
+    session_by_fd_len = 0;
+    netsnmp_event_loop_shutdown();
 #ifndef NETSNMP_DISABLE_MIB_LOADING
     shutdown_mib();
 #endif /* NETSNMP_DISABLE_MIB_LOADING */
@@ -977,12 +1226,38 @@ snmp_shutdown(const char *type)
     shutdown_secmod();
     shutdown_snmp_transport();
     shutdown_data_list();
+    netsnmp_pdu_pool_clear();
     snmp_debug_shutdown();    /* should be done last */
 
     init_snmp_init_done  = 0;
     _init_snmp_init_done = 0;
 }
 
+/*
+ * records the socket of a listed session in session_by_fd
+ */
+static void
+_session_index(struct session_list *slp, int fd)
+{
+    struct session_list **tmp;
+    int             newlen;
+
+    if (fd >= session_by_fd_len) {
+        newlen = session_by_fd_len ? session_by_fd_len : FD_SETSIZE;
+        while (newlen <= fd)
+            newlen *= 2;
+        tmp = realloc(session_by_fd, newlen * sizeof(*tmp));
+        if (NULL == tmp)
+            return;
+        memset(tmp + session_by_fd_len, 0,
+               (newlen - session_by_fd_len) * sizeof(*tmp));
+        session_by_fd = tmp;
+        session_by_fd_len = newlen;
+    }
+    session_by_fd[fd] = slp;
+    slp->internal->index_fd = fd;
+}
+
 /*
  * inserts session into session list
  */
@@ -994,6 +1269,14 @@ void  snmp_session_insert(struct session_list *slp)
     snmp_res_lock(MT_LIBRARY_ID, MT_LIB_SESSION);
     slp->next = Sessions;
     Sessions = slp;
+    if (slp->internal)
+        slp->internal->listed = 1;
+    if (slp->transport && slp->transport->sock >= 0) {
+        netsnmp_event_loop_watch_fd(slp->transport->sock,
+                                    NETSNMP_EVENT_LOOP_READ);
+        if (slp->internal)
+            _session_index(slp, slp->transport->sock);
+    }
     snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SESSION);
 }
 
@@ -1945,8 +2228,25 @@ snmp_sess_close(struct session_list *slp)
 
     if (isp) {
         netsnmp_request_list *rp, *orp;
+        struct session_list **prevp;
+
+        if (isp->listed) {
+            if (isp->index_fd < session_by_fd_len &&
+                session_by_fd[isp->index_fd] == slp)
+                session_by_fd[isp->index_fd] = NULL;
+            for (prevp = &sessions_pending; isp->pending && *prevp;
+                 prevp = &(*prevp)->internal->next_pending)
+                if (*prevp == slp) {
+                    *prevp = isp->next_pending;
+                    break;
+                }
+        }
 
         SNMP_FREE(isp->packet);
+        SNMP_FREE(isp->obuf);
+        SNMP_FREE(isp->rbatch);
+        if (isp->rbatch_alive)
+            *isp->rbatch_alive = 0;
 
         /*
          * Free each element in the input request list.  
@@ -1971,6 +2271,10 @@ snmp_sess_close(struct session_list *slp)
     slp->transport = NULL;
 
     if (transport) {
+        /** send responses queued by a batch this session is closed in */
+        netsnmp_transport_batch_flush(transport);
+        if (transport->sock >= 0)
+            netsnmp_event_loop_forget_fd(transport->sock);
         transport->f_close(transport);
         netsnmp_transport_free(transport);
     }
@@ -4688,7 +4992,7 @@ snmp_pdu_parse(netsnmp_pdu *pdu, u_char * data, size_t * length)
      * get each varBind sequence 
      */
     while ((int) *length > 0) {
-        vp = SNMP_MALLOC_TYPEDEF(netsnmp_variable_list);
+        vp = netsnmp_varbind_alloc();
         if (NULL == vp)
             goto fail;
 
@@ -4920,6 +5224,86 @@ snmpv3_scopedPDU_parse(netsnmp_pdu *pdu, u_char * cp, size_t * length)
  *
  * build pdu packet
  */
+
+/*
+ * Send buffers up to this size are kept by the session for the next
+ * message instead of being freed once the message has been sent.
+ */
+#define SNMP_KEEP_OBUF_MAX  65536
+
+/*
+ * Returns the number of octets needed to encode the sub-identifiers of an
+ * OID (counting the first two separately, which can only overestimate).
+ */
+static size_t
+_snmp_oid_estimate_size(const oid *name, size_t len)
+{
+    size_t          i, size = 0;
+
+    for (i = 0; i < len; i++) {
+        if (name[i] < 0x80)
+            size += 1;
+        else if (name[i] < 0x4000)
+            size += 2;
+        else if (name[i] < 0x200000)
+            size += 3;
+        else
+            size += 5;
+    }
+    return size;
+}
+
+/*
+ * Returns an upper bound for the encoded size of a message carrying pdu,
+ * so that the packet buffer can be allocated once instead of being grown
+ * (and its contents moved) while the message is encoded.
+ */
+static size_t
+_snmp_pdu_estimate_size(netsnmp_session *session, netsnmp_pdu *pdu)
+{
+    netsnmp_variable_list *vp;
+    size_t          len, vlen;
+
+    /*
+     * message and PDU headers, security parameters and padding
+     */
+    len = 128 + pdu->community_len + session->community_len +
+        pdu->securityEngineIDLen + pdu->securityNameLen +
+        pdu->contextEngineIDLen + pdu->contextNameLen +
+        session->securityEngineIDLen + session->securityNameLen;
+
+    for (vp = pdu->variables; vp; vp = vp->next_variable) {
+        if (ASN_PRIV_STOP == vp->type)
+            break;
+        switch (vp->type) {
+        case ASN_INTEGER:
+        case ASN_COUNTER:
+        case ASN_GAUGE:
+        case ASN_TIMETICKS:
+        case ASN_UINTEGER:
+            vlen = 5;
+            break;
+        case ASN_COUNTER64:
+            vlen = 9;
+            break;
+        case ASN_OBJECT_ID:
+            vlen = _snmp_oid_estimate_size(vp->val.objid,
+                                           vp->val_len / sizeof(oid));
+            break;
+        default:
+            /* octet strings; opaque-wrapped types need a few more */
+            vlen = vp->val_len + 8;
+            break;
+        }
+        /*
+         * tag and length of the varbind sequence, name and value
+         */
+        len += 3 * 4 + _snmp_oid_estimate_size(vp->name, vp->name_length) +
+            vlen;
+    }
+    return len;
+}
+
 int
 netsnmp_build_packet(struct snmp_internal_session *isp, netsnmp_session *sp,
                      netsnmp_pdu *pdu, u_char **pktbuf_p,
@@ -4984,7 +5368,8 @@ _build_initial_pdu_packet(struct session_list *slp, netsnmp_pdu *pdu, int bulk)
         return SNMPERR_GENERR;
     }
 
-    SNMP_FREE(isp->obuf); /* should already be NULL */
+    isp->opacket = NULL;
+    isp->opacket_len = 0;
 
     session->s_snmp_errno = 0;
     session->s_errno = 0;
@@ -5063,11 +5448,25 @@ _build_initial_pdu_packet(struct session_list *slp, netsnmp_pdu *pdu, int bulk)
     netsnmp_assert(pdu->msgMaxSize > 0);
 
     /*
-     * allocate initial packet buffer. Buffer will be grown as needed
-     * while building the packet.
+     * allocate initial packet buffer, big enough for the whole message in
+     * the common case, or reuse the one kept from the previous message.
+     * Buffer will be grown as needed while building the packet.
      */
-    pktbuf_len = SNMP_MIN_MAX_LEN;
-    if ((pktbuf = (u_char *)malloc(pktbuf_len)) == NULL) {
+    pktbuf_len = _snmp_pdu_estimate_size(session, pdu);
+    if (pktbuf_len > (size_t)pdu->msgMaxSize)
+        pktbuf_len = pdu->msgMaxSize;
+    if (pktbuf_len < SNMP_MIN_MAX_LEN)
+        pktbuf_len = SNMP_MIN_MAX_LEN;
+    if (isp->obuf && isp->obuf_size >= pktbuf_len) {
+        pktbuf = isp->obuf;
+        pktbuf_len = isp->obuf_size;
+    } else {
+        SNMP_FREE(isp->obuf);
+        pktbuf = (u_char *)malloc(pktbuf_len);
+    }
+    isp->obuf = NULL;
+    isp->obuf_size = 0;
+    if (pktbuf == NULL) {
         DEBUGMSGTL(("sess_async_send",
                     "couldn't malloc initial packet buffer\n"));
         session->s_snmp_errno = SNMPERR_MALLOC;
@@ -5306,7 +5705,10 @@ _sess_async_send(struct session_list *slp,
                                     &(pdu->transport_data),
                                     &(pdu->transport_data_length));
 
-    SNMP_FREE(isp->obuf);
+    if (isp->obuf_size > SNMP_KEEP_OBUF_MAX) {
+        SNMP_FREE(isp->obuf);
+        isp->obuf_size = 0;
+    }
     isp->opacket = NULL; /* opacket was in obuf, so no free needed */
     isp->opacket_len = 0;
 
@@ -5378,6 +5780,11 @@ _sess_async_send(struct session_list *slp,
             isp->requests = rp;
             isp->requestsEnd = rp;
         }
+        if (isp->listed && !isp->pending) {
+            isp->pending = 1;
+            isp->next_pending = sessions_pending;
+            sessions_pending = slp;
+        }
         snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SESSION);
     } else {
         /*
@@ -5456,7 +5863,7 @@ void
 snmp_free_var(netsnmp_variable_list * var)
 {
     snmp_free_var_internals(var);
-    free((char *) var);
+    _pdu_pool_free_var(var);
 }
 
 void
@@ -5495,14 +5902,14 @@ snmp_free_pdu(netsnmp_pdu *pdu)
     free(pdu->contextName);
     free(pdu->securityName);
     free(pdu->transport_data);
-    free(pdu);
+    _pdu_pool_free_pdu(pdu);
 }
 
 netsnmp_pdu    *
 snmp_create_sess_pdu(netsnmp_transport *transport, void *opaque,
                      size_t olength)
 {
-    netsnmp_pdu *pdu = (netsnmp_pdu *)calloc(1, sizeof(netsnmp_pdu));
+    netsnmp_pdu *pdu = netsnmp_pdu_alloc();
     if (pdu == NULL) {
         DEBUGMSGTL(("sess_process_packet", "can't malloc space for PDU\n"));
         return NULL;
@@ -5909,6 +6316,29 @@ snmp_read2(netsnmp_large_fd_set * fdset)
     snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SESSION);
 }
 
+/**
+ * Reads from the session that owns fd, which is known to be ready (see
+ * netsnmp_event_loop_wait_ready()); fdset is passed on as by snmp_read2().
+ * Unlike snmp_read2(), no other session is looked at.
+ */
+void
+snmp_read_fd(int fd, netsnmp_large_fd_set *fdset)
+{
+    struct session_list *slp = NULL;
+
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_SESSION);
+    if (fd >= 0 && fd < session_by_fd_len)
+        slp = session_by_fd[fd];
+    /*
+     * a failed read may have closed the transport, which
+     * snmp_select_timeout() then deletes the session for
+     */
+    if (slp && slp->transport && slp->transport->sock == fd &&
+        snmp_sess_read2(slp, fdset) < 0)
+        sessions_reap = 1;
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SESSION);
+}
+
 /*
  * accept new connections
  * returns 0 if success, -1 if fail
@@ -6058,6 +6488,100 @@ _sess_read_dgram_packet(struct session_list *slp, netsnmp_large_fd_set * fdset,
     return 0;
 }
 
+#define NETSNMP_RBATCH_INITIAL 4 /* receive buffers allocated at first */
+
+/*
+ * Reads up to batch datagrams with a single call to the transport and
+ * processes them.  Responses sent while processing them are handed to the
+ * transport as a batch as well.  Returns -2 if the caller should fall back
+ * to reading a single datagram, otherwise as _sess_read().
+ */
+static int
+_sess_read_dgram_batch(struct session_list *slp, netsnmp_large_fd_set * fdset,
+                       int batch)
+{
+    netsnmp_session *sp = slp->session;
+    struct snmp_internal_session *isp = slp->internal;
+    netsnmp_transport *transport = slp->transport;
+    netsnmp_transport_msg msgs[NETSNMP_TRANSPORT_BATCH_MAX];
+    u_char         *buf;
+    int             alive = 1, count, i, n, max, rc = 0;
+
+    if (batch > NETSNMP_TRANSPORT_BATCH_MAX)
+        batch = NETSNMP_TRANSPORT_BATCH_MAX;
+    max = batch;
+
+    /*
+     * start with a few receive buffers and only grow towards batch when
+     * reads keep filling all of them.
+     */
+    if (NULL == isp->rbatch) {
+        n = batch < NETSNMP_RBATCH_INITIAL ? batch : NETSNMP_RBATCH_INITIAL;
+        isp->rbatch = (u_char *) malloc(n * SNMP_MAX_RCV_MSG_SIZE);
+        if (NULL == isp->rbatch) {
+            DEBUGMSGTL(("sess_read", "can't malloc %d receive buffers\n",
+                        n));
+            return -2;
+        }
+        isp->rbatch_count = n;
+    }
+    if (batch > isp->rbatch_count)
+        batch = isp->rbatch_count;
+
+    for (i = 0; i < batch; i++) {
+        msgs[i].packet = isp->rbatch + i * SNMP_MAX_RCV_MSG_SIZE;
+        msgs[i].length = SNMP_MAX_RCV_MSG_SIZE;
+        msgs[i].opaque = NULL;
+        msgs[i].olength = 0;
+    }
+
+    count = netsnmp_transport_recv_batch(transport, msgs, batch);
+    if (count < 0) {
+        sp->s_snmp_errno = SNMPERR_BAD_RECVFROM;
+        sp->s_errno = errno;
+        snmp_set_detail(strerror(errno));
+        return -1;
+    }
+
+    /** clear so any other sess sharing this socket won't try reading again */
+    NETSNMP_LARGE_FD_CLR(transport->sock, fdset);
+
+    DEBUGMSGTL(("sess_read", "read %d datagrams from fd %d\n", count,
+                transport->sock));
+
+    isp->rbatch_alive = &alive;
+    netsnmp_transport_batch_begin(transport, batch);
+    for (i = 0; i < count; i++) {
+        if (!alive) {
+            /** session closed by a callback; drop the rest */
+            SNMP_FREE(msgs[i].opaque);
+            continue;
+        }
+        /** opaque is freed in _sess_process_packet */
+        if (_sess_process_packet(slp, sp, isp, transport,
+                                 msgs[i].opaque, msgs[i].olength,
+                                 (u_char *) msgs[i].packet,
+                                 msgs[i].length) < 0)
+            rc = -1;
+    }
+    if (!alive)
+        return rc;
+    isp->rbatch_alive = NULL;
+    netsnmp_transport_batch_end(transport);
+
+    if (count == isp->rbatch_count && count < max) {
+        n = 2 * count < max ? 2 * count : max;
+        buf = (u_char *) realloc(isp->rbatch, n * SNMP_MAX_RCV_MSG_SIZE);
+        if (NULL != buf) {
+            DEBUGMSGTL(("sess_read", "%d receive buffers for fd %d\n", n,
+                        transport->sock));
+            isp->rbatch = buf;
+            isp->rbatch_count = n;
+        }
+    }
+    return rc;
+}
+
 /*
  * Same as snmp_read, but works just one session. 
  * returns 0 if success, -1 if fail 
@@ -6103,6 +6627,26 @@ _sess_read(struct session_list *slp, netsnmp_large_fd_set * fdset)
 
     if (!(transport->flags & NETSNMP_TRANSPORT_FLAG_STREAM)) {
         snmp_rcv_packet rcvp;
+        int batch;
+
+        /*
+         * drain several datagrams per wakeup if the transport can; only
+         * for server sessions, which are the ones that see bursts, and not
+         * when called recursively from a callback of an earlier batch.
+         */
+        if (transport->f_recv_batch && NULL != transport->local &&
+            NULL == isp->rbatch_alive) {
+            batch = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                       NETSNMP_DS_LIB_DGRAM_BATCH);
+            if (0 == batch)
+                batch = NETSNMP_DGRAM_BATCH_DEFAULT;
+            if (batch > 1) {
+                rc = _sess_read_dgram_batch(slp, fdset, batch);
+                if (-2 != rc)
+                    return rc;
+            }
+        }
+
         memset(&rcvp, 0x0, sizeof(rcvp));
 
         /** read the packet */
@@ -6479,6 +7023,131 @@ snmp_sess_select_info2(struct session_list *slp, int *numfds, netsnmp_large_fd_s
                                         NETSNMP_SELECT_NOFLAGS);
 }
 
+/*
+ * The second half of snmp_sess_select_info2_flags(): sets *timeout and
+ * *block from the earliest request timeout and the next alarm.
+ */
+static void
+_sess_select_timeout(struct timeval *earliest, int requests,
+                     struct timeval *timeout, int *block, int flags)
+{
+    struct timeval  now, alarm_tm;
+    int             next_alarm = 0;
+
+    netsnmp_get_monotonic_clock(&now);
+
+    if (netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_ALARM_DONT_USE_SIG) &&
+        !(flags & NETSNMP_SELECT_NOALARMS)) {
+        next_alarm = netsnmp_get_next_alarm_time(&alarm_tm, &now);
+        if (next_alarm)
+            DEBUGMSGT(("sess_select","next alarm at %ld.%06ld sec\n",
+                       (long)alarm_tm.tv_sec, (long)alarm_tm.tv_usec));
+    }
+    if (next_alarm == 0 && requests == 0) {
+        /*
+         * If none are active, skip arithmetic.  
+         */
+        DEBUGMSGT(("sess_select","blocking:no session requests or alarms.\n"));
+        *block = 1; /* can block - timeout value is undefined if no requests */
+        return;
+    }
+
+    if (next_alarm &&
+        (!timerisset(earliest) || timercmp(&alarm_tm, earliest, <)))
+        (*earliest) = alarm_tm;
+
+    NETSNMP_TIMERSUB(earliest, &now, earliest);
+    if ((*earliest).tv_sec < 0) {
+        time_t overdue_ms = -((*earliest).tv_sec * 1000 + (*earliest).tv_usec / 1000);
+        if (overdue_ms >= 10)
+            DEBUGMSGT(("verbose:sess_select","timer overdue by %ld ms\n",
+                       (long) overdue_ms));
+        timerclear(earliest);
+    } else {
+        DEBUGMSGT(("verbose:sess_select","timer due in %d.%06d sec\n",
+                   (int)(*earliest).tv_sec, (int)(*earliest).tv_usec));
+    }
+
+    /*
+     * if it was blocking before or our delta time is less, reset timeout 
+     */
+    if ((*block || (timercmp(earliest, timeout, <)))) {
+        DEBUGMSGT(("verbose:sess_select",
+                   "setting timer to %d.%06d sec, clear block (was %d)\n",
+                   (int)(*earliest).tv_sec, (int)(*earliest).tv_usec, *block));
+        *timeout = (*earliest);
+        *block = 0;
+    }
+}
+
+/*
+ * Deletes the listed sessions whose transport has been closed.
+ */
+static void
+_sessions_reap(void)
+{
+    struct session_list *slp, *next;
+
+    for (slp = Sessions; slp; slp = next) {
+        next = slp->next;
+        if (slp->transport && slp->transport->sock == -1) {
+            DEBUGMSGTL(("sess_select", "delete closed session\n"));
+            snmp_close(slp->session);
+        }
+    }
+}
+
+/**
+ * Works out how long an event loop may wait, like snmp_select_info2(), but
+ * without adding the session sockets to a descriptor set: for event loops
+ * whose backend watches them anyway and reports the ready ones (see
+ * netsnmp_event_loop_wait_ready() and snmp_read_fd()).  Only the sessions
+ * with requests outstanding are looked at; all sessions only once a second,
+ * or after a read failed, to delete those whose transport has been closed.
+ *
+ * @return Number of sessions with requests outstanding.
+ */
+int
+snmp_select_timeout(struct timeval *timeout, int *block)
+{
+    struct session_list *slp, **prevp;
+    struct snmp_internal_session *isp;
+    netsnmp_request_list *rp;
+    struct timeval  now, earliest;
+    int             requests = 0;
+
+    snmp_res_lock(MT_LIBRARY_ID, MT_LIB_SESSION);
+    netsnmp_get_monotonic_clock(&now);
+    if (sessions_reap || now.tv_sec != sessions_reaped) {
+        sessions_reap = 0;
+        sessions_reaped = now.tv_sec;
+        _sessions_reap();
+    }
+
+    timerclear(&earliest);
+    for (prevp = &sessions_pending; (slp = *prevp) != NULL; ) {
+        isp = slp->internal;
+        if (isp->requests == NULL) {
+            isp->pending = 0;
+            *prevp = isp->next_pending;
+            continue;
+        }
+        requests++;
+        for (rp = isp->requests; rp; rp = rp->next_request)
+            if (!timerisset(&earliest)
+                || (timerisset(&rp->expireM)
+                    && timercmp(&rp->expireM, &earliest, <)))
+                earliest = rp->expireM;
+        prevp = &isp->next_pending;
+    }
+    snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SESSION);
+
+    _sess_select_timeout(&earliest, requests, timeout, block,
+                         NETSNMP_SELECT_NOFLAGS);
+    return requests;
+}
+
 /**
  * Compute/update the arguments to be passed to select().
  *
@@ -6513,9 +7182,8 @@ snmp_sess_select_info2_flags(struct session_list *sessp, int *numfds,
 {
     struct session_list *slp, *next = NULL;
     netsnmp_request_list *rp;
-    struct timeval  now, earliest, alarm_tm;
+    struct timeval  earliest;
     int             active = 0, requests = 0;
-    int             next_alarm = 0;
 
     timerclear(&earliest);
 
@@ -6586,51 +7254,7 @@ snmp_sess_select_info2_flags(struct session_list *sessp, int *numfds,
     }
     DEBUGMSG(("sess_select", "\n"));
 
-    netsnmp_get_monotonic_clock(&now);
-
-    if (netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID,
-                               NETSNMP_DS_LIB_ALARM_DONT_USE_SIG) &&
-        !(flags & NETSNMP_SELECT_NOALARMS)) {
-        next_alarm = netsnmp_get_next_alarm_time(&alarm_tm, &now);
-        if (next_alarm)
-            DEBUGMSGT(("sess_select","next alarm at %ld.%06ld sec\n",
-                       (long)alarm_tm.tv_sec, (long)alarm_tm.tv_usec));
-    }
-    if (next_alarm == 0 && requests == 0) {
-        /*
-         * If none are active, skip arithmetic.  
-         */
-        DEBUGMSGT(("sess_select","blocking:no session requests or alarms.\n"));
-        *block = 1; /* can block - timeout value is undefined if no requests */
-        return active;
-    }
-
-    if (next_alarm &&
-        (!timerisset(&earliest) || timercmp(&alarm_tm, &earliest, <)))
-        earliest = alarm_tm;
-
-    NETSNMP_TIMERSUB(&earliest, &now, &earliest);
-    if (earliest.tv_sec < 0) {
-        time_t overdue_ms = -(earliest.tv_sec * 1000 + earliest.tv_usec / 1000);
-        if (overdue_ms >= 10)
-            DEBUGMSGT(("verbose:sess_select","timer overdue by %ld ms\n",
-                       (long) overdue_ms));
-        timerclear(&earliest);
-    } else {
-        DEBUGMSGT(("verbose:sess_select","timer due in %d.%06d sec\n",
-                   (int)earliest.tv_sec, (int)earliest.tv_usec));
-    }
-
-    /*
-     * if it was blocking before or our delta time is less, reset timeout 
-     */
-    if ((*block || (timercmp(&earliest, timeout, <)))) {
-        DEBUGMSGT(("verbose:sess_select",
-                   "setting timer to %d.%06d sec, clear block (was %d)\n",
-                   (int)earliest.tv_sec, (int)earliest.tv_usec, *block));
-        *timeout = earliest;
-        *block = 0;
-    }
+    _sess_select_timeout(&earliest, requests, timeout, block, flags);
     return active;
 }
 
@@ -7188,7 +7812,7 @@ snmp_varlist_add_variable(netsnmp_variable_list ** varlist,
     if (varlist == NULL)
         return NULL;
 
-    vars = SNMP_MALLOC_TYPEDEF(netsnmp_variable_list);
+    vars = netsnmp_varbind_alloc();
     if (vars == NULL)
         return NULL;
 
@@ -131,7 +131,7 @@ snmp_pdu_create(int command)
 {
     netsnmp_pdu    *pdu;
 
-    pdu = (netsnmp_pdu *) calloc(1, sizeof(netsnmp_pdu));
+    pdu = netsnmp_pdu_alloc();
     if (pdu) {
         pdu->version = SNMP_DEFAULT_VERSION;
         pdu->command = command;
@@ -366,9 +366,10 @@ _clone_pdu_header(netsnmp_pdu *pdu)
     if (!pdu)
         return NULL;
 
-    newpdu = netsnmp_memdup(pdu, sizeof(netsnmp_pdu));
+    newpdu = netsnmp_pdu_alloc();
     if (!newpdu)
         return NULL;
+    memcpy(newpdu, pdu, sizeof(netsnmp_pdu));
 
     /*
      * reset copied pointers if copy fails 
@@ -443,8 +444,7 @@ _copy_varlist(netsnmp_variable_list * var,      /* source varList */
         /*
          * clone the next variable. Cleanup if alloc fails 
          */
-        newvar = (netsnmp_variable_list *)
-            malloc(sizeof(netsnmp_variable_list));
+        newvar = netsnmp_varbind_alloc();
         if (snmp_clone_var(var, newvar)) {
             if (newvar)
                 free((char *) newvar);
@@ -77,6 +77,11 @@
 
 #include "snmp_syslog.h"
 
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE) && !defined(WIN32)
+#include <pthread.h>
+#define NETSNMP_LOG_LOCKING 1
+#endif
+
 #ifdef va_copy
 #define NEED_VA_END_AFTER_VA_COPY
 #else
@@ -115,6 +120,51 @@ netsnmp_log_handler *logh_head = NULL;
 netsnmp_log_handler *logh_priorities[LOG_DEBUG+1];
 static int  logh_enabled = 0;
 
+#ifdef NETSNMP_LOG_LOCKING
+/*
+ * Messages may come from helper threads (e.g. agent workers) as well, and
+ * the handlers keep state of their own, so only one message at a time is
+ * handed to them.  A handler may log in turn, hence the recursive mutex.
+ */
+static pthread_once_t  log_lock_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t log_lock;
+
+static void
+_log_lock(void)
+{
+    pthread_mutex_lock(&log_lock);
+}
+
+static void
+_log_unlock(void)
+{
+    pthread_mutex_unlock(&log_lock);
+}
+
+static void
+_log_lock_create(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&log_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static void
+_log_lock_init(void)
+{
+    _log_lock_create();
+    /*
+     * hold the lock across fork(), so that no other thread is in the
+     * middle of a message; the child is a new thread as far as the
+     * (recursive) lock is concerned, so it gets a new one
+     */
+    pthread_atfork(_log_lock, _log_unlock, _log_lock_create);
+}
+#endif /* NETSNMP_LOG_LOCKING */
+
 #ifndef NETSNMP_FEATURE_REMOVE_LOGGING_SYSLOG
 static char syslogname[64] = DEFAULT_LOG_ID;
 #endif /* NETSNMP_FEATURE_REMOVE_LOGGING_SYSLOG */
@@ -1279,8 +1329,8 @@ log_handler_null(    netsnmp_log_handler* logh, int pri, const char *str)
     return 1;
 }
 
-void
-snmp_log_string(int priority, const char *str)
+static void
+_snmp_log_string(int priority, const char *str)
 {
 #ifndef NETSNMP_FEATURE_REMOVE_LOGGING_STDIO
     static int stderr_enabled = 0;
@@ -1332,6 +1382,19 @@ snmp_log_string(int priority, const char *str)
     }
 }
 
+void
+snmp_log_string(int priority, const char *str)
+{
+#ifdef NETSNMP_LOG_LOCKING
+    pthread_once(&log_lock_once, _log_lock_init);
+    _log_lock();
+#endif
+    _snmp_log_string(priority, str);
+#ifdef NETSNMP_LOG_LOCKING
+    _log_unlock();
+#endif
+}
+
 /* ==================================================== */
 
 
@@ -214,6 +214,8 @@ netsnmp_transport_copy(const netsnmp_transport *t)
     n->f_copy = t->f_copy;
     n->f_config = t->f_config;
     n->f_fmtaddr = t->f_fmtaddr;
+    n->f_recv_batch = t->f_recv_batch;
+    n->f_send_batch = t->f_send_batch;
     n->sock = t->sock;
     n->flags = t->flags;
     n->base_transport = netsnmp_transport_copy(t->base_transport);
@@ -227,6 +229,34 @@ netsnmp_transport_copy(const netsnmp_transport *t)
 
 
 
+/*
+ * While a batch is open, messages sent over a transport with an
+ * f_send_batch callback are copied to a queue and only handed to the
+ * transport, up to count at a time, when the batch is closed or the queue
+ * is full.  Batches may be nested.  The queue, and the buffers of its
+ * slots up to SENDQ_KEEP_MAX bytes, are kept for the next batch.
+ */
+#define SENDQ_KEEP_MAX 8192
+
+struct netsnmp_transport_sendq_slot_s {
+    void                  *packet;
+    int                    size;
+    void                  *opaque;
+    int                    osize;
+};
+
+struct netsnmp_transport_sendq_s {
+    int                    depth;
+    int                    count;
+    int                    max;
+    netsnmp_transport_msg *msgs;
+    struct netsnmp_transport_sendq_slot_s *slots;
+};
+
+static void _transport_sendq_free(netsnmp_transport *t);
+static int  _transport_sendq_add(netsnmp_transport *t, const void *packet,
+                                 int length, void **opaque, int *olength);
+
 void
 netsnmp_transport_free(netsnmp_transport *t)
 {
@@ -242,6 +272,7 @@ netsnmp_transport_free(netsnmp_transport *t)
     SNMP_FREE(t->local);
     SNMP_FREE(t->remote);
     SNMP_FREE(t->data);
+    _transport_sendq_free(t);
     netsnmp_transport_free(t->base_transport);
 
     SNMP_FREE(t);
@@ -426,6 +457,9 @@ netsnmp_transport_send(netsnmp_transport *t, const void *packet, int length,
     if (dumpPacket)
         xdump(packet, length, "");
 
+    if (t->sendq && t->sendq->depth > 0)
+        return _transport_sendq_add(t, packet, length, opaque, olength);
+
     return t->f_send(t, packet, length, opaque, olength);
 }
 
@@ -461,6 +495,210 @@ netsnmp_transport_recv(netsnmp_transport *t, void *packet, int length,
     return length;
 }
 
+/*
+ * Receives up to count datagrams.  Uses the f_recv_batch callback of the
+ * transport if it has one and falls back to a single f_recv otherwise.
+ * Returns the number of messages received, 0 if there was nothing to read
+ * and -1 on error.
+ */
+int
+netsnmp_transport_recv_batch(netsnmp_transport *t,
+                             netsnmp_transport_msg *msgs, int count)
+{
+    int rc, i;
+
+    if ((NULL == t) || (NULL == t->f_recv) || count < 1) {
+        DEBUGMSGTL(("transport:recv", "NULL transport or recv function\n"));
+        return -1;
+    }
+
+    if (NULL == t->f_recv_batch || 1 == count) {
+        rc = netsnmp_transport_recv(t, msgs[0].packet, msgs[0].length,
+                                    &msgs[0].opaque, &msgs[0].olength);
+        if (rc < 0)
+            return -1;
+        msgs[0].length = rc;
+        return 1;
+    }
+
+    rc = t->f_recv_batch(t, msgs, count);
+    if (rc <= 0)
+        return rc;
+
+    DEBUGIF("transport:recv") {
+        for (i = 0; i < rc; i++) {
+            char *str = netsnmp_transport_peer_string(t, msgs[i].opaque,
+                                                      msgs[i].olength);
+            DEBUGMSGT_NC(("transport:recv", "%d bytes from %s (%d/%d)\n",
+                          msgs[i].length, str, i + 1, rc));
+            SNMP_FREE(str);
+        }
+    }
+
+    return rc;
+}
+
+static void
+_transport_sendq_clear(struct netsnmp_transport_sendq_s *q)
+{
+    struct netsnmp_transport_sendq_slot_s *slot;
+    int i;
+
+    for (i = 0; i < q->count; i++) {
+        slot = &q->slots[i];
+        if (slot->size > SENDQ_KEEP_MAX) {
+            SNMP_FREE(slot->packet);
+            slot->size = 0;
+        }
+        memset(&q->msgs[i], 0, sizeof(q->msgs[i]));
+    }
+    q->count = 0;
+}
+
+static void
+_transport_sendq_free(netsnmp_transport *t)
+{
+    struct netsnmp_transport_sendq_s *q = t->sendq;
+    int i;
+
+    if (NULL == q)
+        return;
+    for (i = 0; i < q->max; i++) {
+        free(q->slots[i].packet);
+        free(q->slots[i].opaque);
+    }
+    free(q->slots);
+    free(q->msgs);
+    free(q);
+    t->sendq = NULL;
+}
+
+void
+netsnmp_transport_batch_begin(netsnmp_transport *t, int count)
+{
+    struct netsnmp_transport_sendq_s *q;
+
+    if (NULL == t || NULL == t->f_send_batch || count < 2)
+        return;
+
+    if (NULL == t->sendq) {
+        q = SNMP_MALLOC_STRUCT(netsnmp_transport_sendq_s);
+        if (NULL == q)
+            return;
+        q->msgs = calloc(count, sizeof(netsnmp_transport_msg));
+        q->slots = calloc(count, sizeof(*q->slots));
+        if (NULL == q->msgs || NULL == q->slots) {
+            free(q->msgs);
+            free(q->slots);
+            free(q);
+            return;
+        }
+        q->max = count;
+        t->sendq = q;
+    }
+    t->sendq->depth++;
+}
+
+static int
+_transport_sendq_flush(netsnmp_transport *t)
+{
+    struct netsnmp_transport_sendq_s *q = t->sendq;
+    int rc, done = 0, failed = 0;
+
+    while (done < q->count) {
+        rc = t->f_send_batch(t, &q->msgs[done], q->count - done);
+        if (rc <= 0) {
+            /* skip the message that could not be sent */
+            failed++;
+            rc = 1;
+        }
+        done += rc;
+    }
+    DEBUGMSGTL(("transport:send", "flushed %d queued messages, %d failed\n",
+                q->count, failed));
+
+    _transport_sendq_clear(q);
+    return failed ? -1 : 0;
+}
+
+/*
+ * Closes a batch opened by netsnmp_transport_batch_begin().  The queued
+ * messages are sent when the outermost batch is closed.  Returns -1 if
+ * some of them could not be sent.
+ */
+int
+netsnmp_transport_batch_end(netsnmp_transport *t)
+{
+    struct netsnmp_transport_sendq_s *q;
+    int rc = 0;
+
+    if (NULL == t || NULL == t->sendq)
+        return 0;
+
+    q = t->sendq;
+    if (q->depth > 0 && --q->depth > 0)
+        return 0;
+
+    if (q->count)
+        rc = _transport_sendq_flush(t);
+    return rc;
+}
+
+/*
+ * Sends the messages queued on t without closing the batch.  Called before
+ * a transport is closed so that responses queued by the callbacks of a
+ * batch in progress are not lost.
+ */
+int
+netsnmp_transport_batch_flush(netsnmp_transport *t)
+{
+    if (NULL == t || NULL == t->sendq || 0 == t->sendq->count)
+        return 0;
+    return _transport_sendq_flush(t);
+}
+
+static int
+_transport_sendq_add(netsnmp_transport *t, const void *packet, int length,
+                     void **opaque, int *olength)
+{
+    struct netsnmp_transport_sendq_s *q = t->sendq;
+    struct netsnmp_transport_sendq_slot_s *slot;
+    netsnmp_transport_msg *m;
+    void *buf;
+
+    if (q->count == q->max && _transport_sendq_flush(t) < 0)
+        return -1;
+
+    m = &q->msgs[q->count];
+    slot = &q->slots[q->count];
+    if (slot->size < length) {
+        if (NULL == (buf = malloc(length)))
+            return -1;
+        free(slot->packet);
+        slot->packet = buf;
+        slot->size = length;
+    }
+    memcpy(slot->packet, packet, length);
+    m->packet = slot->packet;
+    m->length = length;
+    m->opaque = NULL;
+    m->olength = 0;
+    if (opaque && *opaque && olength && *olength > 0) {
+        if (slot->osize < *olength) {
+            if (NULL == (buf = malloc(*olength)))
+                return -1;
+            free(slot->opaque);
+            slot->opaque = buf;
+            slot->osize = *olength;
+        }
+        memcpy(slot->opaque, *opaque, *olength);
+        m->opaque = slot->opaque;
+        m->olength = *olength;
+    }
+    q->count++;
+    return length;
+}
+
 
 
 #ifndef NETSNMP_FEATURE_REMOVE_TDOMAIN_SUPPORT
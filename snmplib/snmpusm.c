@@ -224,10 +224,43 @@ static u_int    salt_integer64_1, salt_integer64_2;
          */
 
 static struct usmUser *noNameUser = NULL;
+
+/*
+ * createUser lines read from the configuration files get their keys once
+ * all of the files have been read: the createUser handler only collects
+ * the passphrases, and usm_set_pending_keys() turns them into keys by
+ * several threads at once.  Until then the users are marked
+ * USMUSER_FLAG_KEYS_PENDING.
+ */
+struct usm_pending_keys {
+    struct usm_pending_keys *next;
+    struct usmUser *user;
+    char           *authPass;       /* NULL if the key is set */
+    char           *privPass;       /* NULL if the key is set */
+    int             privFromAuth;   /* privKey is a copy of authKey */
+    size_t          privKeySize;    /* of the privKey buffer */
+    int             properPrivKeyLen;
+};
+
+static struct usm_pending_keys *usm_pending_keys;
+static int      usm_reading_config;
+static int      usm_key_threads;        /* 0: one per processor */
+static int      usm_persistent_keycache;
 /*
  * Local storage (LCD) of the default user list.
+ *
+ * Users are found by (engineID, name) through userHash, chained through
+ * their hashNext field.  userList holds the same users in the order of
+ * the usmUserTable index (engineID length, engineID, name length, name);
+ * adding a user just puts it at the head, and the list is sorted again
+ * the next time usm_get_userList() is asked for it.
  */
 static struct usmUser *userList = NULL;
+static int      userListSorted = 1;
+static struct usmUser **userHash = NULL;
+static size_t   userHashSize = 0, userCount = 0;
+
+#define USM_USER_HASH(h)        ((h) & (userHashSize - 1))
 
 /*
  * Set a given field of the secStateRef.
@@ -337,9 +370,209 @@ usm_free_usmStateReference(void *old)
     SNMP_FREE(ref);
 }                               /* end usm_free_usmStateReference() */
 
+static u_int
+usm_user_hash(const u_char *engineID, size_t engineIDLen,
+              const char *name, size_t nameLen)
+{
+    u_int           h = 2166136261U;
+    size_t          i;
+
+    for (i = 0; engineID && i < engineIDLen; i++) {
+        h ^= engineID[i];
+        h *= 16777619U;
+    }
+    h ^= (u_int)engineIDLen;
+    h *= 16777619U;
+    for (i = 0; i < nameLen; i++) {
+        h ^= (u_char)name[i];
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static u_int
+usm_user_hash_user(const struct usmUser *user)
+{
+    return usm_user_hash(user->engineID, user->engineIDLen, user->name,
+                         user->name ? strlen(user->name) : 0);
+}
+
+static int
+usm_user_matches(const struct usmUser *user, const u_char *engineID,
+                 size_t engineIDLen, const char *name, size_t nameLen)
+{
+    return user->name && strlen(user->name) == nameLen &&
+        memcmp(user->name, name, nameLen) == 0 &&
+        user->engineIDLen == engineIDLen &&
+        ((user->engineID == NULL && engineID == NULL) ||
+         (user->engineID != NULL && engineID != NULL &&
+          memcmp(user->engineID, engineID, engineIDLen) == 0));
+}
+
+/*
+ * The usmUserTable order: engineID length, engineID, name length, name
+ */
+static int
+usm_user_compare(const struct usmUser *a, const struct usmUser *b)
+{
+    size_t          alen, blen;
+    int             rc;
+
+    if (a->engineIDLen != b->engineIDLen)
+        return a->engineIDLen < b->engineIDLen ? -1 : 1;
+    if (a->engineID != b->engineID) {
+        if (a->engineID == NULL)
+            return -1;
+        if (b->engineID == NULL)
+            return 1;
+        rc = memcmp(a->engineID, b->engineID, a->engineIDLen);
+        if (rc)
+            return rc;
+    }
+    alen = a->name ? strlen(a->name) : 0;
+    blen = b->name ? strlen(b->name) : 0;
+    if (alen != blen)
+        return alen < blen ? -1 : 1;
+    return alen ? memcmp(a->name, b->name, alen) : 0;
+}
+
+static int
+usm_user_hash_insert(struct usmUser *user)
+{
+    struct usmUser **hash, *u, *next;
+    size_t          size, i;
+
+    if (userCount >= userHashSize) {
+        size = userHashSize ? 2 * userHashSize : 64;
+        hash = (struct usmUser **) calloc(size, sizeof(*hash));
+        if (hash == NULL)
+            return -1;
+        for (i = 0; i < userHashSize; i++) {
+            for (u = userHash[i]; u; u = next) {
+                next = u->hashNext;
+                u->hashNext = hash[usm_user_hash_user(u) & (size - 1)];
+                hash[usm_user_hash_user(u) & (size - 1)] = u;
+            }
+        }
+        free(userHash);
+        userHash = hash;
+        userHashSize = size;
+    }
+    i = USM_USER_HASH(usm_user_hash_user(user));
+    user->hashNext = userHash[i];
+    userHash[i] = user;
+    userCount++;
+    return 0;
+}
+
+/*
+ * returns the hash chain link pointing at user, or NULL if it's not there
+ */
+static struct usmUser **
+usm_user_hash_find(const struct usmUser *user)
+{
+    struct usmUser **prevNext;
+
+    if (!userHashSize)
+        return NULL;
+    for (prevNext = &userHash[USM_USER_HASH(usm_user_hash_user(user))];
+         *prevNext; prevNext = &(*prevNext)->hashNext)
+        if (*prevNext == user)
+            return prevNext;
+    return NULL;
+}
+
+/*
+ * merge sort userList into usmUserTable order
+ */
+static void
+usm_sort_user_list(void)
+{
+    struct usmUser *list = userList, *p, *q, *e, *tail;
+    size_t          insize = 1, nmerges, psize, qsize, i;
+
+    if (userListSorted)
+        return;
+    userListSorted = 1;
+    if (!list)
+        return;
+
+    do {
+        p = list;
+        list = tail = NULL;
+        nmerges = 0;
+        while (p) {
+            nmerges++;
+            for (q = p, psize = 0, i = 0; i < insize && q; i++) {
+                psize++;
+                q = q->next;
+            }
+            qsize = insize;
+            while (psize > 0 || (qsize > 0 && q)) {
+                if (psize == 0 || (qsize > 0 && q &&
+                                   usm_user_compare(q, p) < 0)) {
+                    e = q;
+                    q = q->next;
+                    qsize--;
+                } else {
+                    e = p;
+                    p = p->next;
+                    psize--;
+                }
+                if (tail)
+                    tail->next = e;
+                else
+                    list = e;
+                e->prev = tail;
+                tail = e;
+            }
+            p = q;
+        }
+        tail->next = NULL;
+        insize *= 2;
+    } while (nmerges > 1);
+
+    userList = list;
+}
+
+static void
+usm_free_pending_keys(struct usm_pending_keys *pk)
+{
+    if (pk->authPass) {
+        memset(pk->authPass, 0, strlen(pk->authPass));
+        free(pk->authPass);
+    }
+    if (pk->privPass) {
+        memset(pk->privPass, 0, strlen(pk->privPass));
+        free(pk->privPass);
+    }
+    free(pk);
+}
+
+/*
+ * forgets the passphrases of a user that is freed before they were used
+ */
+static void
+usm_forget_pending_keys(struct usmUser *user)
+{
+    struct usm_pending_keys **prevNext, *pk;
+
+    for (prevNext = &usm_pending_keys; *prevNext;
+         prevNext = &(*prevNext)->next) {
+        if ((*prevNext)->user == user) {
+            pk = *prevNext;
+            *prevNext = pk->next;
+            usm_free_pending_keys(pk);
+            break;
+        }
+    }
+    user->flags &= ~USMUSER_FLAG_KEYS_PENDING;
+}
+
 struct usmUser *
 usm_get_userList(void)
 {
+    usm_sort_user_list();
     return userList;
 }
 
@@ -470,34 +703,34 @@ emergency_print(u_char * field, u_int length)
 
 static struct usmUser *
 usm_get_user_from_list(const u_char *engineID, size_t engineIDLen,
-                       const char *name, size_t nameLen,
-                       struct usmUser *puserList, int use_default)
+                       const char *name, size_t nameLen, int use_default)
 {
     struct usmUser *ptr;
 
-    for (ptr = puserList; ptr != NULL; ptr = ptr->next) {
-        if (ptr->name && strlen(ptr->name) == nameLen &&
-            memcmp(ptr->name, name, nameLen) == 0) {
-          DEBUGMSGTL(("usm", "match on user %s\n", ptr->name));
-          if (ptr->engineIDLen == engineIDLen &&
-            ((ptr->engineID == NULL && engineID == NULL) ||
-             (ptr->engineID != NULL && engineID != NULL &&
-              memcmp(ptr->engineID, engineID, engineIDLen) == 0)))
-            return ptr;
-          DEBUGMSGTL(("usm", "no match on engineID ("));
-          if (engineID) {
-              DEBUGMSGHEX(("usm", engineID, engineIDLen));
-          } else {
-              DEBUGMSGTL(("usm", "Empty EngineID"));
-          }
-          DEBUGMSG(("usm", ")\n"));
+    if (userHashSize) {
+        ptr = userHash[USM_USER_HASH(usm_user_hash(engineID, engineIDLen,
+                                                   name, nameLen))];
+        for (; ptr != NULL; ptr = ptr->hashNext) {
+            if (usm_user_matches(ptr, engineID, engineIDLen, name,
+                                 nameLen)) {
+                DEBUGMSGTL(("usm", "match on user %s\n", ptr->name));
+                return ptr;
+            }
         }
     }
 
+    DEBUGMSGTL(("usm", "no user %.*s for engineID (", (int)nameLen, name));
+    if (engineID) {
+        DEBUGMSGHEX(("usm", engineID, engineIDLen));
+    } else {
+        DEBUGMSGTL(("usm", "Empty EngineID"));
+    }
+    DEBUGMSG(("usm", ")\n"));
+
     /*
      * return "" user used to facilitate engineID discovery
      */
-    if (use_default && !strcmp(name, ""))
+    if (use_default && nameLen == 0)
         return noNameUser;
     return NULL;
 }
@@ -508,8 +741,7 @@ usm_get_user2(const u_char *engineID, size_t engineIDLen, const void *name,
 {
     DEBUGMSGTL(("usm", "getting user %.*s\n", (int)nameLen,
                 (const char *)name));
-    return usm_get_user_from_list(engineID, engineIDLen, name, nameLen,
-                                  userList, 1);
+    return usm_get_user_from_list(engineID, engineIDLen, name, nameLen, 1);
 }
 
 /*
@@ -522,207 +754,121 @@ usm_get_user(const u_char *engineID, size_t engineIDLen, const char *name)
     return usm_get_user2(engineID, engineIDLen, name, strlen(name));
 }
 
-static struct usmUser *
-usm_add_user_to_list(struct usmUser *user, struct usmUser *puserList)
-{
-    struct usmUser *nptr, *pptr, *optr;
-
-    /*
-     * loop through puserList till we find the proper, sorted place to
-     * insert the new user
-     */
-    /* XXX - how to handle a NULL user->name ?? */
-    /* XXX - similarly for a NULL nptr->name ?? */
-    for (nptr = puserList, pptr = NULL; nptr != NULL;
-         pptr = nptr, nptr = nptr->next) {
-        if (nptr->engineIDLen > user->engineIDLen)
-            break;
-
-        if (user->engineID == NULL && nptr->engineID != NULL)
-            break;
-
-        if (nptr->engineIDLen == user->engineIDLen &&
-            (nptr->engineID != NULL && user->engineID != NULL &&
-             memcmp(nptr->engineID, user->engineID,
-                    user->engineIDLen) > 0))
-            break;
-
-        if (!(nptr->engineID == NULL && user->engineID != NULL)) {
-            if (nptr->engineIDLen == user->engineIDLen &&
-                ((nptr->engineID == NULL && user->engineID == NULL) ||
-                 memcmp(nptr->engineID, user->engineID,
-                        user->engineIDLen) == 0)
-                && strlen(nptr->name) > strlen(user->name))
-                break;
-
-            if (nptr->engineIDLen == user->engineIDLen &&
-                ((nptr->engineID == NULL && user->engineID == NULL) ||
-                 memcmp(nptr->engineID, user->engineID,
-                        user->engineIDLen) == 0)
-                && strlen(nptr->name) == strlen(user->name)
-                && strcmp(nptr->name, user->name) > 0)
-                break;
-
-            if (nptr->engineIDLen == user->engineIDLen &&
-                ((nptr->engineID == NULL && user->engineID == NULL) ||
-                 memcmp(nptr->engineID, user->engineID,
-                        user->engineIDLen) == 0)
-                && strlen(nptr->name) == strlen(user->name)
-                && strcmp(nptr->name, user->name) == 0) {
-                /*
-                 * the user is an exact match of a previous entry.
-                 * Credentials may be different, though, so remove
-                 * the old entry (and add the new one)!
-                 */
-                if (pptr) { /* change prev's next pointer */
-                  pptr->next = nptr->next;
-                }
-                if (nptr->next) { /* change next's prev pointer */
-                  nptr->next->prev = pptr;
-                }
-                optr = nptr;
-                nptr = optr->next; /* add new user at this position */
-                /* free the old user */
-                optr->next=NULL;
-                optr->prev=NULL;
-                usm_free_user(optr);
-                break; /* new user will be added below */
-            }
-        }
-    }
-
-    /*
-     * nptr should now point to the user that we need to add ourselves
-     * in front of, and pptr should be our new 'prev'.
-     */
-
-    /*
-     * change our pointers
-     */
-    user->prev = pptr;
-    user->next = nptr;
-
-    /*
-     * change the next's prev pointer
-     */
-    if (user->next)
-        user->next->prev = user;
-
-    /*
-     * change the prev's next pointer
-     */
-    if (user->prev)
-        user->prev->next = user;
-
-    /*
-     * rewind to the head of the list and return it (since the new head
-     * could be us, we need to notify the above routine who the head now is.
-     */
-    for (pptr = user; pptr->prev != NULL; pptr = pptr->prev);
-    return pptr;
-}
-
 /*
- * usm_add_user(): Add's a user to the userList, sorted by the
- * engineIDLength then the engineID then the name length then the name
- * to facilitate getNext calls on a usmUser table which is indexed by
- * these values.
+ * usm_add_user(): Add's a user to the userList, replacing any user with
+ * the same engineID and name.
  *
- * returns the head of the list (which could change due to this add).
+ * returns the head of the list (which could change due to this add), or
+ * NULL if the user has no name or could not be indexed.
+ * The list is only put back in usmUserTable order (the engineIDLength
+ * then the engineID then the name length then the name) by
+ * usm_get_userList().
  */
 
 struct usmUser *
 usm_add_user(struct usmUser *user)
 {
-    struct usmUser *uptr;
-    uptr = usm_add_user_to_list(user, userList);
-    if (uptr != NULL)
-        userList = uptr;
-    return uptr;
+    struct usmUser *optr, **prevNext;
+
+    if (user == NULL || user->name == NULL) {
+        snmp_log(LOG_ERR, "usm: can't add a user without a name\n");
+        return NULL;
+    }
+    optr = usm_get_user_from_list(user->engineID, user->engineIDLen,
+                                  user->name, strlen(user->name), 0);
+    if (optr == user)
+        return userList;
+    if (optr) {
+        /*
+         * the user is an exact match of a previous entry.
+         * Credentials may be different, though, so remove
+         * the old entry and put the new one in its place.
+         */
+        user->prev = optr->prev;
+        user->next = optr->next;
+        if (user->prev)
+            user->prev->next = user;
+        else
+            userList = user;
+        if (user->next)
+            user->next->prev = user;
+
+        prevNext = usm_user_hash_find(optr);
+        netsnmp_assert(prevNext != NULL);
+        *prevNext = user;
+        user->hashNext = optr->hashNext;
+
+        optr->next = optr->prev = optr->hashNext = NULL;
+        usm_free_user(optr);
+        return userList;
+    }
+
+    if (usm_user_hash_insert(user) != 0)
+        return NULL;
+    user->prev = NULL;
+    user->next = userList;
+    if (userList) {
+        userList->prev = user;
+        if (usm_user_compare(user, userList) > 0)
+            userListSorted = 0;
+    }
+    userList = user;
+    return userList;
 }
 
 /*
- * usm_remove_usmUser_from_list remove user from (optional) list
+ * usm_remove_usmUser_from_list removes user from the global userList.
  *
- * if list is not specified, defaults to global userList.
+ * The user is found through the user hash, so there is no other list
+ * it could be removed from.
  *
  * returns SNMPERR_SUCCESS or SNMPERR_USM_UNKNOWNSECURITYNAME
  */
 static int
-usm_remove_usmUser_from_list(struct usmUser *user, struct usmUser **ppuserList)
+usm_remove_usmUser_from_list(struct usmUser *user)
 {
-    struct usmUser *nptr, *pptr;
-
-    /*
-     * NULL pointers aren't allowed
-     */
-    if (ppuserList == NULL)
-        ppuserList = &userList;
-
-    if (*ppuserList == NULL)
-        return SNMPERR_USM_UNKNOWNSECURITYNAME;
+    struct usmUser **prevNext;
 
     /*
-     * find the user in the list
+     * find the user in the table
      */
-    for (nptr = *ppuserList, pptr = NULL; nptr != NULL;
-         pptr = nptr, nptr = nptr->next) {
-        if (nptr == user)
-            break;
-    }
-
-    if (nptr) {
-        /*
-         * remove the user from the linked list
-         */
-        if (pptr) {
-            pptr->next = nptr->next;
-        }
-        if (nptr->next) {
-            nptr->next->prev = pptr;
-        }
-    } else {
+    prevNext = usm_user_hash_find(user);
+    if (prevNext == NULL) {
         /*
          * user didn't exist
          */
         return SNMPERR_USM_UNKNOWNSECURITYNAME;
     }
-    if (nptr == *ppuserList)    /* we're the head of the list, need to change
+    *prevNext = user->hashNext;
+    user->hashNext = NULL;
+    userCount--;
+
+    /*
+     * remove the user from the linked list
+     */
+    if (user->prev)
+        user->prev->next = user->next;
+    else                        /* we're the head of the list, need to change
                                  * * the head to the next user */
-        *ppuserList = nptr->next;
+        userList = user->next;
+    if (user->next)
+        user->next->prev = user->prev;
     return SNMPERR_SUCCESS;
 }                               /* end usm_remove_usmUser_from_list() */
 
-/*
- * usm_remove_user_from_list
- *
- * removes user from list.
- *
- * returns new list head on success, or NULL on error.
- *
- * NOTE: if there was only one user in the list, list head will be NULL.
- *       So NULL can also mean success. Use the newer usm_remove_usmUser() for
- *       more specific return codes. This function is kept for backwards
- *       compatability with this ambiguous behaviour.
- */
-static struct usmUser *
-usm_remove_user_from_list(struct usmUser *user,
-                          struct usmUser **ppuserList)
-{
-    int rc = usm_remove_usmUser_from_list(user, ppuserList);
-    if (rc != SNMPERR_SUCCESS || NULL == ppuserList)
-        return NULL;
-
-    return *ppuserList;
-}                               /* end usm_remove_user_from_list() */
-
 /*
  * usm_remove_user(): finds and removes a user from a list
  */
 struct usmUser *
 usm_remove_user(struct usmUser *user)
 {
-    return usm_remove_user_from_list(user, &userList);
+    /*
+     * NOTE: if there was only one user in the list, the new list head is
+     *       NULL, so NULL can also mean success.
+     */
+    if (usm_remove_usmUser_from_list(user) != SNMPERR_SUCCESS)
+        return NULL;
+    return userList;
 }
 
 /*
@@ -738,9 +884,19 @@ usm_remove_user(struct usmUser *user)
 struct usmUser *
 usm_free_user(struct usmUser *user)
 {
+    struct usmUser **prevNext;
+
     if (user == NULL)
         return NULL;
 
+    prevNext = usm_user_hash_find(user);
+    if (prevNext != NULL) {     /* this shouldn't happen either */
+        *prevNext = user->hashNext;
+        userCount--;
+    }
+    if (user->flags & USMUSER_FLAG_KEYS_PENDING)
+        usm_forget_pending_keys(user);
+
     SNMP_FREE(user->engineID);
     SNMP_FREE(user->name);
     SNMP_FREE(user->secName);
@@ -750,11 +906,13 @@ usm_free_user(struct usmUser *user)
     SNMP_FREE(user->privProtocol);
 
     if (user->authKey != NULL) {
+        sc_forget_key(user->authKey, user->authKeyLen);
         SNMP_ZERO(user->authKey, user->authKeyLen);
         SNMP_FREE(user->authKey);
     }
 
     if (user->privKey != NULL) {
+        sc_forget_key(user->privKey, user->privKeyLen);
         SNMP_ZERO(user->privKey, user->privKeyLen);
         SNMP_FREE(user->privKey);
     }
@@ -3052,7 +3210,7 @@ usm_process_in_msg(int msgProcModel,    /* (UNUSED) */
      * If the user/engine ID is unknown, report this as an error.
      */
     if ((user = usm_get_user_from_list(secEngineID, *secEngineIDLen,
-                                       secName, *secNameLen, userList,
+                                       secName, *secNameLen,
                                        (((sess && sess->isAuthoritative ==
                                           SNMP_SESS_AUTHORITATIVE) ||
                                          (!sess)) ? 0 : 1)))
@@ -3587,8 +3745,7 @@ usm_create_user_from_session(netsnmp_session * session)
     user = usm_get_user_from_list(session->securityEngineID,
                                   session->securityEngineIDLen,
                                   session->securityName,
-                                  session->securityNameLen,
-                                  usm_get_userList(), 0);
+                                  session->securityNameLen, 0);
     if (NULL != user) {
         DEBUGMSGTL(("usm", "user exists x=%p\n", user));
     } else {
@@ -3913,12 +4070,15 @@ clear_user_list(void)
 {
     struct usmUser *tmp = userList, *next = NULL;
 
+    SNMP_FREE(userHash);
+    userHashSize = userCount = 0;
     while (tmp != NULL) {
 	next = tmp->next;
 	usm_free_user(tmp);
 	tmp = next;
     }
     userList = NULL;
+    userListSorted = 1;
 
 }
 
@@ -4178,7 +4338,7 @@ usm_save_users_from_list(struct usmUser *puserList, const char *token,
 static void
 usm_save_users(const char *token, const char *type)
 {
-    usm_save_users_from_list(userList, token, type);
+    usm_save_users_from_list(usm_get_userList(), token, type);
 }
 
 /*
@@ -4486,6 +4646,38 @@ usm_set_user_password(struct usmUser *user, const char *token, char *line)
     }
 }                               /* end usm_set_password() */
 
+/*
+ * Localizes a createUser passphrase for user, or takes the key saved for
+ * the user and its engineID when persistentKeyCache is enabled.
+ */
+static int
+usm_kul_from_passphrase(struct usmUser *user, int which, const char *pass,
+                        u_char *Kul, size_t *kul_len)
+{
+    int             rc;
+
+    if (usm_persistent_keycache &&
+        netsnmp_keycache_get_kul(user->name, which, user->authProtocol,
+                                 user->authProtocolLen, user->engineID,
+                                 user->engineIDLen, (const u_char *) pass,
+                                 strlen(pass), Kul, kul_len) ==
+        SNMPERR_SUCCESS)
+        return SNMPERR_SUCCESS;
+
+    rc = netsnmp_generate_kul_from_passphrase(user->authProtocol,
+                                              user->authProtocolLen,
+                                              user->engineID,
+                                              user->engineIDLen,
+                                              (const u_char *) pass,
+                                              strlen(pass), Kul, kul_len);
+    if (rc == SNMPERR_SUCCESS && usm_persistent_keycache)
+        netsnmp_keycache_save_kul(user->name, which, user->authProtocol,
+                                  user->authProtocolLen, user->engineID,
+                                  user->engineIDLen, (const u_char *) pass,
+                                  strlen(pass), Kul, *kul_len);
+    return rc;
+}
+
 /*
  * create a usm user from a string.
  *
@@ -4497,9 +4689,12 @@ usm_set_user_password(struct usmUser *user, const char *token, char *line)
  *    char pointer is provided in errorMsg, an error string is returned.
  *    This error string points to a static message, and should not be
  *    freed.
+ * If pending is not NULL, the passphrases are stored there, and the keys
+ *    derived from them are left to usm_set_user_keys().
  */
 static struct usmUser *
-usm_create_usmUser_from_string(char *line, const char **errorMsg)
+usm_create_usmUser_from_string(char *line, const char **errorMsg,
+                               struct usm_pending_keys *pending)
 {
     char           *cp;
     const char     *dummy;
@@ -4509,7 +4704,7 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
     size_t          userKeyLen = SNMP_MAXBUF_SMALL;
     size_t          privKeySize;
     size_t          ret;
-    int             ret2, properLen, properPrivKeyLen;
+    int             ret2, properLen, properPrivKeyLen, from_pass = 0;
     const oid      *def_auth_prot, *def_priv_prot;
     size_t          def_auth_prot_len, def_priv_prot_len;
     netsnmp_priv_alg_info *pai;
@@ -4666,15 +4861,17 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
         }
     } else if (strcmp(buf,"-l") != 0) {
         /* a password is specified */
-        userKeyLen = sizeof(userKey);
-        ret2 = generate_Ku(newuser->authProtocol, newuser->authProtocolLen,
-                          (u_char *) buf, strlen(buf), userKey, &userKeyLen);
-        if (ret2 != SNMPERR_SUCCESS) {
-            *errorMsg = "could not generate the authentication key from the supplied pass phrase.";
-            goto fail;
-        }
+        from_pass = 1;
         /* save master key */
         if (newuser->flags & USMUSER_FLAG_KEEP_MASTER_KEY) {
+            userKeyLen = sizeof(userKey);
+            ret2 = generate_Ku(newuser->authProtocol,
+                               newuser->authProtocolLen, (u_char *) buf,
+                               strlen(buf), userKey, &userKeyLen);
+            if (ret2 != SNMPERR_SUCCESS) {
+                *errorMsg = "could not generate the authentication key from the supplied pass phrase.";
+                goto fail;
+            }
             newuser->authKeyKu = netsnmp_memdup(userKey, userKeyLen);
             newuser->authKeyKuLen = userKeyLen;
         }
@@ -4706,6 +4903,21 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
             *errorMsg = "improper key length to -l";
             goto fail;
         }
+    } else if (from_pass && pending && strlen(buf) >= USM_LENGTH_P_MIN) {
+        pending->authPass = strdup(buf);
+        if (pending->authPass == NULL) {
+            *errorMsg = "malloc failed";
+            goto fail;
+        }
+        memset(newuser->authKey, 0, newuser->authKeyLen);
+    } else if (from_pass) {
+        ret2 = usm_kul_from_passphrase(newuser, NETSNMP_KEYCACHE_AUTHKEY,
+                                       buf, newuser->authKey,
+                                       &newuser->authKeyLen);
+        if (ret2 != SNMPERR_SUCCESS) {
+            *errorMsg = "could not generate the authentication key from the supplied pass phrase.";
+            goto fail;
+        }
     } else {
         ret2 = generate_kul(newuser->authProtocol, newuser->authProtocolLen,
                            newuser->engineID, newuser->engineIDLen,
@@ -4799,6 +5011,8 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
         newuser->privKey = netsnmp_memdup(newuser->authKey,
                                           newuser->authKeyLen);
         privKeySize = newuser->privKeyLen = newuser->authKeyLen;
+        if (pending && pending->authPass)
+            pending->privFromAuth = 1;
         if (newuser->flags & USMUSER_FLAG_KEEP_MASTER_KEY) {
             newuser->privKeyKu = netsnmp_memdup(newuser->authKeyKu,
                                                 newuser->authKeyKuLen);
@@ -4806,6 +5020,7 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
         }
     } else {
         cp = copy_nword(cp, buf, sizeof(buf));
+        from_pass = 0;
         
         if (strcmp(buf,"-m") == 0) {
             /* a master key is specified */
@@ -4824,15 +5039,17 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
             }
         } else if (strcmp(buf,"-l") != 0) {
             /* a password is specified */
-            userKeyLen = sizeof(userKey);
-            ret2 = generate_Ku(newuser->authProtocol, newuser->authProtocolLen,
-                              (u_char*)buf, strlen(buf), userKey, &userKeyLen);
-            if (ret2 != SNMPERR_SUCCESS) {
-                *errorMsg = "could not generate the privacy key from the supplied pass phrase.";
-                goto fail;
-            }
+            from_pass = 1;
             /* save master key */
             if (newuser->flags & USMUSER_FLAG_KEEP_MASTER_KEY) {
+                userKeyLen = sizeof(userKey);
+                ret2 = generate_Ku(newuser->authProtocol,
+                                   newuser->authProtocolLen, (u_char*)buf,
+                                   strlen(buf), userKey, &userKeyLen);
+                if (ret2 != SNMPERR_SUCCESS) {
+                    *errorMsg = "could not generate the privacy key from the supplied pass phrase.";
+                    goto fail;
+                }
                 newuser->privKeyKu = netsnmp_memdup(userKey, userKeyLen);
                 newuser->privKeyKuLen = userKeyLen;
             }
@@ -4856,6 +5073,23 @@ usm_create_usmUser_from_string(char *line, const char **errorMsg)
                 *errorMsg = "invalid key value argument to -l";
                 goto fail;
             }
+        } else if (from_pass && pending && strlen(buf) >= USM_LENGTH_P_MIN) {
+            pending->privPass = strdup(buf);
+            if (pending->privPass == NULL) {
+                *errorMsg = "malloc failed";
+                goto fail;
+            }
+            memset(newuser->privKey, 0, privKeySize);
+            pending->privKeySize = privKeySize;
+            pending->properPrivKeyLen = properPrivKeyLen;
+        } else if (from_pass) {
+            ret2 = usm_kul_from_passphrase(newuser, NETSNMP_KEYCACHE_PRIVKEY,
+                                           buf, newuser->privKey,
+                                           &newuser->privKeyLen);
+            if (ret2 != SNMPERR_SUCCESS) {
+                *errorMsg = "could not generate the privacy key from the supplied pass phrase.";
+                goto fail;
+            }
         } else {
             ret2 = generate_kul(newuser->authProtocol, newuser->authProtocolLen,
                                newuser->engineID, newuser->engineIDLen,
@@ -4906,9 +5140,165 @@ void
 usm_parse_create_usmUser(const char *token, char *line)
 {
     const char *error = NULL;
-    usm_create_usmUser_from_string(line, &error);
+    struct usm_pending_keys *pk = NULL;
+    struct usmUser *user;
+
+    /*
+     * while the configuration files are read, only collect passphrases
+     */
+    if (usm_reading_config)
+        pk = SNMP_MALLOC_STRUCT(usm_pending_keys);
+    user = usm_create_usmUser_from_string(line, &error, pk);
     if (error)
         config_perror(error);
+    if (user && pk && (pk->authPass || pk->privPass)) {
+        pk->user = user;
+        user->flags |= USMUSER_FLAG_KEYS_PENDING;
+        pk->next = usm_pending_keys;
+        usm_pending_keys = pk;
+    } else if (pk)
+        usm_free_pending_keys(pk);
+}
+
+/*
+ * Turns the passphrases collected by usm_parse_create_usmUser() into the
+ * keys of their user, like usm_create_usmUser_from_string() would have.
+ */
+static int
+usm_set_user_keys(struct usm_pending_keys *pk)
+{
+    struct usmUser *user = pk->user;
+    size_t          len;
+
+    if (pk->authPass) {
+        len = user->authKeyLen;
+        if (usm_kul_from_passphrase(user, NETSNMP_KEYCACHE_AUTHKEY,
+                                    pk->authPass, user->authKey,
+                                    &len) != SNMPERR_SUCCESS)
+            return SNMPERR_GENERR;
+        user->authKeyLen = len;
+        if (pk->privFromAuth)
+            memcpy(user->privKey, user->authKey, user->privKeyLen);
+    }
+    if (pk->privPass) {
+        len = pk->privKeySize;
+        if (usm_kul_from_passphrase(user, NETSNMP_KEYCACHE_PRIVKEY,
+                                    pk->privPass, user->privKey,
+                                    &len) != SNMPERR_SUCCESS)
+            return SNMPERR_GENERR;
+        user->privKeyLen = len;
+        if (user->privKeyLen < pk->properPrivKeyLen &&
+            usm_extend_user_kul(user, pk->properPrivKeyLen) !=
+            SNMPERR_SUCCESS)
+            return SNMPERR_GENERR;
+        if (user->privKeyLen < pk->properPrivKeyLen)
+            return SNMPERR_GENERR;
+        user->privKeyLen = pk->properPrivKeyLen;
+    }
+    return SNMPERR_SUCCESS;
+}
+
+static int
+usm_collect_pending_keys(int majorID, int minorID, void *serverarg,
+                         void *clientarg)
+{
+    usm_reading_config = 1;
+    return SNMPERR_SUCCESS;
+}
+
+static int
+usm_set_pending_keys(int majorID, int minorID, void *serverarg,
+                     void *clientarg)
+{
+    struct usm_pending_keys *pk;
+    struct usmUser *user;
+    const char     *name;
+
+    usm_reading_config = 0;
+    /*
+     * the keys saved before the cache was disabled won't be used, or
+     * stored again
+     */
+    if (!usm_persistent_keycache)
+        netsnmp_keycache_clear_saved();
+
+    for (pk = usm_pending_keys; pk; pk = pk->next) {
+        user = pk->user;
+        name = usm_persistent_keycache ? user->name : NULL;
+        if (pk->authPass)
+            netsnmp_keycache_prefetch(name, NETSNMP_KEYCACHE_AUTHKEY,
+                                      user->authProtocol,
+                                      user->authProtocolLen,
+                                      user->engineID, user->engineIDLen,
+                                      (u_char *) pk->authPass,
+                                      strlen(pk->authPass));
+        if (pk->privPass)
+            netsnmp_keycache_prefetch(name, NETSNMP_KEYCACHE_PRIVKEY,
+                                      user->authProtocol,
+                                      user->authProtocolLen,
+                                      user->engineID, user->engineIDLen,
+                                      (u_char *) pk->privPass,
+                                      strlen(pk->privPass));
+    }
+    netsnmp_keycache_prefetch_run(usm_key_threads);
+
+    while ((pk = usm_pending_keys) != NULL) {
+        usm_pending_keys = pk->next;
+        user = pk->user;
+        user->flags &= ~USMUSER_FLAG_KEYS_PENDING;
+        if (usm_set_user_keys(pk) != SNMPERR_SUCCESS) {
+            snmp_log(LOG_ERR, "could not generate the keys of user %s "
+                     "from the supplied pass phrases\n", user->name);
+            usm_remove_user(user);
+            usm_free_user(user);
+        }
+        usm_free_pending_keys(pk);
+    }
+    return SNMPERR_SUCCESS;
+}
+
+static void
+usm_parse_key_threads(const char *token, char *line)
+{
+    usm_key_threads = atoi(line);
+    if (usm_key_threads < 0) {
+        config_perror("keyDerivationThreads must not be negative");
+        usm_key_threads = 0;
+    }
+}
+
+static void
+usm_parse_persistent_keycache(const char *token, char *line)
+{
+    int             val = netsnmp_ds_parse_boolean(line);
+
+    if (val < 0)
+        config_perror("persistentKeyCache must be yes or no");
+    else
+        usm_persistent_keycache = val;
+}
+
+static int
+usm_store_keycache(int majorID, int minorID, void *serverarg,
+                   void *clientarg)
+{
+    char           *appname = (char *) clientarg;
+
+    if (!usm_persistent_keycache)
+        return SNMPERR_SUCCESS;
+    if (appname == NULL)
+        appname = netsnmp_ds_get_string(NETSNMP_DS_LIBRARY_ID,
+                                        NETSNMP_DS_LIB_APPTYPE);
+    netsnmp_keycache_store("usmKeyCache", appname);
+    return SNMPERR_SUCCESS;
+}
+
+static int
+usm_free_keycache(int majorID, int minorID, void *serverarg,
+                  void *clientarg)
+{
+    netsnmp_keycache_clear();
+    return SNMPERR_SUCCESS;
 }
 
 static void
@@ -4963,12 +5353,27 @@ init_usm_conf(const char *app)
     register_config_handler(app, "createUser",
                                   usm_parse_create_usmUser, NULL,
                                   "username [-e ENGINEID] (MD5|SHA|SHA-512|SHA-384|SHA-256|SHA-224|default) authpassphrase [(DES|AES|default) [privpassphrase]]");
+    register_prenetsnmp_mib_handler(app, "keyDerivationThreads",
+                                    usm_parse_key_threads, NULL, "NUM");
+    register_prenetsnmp_mib_handler(app, "persistentKeyCache",
+                                    usm_parse_persistent_keycache, NULL,
+                                    "yes|no");
+    register_prenetsnmp_mib_handler(app, "usmKeyCache",
+                                    netsnmp_keycache_parse, NULL, NULL);
 
     /*
      * we need to be called back later
      */
     snmp_register_callback(SNMP_CALLBACK_LIBRARY, SNMP_CALLBACK_STORE_DATA,
                            usm_store_users, NULL);
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY, SNMP_CALLBACK_STORE_DATA,
+                           usm_store_keycache, NULL);
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                           SNMP_CALLBACK_PRE_READ_CONFIG,
+                           usm_collect_pending_keys, NULL);
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                           SNMP_CALLBACK_POST_READ_CONFIG,
+                           usm_set_pending_keys, NULL);
 }
 
 /*
@@ -5107,6 +5512,12 @@ init_usm(void)
     snmp_register_callback(SNMP_CALLBACK_LIBRARY,
                            SNMP_CALLBACK_SHUTDOWN,
                            free_enginetime_on_shutdown, NULL);
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                           SNMP_CALLBACK_SHUTDOWN,
+                           sc_shutdown, NULL);
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                           SNMP_CALLBACK_SHUTDOWN,
+                           usm_free_keycache, NULL);
 
 
     type = netsnmp_ds_get_string(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_APPTYPE);
@@ -1507,6 +1507,8 @@ _transport_common(netsnmp_transport *t, int local)
     t->f_accept        = NULL;
     t->f_fmtaddr       = netsnmp_dtlsudp4_fmtaddr;
     t->f_get_taddr     = netsnmp_ipv4_get_taddr;
+    t->f_recv_batch    = NULL;
+    t->f_send_batch    = NULL;
 
     t->flags = NETSNMP_TRANSPORT_FLAG_TUNNELED;
 
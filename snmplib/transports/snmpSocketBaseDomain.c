@@ -38,11 +38,13 @@
 #include <net-snmp/library/default_store.h>
 #include <net-snmp/library/system.h>
 #include <net-snmp/library/snmp_assert.h>
+#include <net-snmp/library/fd_event_manager.h>
 
 /* all sockets pretty much close the same way */
 int netsnmp_socketbase_close(netsnmp_transport *t) {
     int rc = -1;
     if (t->sock >= 0) {
+        netsnmp_event_loop_forget_fd(t->sock);
 #ifndef HAVE_CLOSESOCKET
         rc = close(t->sock);
 #else
@@ -60,6 +60,30 @@
 #define MSG_DONTWAIT 0
 #endif
 
+/*
+ * Set by netsnmp_udp_set_reuseport(): listening sockets opened while this
+ * is non-zero get SO_REUSEPORT.
+ */
+static int udp_reuseport;
+
+/*
+ * Make UDP listening sockets opened from now on use SO_REUSEPORT, so that
+ * several of them can be bound to the same address and the kernel spreads
+ * the incoming datagrams over them.  Returns 0 on success or -1 if the
+ * platform does not support SO_REUSEPORT.
+ */
+int
+netsnmp_udp_set_reuseport(int onoff)
+{
+#ifdef SO_REUSEPORT
+    udp_reuseport = onoff;
+    return 0;
+#else
+    udp_reuseport = 0;
+    return onoff ? -1 : 0;
+#endif
+}
+
 void
 _netsnmp_udp_sockopt_set(int fd, int local)
 {
@@ -98,6 +122,17 @@ _netsnmp_udp_sockopt_set(int fd, int local)
 #endif                          /*SO_REUSEADDR */
 #endif
 
+#ifdef  SO_REUSEPORT
+    if (local && udp_reuseport) {
+        int             one = 1;
+        DEBUGMSGTL(("socket:option", "setting socket option SO_REUSEPORT\n"));
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (void *) &one,
+                       sizeof(one)) < 0)
+            DEBUGMSGTL(("socket:option", "couldn't set SO_REUSEPORT: %s\n",
+                        strerror(errno)));
+    }
+#endif                          /*SO_REUSEPORT */
+
     /*
      * Try to set the send and receive buffers to a reasonably large value, so
      * that we can send and receive big PDUs (defaults to 8192 bytes (!) on
@@ -133,6 +168,40 @@ static LPFN_WSARECVMSG pfWSARecvMsg;
 static LPFN_WSASENDMSG pfWSASendMsg;
 #endif
 
+#if !defined(WIN32)
+/*
+ * Extracts the local address a datagram was sent to from the control
+ * messages returned by recvmsg().
+ */
+static void
+_udpbase_get_dstaddr(struct msghdr *msg, struct sockaddr *dstip,
+                     int *if_index)
+{
+    struct cmsghdr *cm;
+
+    for (cm = CMSG_FIRSTHDR(msg); cm != NULL; cm = CMSG_NXTHDR(msg, cm)) {
+#if defined(HAVE_IP_PKTINFO)
+        if (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_PKTINFO) {
+            struct in_pktinfo* src = (struct in_pktinfo *)CMSG_DATA(cm);
+            netsnmp_assert(dstip->sa_family == AF_INET);
+            ((struct sockaddr_in*)dstip)->sin_addr = src->ipi_addr;
+            *if_index = src->ipi_ifindex;
+            DEBUGMSGTL(("udpbase:recv",
+                        "got destination (local) addr %s, iface %d\n",
+                        inet_ntoa(src->ipi_addr), *if_index));
+        }
+#elif defined(HAVE_IP_RECVDSTADDR)
+        if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_RECVDSTADDR) {
+            struct in_addr* src = (struct in_addr *)CMSG_DATA(cm);
+            ((struct sockaddr_in*)dstip)->sin_addr = *src;
+            DEBUGMSGTL(("netsnmp_udp", "got destination (local) addr %s\n",
+                        inet_ntoa(*src)));
+        }
+#endif
+    }
+}
+#endif /* !defined(WIN32) */
+
 int
 netsnmp_udpbase_recvfrom(int s, void *buf, int len, struct sockaddr *from,
                          socklen_t *fromlen, struct sockaddr *dstip,
@@ -142,7 +211,6 @@ netsnmp_udpbase_recvfrom(int s, void *buf, int len, struct sockaddr *from,
 #if !defined(WIN32)
     struct iovec iov;
     char cmsg[CMSG_SPACE(cmsg_data_size)];
-    struct cmsghdr *cm;
     struct msghdr msg;
 
     iov.iov_base = buf;
@@ -198,26 +266,7 @@ netsnmp_udpbase_recvfrom(int s, void *buf, int len, struct sockaddr *from,
     }
 
 #if !defined(WIN32)
-    for (cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm)) {
-#if defined(HAVE_IP_PKTINFO)
-        if (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_PKTINFO) {
-            struct in_pktinfo* src = (struct in_pktinfo *)CMSG_DATA(cm);
-            netsnmp_assert(dstip->sa_family == AF_INET);
-            ((struct sockaddr_in*)dstip)->sin_addr = src->ipi_addr;
-            *if_index = src->ipi_ifindex;
-            DEBUGMSGTL(("udpbase:recv",
-                        "got destination (local) addr %s, iface %d\n",
-                        inet_ntoa(src->ipi_addr), *if_index));
-        }
-#elif defined(HAVE_IP_RECVDSTADDR)
-        if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_RECVDSTADDR) {
-            struct in_addr* src = (struct in_addr *)CMSG_DATA(cm);
-            ((struct sockaddr_in*)dstip)->sin_addr = *src;
-            DEBUGMSGTL(("netsnmp_udp", "got destination (local) addr %s\n",
-                        inet_ntoa(*src)));
-        }
-#endif
-    }
+    _udpbase_get_dstaddr(&msg, dstip, if_index);
 #else /* !defined(WIN32) */
     for (cm = WSA_CMSG_FIRSTHDR(&msg); cm; cm = WSA_CMSG_NXTHDR(&msg, cm)) {
         if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_PKTINFO) {
@@ -530,6 +579,184 @@ netsnmp_udpbase_send(netsnmp_transport *t, const void *buf, int size,
     return rc;
 }
 
+#if defined(HAVE_IP_PKTINFO) && !defined(WIN32)
+#ifdef HAVE_RECVMMSG
+/*
+ * Receives up to count datagrams with a single recvmmsg() call.  Each
+ * message gets its own address pair, as netsnmp_udpbase_recv() does.
+ */
+int
+netsnmp_udpbase_recv_batch(netsnmp_transport *t, netsnmp_transport_msg *msgs,
+                           int count)
+{
+    struct mmsghdr  mmsg[NETSNMP_TRANSPORT_BATCH_MAX];
+    struct iovec    iov[NETSNMP_TRANSPORT_BATCH_MAX];
+    char            cmsg[NETSNMP_TRANSPORT_BATCH_MAX][CMSG_SPACE(cmsg_data_size)];
+    netsnmp_indexed_addr_pair *addr_pair[NETSNMP_TRANSPORT_BATCH_MAX];
+    netsnmp_sockaddr_storage local_addr;
+    socklen_t       local_addr_len = sizeof(local_addr);
+    int             rc, i, saved_errno;
+
+    if (t == NULL || t->sock < 0)
+        return -1;
+    if (count > NETSNMP_TRANSPORT_BATCH_MAX)
+        count = NETSNMP_TRANSPORT_BATCH_MAX;
+
+    for (i = 0; i < count; i++) {
+        addr_pair[i] = SNMP_MALLOC_TYPEDEF(netsnmp_indexed_addr_pair);
+        if (addr_pair[i] == NULL)
+            break;
+        iov[i].iov_base = msgs[i].packet;
+        iov[i].iov_len = msgs[i].length;
+        memset(&mmsg[i], 0, sizeof(mmsg[i]));
+        mmsg[i].msg_hdr.msg_name = &addr_pair[i]->remote_addr;
+        mmsg[i].msg_hdr.msg_namelen = sizeof(addr_pair[i]->remote_addr);
+        mmsg[i].msg_hdr.msg_iov = &iov[i];
+        mmsg[i].msg_hdr.msg_iovlen = 1;
+        mmsg[i].msg_hdr.msg_control = cmsg[i];
+        mmsg[i].msg_hdr.msg_controllen = sizeof(cmsg[i]);
+    }
+    count = i;
+    if (count == 0)
+        return -1;
+
+    do {
+        rc = recvmmsg(t->sock, mmsg, count, MSG_DONTWAIT, NULL);
+    } while (rc < 0 && errno == EINTR);
+    saved_errno = errno;
+
+    if (rc > 0 && getsockname(t->sock, &local_addr.sa, &local_addr_len) != 0)
+        memset(&local_addr, 0, sizeof(local_addr));
+
+    for (i = 0; i < rc; i++) {
+        memcpy(&addr_pair[i]->local_addr, &local_addr, sizeof(local_addr));
+        _udpbase_get_dstaddr(&mmsg[i].msg_hdr, &addr_pair[i]->local_addr.sa,
+                             &addr_pair[i]->if_index);
+        msgs[i].length = mmsg[i].msg_len;
+        msgs[i].opaque = addr_pair[i];
+        msgs[i].olength = sizeof(netsnmp_indexed_addr_pair);
+        DEBUGIF("netsnmp_udp") {
+            char *str = netsnmp_udp_fmtaddr(
+                NULL, addr_pair[i], sizeof(netsnmp_indexed_addr_pair));
+            DEBUGMSGTL(("netsnmp_udp",
+                        "recvmmsg fd %d got %d bytes (from %s)\n",
+                        t->sock, msgs[i].length, str));
+            free(str);
+        }
+    }
+    for (i = rc < 0 ? 0 : rc; i < count; i++)
+        free(addr_pair[i]);
+
+    if (rc < 0) {
+        DEBUGMSGTL(("netsnmp_udp", "recvmmsg fd %d err %d (\"%s\")\n",
+                    t->sock, saved_errno, strerror(saved_errno)));
+        errno = saved_errno;
+    }
+    return rc;
+}
+#endif /* HAVE_RECVMMSG */
+
+#ifdef HAVE_SENDMMSG
+/*
+ * Sends up to count datagrams with a single sendmmsg() call.  Anything
+ * out of the ordinary (unknown address types, errors that need a retry
+ * with different source address options) is left to netsnmp_udpbase_send().
+ */
+int
+netsnmp_udpbase_send_batch(netsnmp_transport *t, netsnmp_transport_msg *msgs,
+                           int count)
+{
+    struct mmsghdr  mmsg[NETSNMP_TRANSPORT_BATCH_MAX];
+    struct iovec    iov[NETSNMP_TRANSPORT_BATCH_MAX];
+    char            cmsg[NETSNMP_TRANSPORT_BATCH_MAX][CMSG_SPACE(cmsg_data_size)];
+    const netsnmp_indexed_addr_pair *addr_pair;
+    const struct in_addr *srcip;
+    struct cmsghdr *cm;
+    int             use_srcip = TRUE;
+    int             rc, i;
+
+    if (t == NULL || t->sock < 0)
+        return -1;
+    if (count > NETSNMP_TRANSPORT_BATCH_MAX)
+        count = NETSNMP_TRANSPORT_BATCH_MAX;
+
+#ifdef HAVE_SO_BINDTODEVICE
+    {
+        /* see netsnmp_udpbase_sendto_unix() */
+        char      iface[IFNAMSIZ];
+        socklen_t ifacelen = IFNAMSIZ;
+
+        if (getsockopt(t->sock, SOL_SOCKET, SO_BINDTODEVICE, iface,
+                       &ifacelen) == 0 && ifacelen != 0)
+            use_srcip = FALSE;
+    }
+#endif /* HAVE_SO_BINDTODEVICE */
+
+    for (i = 0; i < count; i++) {
+        if (msgs[i].opaque != NULL &&
+            msgs[i].olength == sizeof(netsnmp_indexed_addr_pair))
+            addr_pair = (const netsnmp_indexed_addr_pair *) msgs[i].opaque;
+        else if (msgs[i].opaque == NULL && t->data != NULL &&
+                 t->data_length == sizeof(netsnmp_indexed_addr_pair))
+            addr_pair = (const netsnmp_indexed_addr_pair *) t->data;
+        else
+            break;
+
+        iov[i].iov_base = msgs[i].packet;
+        iov[i].iov_len = msgs[i].length;
+        memset(&mmsg[i], 0, sizeof(mmsg[i]));
+        mmsg[i].msg_hdr.msg_name =
+            NETSNMP_REMOVE_CONST(void *, &addr_pair->remote_addr.sa);
+        mmsg[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        mmsg[i].msg_hdr.msg_iov = &iov[i];
+        mmsg[i].msg_hdr.msg_iovlen = 1;
+
+        srcip = &addr_pair->local_addr.sin.sin_addr;
+        if (!use_srcip || srcip->s_addr == INADDR_ANY)
+            continue;
+
+        memset(cmsg[i], 0, sizeof(cmsg[i]));
+        mmsg[i].msg_hdr.msg_control = cmsg[i];
+        mmsg[i].msg_hdr.msg_controllen = sizeof(cmsg[i]);
+        cm = CMSG_FIRSTHDR(&mmsg[i].msg_hdr);
+        cm->cmsg_len = CMSG_LEN(cmsg_data_size);
+        cm->cmsg_level = SOL_IP;
+        cm->cmsg_type = IP_PKTINFO;
+#ifdef HAVE_STRUCT_IN_PKTINFO_IPI_SPEC_DST
+        {
+            struct in_pktinfo ipi;
+
+            memset(&ipi, 0, sizeof(ipi));
+            ipi.ipi_spec_dst.s_addr = srcip->s_addr;
+            memcpy(CMSG_DATA(cm), &ipi, sizeof(ipi));
+        }
+#endif
+    }
+
+    if (i == 0)
+        return netsnmp_udpbase_send(t, msgs[0].packet, msgs[0].length,
+                                    &msgs[0].opaque, &msgs[0].olength) < 0 ?
+            -1 : 1;
+
+    do {
+        rc = sendmmsg(t->sock, mmsg, i, MSG_DONTWAIT);
+    } while (rc < 0 && errno == EINTR);
+
+    if (rc <= 0) {
+        DEBUGMSGTL(("netsnmp_udp", "sendmmsg fd %d err %d, retrying singly\n",
+                    t->sock, errno));
+        return netsnmp_udpbase_send(t, msgs[0].packet, msgs[0].length,
+                                    &msgs[0].opaque, &msgs[0].olength) < 0 ?
+            -1 : 1;
+    }
+
+    DEBUGMSGTL(("netsnmp_udp", "sendmmsg fd %d sent %d of %d messages\n",
+                t->sock, rc, count));
+    return rc;
+}
+#endif /* HAVE_SENDMMSG */
+#endif /* HAVE_IP_PKTINFO && !WIN32 */
+
 void
 netsnmp_udp_base_ctor(void)
 {
@@ -145,6 +145,14 @@ netsnmp_udp_transport_base(netsnmp_transport *t)
     t->f_accept   = NULL;
     t->f_fmtaddr  = netsnmp_udp_fmtaddr;
     t->f_get_taddr = netsnmp_ipv4_get_taddr;
+#if defined(HAVE_IP_PKTINFO) && !defined(WIN32)
+#ifdef HAVE_RECVMMSG
+    t->f_recv_batch = netsnmp_udpbase_recv_batch;
+#endif
+#ifdef HAVE_SENDMMSG
+    t->f_send_batch = netsnmp_udpbase_send_batch;
+#endif
+#endif
 
     return t;
 }
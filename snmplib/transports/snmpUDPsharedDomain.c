@@ -179,6 +179,8 @@ _transport_common(netsnmp_transport *t)
     t->f_fmtaddr       = _udpshared_fmtaddr;
     t->f_setup_session = _setup_session;
     t->flags = NETSNMP_TRANSPORT_FLAG_SHARED;
+    t->f_recv_batch    = NULL;
+    t->f_send_batch    = NULL;
     if (t->base_transport->domain == netsnmpUDPDomain)
         t->f_get_taddr = netsnmp_ipv4_get_taddr;
     else if (t->base_transport->domain == netsnmp_UDPIPv6Domain)
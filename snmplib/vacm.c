@@ -67,6 +67,8 @@ static struct vacm_viewEntry *viewList = NULL, *viewScanPtr = NULL;
 static struct vacm_accessEntry *accessList = NULL, *accessScanPtr = NULL;
 static struct vacm_groupEntry *groupList = NULL, *groupScanPtr = NULL;
 
+static void     vacm_config_changed(void);
+
 /*
  * Macro to extend view masks with 1 bits when shorter than subtree lengths
  * REF: vacmViewTreeFamilyMask [RFC3415], snmpNotifyFilterMask [RFC3413]
@@ -171,7 +173,7 @@ vacm_parse_config_view(const char *token, const char *line)
     struct vacm_viewEntry *vptr;
     char           *viewName = (char *) &view.viewName;
     oid            *viewSubtree = (oid *) & view.viewSubtree;
-    u_char         *viewMask;
+    u_char         *viewMask = view.viewMask;
     size_t          len;
 
     view.viewStatus = atoi(line);
@@ -195,13 +197,13 @@ vacm_parse_config_view(const char *token, const char *line)
         return;
     }
 
-    vptr->viewStatus = view.viewStatus;
+    vacm_setViewStatus(vptr, view.viewStatus);
     vptr->viewStorageType = view.viewStorageType;
-    vptr->viewType = view.viewType;
-    viewMask = vptr->viewMask;
-    vptr->viewMaskLen = sizeof(vptr->viewMask);
-    line =
-        read_config_read_octet_string(line, &viewMask, &vptr->viewMaskLen);
+    vacm_setViewType(vptr, view.viewType);
+    memset(view.viewMask, 0, sizeof(view.viewMask));
+    len = sizeof(view.viewMask);
+    line = read_config_read_octet_string(line, &viewMask, &len);
+    vacm_setViewMask(vptr, view.viewMask, len);
 }
 
 /*
@@ -318,11 +320,11 @@ _vacm_parse_config_access_common(struct vacm_accessEntry **aptr,
     if (!*aptr)
         return NULL;
 
-    (*aptr)->status = access.status;
+    vacm_setAccessStatus(*aptr, access.status);
     (*aptr)->storageType   = access.storageType;
     (*aptr)->securityModel = access.securityModel;
     (*aptr)->securityLevel = access.securityLevel;
-    (*aptr)->contextMatch  = access.contextMatch;
+    vacm_setAccessContextMatch(*aptr, access.contextMatch);
     return NETSNMP_REMOVE_CONST(char *, line);
 }
 
@@ -330,26 +332,24 @@ void
 vacm_parse_config_access(const char *token, const char *line)
 {
     struct vacm_accessEntry *aptr;
-    char           *readView, *writeView, *notifyView;
+    char            viewName[VACMSTRINGLEN];
+    char           *view = viewName;
     size_t          len;
+    int             i;
+    static const int views[] = {
+        VACM_VIEW_READ, VACM_VIEW_WRITE, VACM_VIEW_NOTIFY
+    };
 
     line = _vacm_parse_config_access_common(&aptr, line);
     if (!line)
         return;
 
-    readView = (char *) aptr->views[VACM_VIEW_READ];
-    len = sizeof(aptr->views[VACM_VIEW_READ]);
-    line =
-        read_config_read_octet_string(line, (u_char **) & readView, &len);
-    writeView = (char *) aptr->views[VACM_VIEW_WRITE];
-    len = sizeof(aptr->views[VACM_VIEW_WRITE]);
-    line =
-        read_config_read_octet_string(line, (u_char **) & writeView, &len);
-    notifyView = (char *) aptr->views[VACM_VIEW_NOTIFY];
-    len = sizeof(aptr->views[VACM_VIEW_NOTIFY]);
-    line =
-        read_config_read_octet_string(line, (u_char **) & notifyView,
-                                      &len);
+    for (i = 0; i < (int) (sizeof(views) / sizeof(views[0])); i++) {
+        memset(viewName, 0, sizeof(viewName));
+        len = sizeof(viewName);
+        line = read_config_read_octet_string(line, (u_char **) & view, &len);
+        vacm_setAccessView(aptr, views[i], viewName, strlen(viewName));
+    }
 }
 
 void
@@ -357,7 +357,8 @@ vacm_parse_config_auth_access(const char *token, const char *line)
 {
     struct vacm_accessEntry *aptr;
     int             authtype;
-    char           *view;
+    char            viewName[VACMSTRINGLEN];
+    char           *view = viewName;
     size_t          len;
 
     line = _vacm_parse_config_access_common(&aptr, line);
@@ -367,9 +368,10 @@ vacm_parse_config_auth_access(const char *token, const char *line)
     authtype = atoi(line);
     line = skip_token_const(line);
 
-    view = (char *) aptr->views[authtype];
-    len  = sizeof(aptr->views[authtype]);
+    memset(viewName, 0, sizeof(viewName));
+    len  = sizeof(viewName);
     line = read_config_read_octet_string(line, (u_char **) & view, &len);
+    vacm_setAccessView(aptr, authtype, viewName, strlen(viewName));
 }
 
 /*
@@ -406,7 +408,7 @@ vacm_parse_config_group(const char *token, const char *line)
     struct vacm_groupEntry group;
     struct vacm_groupEntry *gptr;
     char           *securityName = (char *) &group.securityName;
-    char           *groupName;
+    char           *groupName = (char *) &group.groupName;
     size_t          len;
 
     group.status = atoi(line);
@@ -424,12 +426,13 @@ vacm_parse_config_group(const char *token, const char *line)
     if (!gptr)
         return;
 
-    gptr->status = group.status;
+    vacm_setGroupStatus(gptr, group.status);
     gptr->storageType = group.storageType;
-    groupName = (char *) gptr->groupName;
+    memset(group.groupName, 0, sizeof(group.groupName));
     len = sizeof(group.groupName);
     line =
         read_config_read_octet_string(line, (u_char **) & groupName, &len);
+    vacm_setGroupName(gptr, group.groupName, strlen(group.groupName));
 }
 
 struct vacm_viewEntry *
@@ -749,6 +752,7 @@ netsnmp_view_create(struct vacm_viewEntry **head, const char *viewName,
         op->next = vp;
     else
         *head = vp;
+    vacm_config_changed();
     return vp;
 }
 
@@ -780,6 +784,7 @@ netsnmp_view_destroy(struct vacm_viewEntry **head, const char *viewName,
     if (vp->reserved)
         free(vp->reserved);
     free(vp);
+    vacm_config_changed();
     return;
 }
 
@@ -793,6 +798,7 @@ netsnmp_view_clear(struct vacm_viewEntry **head)
             free(vp->reserved);
         free(vp);
     }
+    vacm_config_changed();
 }
 
 struct vacm_groupEntry *
@@ -877,6 +883,7 @@ vacm_createGroupEntry(int securityModel, const char *securityName)
         groupList = gp;
     else
         og->next = gp;
+    vacm_config_changed();
     return gp;
 }
 
@@ -903,6 +910,7 @@ vacm_destroyGroupEntry(int securityModel, const char *securityName)
     if (vp->reserved)
         free(vp->reserved);
     free(vp);
+    vacm_config_changed();
     return;
 }
 
@@ -917,6 +925,7 @@ vacm_destroyAllGroupEntries(void)
             free(gp->reserved);
         free(gp);
     }
+    vacm_config_changed();
 }
 
 struct vacm_accessEntry *
@@ -1075,6 +1084,7 @@ vacm_createAccessEntry(const char *groupName,
         accessList = vp;
     else
         op->next = vp;
+    vacm_config_changed();
     return vp;
 }
 
@@ -1107,6 +1117,7 @@ vacm_destroyAccessEntry(const char *groupName,
     if (vp->reserved)
         free(vp->reserved);
     free(vp);
+    vacm_config_changed();
     return;
 }
 
@@ -1120,6 +1131,7 @@ vacm_destroyAllAccessEntries(void)
             free(ap->reserved);
         free(ap);
     }
+    vacm_config_changed();
 }
 
 int
@@ -1155,6 +1167,368 @@ vacm_is_configured(void)
     return 1;
 }
 
+/*
+ * Changes to existing entries that take part in access decisions.  Like
+ * the create and destroy functions, these discard the compiled views and
+ * cached access decisions, so they must be used instead of writing the
+ * fields directly.
+ */
+void
+vacm_setGroupName(struct vacm_groupEntry *gp, const char *name, size_t len)
+{
+    if (len >= sizeof(gp->groupName))
+        len = sizeof(gp->groupName) - 1;
+    memcpy(gp->groupName, name, len);
+    gp->groupName[len] = 0;
+    vacm_config_changed();
+}
+
+void
+vacm_setGroupStatus(struct vacm_groupEntry *gp, int status)
+{
+    gp->status = status;
+    vacm_config_changed();
+}
+
+void
+vacm_setAccessContextMatch(struct vacm_accessEntry *ap, int contextMatch)
+{
+    ap->contextMatch = contextMatch;
+    vacm_config_changed();
+}
+
+void
+vacm_setAccessView(struct vacm_accessEntry *ap, int view, const char *name,
+                   size_t len)
+{
+    if (view < 0 || view >= VACM_MAX_VIEWS)
+        return;
+    if (len >= sizeof(ap->views[view]))
+        len = sizeof(ap->views[view]) - 1;
+    memset(ap->views[view], 0, sizeof(ap->views[view]));
+    memcpy(ap->views[view], name, len);
+    vacm_config_changed();
+}
+
+void
+vacm_setAccessStatus(struct vacm_accessEntry *ap, int status)
+{
+    ap->status = status;
+    vacm_config_changed();
+}
+
+void
+vacm_setViewMask(struct vacm_viewEntry *vp, const u_char *mask, size_t len)
+{
+    if (len > sizeof(vp->viewMask))
+        len = sizeof(vp->viewMask);
+    memcpy(vp->viewMask, mask, len);
+    vp->viewMaskLen = len;
+    vacm_config_changed();
+}
+
+void
+vacm_setViewType(struct vacm_viewEntry *vp, int viewType)
+{
+    vp->viewType = viewType;
+    vacm_config_changed();
+}
+
+void
+vacm_setViewStatus(struct vacm_viewEntry *vp, int status)
+{
+    vp->viewStatus = status;
+    vacm_config_changed();
+}
+
+/*
+ * Compiled views and cached access decisions.
+ *
+ * The families of each view in viewList are compiled, on first use, into
+ * a tree keyed by sub-identifier.  A position that the family mask leaves
+ * out becomes a wildcard edge, so an OID is checked with a single walk
+ * down the tree instead of matching every family of the view.  The group
+ * and access entries chosen for a (securityModel, securityName, context,
+ * securityLevel) tuple are remembered as well.  Both are thrown away by
+ * vacm_config_changed(), which the functions above that create, change
+ * and destroy entries call, and nothing else.
+ */
+
+struct vacm_viewNode {
+    oid             subid;
+    struct vacm_viewEntry *entry;        /* best family ending here */
+    int             entry_pos;           /* its position in viewList */
+    struct vacm_viewNode *wildcard;
+    struct vacm_viewNode **children;     /* sorted by subid */
+    int             children_len;
+    int             children_max;
+};
+
+struct vacm_viewCompiled {
+    char            viewName[VACMSTRINGLEN];
+    struct vacm_viewNode *root;
+    struct vacm_viewCompiled *next;
+};
+
+static struct vacm_viewCompiled *compiledViews = NULL;
+
+#define VACM_ACCESS_CACHE_SIZE 64
+
+struct vacm_accessCache {
+    int             valid;
+    int             securityModel;
+    int             securityLevel;
+    char            securityName[VACMSTRINGLEN];
+    char            contextName[VACMSTRINGLEN];
+    struct vacm_groupEntry *group;
+    struct vacm_accessEntry *access;
+};
+
+static struct vacm_accessCache accessCache[VACM_ACCESS_CACHE_SIZE];
+
+static void
+vacm_freeViewNode(struct vacm_viewNode *node)
+{
+    int             i;
+
+    if (node == NULL)
+        return;
+    for (i = 0; i < node->children_len; i++)
+        vacm_freeViewNode(node->children[i]);
+    vacm_freeViewNode(node->wildcard);
+    free(node->children);
+    free(node);
+}
+
+/*
+ * Discards the compiled views and the cached access decisions.
+ */
+static void
+vacm_config_changed(void)
+{
+    struct vacm_viewCompiled *cv;
+
+    while ((cv = compiledViews)) {
+        compiledViews = cv->next;
+        vacm_freeViewNode(cv->root);
+        free(cv);
+    }
+    memset(accessCache, 0, sizeof(accessCache));
+}
+
+/*
+ * Same preference as netsnmp_view_get(): the longest family wins, then
+ * the lexicographically greater one, then the one found first in the list
+ * (the same subtree may be listed more than once, with different masks).
+ */
+static int
+vacm_viewIsBetter(const struct vacm_viewEntry *vp, int pos,
+                  const struct vacm_viewEntry *best, int best_pos)
+{
+    int             cmp;
+
+    if (best == NULL || vp->viewSubtreeLen != best->viewSubtreeLen)
+        return best == NULL || vp->viewSubtreeLen > best->viewSubtreeLen;
+    cmp = snmp_oid_compare(vp->viewSubtree + 1, vp->viewSubtreeLen - 1,
+                           best->viewSubtree + 1, best->viewSubtreeLen - 1);
+    return cmp > 0 || (cmp == 0 && pos < best_pos);
+}
+
+static struct vacm_viewNode *
+vacm_viewNodeChild(struct vacm_viewNode *node, oid subid, int create)
+{
+    struct vacm_viewNode *child, **children;
+    int             lo = 0, hi = node->children_len, mid, max;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (node->children[mid]->subid < subid)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < node->children_len && node->children[lo]->subid == subid)
+        return node->children[lo];
+    if (!create)
+        return NULL;
+
+    if (node->children_len == node->children_max) {
+        max = node->children_max ? 2 * node->children_max : 4;
+        children = (struct vacm_viewNode **)
+            realloc(node->children, max * sizeof(*children));
+        if (children == NULL)
+            return NULL;
+        node->children = children;
+        node->children_max = max;
+    }
+    child = SNMP_MALLOC_STRUCT(vacm_viewNode);
+    if (child == NULL)
+        return NULL;
+    child->subid = subid;
+    memmove(&node->children[lo + 1], &node->children[lo],
+            (node->children_len - lo) * sizeof(*node->children));
+    node->children[lo] = child;
+    node->children_len++;
+    return child;
+}
+
+static int
+vacm_viewNodeAdd(struct vacm_viewNode *node, struct vacm_viewEntry *vp,
+                 int pos)
+{
+    int             mask = 0x80;
+    unsigned int    oidpos, maskpos = 0;
+
+    for (oidpos = 0; oidpos < vp->viewSubtreeLen - 1; oidpos++) {
+        if (VIEW_MASK(vp, maskpos, mask) != 0) {
+            node = vacm_viewNodeChild(node, vp->viewSubtree[oidpos + 1], 1);
+        } else {
+            if (node->wildcard == NULL)
+                node->wildcard = SNMP_MALLOC_STRUCT(vacm_viewNode);
+            node = node->wildcard;
+        }
+        if (node == NULL)
+            return -1;
+        if (mask == 1) {
+            mask = 0x80;
+            maskpos++;
+        } else
+            mask >>= 1;
+    }
+    if (vacm_viewIsBetter(vp, pos, node->entry, node->entry_pos)) {
+        node->entry = vp;
+        node->entry_pos = pos;
+    }
+    return 0;
+}
+
+static void
+vacm_viewNodeFind(struct vacm_viewNode *node, const oid * name, size_t len,
+                  struct vacm_viewEntry **best, int *best_pos)
+{
+    for (; node; node = vacm_viewNodeChild(node, *name++, 0), len--) {
+        if (node->entry &&
+            vacm_viewIsBetter(node->entry, node->entry_pos, *best, *best_pos)) {
+            *best = node->entry;
+            *best_pos = node->entry_pos;
+        }
+        if (len == 0)
+            break;
+        if (node->wildcard)
+            vacm_viewNodeFind(node->wildcard, name + 1, len - 1,
+                              best, best_pos);
+    }
+}
+
+/*
+ * Returns the compiled form of a view of the global view list, compiling
+ * it if needed, or NULL if it can't be compiled.
+ */
+static struct vacm_viewCompiled *
+vacm_getCompiledView(const char *viewName)
+{
+    struct vacm_viewCompiled *cv;
+    struct vacm_viewEntry *vp;
+    int             glen, pos;
+
+    glen = (int) strlen(viewName);
+    if (glen < 0 || glen > VACM_MAX_STRING)
+        return NULL;
+    for (cv = compiledViews; cv; cv = cv->next)
+        if (cv->viewName[0] == glen &&
+            !memcmp(cv->viewName + 1, viewName, glen))
+            return cv;
+
+    cv = SNMP_MALLOC_STRUCT(vacm_viewCompiled);
+    if (cv == NULL)
+        return NULL;
+    cv->root = SNMP_MALLOC_STRUCT(vacm_viewNode);
+    if (cv->root == NULL) {
+        free(cv);
+        return NULL;
+    }
+    cv->viewName[0] = glen;
+    memcpy(cv->viewName + 1, viewName, glen);
+    for (vp = viewList, pos = 0; vp; vp = vp->next, pos++) {
+        if (vp->viewName[0] == glen &&
+            !memcmp(vp->viewName + 1, viewName, glen) &&
+            vacm_viewNodeAdd(cv->root, vp, pos) < 0) {
+            vacm_freeViewNode(cv->root);
+            free(cv);
+            return NULL;
+        }
+    }
+    DEBUGMSGTL(("vacm:compile", "compiled view %s\n", viewName));
+    cv->next = compiledViews;
+    compiledViews = cv;
+    return cv;
+}
+
+/*
+ * Returns the group and access entries that apply to a request, as
+ * vacm_getGroupEntry() followed by vacm_getAccessEntry() would, using the
+ * cache where possible.
+ *
+ * Returns VACM_SUCCESS, VACM_NOGROUP or VACM_NOACCESS.
+ */
+int
+vacm_getAccessForRequest(int securityModel, const char *securityName,
+                         const char *contextName, int securityLevel,
+                         struct vacm_groupEntry **group,
+                         struct vacm_accessEntry **access)
+{
+    struct vacm_accessCache *ce = NULL;
+    struct vacm_groupEntry *gp;
+    struct vacm_accessEntry *ap = NULL;
+    size_t          slen, clen;
+    u_int           hash;
+    const char     *cp;
+
+    slen = strlen(securityName);
+    clen = strlen(contextName);
+    if (slen <= VACM_MAX_STRING && clen <= VACM_MAX_STRING) {
+        hash = securityModel * 31 + securityLevel;
+        for (cp = securityName; *cp; cp++)
+            hash = hash * 31 + (u_char) *cp;
+        for (cp = contextName; *cp; cp++)
+            hash = hash * 31 + (u_char) *cp;
+        ce = &accessCache[hash % VACM_ACCESS_CACHE_SIZE];
+        if (ce->valid && ce->securityModel == securityModel &&
+            ce->securityLevel == securityLevel &&
+            !strcmp(ce->securityName, securityName) &&
+            !strcmp(ce->contextName, contextName)) {
+            gp = ce->group;
+            ap = ce->access;
+            goto done;
+        }
+    }
+
+    gp = vacm_getGroupEntry(securityModel, securityName);
+    if (gp)
+        ap = vacm_getAccessEntry(gp->groupName, contextName,
+                                 securityModel, securityLevel);
+    if (ce) {
+        ce->valid = 1;
+        ce->securityModel = securityModel;
+        ce->securityLevel = securityLevel;
+        memcpy(ce->securityName, securityName, slen + 1);
+        memcpy(ce->contextName, contextName, clen + 1);
+        ce->group = gp;
+        ce->access = ap;
+    }
+
+  done:
+    if (group)
+        *group = gp;
+    if (access)
+        *access = ap;
+    if (gp == NULL)
+        return VACM_NOGROUP;
+    if (ap == NULL)
+        return VACM_NOACCESS;
+    return VACM_SUCCESS;
+}
+
 /*
  * backwards compatability
  */
@@ -1162,6 +1536,14 @@ struct vacm_viewEntry *
 vacm_getViewEntry(const char *viewName,
                   oid * viewSubtree, size_t viewSubtreeLen, int mode)
 {
+    struct vacm_viewCompiled *cv;
+    struct vacm_viewEntry *vp = NULL;
+    int             pos = 0;
+
+    if (mode == VACM_MODE_FIND && (cv = vacm_getCompiledView(viewName))) {
+        vacm_viewNodeFind(cv->root, viewSubtree, viewSubtreeLen, &vp, &pos);
+        return vp;
+    }
     return netsnmp_view_get( viewList, viewName, viewSubtree, viewSubtreeLen,
                              mode);
 }
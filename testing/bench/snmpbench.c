@@ -0,0 +1,912 @@
+/*
+ * snmpbench.c - micro-benchmarks for the SNMP library and agent.
+ *
+ * Usage: snmpbench [-l] [-f SUBSTRING] [-t SECONDS] [-n SAMPLES]
+ *                  [-o FILE] [-b BASELINE [-T PERCENT]]
+ *
+ * Each benchmark is run in batches that take about SECONDS/SAMPLES each.
+ * One line is printed per benchmark, with tab-separated fields:
+ *
+ *   name  ns/op (median)  ns/op (min)  ns/op (max)  operations per sample
+ *
+ * Lines starting with '#' are comments.  With -b, the median of every
+ * benchmark is compared with the one in a BASELINE file written by an
+ * earlier run, and the exit status is 1 if any of them got more than
+ * PERCENT (default 10) slower.
+ */
+#include <net-snmp/net-snmp-config.h>
+
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+#include <sys/types.h>
+#include <stdio.h>
+#if TIME_WITH_SYS_TIME
+# include <sys/time.h>
+# include <time.h>
+#else
+# if HAVE_SYS_TIME_H
+#  include <sys/time.h>
+# else
+#  include <time.h>
+# endif
+#endif
+
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+
+/* from agent/agent_global_vars.h */
+extern int      callback_master_num;
+
+#define BENCH_MAX             64
+#define BENCH_MAX_SAMPLES     99
+#define BENCH_INSTANCES       2000
+#define BENCH_CONTAINER_SIZE  1000
+#define BENCH_PACKET_SIZE     65536
+
+typedef struct bench_s {
+    const char     *name;
+    void          (*run) (long n, void *arg);
+    void           *arg;
+} bench;
+
+static bench    benches[BENCH_MAX];
+static int      nbenches;
+
+static void
+bench_add(const char *name, void (*run) (long, void *), void *arg)
+{
+    if (nbenches < BENCH_MAX) {
+        benches[nbenches].name = name;
+        benches[nbenches].run = run;
+        benches[nbenches].arg = arg;
+        nbenches++;
+    }
+}
+
+static double
+bench_now(void)
+{
+    struct timeval  tv;
+
+    netsnmp_get_monotonic_clock(&tv);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static int
+bench_cmp_double(const void *a, const void *b)
+{
+    double          x = *(const double *) a, y = *(const double *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Runs one benchmark, prints its result line to each of out1 and out2 that
+ * isn't NULL, and returns the median time per operation.
+ */
+static double
+bench_measure(bench * b, double seconds, int samples, FILE * out1,
+              FILE * out2)
+{
+    double          t, elapsed, per_sample = seconds / samples;
+    double          ns[BENCH_MAX_SAMPLES];
+    long            n = 1;
+    int             i;
+
+    /*
+     * Warm up, and find an operation count that fills a sample.
+     */
+    for (;;) {
+        t = bench_now();
+        b->run(n, b->arg);
+        elapsed = bench_now() - t;
+        if (elapsed >= per_sample / 4 || n >= (1L << 30))
+            break;
+        n *= elapsed > 0 ? 2 : 16;
+    }
+    if (elapsed > 0 && elapsed < per_sample)
+        n = (long) (n * per_sample / elapsed);
+
+    for (i = 0; i < samples; i++) {
+        t = bench_now();
+        b->run(n, b->arg);
+        ns[i] = (bench_now() - t) * 1e9 / n;
+    }
+    qsort(ns, samples, sizeof(ns[0]), bench_cmp_double);
+    if (out1)
+        fprintf(out1, "%s\t%.1f\t%.1f\t%.1f\t%ld\n", b->name,
+                ns[samples / 2], ns[0], ns[samples - 1], n);
+    if (out2)
+        fprintf(out2, "%s\t%.1f\t%.1f\t%.1f\t%ld\n", b->name,
+                ns[samples / 2], ns[0], ns[samples - 1], n);
+    fflush(out1);
+    return ns[samples / 2];
+}
+
+/*
+ * Returns the median of a benchmark in a baseline file, or -1.
+ */
+static double
+bench_baseline(const char *file, const char *name)
+{
+    FILE           *f;
+    char            line[256], *tab;
+    double          result = -1;
+
+    if ((f = fopen(file, "r")) == NULL)
+        return -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || (tab = strchr(line, '\t')) == NULL)
+            continue;
+        *tab = '\0';
+        if (strcmp(line, name) == 0) {
+            result = atof(tab + 1);
+            break;
+        }
+    }
+    fclose(f);
+    return result;
+}
+
+/*
+ * ASN.1 primitives.
+ */
+static u_char   asn_buf[256];
+static u_char   asn_string[32] = "0123456789abcdef0123456789abcdef";
+
+/* tcpConnectionState.ipv4."192.168.1.10".161.ipv4."10.0.0.1".50000 */
+static oid      long_oid[] = { 1, 3, 6, 1, 2, 1, 6, 19, 1, 7, 1, 4,
+                               192, 168, 1, 10, 161, 1, 4, 10, 0, 0, 1,
+                               50000 };
+static oid      long_oid2[] = { 1, 3, 6, 1, 2, 1, 6, 19, 1, 7, 1, 4,
+                                192, 168, 1, 10, 161, 1, 4, 10, 0, 0, 1,
+                                50001 };
+
+static void
+bench_asn_build_int(long n, void *arg)
+{
+    size_t          len;
+    long            i, val;
+
+    for (i = 0; i < n; i++) {
+        len = sizeof(asn_buf);
+        val = i * 7919;
+        asn_build_int(asn_buf, &len, ASN_INTEGER, &val, sizeof(val));
+    }
+}
+
+static void
+bench_asn_parse_int(long n, void *arg)
+{
+    u_char          buf[16], type;
+    size_t          len, asn_int_len;
+    long            i, val = -123456789;
+
+    len = sizeof(buf);
+    asn_build_int(buf, &len, ASN_INTEGER, &val, sizeof(val));
+    asn_int_len = sizeof(buf) - len;
+    for (i = 0; i < n; i++) {
+        len = asn_int_len;
+        asn_parse_int(buf, &len, &type, &val, sizeof(val));
+    }
+}
+
+static void
+bench_asn_build_objid(long n, void *arg)
+{
+    size_t          len;
+    long            i;
+
+    for (i = 0; i < n; i++) {
+        len = sizeof(asn_buf);
+        asn_build_objid(asn_buf, &len, ASN_OBJECT_ID, long_oid,
+                        OID_LENGTH(long_oid));
+    }
+}
+
+static void
+bench_asn_parse_objid(long n, void *arg)
+{
+    oid             name[MAX_OID_LEN];
+    u_char          buf[128], type;
+    size_t          len, name_len, asn_objid_len;
+    long            i;
+
+    len = sizeof(buf);
+    asn_build_objid(buf, &len, ASN_OBJECT_ID, long_oid, OID_LENGTH(long_oid));
+    asn_objid_len = sizeof(buf) - len;
+    for (i = 0; i < n; i++) {
+        len = asn_objid_len;
+        name_len = MAX_OID_LEN;
+        asn_parse_objid(buf, &len, &type, name, &name_len);
+    }
+}
+
+static void
+bench_asn_build_string(long n, void *arg)
+{
+    size_t          len;
+    long            i;
+
+    for (i = 0; i < n; i++) {
+        len = sizeof(asn_buf);
+        asn_build_string(asn_buf, &len, ASN_OCTET_STR, asn_string,
+                         sizeof(asn_string));
+    }
+}
+
+static void
+bench_asn_parse_string(long n, void *arg)
+{
+    u_char          buf[64], str[64], type;
+    size_t          len, str_len, asn_string_len;
+    long            i;
+
+    len = sizeof(buf);
+    asn_build_string(buf, &len, ASN_OCTET_STR, asn_string,
+                     sizeof(asn_string));
+    asn_string_len = sizeof(buf) - len;
+    for (i = 0; i < n; i++) {
+        len = asn_string_len;
+        str_len = sizeof(str);
+        asn_parse_string(buf, &len, &type, str, &str_len);
+    }
+}
+
+static volatile int oid_compare_result;
+
+static void
+bench_oid_compare(long n, void *arg)
+{
+    const oid      *other = arg;
+    long            i;
+
+    for (i = 0; i < n; i++)
+        oid_compare_result = snmp_oid_compare(long_oid, OID_LENGTH(long_oid),
+                                              other, OID_LENGTH(long_oid));
+}
+
+/*
+ * PDU encoding and decoding.
+ */
+typedef struct bench_pdu_s {
+    netsnmp_session *ss;
+    netsnmp_pdu    *pdu;
+    u_char         *buf;
+    size_t          buf_len;
+    u_char         *packet;
+    size_t          packet_len;
+} bench_pdu;
+
+static bench_pdu pdus[6];
+
+static int
+bench_build(bench_pdu * bp)
+{
+    size_t          offset = 0;
+    int             rc;
+
+#ifdef NETSNMP_USE_REVERSE_ASNENCODING
+    rc = snmp_build(&bp->buf, &bp->buf_len, &offset, bp->ss, bp->pdu);
+    bp->packet = bp->buf + bp->buf_len - offset;
+    bp->packet_len = offset;
+#else
+    bp->packet = bp->buf;
+    bp->packet_len = bp->buf_len;
+    rc = snmp_build(&bp->buf, &bp->packet_len, &offset, bp->ss, bp->pdu);
+    bp->packet_len = bp->buf_len - bp->packet_len;
+#endif
+    return rc;
+}
+
+static void
+bench_pdu_build(long n, void *arg)
+{
+    long            i;
+
+    for (i = 0; i < n; i++)
+        bench_build(arg);
+}
+
+static void
+bench_pdu_parse(long n, void *arg)
+{
+    static u_char   packet[BENCH_PACKET_SIZE];
+    bench_pdu      *bp = arg;
+    netsnmp_pdu    *pdu;
+    long            i;
+
+    for (i = 0; i < n; i++) {
+        /*
+         * USM clears the authentication parameters in place, so parse a
+         * fresh copy each time.
+         */
+        memcpy(packet, bp->packet, bp->packet_len);
+        pdu = netsnmp_pdu_alloc();
+        if (snmp_parse(snmp_sess_pointer(bp->ss), bp->ss, pdu, packet,
+                       bp->packet_len) != 0) {
+            fprintf(stderr, "snmpbench: parse failed: %s\n",
+                    snmp_api_errstring(bp->ss->s_snmp_errno));
+            exit(1);
+        }
+        snmp_free_pdu(pdu);
+    }
+}
+
+static netsnmp_session *
+bench_session(long version)
+{
+    static u_char   authpass[] = "benchauthpass";
+    static u_char   privpass[] = "benchprivpass";
+    netsnmp_session session;
+    u_char          engineID[SNMP_MAXBUF_SMALL];
+
+    snmp_sess_init(&session);
+    session.version = version;
+    session.peername = strdup("udp:127.0.0.1:1");     /* never used */
+    if (version != SNMP_VERSION_3) {
+        session.community = (u_char *) strdup("public");
+        session.community_len = strlen((char *) session.community);
+        return snmp_open(&session);
+    }
+
+#if defined(NETSNMP_SECMOD_USM) && defined(HAVE_AES)
+    /*
+     * authPriv with SHA and AES, for a user of our own engine so that the
+     * messages can be parsed again.
+     */
+    session.securityEngineIDLen = snmpv3_get_engineID(engineID,
+                                                      sizeof(engineID));
+    session.securityEngineID = netsnmp_memdup(engineID,
+                                              session.securityEngineIDLen);
+    session.securityName = strdup("bench");
+    session.securityNameLen = strlen(session.securityName);
+    session.securityLevel = SNMP_SEC_LEVEL_AUTHPRIV;
+    session.securityAuthProtoLen = OID_LENGTH(usmHMACSHA1AuthProtocol);
+    session.securityAuthProto =
+        snmp_duplicate_objid(usmHMACSHA1AuthProtocol,
+                             session.securityAuthProtoLen);
+    session.securityAuthKeyLen = USM_AUTH_KU_LEN;
+    session.securityPrivProtoLen = OID_LENGTH(usmAESPrivProtocol);
+    session.securityPrivProto =
+        snmp_duplicate_objid(usmAESPrivProtocol,
+                             session.securityPrivProtoLen);
+    session.securityPrivKeyLen = USM_PRIV_KU_LEN;
+    session.flags |= SNMP_FLAGS_DONT_PROBE;
+    if (generate_Ku(session.securityAuthProto, session.securityAuthProtoLen,
+                    authpass, sizeof(authpass) - 1,
+                    session.securityAuthKey,
+                    &session.securityAuthKeyLen) != SNMPERR_SUCCESS ||
+        generate_Ku(session.securityAuthProto, session.securityAuthProtoLen,
+                    privpass, sizeof(privpass) - 1,
+                    session.securityPrivKey,
+                    &session.securityPrivKeyLen) != SNMPERR_SUCCESS)
+        return NULL;
+    return snmp_open(&session);
+#else
+    return NULL;
+#endif
+}
+
+static netsnmp_pdu *
+bench_get_pdu(void)
+{
+    static oid      sysDescr[] = { 1, 3, 6, 1, 2, 1, 1, 1, 0 };
+    netsnmp_pdu    *pdu = snmp_pdu_create(SNMP_MSG_GET);
+    int             i;
+
+    for (i = 0; i < 5; i++) {
+        sysDescr[7] = i + 1;
+        snmp_add_null_var(pdu, sysDescr, OID_LENGTH(sysDescr));
+    }
+    return pdu;
+}
+
+/*
+ * A response with 20 varbinds of mixed types, as returned for a GETBULK
+ * of a table with long indexes.
+ */
+static netsnmp_pdu *
+bench_response_pdu(void)
+{
+    netsnmp_pdu    *pdu = snmp_pdu_create(SNMP_MSG_RESPONSE);
+    oid             name[MAX_OID_LEN];
+    long            val;
+    u_char          addr[4] = { 10, 0, 0, 1 };
+    int             i;
+
+    memcpy(name, long_oid, sizeof(long_oid));
+    for (i = 0; i < 20; i++) {
+        name[OID_LENGTH(long_oid) - 1] = 50000 + i;
+        val = 100000 + i * 4099;
+        switch (i % 4) {
+        case 0:
+            snmp_pdu_add_variable(pdu, name, OID_LENGTH(long_oid),
+                                  ASN_INTEGER, &val, sizeof(val));
+            break;
+        case 1:
+            snmp_pdu_add_variable(pdu, name, OID_LENGTH(long_oid),
+                                  ASN_COUNTER, &val, sizeof(val));
+            break;
+        case 2:
+            snmp_pdu_add_variable(pdu, name, OID_LENGTH(long_oid),
+                                  ASN_OCTET_STR, asn_string, 20);
+            break;
+        default:
+            snmp_pdu_add_variable(pdu, name, OID_LENGTH(long_oid),
+                                  ASN_IPADDRESS, addr, sizeof(addr));
+            break;
+        }
+    }
+    return pdu;
+}
+
+static void
+bench_add_pdus(void)
+{
+    static const struct {
+        long            version;
+        const char     *build_get, *parse_get, *build_resp, *parse_resp;
+    } versions[] = {
+#ifndef NETSNMP_DISABLE_SNMPV1
+        { SNMP_VERSION_1, "pdu/v1/build_get5", "pdu/v1/parse_get5",
+          "pdu/v1/build_response20", "pdu/v1/parse_response20" },
+#endif
+#ifndef NETSNMP_DISABLE_SNMPV2C
+        { SNMP_VERSION_2c, "pdu/v2c/build_get5", "pdu/v2c/parse_get5",
+          "pdu/v2c/build_response20", "pdu/v2c/parse_response20" },
+#endif
+        { SNMP_VERSION_3, "pdu/v3authpriv/build_get5",
+          "pdu/v3authpriv/parse_get5", "pdu/v3authpriv/build_response20",
+          "pdu/v3authpriv/parse_response20" },
+    };
+    netsnmp_session *ss;
+    bench_pdu      *bp = pdus;
+    unsigned int    i;
+
+    for (i = 0; i < sizeof(versions) / sizeof(versions[0]); i++) {
+        if ((ss = bench_session(versions[i].version)) == NULL) {
+            printf("# %s: no session, skipped\n", versions[i].build_get);
+            continue;
+        }
+        bp[0].ss = bp[1].ss = ss;
+        bp[0].pdu = bench_get_pdu();
+        bp[1].pdu = bench_response_pdu();
+        bp[0].pdu->version = bp[1].pdu->version = ss->version;
+        bp[0].buf_len = bp[1].buf_len = BENCH_PACKET_SIZE;
+        bp[0].buf = malloc(BENCH_PACKET_SIZE);
+        bp[1].buf = malloc(BENCH_PACKET_SIZE);
+        if (bench_build(&bp[0]) != 0 || bench_build(&bp[1]) != 0) {
+            printf("# %s: can't build, skipped (%s)\n",
+                   versions[i].build_get, snmp_api_errstring(ss->s_snmp_errno));
+            continue;
+        }
+        bench_add(versions[i].build_get, bench_pdu_build, &bp[0]);
+        bench_add(versions[i].parse_get, bench_pdu_parse, &bp[0]);
+        bench_add(versions[i].build_resp, bench_pdu_build, &bp[1]);
+        bench_add(versions[i].parse_resp, bench_pdu_parse, &bp[1]);
+        bp += 2;
+    }
+}
+
+/*
+ * Containers, keyed by OIDs of a table with long indexes.
+ */
+static netsnmp_index container_keys[BENCH_CONTAINER_SIZE];
+static oid      container_oids[BENCH_CONTAINER_SIZE][24];
+
+static void
+bench_container_keys(void)
+{
+    int             i, j;
+
+    for (i = 0; i < BENCH_CONTAINER_SIZE; i++) {
+        memcpy(container_oids[i], long_oid, sizeof(long_oid));
+        /* scatter the rows so that they arrive out of order */
+        j = (i * 389) % BENCH_CONTAINER_SIZE;
+        container_oids[i][14] = j / 250;
+        container_oids[i][15] = j % 250;
+        container_oids[i][23] = 1024 + j;
+        container_keys[i].oids = container_oids[i];
+        container_keys[i].len = OID_LENGTH(long_oid);
+    }
+}
+
+static void
+bench_container_insert(long n, void *arg)
+{
+    netsnmp_container *c = NULL;
+    long            i;
+
+    for (i = 0; i < n; i++) {
+        if (i % BENCH_CONTAINER_SIZE == 0) {
+            if (c)
+                CONTAINER_FREE(c);
+            c = netsnmp_container_find((const char *) arg);
+        }
+        CONTAINER_INSERT(c, &container_keys[i % BENCH_CONTAINER_SIZE]);
+    }
+    if (c)
+        CONTAINER_FREE(c);
+}
+
+static netsnmp_container *
+bench_container_filled(const char *type)
+{
+    netsnmp_container *c = netsnmp_container_find(type);
+    int             i;
+
+    if (c)
+        for (i = 0; i < BENCH_CONTAINER_SIZE; i++)
+            CONTAINER_INSERT(c, &container_keys[i]);
+    return c;
+}
+
+static void
+bench_container_find(long n, void *arg)
+{
+    netsnmp_container *c = arg;
+    long            i;
+
+    for (i = 0; i < n; i++)
+        CONTAINER_FIND(c, &container_keys[(i * 7) % BENCH_CONTAINER_SIZE]);
+}
+
+static void
+bench_container_next(long n, void *arg)
+{
+    netsnmp_container *c = arg;
+    long            i;
+
+    for (i = 0; i < n; i++)
+        CONTAINER_NEXT(c, &container_keys[(i * 7) % BENCH_CONTAINER_SIZE]);
+}
+
+static void
+bench_add_containers(void)
+{
+    static char     types[][32] = {
+        "binary_array", "skiplist", "hash", "sorted_singly_linked_list"
+    };
+    static char     names[3 * sizeof(types) / sizeof(types[0])][64];
+    netsnmp_container *c;
+    unsigned int    i;
+
+    bench_container_keys();
+    for (i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if ((c = bench_container_filled(types[i])) == NULL) {
+            printf("# container/%s: not available, skipped\n", types[i]);
+            continue;
+        }
+        snprintf(names[3 * i], sizeof(names[0]), "container/%s/insert",
+                 types[i]);
+        snprintf(names[3 * i + 1], sizeof(names[0]), "container/%s/find",
+                 types[i]);
+        snprintf(names[3 * i + 2], sizeof(names[0]), "container/%s/next",
+                 types[i]);
+        bench_add(names[3 * i], bench_container_insert, types[i]);
+        bench_add(names[3 * i + 1], bench_container_find, c);
+        bench_add(names[3 * i + 2], bench_container_next, c);
+    }
+}
+
+/*
+ * Alarms: register/unregister and next-alarm lookups with BENCH_ALARMS
+ * other alarms pending.
+ */
+#define BENCH_ALARMS 2000
+
+static void
+bench_alarm_callback(unsigned int clientreg, void *clientarg)
+{
+}
+
+static void
+bench_alarm_register(long n, void *arg)
+{
+    long            i;
+
+    for (i = 0; i < n; i++)
+        snmp_alarm_unregister(snmp_alarm_register(3600 + i % 1000, 0,
+                                                   bench_alarm_callback,
+                                                   NULL));
+}
+
+static void
+bench_alarm_next(long n, void *arg)
+{
+    struct timeval  delta;
+    long            i;
+
+    for (i = 0; i < n; i++)
+        get_next_alarm_delay_time(&delta);
+}
+
+static void
+bench_add_alarms(void)
+{
+    int             i;
+
+    for (i = 0; i < BENCH_ALARMS; i++)
+        snmp_alarm_register(3600 + i, SA_REPEAT, bench_alarm_callback, NULL);
+    bench_add("alarm/register_unregister", bench_alarm_register, NULL);
+    bench_add("alarm/next", bench_alarm_next, NULL);
+}
+
+/*
+ * USM: user lookups with BENCH_USERS users, one per engineID, as a trap
+ * receiver with a user for each device would have.
+ */
+#define BENCH_USERS 20000
+
+static void
+bench_usm_engineID(int i, u_char * engineID)
+{
+    static const u_char prefix[] = { 0x80, 0x00, 0x1f, 0x88, 0x04 };
+
+    memcpy(engineID, prefix, sizeof(prefix));
+    engineID[5] = i >> 8;
+    engineID[6] = i & 0xff;
+}
+
+static void
+bench_usm_get_user(long n, void *arg)
+{
+    u_char          engineID[7];
+    long            i;
+
+    for (i = 0; i < n; i++) {
+        bench_usm_engineID((i * 7) % BENCH_USERS, engineID);
+        if (usm_get_user(engineID, sizeof(engineID), "trapuser") == NULL) {
+            fprintf(stderr, "snmpbench: usm user not found\n");
+            exit(1);
+        }
+    }
+}
+
+static void
+bench_add_usm(void)
+{
+    struct usmUser *user;
+    u_char          engineID[7];
+    int             i;
+
+    for (i = 0; i < BENCH_USERS; i++) {
+        bench_usm_engineID(i, engineID);
+        user = usm_create_user();
+        user->engineID = netsnmp_memdup(engineID, sizeof(engineID));
+        user->engineIDLen = sizeof(engineID);
+        user->name = strdup("trapuser");
+        user->secName = strdup("trapuser");
+        usm_add_user(user);
+    }
+    bench_add("usm/get_user", bench_usm_get_user, NULL);
+}
+
+/*
+ * Agent registry and request processing.  BENCH_INSTANCES integer
+ * instances are registered under netSnmpPlaypen, and requests are sent to
+ * the agent in this process over the callback transport.
+ */
+static int      instance_values[BENCH_INSTANCES];
+static oid      instance_base[] = { 1, 3, 6, 1, 4, 1, 8072, 9999, 9999, 1 };
+#define INSTANCE_OID_LEN (OID_LENGTH(instance_base) + 2)
+static netsnmp_session *agent_ss;
+static int      get_command = SNMP_MSG_GET;
+static int      getnext_command = SNMP_MSG_GETNEXT;
+static int      getbulk_command = SNMP_MSG_GETBULK;
+
+static void
+bench_instance_oid(int i, oid * name)
+{
+    memcpy(name, instance_base, sizeof(instance_base));
+    name[OID_LENGTH(instance_base)] = i / 100 + 1;
+    name[OID_LENGTH(instance_base) + 1] = i % 100 + 1;
+}
+
+static void
+bench_subtree_find(long n, void *arg)
+{
+    oid             name[MAX_OID_LEN];
+    long            i;
+
+    for (i = 0; i < n; i++) {
+        bench_instance_oid((i * 7) % BENCH_INSTANCES, name);
+        netsnmp_subtree_find(name, INSTANCE_OID_LEN, NULL, "");
+    }
+}
+
+static void
+bench_agent_request(long n, void *arg)
+{
+    netsnmp_pdu    *pdu, *response;
+    oid             name[MAX_OID_LEN];
+    int             command = *(int *) arg;
+    long            i;
+
+    for (i = 0; i < n; i++) {
+        pdu = snmp_pdu_create(command);
+        bench_instance_oid((i * 7) % (BENCH_INSTANCES - 100), name);
+        snmp_add_null_var(pdu, name, INSTANCE_OID_LEN);
+        if (command == SNMP_MSG_GETBULK) {
+            pdu->non_repeaters = 0;
+            pdu->max_repetitions = 20;
+        }
+        response = NULL;
+        if (snmp_synch_response(agent_ss, pdu, &response) != STAT_SUCCESS ||
+            response == NULL || response->errstat != SNMP_ERR_NOERROR) {
+            fprintf(stderr, "snmpbench: request failed: %s\n",
+                    response ? snmp_errstring(response->errstat) :
+                    snmp_api_errstring(agent_ss->s_snmp_errno));
+            exit(1);
+        }
+        snmp_free_pdu(response);
+    }
+}
+
+static void
+bench_add_agent(void)
+{
+    oid             name[MAX_OID_LEN];
+    int             i;
+
+    for (i = 0; i < BENCH_INSTANCES; i++) {
+        bench_instance_oid(i, name);
+        instance_values[i] = i;
+        netsnmp_register_read_only_int_instance("snmpbench", name,
+                                                INSTANCE_OID_LEN,
+                                                &instance_values[i], NULL);
+    }
+    bench_add("agent/subtree_find", bench_subtree_find, NULL);
+
+#ifdef NETSNMP_TRANSPORT_CALLBACK_DOMAIN
+    agent_ss = netsnmp_callback_open(callback_master_num, NULL, NULL, NULL);
+    if (agent_ss == NULL) {
+        printf("# agent/request: no callback session, skipped\n");
+        return;
+    }
+    /*
+     * Like the agent's internal queries: the callback transport hands the
+     * PDU over as it is, and access is granted by the "rouser" line below.
+     */
+    agent_ss->version = SNMP_VERSION_3;
+    agent_ss->securityModel = SNMP_SEC_MODEL_USM;
+    agent_ss->securityLevel = SNMP_SEC_LEVEL_NOAUTH;
+    agent_ss->securityName = strdup("bench");
+    agent_ss->securityNameLen = strlen(agent_ss->securityName);
+    agent_ss->flags |= SNMP_FLAGS_DONT_PROBE;
+    bench_add("agent/get1", bench_agent_request, &get_command);
+    bench_add("agent/getnext1", bench_agent_request,
+              &getnext_command);
+    bench_add("agent/getbulk20", bench_agent_request,
+              &getbulk_command);
+#endif
+}
+
+static void
+usage(void)
+{
+    fprintf(stderr,
+            "Usage: snmpbench [-l] [-f SUBSTRING] [-t SECONDS] [-n SAMPLES]\n"
+            "                 [-o FILE] [-b BASELINE [-T PERCENT]]\n"
+            "  -l           list the benchmarks and exit\n"
+            "  -f SUBSTRING only run benchmarks whose name contains it\n"
+            "  -t SECONDS   time spent on each benchmark (default 1)\n"
+            "  -n SAMPLES   samples per benchmark (default 5)\n"
+            "  -o FILE      also write the results to FILE\n"
+            "  -b BASELINE  compare with the results in BASELINE\n"
+            "  -T PERCENT   slowdown that counts as a regression"
+            " (default 10)\n");
+    exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const char     *filter = NULL, *baseline = NULL, *outfile = NULL;
+    double          seconds = 1, threshold = 10, median, base;
+    int             samples = 5, list = 0, regressions = 0, arg, i;
+    FILE           *out = NULL;
+
+    while ((arg = getopt(argc, argv, "b:f:ln:o:t:T:")) != -1) {
+        switch (arg) {
+        case 'b':
+            baseline = optarg;
+            break;
+        case 'f':
+            filter = optarg;
+            break;
+        case 'l':
+            list = 1;
+            break;
+        case 'n':
+            samples = atoi(optarg);
+            break;
+        case 'o':
+            outfile = optarg;
+            break;
+        case 't':
+            seconds = atof(optarg);
+            break;
+        case 'T':
+            threshold = atof(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind != argc || samples < 1 || samples > BENCH_MAX_SAMPLES ||
+        seconds <= 0)
+        usage();
+    if (outfile && (out = fopen(outfile, "w")) == NULL) {
+        perror(outfile);
+        exit(1);
+    }
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    snmp_enable_stderrlog();
+#ifndef NETSNMP_DISABLE_MIB_LOADING
+    setenv("MIBS", "", 1);
+#endif
+    netsnmp_config_remember(strdup("rouser bench noauth"));
+    init_agent("snmpbench");
+    init_snmp("snmpbench");
+
+    bench_add("asn/build_int", bench_asn_build_int, NULL);
+    bench_add("asn/parse_int", bench_asn_parse_int, NULL);
+    bench_add("asn/build_objid24", bench_asn_build_objid, NULL);
+    bench_add("asn/parse_objid24", bench_asn_parse_objid, NULL);
+    bench_add("asn/build_string32", bench_asn_build_string, NULL);
+    bench_add("asn/parse_string32", bench_asn_parse_string, NULL);
+    bench_add("oid/compare_equal24", bench_oid_compare, long_oid);
+    bench_add("oid/compare_last24", bench_oid_compare, long_oid2);
+    bench_add_pdus();
+    bench_add_containers();
+    bench_add_alarms();
+    bench_add_usm();
+    bench_add_agent();
+
+    printf("# snmpbench %s: %d samples, %g s per benchmark\n",
+           netsnmp_get_version(), samples, seconds);
+    printf("# name\tns/op\tmin\tmax\tops/sample\n");
+    if (out)
+        fprintf(out, "# snmpbench %s: %d samples, %g s per benchmark\n"
+                "# name\tns/op\tmin\tmax\tops/sample\n",
+                netsnmp_get_version(), samples, seconds);
+    for (i = 0; i < nbenches; i++) {
+        if (filter && !strstr(benches[i].name, filter))
+            continue;
+        if (list) {
+            printf("%s\n", benches[i].name);
+            continue;
+        }
+        median = bench_measure(&benches[i], seconds, samples, stdout, out);
+        if (baseline && (base = bench_baseline(baseline, benches[i].name)) > 0
+            && median > base * (1 + threshold / 100)) {
+            printf("# REGRESSION %s: %.1f ns/op, baseline %.1f (+%.0f%%)\n",
+                   benches[i].name, median, base,
+                   (median / base - 1) * 100);
+            regressions++;
+        }
+    }
+    if (out)
+        fclose(out);
+
+    snmp_shutdown("snmpbench");
+    shutdown_agent();
+    return regressions ? 1 : 0;
+}
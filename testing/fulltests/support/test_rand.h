@@ -0,0 +1,17 @@
+#ifndef NETSNMP_TESTING_TEST_RAND_H
+#define NETSNMP_TESTING_TEST_RAND_H
+
+/* A small, portable pseudo-random sequence (the ANSI C example rand()),
+   so that randomized unit tests see the same numbers on every platform.
+   Only the unit test harnesses in this directory include this file. */
+NETSNMP_STATIC_INLINE unsigned int __test_rand(void)
+{
+    static unsigned int seed = 1;
+
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+#define TEST_RAND() __test_rand()
+
+#endif /* NETSNMP_TESTING_TEST_RAND_H */
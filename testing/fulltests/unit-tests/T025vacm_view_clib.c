@@ -0,0 +1,65 @@
+/* HEADER Testing compiled VACM view lookups */
+
+static const char test_name[] = "vacm-view-test";
+struct vacm_viewEntry *head, *vp1, *vp2;
+oid             name[10];
+size_t          len;
+int             i, j, lookups = 0, found = 0, mismatches = 0;
+
+init_snmp(test_name);
+
+/*
+ * Build a random set of view families, some of them masked.
+ */
+for (i = 0; i < 40; i++) {
+    len = 1 + TEST_RAND() % 6;
+    for (j = 0; j < (int)len; j++)
+        name[j] = 1 + TEST_RAND() % 3;
+    vp1 = vacm_createViewEntry("v", name, len);
+    if (!vp1)
+        break;
+    vp1->viewType = (TEST_RAND() % 4) ? SNMP_VIEW_INCLUDED :
+        SNMP_VIEW_EXCLUDED;
+    if (TEST_RAND() % 2) {
+        vp1->viewMaskLen = 1;
+        vp1->viewMask[0] = 0xff & ~(0x80 >> (TEST_RAND() % 6));
+    }
+}
+OKF(i == 40, ("created the view families"));
+vacm_createViewEntry("other", name, 1);
+
+/*
+ * The compiled lookup must pick the same family as a walk of the list.
+ */
+vacm_scanViewInit();
+head = vacm_scanViewNext();
+for (i = 0; i < 5000; i++) {
+    len = TEST_RAND() % 9;
+    for (j = 0; j < (int)len; j++)
+        name[j] = 1 + TEST_RAND() % 3;
+    vp1 = vacm_getViewEntry("v", name, len, VACM_MODE_FIND);
+    vp2 = netsnmp_view_get(head, "v", name, len, VACM_MODE_FIND);
+    lookups++;
+    if (vp1 && vp2)
+        found++;
+    if (vp1 != vp2)
+        mismatches++;
+}
+OKF(mismatches == 0, ("compiled and linear lookups agree (%d of %d lookups"
+                      " differ, %d matched a family)",
+                      mismatches, lookups, found));
+OKF(found > 0 && found < lookups, ("lookups both hit and missed the view"));
+
+/*
+ * Changing the view list must not leave stale compiled views behind.
+ */
+name[0] = 1;
+vacm_destroyAllViewEntries();
+OKF(vacm_getViewEntry("v", name, 1, VACM_MODE_FIND) == NULL,
+    ("no family found after the view list was cleared"));
+vacm_createViewEntry("v", name, 1);
+OKF(vacm_getViewEntry("v", name, 1, VACM_MODE_FIND) != NULL,
+    ("new family found after it was added"));
+
+vacm_destroyAllViewEntries();
+snmp_shutdown(test_name);
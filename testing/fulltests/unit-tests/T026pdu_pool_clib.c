@@ -0,0 +1,56 @@
+/* HEADER Testing PDU and varbind reuse */
+
+static const char test_name[] = "pdu-pool-test";
+static oid      name[] = { 1, 3, 6, 1, 2, 1, 1, 1, 0 };
+netsnmp_pdu_pool_stats before, after;
+netsnmp_pdu    *pdu, *clone;
+int             i;
+
+init_snmp(test_name);
+
+/*
+ * Create, clone and free a few PDUs.  Freed objects must be handed out
+ * again, and must come back zeroed.
+ */
+netsnmp_pdu_pool_get_stats(&before);
+for (i = 0; i < 10; i++) {
+    pdu = snmp_pdu_create(SNMP_MSG_GET);
+    OKF(pdu && pdu->variables == NULL && pdu->community == NULL,
+        ("PDU %d created empty", i));
+    snmp_add_null_var(pdu, name, OID_LENGTH(name));
+    snmp_pdu_add_variable(pdu, name, OID_LENGTH(name), ASN_OCTET_STR,
+                          "value", 5);
+    clone = snmp_clone_pdu(pdu);
+    OKF(clone && clone->variables && clone->variables->next_variable &&
+        clone->variables->next_variable->val.string ==
+        clone->variables->next_variable->buf &&
+        memcmp(clone->variables->next_variable->buf, "value", 5) == 0,
+        ("PDU %d cloned", i));
+    snmp_free_pdu(clone);
+    snmp_free_pdu(pdu);
+}
+netsnmp_pdu_pool_get_stats(&after);
+
+#ifndef NETSNMP_NO_PDU_POOL
+/* the counters only cover the free lists, i.e. this thread */
+OKF(after.pdu_allocs - before.pdu_allocs == 20 &&
+    after.pdu_frees - before.pdu_frees == 20,
+    ("PDU allocations counted (%lu allocs, %lu frees)",
+     after.pdu_allocs - before.pdu_allocs,
+     after.pdu_frees - before.pdu_frees));
+OKF(after.var_allocs - before.var_allocs == 40 &&
+    after.var_frees - before.var_frees == 40,
+    ("varbind allocations counted (%lu allocs, %lu frees)",
+     after.var_allocs - before.var_allocs,
+     after.var_frees - before.var_frees));
+OKF(after.pdu_hits - before.pdu_hits >= 18 &&
+    after.var_hits - before.var_hits >= 36,
+    ("freed objects were reused (%lu PDUs, %lu varbinds)",
+     after.pdu_hits - before.pdu_hits, after.var_hits - before.var_hits));
+#endif
+
+netsnmp_pdu_pool_clear();
+netsnmp_pdu_pool_get_stats(&after);
+OKF(after.pdu_cached == 0 && after.var_cached == 0, ("pool emptied"));
+
+snmp_shutdown(test_name);
@@ -0,0 +1,210 @@
+/* HEADER Testing ASN.1 OID and integer decoding against a reference */
+
+/*
+ * Differential test: random and malformed encodings are decoded both by
+ * asn_parse_objid() / asn_parse_int() and by the original byte-at-a-time
+ * decoders below, and the results must be identical, errors included.
+ */
+unsigned int    seed = 1;
+u_char          buf[600], *ret, *ref_ret, *bufp;
+oid             objid[MAX_OID_LEN], ref[MAX_OID_LEN], *oidp;
+size_t          dlen, ref_dlen, olen, ref_olen, cap, pos, hdr;
+u_long          asn_length, sub;
+long            length, ival, ref_ival;
+u_char          type, ref_type;
+int             i, j, k, n, mode, cases = 0, ok = 0, mismatches = 0;
+union {
+    long            l;
+    unsigned char   b[sizeof(long)];
+} value;
+
+#define RAND() (seed = seed * 1103515245 + 12345, (seed >> 16) & 0x7fff)
+
+for (i = 0; i < 200000; i++) {
+    /*
+     * Content: encoded sub-identifiers, random bytes, or encoded
+     * sub-identifiers with the last byte cut off.
+     */
+    mode = RAND() % 4;
+    pos = 4;
+    if (mode == 1) {
+        n = RAND() % 300;
+        for (j = 0; j < n; j++)
+            buf[pos++] = RAND() & 0xff;
+    } else {
+        n = RAND() % 60;
+        for (j = 0; j < n; j++) {
+            k = RAND() % 100;
+            if (k < 70)
+                sub = RAND() % 128;
+            else if (k < 88)
+                sub = RAND() % 16384;
+            else if (k < 99 || RAND() % 10)
+                sub = ((u_long) RAND() << 17) ^ ((u_long) RAND() << 2) ^ RAND();
+            else
+                sub = ((u_long) RAND() << 30) ^ ((u_long) RAND() << 15) ^ RAND();
+            if (RAND() % 50 == 0)
+                buf[pos++] = 0x80;      /* non-minimal encoding */
+            for (k = 35; k > 0; k -= 7)
+                if (sub >> k)
+                    buf[pos++] = 0x80 | ((sub >> k) & 0x7f);
+            buf[pos++] = sub & 0x7f;
+        }
+        if (mode == 3 && pos > 4)
+            buf[pos - 1] |= 0x80;
+    }
+
+    /*
+     * Header, in short or long form, and a buffer length that may be
+     * shorter than the encoding.
+     */
+    length = pos - 4;
+    if (length < 128 && RAND() % 4) {
+        hdr = 2;
+        buf[2] = length;
+    } else {
+        hdr = 4;
+        buf[1] = 0x82;
+        buf[2] = length >> 8;
+        buf[3] = length & 0xff;
+    }
+    bufp = buf + 4 - hdr;
+    bufp[0] = RAND() % 100 ? ASN_OBJECT_ID : ASN_INTEGER;
+    if (hdr == 2)
+        bufp[1] = length;
+    dlen = pos - (bufp - buf);
+    if (RAND() % 10 == 0)
+        dlen = RAND() % (dlen + 1);
+    cap = RAND() % 3 ? MAX_OID_LEN : 1 + RAND() % 40;
+
+    memset(objid, 0xaa, sizeof(objid));
+    olen = cap;
+    type = 0;
+    ref_dlen = dlen;
+    ret = asn_parse_objid(bufp, &dlen, &type, objid, &olen);
+
+    /*
+     * Reference decoder.
+     */
+    memset(ref, 0xaa, sizeof(ref));
+    ref_olen = cap;
+    ref_ret = NULL;
+    ref_type = 0;
+    do {
+        u_char         *p = bufp;
+
+        if (ref_dlen < 2)
+            break;
+        ref_type = *p++;
+        if (ref_type != ASN_OBJECT_ID)
+            break;
+        if (*p & 0x80) {
+            k = (*p & 0x7f) + 1;
+            if ((int) ref_dlen - 1 <= k || !asn_parse_length(p, &asn_length))
+                break;
+        } else {
+            k = 1;
+            asn_length = *p;
+        }
+        if (asn_length + k > ref_dlen - 1)
+            break;
+        p += k;
+        ref_dlen -= (int) asn_length + (p - bufp);
+        if (asn_length == 0)
+            ref[0] = ref[1] = 0;
+        length = asn_length;
+        oidp = ref + 1;
+        ref_olen--;
+        k = 0;
+        while (length > 0 && ref_olen-- > 0) {
+            sub = 0;
+            do {
+                sub = (sub << 7) + (*p & ~ASN_BIT8);
+                length--;
+            } while ((*p++ & ASN_BIT8) && length > 0);
+            if (length == 0 && (p[-1] & ASN_BIT8))
+                k = 1;          /* subidentifier syntax error */
+#if defined(EIGHTBIT_SUBIDS) || (SIZEOF_LONG != 4)
+            if (sub > MAX_SUBID)
+                k = 1;          /* subidentifier too large */
+#endif
+            if (k)
+                break;
+            *oidp++ = (oid) sub;
+        }
+        if (k)
+            break;
+        if (length || oidp < ref + 1) {
+            ref_olen = cap;
+            break;
+        }
+        sub = oidp - ref >= 2 ? ref[1] : 0;
+        if (sub == 0x2B) {
+            ref[0] = 1;
+            ref[1] = 3;
+        } else if (sub < 40) {
+            ref[0] = 0;
+            ref[1] = sub;
+        } else if (sub < 80) {
+            ref[0] = 1;
+            ref[1] = sub - 40;
+        } else {
+            ref[0] = 2;
+            ref[1] = sub - 80;
+        }
+        ref_olen = oidp - ref;
+        ref_ret = p;
+    } while (0);
+
+    cases++;
+    if (ret)
+        ok++;
+    if (ret != ref_ret || type != ref_type ||
+        dlen != ref_dlen || olen != ref_olen ||
+        (ret && memcmp(objid, ref, olen * sizeof(oid)) != 0)) {
+        if (mismatches++ < 5)
+            printf("# case %d (mode %d): ret %+ld/%+ld olen %lu/%lu\n",
+                   i, mode, ret ? (long) (ret - bufp) : -1L,
+                   ref_ret ? (long) (ref_ret - bufp) : -1L,
+                   (unsigned long) olen, (unsigned long) ref_olen);
+    }
+}
+OKF(mismatches == 0, ("asn_parse_objid() matches the reference decoder"
+                      " (%d of %d cases differ)", mismatches, cases));
+OKF(ok > cases / 4 && ok < cases, ("%d of %d OIDs were valid", ok, cases));
+
+/*
+ * Integers of every length, including invalid ones.
+ */
+mismatches = 0;
+for (i = 0; i < 100000; i++) {
+    n = RAND() % (sizeof(long) + 2);
+    buf[0] = ASN_INTEGER;
+    buf[1] = n;
+    for (j = 0; j < n; j++)
+        buf[2 + j] = RAND() & 0xff;
+    dlen = 2 + n;
+    ret = asn_parse_int(buf, &dlen, &type, &ival, sizeof(ival));
+
+    ref_ret = NULL;
+    if (n > 0 && n <= (int) sizeof(long)) {
+        memset(&value.b, buf[2] & 0x80 ? 0xff : 0, sizeof(value.b));
+        if (NETSNMP_BIGENDIAN) {
+            for (j = 0; j < n; j++)
+                value.b[sizeof(long) - n + j] = buf[2 + j];
+        } else {
+            for (j = 0; j < n; j++)
+                value.b[n - 1 - j] = buf[2 + j];
+        }
+        ref_ival = value.l;
+        if (ref_ival > INT32_MAX)
+            ref_ival &= 0xffffffff;
+        else if (ref_ival < INT32_MIN)
+            ref_ival = 0 - (ref_ival & 0xffffffff);
+        ref_ret = buf + 2 + n;
+    }
+    if (ret != ref_ret || (ret && (ival != ref_ival || dlen != 0)))
+        mismatches++;
+}
+OKF(mismatches == 0, ("asn_parse_int() matches the reference decoder"
+                      " (%d cases differ)", mismatches));
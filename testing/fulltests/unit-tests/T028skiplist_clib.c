@@ -0,0 +1,146 @@
+/* HEADER Testing the skiplist container */
+
+static const char test_name[] = "skiplist-test";
+static oid      oids[400][2];
+static netsnmp_index idx[400];
+netsnmp_container *sk, *ba, *dup;
+netsnmp_iterator *it;
+netsnmp_void_array *va1, *va2;
+netsnmp_index   key;
+void           *p1, *p2;
+int             i, n, rc1, rc2, mismatches = 0;
+
+init_snmp(test_name);
+
+for (i = 0; i < 400; i++) {
+    oids[i][0] = i / 20;
+    oids[i][1] = i % 20;
+    idx[i].oids = oids[i];
+    idx[i].len = 2;
+}
+
+sk = netsnmp_container_find("skiplist");
+ba = netsnmp_container_find("binary_array");
+OKF(sk && ba, ("created the containers"));
+sk->ncompare = ba->ncompare = netsnmp_ncompare_netsnmp_index;
+
+/*
+ * Random inserts, removes and lookups must give the same answers as the
+ * binary array.
+ */
+for (i = 0; i < 20000; i++) {
+    n = TEST_RAND() % 400;
+    switch (TEST_RAND() % 4) {
+    case 0:
+        /* binary_array misses duplicates of its first entry; use find */
+        rc1 = CONTAINER_INSERT(sk, &idx[n]);
+        rc2 = CONTAINER_FIND(ba, &idx[n]) ? -1 : CONTAINER_INSERT(ba, &idx[n]);
+        break;
+    case 1:
+        rc1 = CONTAINER_REMOVE(sk, &idx[n]);
+        rc2 = CONTAINER_REMOVE(ba, &idx[n]);
+        break;
+    case 2:
+        rc1 = CONTAINER_FIND(sk, &idx[n]) != NULL;
+        rc2 = CONTAINER_FIND(ba, &idx[n]) != NULL;
+        break;
+    default:
+        p1 = CONTAINER_NEXT(sk, &idx[n]);
+        p2 = CONTAINER_NEXT(ba, &idx[n]);
+        rc1 = rc2 = 0;
+        if (p1 != p2)
+            mismatches++;
+        break;
+    }
+    if ((rc1 == 0) != (rc2 == 0) || CONTAINER_SIZE(sk) != CONTAINER_SIZE(ba))
+        mismatches++;
+}
+OKF(mismatches == 0, ("skiplist agrees with binary_array (%d mismatches,"
+                      " %d entries)", mismatches, (int)CONTAINER_SIZE(sk)));
+
+/*
+ * Walks with find_next and with an iterator visit the same entries in
+ * the same order.
+ */
+mismatches = 0;
+p1 = CONTAINER_FIRST(sk);
+p2 = CONTAINER_FIRST(ba);
+for (n = 0; p1 || p2; n++) {
+    if (p1 != p2)
+        mismatches++;
+    p1 = p1 ? CONTAINER_NEXT(sk, p1) : NULL;
+    p2 = p2 ? CONTAINER_NEXT(ba, p2) : NULL;
+}
+it = CONTAINER_ITERATOR(sk);
+for (i = 0, p1 = ITERATOR_FIRST(it); p1; p1 = ITERATOR_NEXT(it), i++) {
+    if (p1 != CONTAINER_FIND(ba, p1))
+        mismatches++;
+    p2 = p1;
+}
+OKF(mismatches == 0 && n == i && n == (int)CONTAINER_SIZE(ba),
+    ("find_next and iterator walks match (%d entries)", n));
+OKF(ITERATOR_LAST(it) == p2, ("iterator last is the greatest entry"));
+ITERATOR_RELEASE(it);
+
+/*
+ * Partial key lookups.
+ */
+mismatches = 0;
+key.len = 1;
+for (i = 0; i < 20; i++) {
+    key.oids = oids[i * 20];
+    va1 = CONTAINER_GET_SUBSET(sk, &key);
+    va2 = CONTAINER_GET_SUBSET(ba, &key);
+    if ((va1 == NULL) != (va2 == NULL) ||
+        (va1 && (va1->size != va2->size ||
+                 memcmp(va1->array, va2->array,
+                        va1->size * sizeof(void *)))))
+        mismatches++;
+    if (va1) {
+        free(va1->array);
+        free(va1);
+    }
+    if (va2) {
+        free(va2->array);
+        free(va2);
+    }
+}
+OKF(mismatches == 0, ("subsets match"));
+
+/*
+ * A duplicate holds the same entries; removing through an iterator
+ * leaves the iterator usable.
+ */
+dup = CONTAINER_DUP(sk, NULL, 0);
+OKF(dup && CONTAINER_SIZE(dup) == CONTAINER_SIZE(sk) &&
+    CONTAINER_FIRST(dup) == CONTAINER_FIRST(sk),
+    ("duplicate has the same entries"));
+it = CONTAINER_ITERATOR(dup);
+n = CONTAINER_SIZE(dup);
+for (i = 0, p1 = ITERATOR_FIRST(it); p1; p1 = ITERATOR_NEXT(it), i++)
+    if (i % 2 == 0)
+        ITERATOR_REMOVE(it);
+ITERATOR_RELEASE(it);
+OKF(i == n && (int)CONTAINER_SIZE(dup) == n / 2,
+    ("removed every other entry through the iterator (%d of %d left)",
+     (int)CONTAINER_SIZE(dup), n));
+CONTAINER_FREE(dup);
+
+/*
+ * Duplicate keys, when allowed, are kept in insertion order.
+ */
+CONTAINER_CLEAR(sk, NULL, NULL);
+CONTAINER_SET_OPTIONS(sk, CONTAINER_KEY_ALLOW_DUPLICATES, rc1);
+OKF(rc1 != -1, ("allowed duplicate keys"));
+key.oids = oids[5];
+key.len = 2;
+CONTAINER_INSERT(sk, &idx[5]);
+rc1 = CONTAINER_INSERT(sk, &key);
+OKF(rc1 == 0 && CONTAINER_SIZE(sk) == 2, ("inserted a duplicate key"));
+OKF(CONTAINER_FIRST(sk) == &idx[5] && CONTAINER_NEXT(sk, &idx[4]) == &idx[5],
+    ("first duplicate comes first"));
+OKF(CONTAINER_NEXT(sk, &idx[5]) == NULL, ("find_next skips duplicates"));
+
+CONTAINER_FREE(sk);
+CONTAINER_FREE(ba);
+snmp_shutdown(test_name);
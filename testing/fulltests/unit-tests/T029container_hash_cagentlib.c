@@ -0,0 +1,107 @@
+/* HEADER Testing the hash container and table hash indexes */
+
+static const char test_name[] = "container-hash-test";
+static oid      oids[300][2];
+static netsnmp_index idx[300];
+netsnmp_container *hc, *ba, *primary, *index;
+netsnmp_iterator *it;
+netsnmp_index   key;
+void           *p;
+int             i, n, rc1, rc2, mismatches = 0;
+
+init_snmp(test_name);
+
+for (i = 0; i < 300; i++) {
+    oids[i][0] = i % 7;
+    oids[i][1] = i;
+    idx[i].oids = oids[i];
+    idx[i].len = 2;
+}
+
+hc = netsnmp_container_find("hash");
+ba = netsnmp_container_find("binary_array");
+OKF(hc && ba, ("created the containers"));
+
+/*
+ * Random inserts, removes and lookups must give the same answers as the
+ * binary array, across several resizes of the hash table.
+ */
+for (i = 0; i < 20000; i++) {
+    n = TEST_RAND() % 300;
+    switch (TEST_RAND() % 3) {
+    case 0:
+        /* binary_array misses duplicates of its first entry; use find */
+        rc1 = CONTAINER_INSERT(hc, &idx[n]);
+        rc2 = CONTAINER_FIND(ba, &idx[n]) ? -1 : CONTAINER_INSERT(ba, &idx[n]);
+        break;
+    case 1:
+        rc1 = hc->remove(hc, &idx[n]);
+        rc2 = CONTAINER_FIND(ba, &idx[n]) ? ba->remove(ba, &idx[n]) : -1;
+        break;
+    default:
+        key.oids = oids[n];
+        key.len = 2;
+        rc1 = CONTAINER_FIND(hc, &key) == &idx[n];
+        rc2 = CONTAINER_FIND(ba, &key) == &idx[n];
+        break;
+    }
+    if ((rc1 == 0) != (rc2 == 0) || CONTAINER_SIZE(hc) != CONTAINER_SIZE(ba))
+        mismatches++;
+}
+OKF(mismatches == 0, ("hash agrees with binary_array (%d mismatches,"
+                      " %d entries)", mismatches, (int)CONTAINER_SIZE(hc)));
+
+/*
+ * Iterators and find_next visit every entry once.
+ */
+mismatches = 0;
+for (n = 0, p = CONTAINER_FIRST(hc); p; p = CONTAINER_NEXT(hc, p), n++)
+    if (CONTAINER_FIND(ba, p) != p)
+        mismatches++;
+OKF(mismatches == 0 && n == (int)CONTAINER_SIZE(ba),
+    ("find_next walk visits every entry (%d)", n));
+it = CONTAINER_ITERATOR(hc);
+n = CONTAINER_SIZE(hc);
+for (i = 0, p = ITERATOR_FIRST(it); p; p = ITERATOR_NEXT(it), i++)
+    if (i % 2 == 0)
+        ITERATOR_REMOVE(it);
+ITERATOR_RELEASE(it);
+OKF(i == n && (int)CONTAINER_SIZE(hc) == n / 2,
+    ("removed every other entry through the iterator (%d of %d left)",
+     (int)CONTAINER_SIZE(hc), n));
+CONTAINER_FREE(hc);
+CONTAINER_FREE(ba);
+
+/*
+ * A hash index attached to a table container follows inserts, removes
+ * and clears of the table, and is used for exact lookups only.
+ */
+primary = netsnmp_container_find("table_container");
+for (i = 0; i < 100; i++)
+    CONTAINER_INSERT(primary, &idx[i]);
+index = netsnmp_container_table_add_hash_index(primary);
+OKF(index && CONTAINER_SIZE(index) == 100,
+    ("hash index holds the existing rows"));
+OKF(SUBCONTAINER_FIND(primary, TABLE_CONTAINER_HASH_INDEX) == index,
+    ("hash index found by name"));
+for (i = 100; i < 300; i++)
+    CONTAINER_INSERT(primary, &idx[i]);
+for (i = 0; i < 300; i += 3)
+    CONTAINER_REMOVE(primary, &idx[i]);
+mismatches = 0;
+for (i = 0; i < 300; i++) {
+    key.oids = oids[i];
+    key.len = 2;
+    if (CONTAINER_FIND(index, &key) != CONTAINER_FIND(primary, &key))
+        mismatches++;
+}
+OKF(mismatches == 0 && CONTAINER_SIZE(index) == CONTAINER_SIZE(primary),
+    ("hash index follows the table (%d mismatches, %d rows)", mismatches,
+     (int)CONTAINER_SIZE(index)));
+CONTAINER_CLEAR(primary, NULL, NULL);
+OKF(CONTAINER_SIZE(index) == 0, ("hash index cleared with the table"));
+OKF(netsnmp_container_table_add_hash_index(index) == NULL,
+    ("can't index an index"));
+CONTAINER_FREE(primary);
+
+snmp_shutdown(test_name);
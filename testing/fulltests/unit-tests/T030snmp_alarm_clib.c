@@ -0,0 +1,71 @@
+/* HEADER Testing the order in which alarms fire */
+
+static const char test_name[] = "snmp-alarm-test";
+static unsigned int regs[500];
+struct snmp_alarm *a, *best;
+struct timeval  t, now, when;
+int             i, j, nregs = 0, mismatches = 0;
+
+init_snmp(test_name);
+netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                       NETSNMP_DS_LIB_ALARM_DONT_USE_SIG, 1);
+
+/*
+ * Register, reset and unregister alarms at random, checking every time
+ * that the next alarm is the one a scan of all of them would pick.  None
+ * of them is due during the test, so the callbacks are never called.
+ */
+for (i = 0; i < 5000; i++) {
+    j = TEST_RAND() % 4;
+    if (nregs < 10 || (j <= 1 && nregs < 500)) {
+        t.tv_sec = 100 + TEST_RAND() % 50;
+        t.tv_usec = TEST_RAND() % 4 * 250000;
+        regs[nregs] = snmp_alarm_register_hr(t,
+                                             (TEST_RAND() % 2) ? SA_REPEAT : 0,
+                                             NULL, NULL);
+        if (regs[nregs])
+            nregs++;
+    } else if (j == 2) {
+        j = TEST_RAND() % nregs;
+        snmp_alarm_unregister(regs[j]);
+        regs[j] = regs[--nregs];
+    } else {
+        snmp_alarm_reset(regs[TEST_RAND() % nregs]);
+    }
+
+    best = NULL;
+    for (j = 0; j < nregs; j++) {
+        a = sa_find_specific(regs[j]);
+        if (a == NULL) {
+            mismatches++;
+            continue;
+        }
+        if (best == NULL || timercmp(&a->t_nextM, &best->t_nextM, <) ||
+            (timercmp(&a->t_nextM, &best->t_nextM, ==) &&
+             a->clientreg < best->clientreg))
+            best = a;
+    }
+    if (sa_find_next() != best)
+        mismatches++;
+}
+OKF(mismatches == 0, ("next alarm always the earliest (%d mismatches,"
+                      " %d alarms)", mismatches, nregs));
+
+netsnmp_get_monotonic_clock(&now);
+OKF(netsnmp_get_next_alarm_time(&when, &now) == (int)sa_find_next()->clientreg
+    && timercmp(&when, &sa_find_next()->t_nextM, ==),
+    ("next alarm time reported"));
+
+a = sa_find_next();
+snmp_alarm_unregister(a->clientreg);
+OKF(sa_find_specific(a->clientreg) == NULL && sa_find_next() != a,
+    ("unregistered alarm is gone"));
+
+snmp_alarm_unregister_all();
+OKF(sa_find_next() == NULL && get_next_alarm_delay_time(&when) == 0,
+    ("no alarms left after unregistering all"));
+OKF(snmp_alarm_register(1000, 0, NULL, NULL) != 0 && sa_find_next() != NULL,
+    ("alarms can be registered again"));
+snmp_alarm_unregister_all();
+
+snmp_shutdown(test_name);
@@ -0,0 +1,94 @@
+/* HEADER Testing the USM user store */
+
+static struct usmUser *users[1000];
+struct usmUser *u, *prev;
+u_char          engineID[4];
+char            name[16];
+int             i, nusers = 0, missing = 0, stale = 0, count, misordered;
+
+/*
+ * Add users with a few different engineIDs and names of varying length,
+ * some of them twice, which replaces the first copy.
+ */
+for (i = 0; i < 1500; i++) {
+    engineID[0] = TEST_RAND() % 4;
+    engineID[1] = TEST_RAND() % 2;
+    snprintf(name, sizeof(name), "u%d", TEST_RAND() % 700);
+
+    u = usm_create_user();
+    u->engineIDLen = 1 + TEST_RAND() % 2;
+    u->engineID = netsnmp_memdup(engineID, u->engineIDLen);
+    u->name = strdup(name);
+    u->secName = strdup(name);
+    if (usm_get_user(u->engineID, u->engineIDLen, u->name) == NULL)
+        users[nusers++] = u;
+    else {
+        int             j;
+
+        for (j = 0; j < nusers; j++)
+            if (users[j]->engineIDLen == u->engineIDLen &&
+                memcmp(users[j]->engineID, u->engineID,
+                       u->engineIDLen) == 0 &&
+                strcmp(users[j]->name, u->name) == 0)
+                users[j] = u;
+    }
+    usm_add_user(u);
+    if (nusers == sizeof(users) / sizeof(users[0]))
+        break;
+}
+
+for (i = 0; i < nusers; i++)
+    if (usm_get_user(users[i]->engineID, users[i]->engineIDLen,
+                     users[i]->name) != users[i])
+        missing++;
+OKF(missing == 0, ("every user is found (%d of %d missing)", missing,
+                   nusers));
+
+/*
+ * Remove every other one
+ */
+for (i = 0; i < nusers; i += 2)
+    usm_remove_user(users[i]);
+for (i = 0; i < nusers; i++) {
+    u = usm_get_user(users[i]->engineID, users[i]->engineIDLen,
+                     users[i]->name);
+    if (i % 2 == 0 && u != NULL)
+        stale++;
+    if (i % 2 == 1 && u != users[i])
+        missing++;
+}
+OKF(missing == 0 && stale == 0,
+    ("users are removed (%d missing, %d not removed)", missing, stale));
+usm_remove_user(users[0]);     /* again: nothing to remove */
+OKF(usm_get_user(engineID, 2, "nobody") == NULL, ("unknown user"));
+
+/*
+ * The list is in usmUserTable order
+ */
+count = misordered = 0;
+for (u = usm_get_userList(), prev = NULL; u; prev = u, u = u->next) {
+    count++;
+    if (u->prev != prev)
+        misordered++;
+    else if (prev &&
+             (prev->engineIDLen > u->engineIDLen ||
+              (prev->engineIDLen == u->engineIDLen &&
+               (memcmp(prev->engineID, u->engineID, u->engineIDLen) > 0 ||
+                (memcmp(prev->engineID, u->engineID, u->engineIDLen) == 0 &&
+                 (strlen(prev->name) > strlen(u->name) ||
+                  (strlen(prev->name) == strlen(u->name) &&
+                   strcmp(prev->name, u->name) >= 0)))))))
+        misordered++;
+}
+OKF(count == nusers / 2 && misordered == 0,
+    ("user list sorted (%d users, %d out of order)", count, misordered));
+
+for (i = 0; i < nusers; i += 2)
+    usm_free_user(users[i]);
+
+/*
+ * A user without a name is refused
+ */
+u = usm_create_user();
+OKF(usm_add_user(u) == NULL, ("nameless user refused"));
+usm_free_user(u);
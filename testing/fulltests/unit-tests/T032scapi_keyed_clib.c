@@ -0,0 +1,139 @@
+/* HEADER Testing keyed hashes and ciphers with changing keys */
+
+/*
+ * Alternate between keys (and IVs), so that an answer computed with the
+ * wrong prepared context would show up.
+ */
+static const u_char key1[20] = {
+    0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
+    0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b
+};
+static const u_char mac1[20] = {     /* RFC 2202, test case 1 */
+    0xb6, 0x17, 0x31, 0x86, 0x55, 0x05, 0x72, 0x64, 0xe2, 0x8b,
+    0xc0, 0xb6, 0xfb, 0x37, 0x8c, 0x8e, 0xf1, 0x46, 0xbe, 0x00
+};
+static const u_char mac2[20] = {     /* RFC 2202, test case 3 */
+    0x12, 0x5d, 0x73, 0x42, 0xb9, 0xac, 0x11, 0xcd, 0x91, 0xa3,
+    0x9a, 0xf4, 0x8a, 0xa1, 0x7b, 0x4f, 0x63, 0xf1, 0x75, 0xd3
+};
+u_char          key2[20], msg2[50], mac[20];
+size_t          maclen;
+int             i, failures = 0;
+
+memset(key2, 0xaa, sizeof(key2));
+memset(msg2, 0xdd, sizeof(msg2));
+for (i = 0; i < 6; i++) {
+    maclen = sizeof(mac);
+    if (i % 2 == 0) {
+        if (sc_generate_keyed_hash(usmHMACSHA1AuthProtocol,
+                                   OID_LENGTH(usmHMACSHA1AuthProtocol),
+                                   key1, sizeof(key1),
+                                   (const u_char *) "Hi There", 8,
+                                   mac, &maclen) != SNMPERR_SUCCESS ||
+            maclen != sizeof(mac1) || memcmp(mac, mac1, maclen) != 0)
+            failures++;
+    } else {
+        if (sc_generate_keyed_hash(usmHMACSHA1AuthProtocol,
+                                   OID_LENGTH(usmHMACSHA1AuthProtocol),
+                                   key2, sizeof(key2), msg2, sizeof(msg2),
+                                   mac, &maclen) != SNMPERR_SUCCESS ||
+            maclen != sizeof(mac2) || memcmp(mac, mac2, maclen) != 0)
+            failures++;
+    }
+}
+OKF(failures == 0, ("HMAC-SHA1 with alternating keys (%d failures)",
+                    failures));
+OKF(sc_check_keyed_hash(usmHMACSHA1AuthProtocol,
+                        OID_LENGTH(usmHMACSHA1AuthProtocol),
+                        key2, sizeof(key2), msg2, sizeof(msg2),
+                        mac2, 12) == SNMPERR_SUCCESS &&
+    sc_check_keyed_hash(usmHMACSHA1AuthProtocol,
+                        OID_LENGTH(usmHMACSHA1AuthProtocol),
+                        key1, sizeof(key1), msg2, sizeof(msg2),
+                        mac2, 12) != SNMPERR_SUCCESS,
+    ("HMAC-SHA1 check"));
+
+/* a forgotten key is prepared again the next time it is used */
+sc_forget_key(key1, sizeof(key1));
+maclen = sizeof(mac);
+OKF(sc_generate_keyed_hash(usmHMACSHA1AuthProtocol,
+                           OID_LENGTH(usmHMACSHA1AuthProtocol),
+                           key1, sizeof(key1),
+                           (const u_char *) "Hi There", 8,
+                           mac, &maclen) == SNMPERR_SUCCESS &&
+    maclen == sizeof(mac1) && memcmp(mac, mac1, maclen) == 0,
+    ("HMAC-SHA1 after forgetting the key"));
+
+#if defined(NETSNMP_ENABLE_SCAPI_AUTHPRIV) && defined(HAVE_AES)
+{
+    /*
+     * NIST SP 800-38A F.3.13, and the same with another IV and key
+     */
+    static u_char   aeskey[16] = {
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+    };
+    static u_char   iv[16] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+    };
+    static u_char   rviv[16] = {
+        0x0f, 0x0e, 0x0d, 0x0c, 0x0b, 0x0a, 0x09, 0x08,
+        0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00
+    };
+    static const u_char plain[32] = {
+        0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+        0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+        0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+        0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51
+    };
+    static const u_char cipher[3][32] = {
+        { 0x3b, 0x3f, 0xd9, 0x2e, 0xb7, 0x2d, 0xad, 0x20,
+          0x33, 0x34, 0x49, 0xf8, 0xe8, 0x3c, 0xfb, 0x4a,
+          0xc8, 0xa6, 0x45, 0x37, 0xa0, 0xb3, 0xa9, 0x3f,
+          0xcd, 0xe3, 0xcd, 0xad, 0x9f, 0x1c, 0xe5, 0x8b },
+        { 0x19, 0xba, 0xc1, 0xf0, 0x9c, 0x67, 0xbd, 0x95,
+          0x67, 0x9f, 0xba, 0x75, 0x4c, 0xb3, 0x75, 0xc7,
+          0xee, 0x20, 0x63, 0x61, 0x1b, 0x74, 0xd7, 0x83,
+          0xc5, 0xd7, 0x9a, 0xef, 0x03, 0x9b, 0xbd, 0xdc },
+        { 0x61, 0x55, 0xb5, 0x57, 0x6f, 0x2e, 0x6f, 0xd3,
+          0x18, 0xfe, 0xea, 0x49, 0xb5, 0xc0, 0xfd, 0x70,
+          0xbe, 0x25, 0xfd, 0x71, 0x47, 0xa3, 0x87, 0x60,
+          0x66, 0xe7, 0x95, 0x05, 0x30, 0x56, 0x2a, 0x9b }
+    };
+    u_char          out[32], back[32];
+    size_t          outlen, backlen;
+    int             c;
+
+    failures = 0;
+    for (i = 0; i < 9; i++) {
+        c = i % 3;
+        if (c == 2)
+            memcpy(aeskey, iv, sizeof(aeskey));        /* 00 01 .. 0f */
+        outlen = sizeof(out);
+        backlen = sizeof(back);
+        if (sc_encrypt(usmAESPrivProtocol, OID_LENGTH(usmAESPrivProtocol),
+                       aeskey, sizeof(aeskey), c == 1 ? rviv : iv,
+                       sizeof(iv), plain, sizeof(plain),
+                       out, &outlen) != SNMPERR_SUCCESS ||
+            outlen != sizeof(plain) || memcmp(out, cipher[c], outlen) ||
+            sc_decrypt(usmAESPrivProtocol, OID_LENGTH(usmAESPrivProtocol),
+                       aeskey, sizeof(aeskey), c == 1 ? rviv : iv,
+                       sizeof(iv), out, outlen,
+                       back, &backlen) != SNMPERR_SUCCESS ||
+            backlen != sizeof(plain) || memcmp(back, plain, backlen))
+            failures++;
+        if (c == 2) {
+            static const u_char nistkey[16] = {
+                0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+            };
+            memcpy(aeskey, nistkey, sizeof(aeskey));
+        }
+    }
+    OKF(failures == 0, ("AES-CFB with alternating keys and IVs"
+                        " (%d failures)", failures));
+}
+#endif
+
+sc_shutdown(0, 0, NULL, NULL);
@@ -0,0 +1,193 @@
+/* HEADER Testing the derived key cache */
+
+/*
+ * RFC 3414, A.3.2: "maplesyrup" with SHA, localized to engineID 0...02
+ */
+static const u_char engineID[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2 };
+static const u_char sha_ku[20] = {
+    0x9f, 0xb5, 0xcc, 0x03, 0x81, 0x49, 0x7b, 0x37, 0x93, 0x52,
+    0x89, 0x39, 0xff, 0x78, 0x8d, 0x5d, 0x79, 0x14, 0x52, 0x11
+};
+static const u_char sha_kul[20] = {
+    0x66, 0x95, 0xfe, 0xbc, 0x92, 0x88, 0xe3, 0x62, 0x82, 0x23,
+    0x5f, 0xc7, 0x15, 0x1f, 0x12, 0x84, 0x97, 0xb3, 0x8f, 0x3f
+};
+static const char *pass[] = {
+    "maplesyrup", "passphrase1", "passphrase2", "maplesyrup",
+    "passphrase3", "passphrase1"
+};
+#define NPASS (sizeof(pass) / sizeof(pass[0]))
+u_char          key[SNMP_MAXBUF_SMALL], ref[NPASS][SNMP_MAXBUF_SMALL];
+size_t          keyLen, refLen[NPASS];
+char            dir[] = "/tmp/T033keycacheXXXXXX", file[256];
+char            line[SNMP_MAXBUF], saved[SNMP_MAXBUF], *cp;
+FILE           *fp;
+int             i, ok, keys;
+
+#define SHA usmHMACSHA1AuthProtocol, OID_LENGTH(usmHMACSHA1AuthProtocol)
+
+for (i = 0, ok = 1; i < 2; i++) {
+    keyLen = sizeof(key);
+    ok &= generate_Ku(SHA, (const u_char *) "maplesyrup", 10, key,
+                      &keyLen) == SNMPERR_SUCCESS &&
+        keyLen == sizeof(sha_ku) && memcmp(key, sha_ku, keyLen) == 0;
+}
+OKF(ok, ("Ku derived and found again"));
+
+for (i = 0, ok = 1; i < 2; i++) {
+    keyLen = sizeof(key);
+    ok &= netsnmp_generate_kul_from_passphrase(SHA, engineID,
+                                               sizeof(engineID),
+                                               (const u_char *) "maplesyrup",
+                                               10, key, &keyLen) ==
+        SNMPERR_SUCCESS &&
+        keyLen == sizeof(sha_kul) && memcmp(key, sha_kul, keyLen) == 0;
+}
+OKF(ok, ("Kul derived and found again"));
+
+keyLen = sizeof(key);
+OKF(generate_Ku(SHA, (const u_char *) "short", 5, key, &keyLen) !=
+    SNMPERR_SUCCESS, ("short passphrases are still refused"));
+
+/*
+ * Derive ahead of time, with and without threads
+ */
+for (i = 0; i < (int) NPASS; i++) {
+    refLen[i] = sizeof(ref[i]);
+    generate_Ku(SHA, (const u_char *) pass[i], strlen(pass[i]), ref[i],
+                &refLen[i]);
+}
+netsnmp_keycache_clear();
+for (i = 0; i < (int) NPASS; i++)
+    netsnmp_keycache_prefetch(NULL, NETSNMP_KEYCACHE_AUTHKEY, SHA, NULL, 0,
+                              (const u_char *) pass[i], strlen(pass[i]));
+netsnmp_keycache_prefetch(NULL, NETSNMP_KEYCACHE_AUTHKEY, SHA, NULL, 0,
+                          (const u_char *) "short", 5);
+OKF(netsnmp_keycache_prefetch_run(3) == 4, ("distinct passphrases derived"));
+for (i = 0; i < (int) NPASS; i++)
+    netsnmp_keycache_prefetch(NULL, NETSNMP_KEYCACHE_AUTHKEY, SHA, NULL, 0,
+                              (const u_char *) pass[i], strlen(pass[i]));
+OKF(netsnmp_keycache_prefetch_run(1) == 0, ("cached ones are skipped"));
+for (i = 0, ok = 1; i < (int) NPASS; i++) {
+    keyLen = sizeof(key);
+    ok &= generate_Ku(SHA, (const u_char *) pass[i], strlen(pass[i]), key,
+                      &keyLen) == SNMPERR_SUCCESS &&
+        keyLen == refLen[i] && memcmp(key, ref[i], keyLen) == 0;
+}
+OKF(ok, ("prefetched keys match"));
+
+/*
+ * Store the localized key of a user, and read it back
+ */
+OKF(mkdtemp(dir) != NULL, ("temporary directory %s", dir));
+set_persistent_directory(dir);
+keyLen = sizeof(key);
+netsnmp_generate_kul_from_passphrase(SHA, engineID, sizeof(engineID),
+                                     (const u_char *) "maplesyrup", 10,
+                                     key, &keyLen);
+netsnmp_keycache_save_kul("user", NETSNMP_KEYCACHE_AUTHKEY, SHA, engineID,
+                          sizeof(engineID), (const u_char *) "maplesyrup",
+                          10, key, keyLen);
+netsnmp_keycache_store("usmKeyCache", "T033");
+netsnmp_keycache_clear();
+
+snprintf(file, sizeof(file), "%s/T033.conf", dir);
+keys = 0;
+saved[0] = '\0';
+fp = fopen(file, "r");
+while (fp && fgets(line, sizeof(line), fp)) {
+    if (strncmp(line, "usmKeyCache ", 12) != 0)
+        continue;
+    /*
+     * besides the key, only a verifier that takes as many SHA-1 blocks
+     * as the key (a megabyte) is derived from the passphrase
+     */
+    OKF(strncmp(line + 12,
+                "\"user\" auth SHA 0x000000000000000000000002 8192 0x",
+                49) == 0, ("stored line %s", line + 12));
+    /*
+     * replace the key itself, to see where the answer comes from
+     */
+    keys++;
+    cp = strrchr(line, ' ');
+    strcpy(cp, " 0x0102030405060708090a0b0c0d0e0f1011121314");
+    strlcpy(saved, line + 12, sizeof(saved));
+}
+if (fp)
+    fclose(fp);
+OKF(keys == 1, ("stored %d key lines", keys));
+
+#define LOAD_SAVED() do {                                   \
+        strlcpy(line, saved, sizeof(line));                 \
+        netsnmp_keycache_parse("usmKeyCache", line);        \
+    } while (0)
+#define GET_SAVED(which, user, pass)                                    \
+    (keyLen = sizeof(key),                                              \
+     netsnmp_keycache_get_kul(user, which, SHA, engineID,               \
+                              sizeof(engineID), (const u_char *) pass,  \
+                              strlen(pass), key, &keyLen) ==            \
+     SNMPERR_SUCCESS)
+
+LOAD_SAVED();
+OKF(GET_SAVED(NETSNMP_KEYCACHE_AUTHKEY, "user", "maplesyrup") &&
+    keyLen == 20 && key[0] == 1 && key[19] == 0x14,
+    ("stored key is found with its passphrase"));
+OKF(!GET_SAVED(NETSNMP_KEYCACHE_PRIVKEY, "user", "maplesyrup") &&
+    !GET_SAVED(NETSNMP_KEYCACHE_AUTHKEY, "other", "maplesyrup"),
+    ("only for that user and key"));
+
+LOAD_SAVED();
+netsnmp_keycache_prefetch("user", NETSNMP_KEYCACHE_AUTHKEY, SHA, engineID,
+                          sizeof(engineID), (const u_char *) "maplesyrup",
+                          10);
+OKF(netsnmp_keycache_prefetch_run(1) == 0 &&
+    GET_SAVED(NETSNMP_KEYCACHE_AUTHKEY, "user", "maplesyrup") &&
+    key[0] == 1, ("users whose stored key matches are skipped"));
+
+/*
+ * The passphrase changes
+ */
+LOAD_SAVED();
+OKF(!GET_SAVED(NETSNMP_KEYCACHE_AUTHKEY, "user", "passphrase9"),
+    ("stored key is not used for another passphrase"));
+OKF(!GET_SAVED(NETSNMP_KEYCACHE_AUTHKEY, "user", "maplesyrup"),
+    ("... and is dropped"));
+
+LOAD_SAVED();
+netsnmp_keycache_prefetch("user", NETSNMP_KEYCACHE_AUTHKEY, SHA, engineID,
+                          sizeof(engineID), (const u_char *) "passphrase9",
+                          11);
+OKF(netsnmp_keycache_prefetch_run(1) == 1,
+    ("a changed passphrase is derived again"));
+refLen[0] = sizeof(ref[0]);
+netsnmp_generate_kul_from_passphrase(SHA, engineID, sizeof(engineID),
+                                     (const u_char *) "passphrase9", 11,
+                                     ref[0], &refLen[0]);
+OKF(GET_SAVED(NETSNMP_KEYCACHE_AUTHKEY, "user", "passphrase9") &&
+    keyLen == refLen[0] && memcmp(key, ref[0], keyLen) == 0,
+    ("... and its key saved instead"));
+OKF(!GET_SAVED(NETSNMP_KEYCACHE_AUTHKEY, "user", "maplesyrup"),
+    ("... for that passphrase only"));
+
+/*
+ * Verifiers that are cheaper than the key aren't accepted
+ */
+netsnmp_keycache_clear_saved();
+cp = strstr(saved, " 8192 ");
+OKF(cp != NULL, ("verifier rounds found"));
+if (cp)
+    memcpy(cp, " 0001 ", 6);
+LOAD_SAVED();
+OKF(!GET_SAVED(NETSNMP_KEYCACHE_AUTHKEY, "user", "maplesyrup"),
+    ("entries with too few verifier rounds are refused"));
+
+keyLen = sizeof(key);
+OKF(netsnmp_generate_kul_from_passphrase(SHA, engineID, sizeof(engineID),
+                                         (const u_char *) "maplesyrup", 10,
+                                         key, &keyLen) == SNMPERR_SUCCESS &&
+    keyLen == 20 && memcmp(key, sha_kul, keyLen) == 0,
+    ("passphrases are derived again"));
+
+netsnmp_keycache_clear();
+unlink(file);
+rmdir(dir);
@@ -0,0 +1,51 @@
+/* HEADER Testing the event loop backend */
+
+netsnmp_large_fd_set readfds;
+struct timeval  tv;
+int             fds[2], first = -1, i, count;
+
+netsnmp_large_fd_set_init(&readfds, FD_SETSIZE);
+
+/*
+ * Register, signal and close a pipe twice.  The second pipe gets the same
+ * descriptor numbers, and must still be reported.
+ */
+for (i = 0; i < 2; i++) {
+    if (pipe(fds) < 0)
+        break;
+    if (first < 0)
+        first = fds[0];
+    register_readfd(fds[0], NULL, NULL);
+
+    NETSNMP_LARGE_FD_ZERO(&readfds);
+    NETSNMP_LARGE_FD_SET(fds[0], &readfds);
+    tv.tv_sec = 0;
+    tv.tv_usec = 10000;
+    count = netsnmp_event_loop_wait2(fds[0] + 1, &readfds, NULL, NULL, &tv);
+    OKF(count == 0, ("%s pipe: idle (%d)", i ? "second" : "first", count));
+
+    if (write(fds[1], "x", 1) != 1)
+        break;
+    NETSNMP_LARGE_FD_ZERO(&readfds);
+    tv.tv_sec = 0;
+    tv.tv_usec = 10000;
+    count = netsnmp_event_loop_wait2(fds[0] + 1, &readfds, NULL, NULL, &tv);
+    OKF(count == 0, ("%s pipe: not asked for, not reported (%d)",
+                     i ? "second" : "first", count));
+
+    NETSNMP_LARGE_FD_SET(fds[0], &readfds);
+    tv.tv_sec = 1;
+    tv.tv_usec = 0;
+    count = netsnmp_event_loop_wait2(fds[0] + 1, &readfds, NULL, NULL, &tv);
+    OKF(count == 1 && NETSNMP_LARGE_FD_ISSET(fds[0], &readfds),
+        ("%s pipe (fd %d): readable (%d)", i ? "second" : "first", fds[0],
+         count));
+
+    unregister_readfd(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+}
+OKF(i == 2 && fds[0] == first, ("descriptor %d was reused", first));
+
+netsnmp_large_fd_set_cleanup(&readfds);
+netsnmp_event_loop_shutdown();
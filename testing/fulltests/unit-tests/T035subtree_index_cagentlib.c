@@ -0,0 +1,144 @@
+/* HEADER Testing subtree index lookups */
+
+static const char test_name[] = "subtree-index-test";
+static const char context[] = "index-test";
+static struct variable var[] = {
+    { 0, ASN_INTEGER, NETSNMP_OLDAPI_RONLY, NULL, 1, { 1 } },
+};
+static struct {
+    oid             name[6];
+    size_t          len;
+    int             priority, range_subid;
+    oid             range_ubound;
+    int             registered;
+} regs[120];
+netsnmp_handler_registration *reginfo;
+netsnmp_subtree *s, *c, *prev, *next, *ref_prev, *ref_find, *ref_next;
+oid             name[8];
+size_t          len;
+int             i, j, m, n, phase, res;
+int             lookups = 0, found = 0, mismatches = 0, registered = 0;
+int             unregistered = 0;
+
+init_snmp(test_name);
+
+/*
+ * Register, unregister and register again random subtrees, some of them
+ * overlapping, with several priorities or as ranges, some without
+ * variables (which find-next skips).  After every phase, lookups through
+ * the index must give the same answers as a walk along the list.
+ *
+ * The subtrees stay below the null registrations of .1 and .2 that every
+ * context starts with.  Ranges (rows .2.5.a.1 to .2.5.a.n) are kept apart
+ * from each other and from deeper registrations, and start at 1: the
+ * range code copies the first subtree for the other rows after it has
+ * been loaded, unregister_mib_context() takes the upper bound relative to
+ * the start, and a range rejected half way is not taken back cleanly.
+ */
+for (phase = 0; phase < 4; phase++) {
+    for (n = 0; n < 120; n++) {
+        if (phase == 1 || phase == 3) {
+            if (!regs[n].registered || (phase == 1 && TEST_RAND() % 2))
+                continue;
+            res = unregister_mib_context(regs[n].name, regs[n].len,
+                                         regs[n].priority,
+                                         regs[n].range_subid,
+                                         regs[n].range_ubound, context);
+            if (res == MIB_UNREGISTERED_OK)
+                unregistered++;
+            regs[n].registered = 0;
+            continue;
+        }
+        if (regs[n].registered || (phase == 2 && TEST_RAND() % 2))
+            continue;
+        regs[n].len = 1 + TEST_RAND() % 5;
+        regs[n].name[0] = 1 + TEST_RAND() % 2;
+        for (j = 1; j < (int)regs[n].len; j++)
+            regs[n].name[j] = 1 + TEST_RAND() % 4;
+        regs[n].priority = 127 + TEST_RAND() % 3;
+        regs[n].range_subid = regs[n].range_ubound = 0;
+        if (TEST_RAND() % 4 == 0) {
+            regs[n].len = 4;
+            regs[n].name[0] = 2;
+            regs[n].name[1] = 5;
+            regs[n].name[2] = 1 + TEST_RAND() % 6;
+            regs[n].name[3] = 1;
+            regs[n].priority = 126;
+            regs[n].range_subid = 4;
+            regs[n].range_ubound = 1 + TEST_RAND() % 3;
+            for (m = 0; m < 120; m++)
+                if (m != n && regs[m].registered && regs[m].range_subid &&
+                    regs[m].name[2] == regs[n].name[2])
+                    break;
+            if (m < 120)
+                continue;
+        }
+        reginfo = netsnmp_create_handler_registration("index-test", NULL,
+                                                      regs[n].name,
+                                                      regs[n].len,
+                                                      HANDLER_CAN_RONLY);
+        if (!reginfo)
+            break;
+        reginfo->contextName = strdup(context);
+        reginfo->priority = regs[n].priority;
+        reginfo->range_subid = regs[n].range_subid;
+        reginfo->range_ubound = regs[n].range_ubound;
+        i = TEST_RAND() % 3;
+        res = netsnmp_register_mib("index-test", i ? var : NULL,
+                                   sizeof(var[0]), i ? 1 : 0,
+                                   regs[n].name, regs[n].len,
+                                   regs[n].priority, regs[n].range_subid,
+                                   regs[n].range_ubound, NULL, context, -1,
+                                   0, reginfo, 0);
+        if (res == MIB_REGISTERED_OK) {
+            regs[n].registered = 1;
+            registered++;
+        }
+    }
+
+    for (i = 0; i < 3000; i++) {
+        len = TEST_RAND() % 8;
+        for (j = 0; j < (int)len; j++)
+            name[j] = TEST_RAND() % 6;
+
+        ref_prev = NULL;
+        for (s = netsnmp_subtree_find_first(context); s; s = s->next) {
+            if (snmp_oid_compare(name, len, s->start_a, s->start_len) < 0)
+                break;
+            ref_prev = s;
+        }
+        ref_find = ref_prev && ref_prev->end_a &&
+            snmp_oid_compare(name, len, ref_prev->end_a,
+                             ref_prev->end_len) < 0 ? ref_prev : NULL;
+        ref_next = ref_prev ? ref_prev->next : NULL;
+        while (ref_next && (ref_next->variables == NULL ||
+                            ref_next->variables_len == 0))
+            ref_next = ref_next->next;
+
+        prev = netsnmp_subtree_find_prev(name, len, NULL, context);
+        s = netsnmp_subtree_find(name, len, NULL, context);
+        next = netsnmp_subtree_find_next(name, len, NULL, context);
+        lookups++;
+        if (s)
+            found++;
+        if (prev != ref_prev || s != ref_find || next != ref_next)
+            mismatches++;
+    }
+    OKF(mismatches == 0, ("phase %d: index and list lookups agree (%d of %d"
+                          " lookups differ, %d found a subtree)", phase,
+                          mismatches, lookups, found));
+    if (phase < 3)
+        OKF(found > 0 && found < lookups,
+            ("phase %d: lookups both hit and missed a subtree", phase));
+    lookups = found = mismatches = 0;
+}
+OKF(registered > 60 && unregistered > 30,
+    ("registered %d and unregistered %d subtrees", registered,
+     unregistered));
+for (n = 0, s = netsnmp_subtree_find_first(context); s; s = s->next)
+    for (c = s; c; c = c->children)
+        if (c->label_a && strcmp(c->label_a, "index-test") == 0)
+            n++;
+OKF(n == 0, ("%d subtrees left after unregistering all of them", n));
+
+snmp_shutdown(test_name);
@@ -8,3 +8,4 @@
 #include "mibgroup/agentx/client.h"
 #include "mibgroup/agentx/master_admin.h"
 #include "mibgroup/agentx/agentx_config.h"
+#include "mibgroup/agentx/master_stats.h"
@@ -2,4 +2,5 @@
   if (should_init("usmConf")) init_usmConf();
   if (should_init("iquery")) init_iquery();
   if (should_init("vacm_conf")) init_vacm_conf();
+  if (should_init("master_stats")) init_master_stats();
 
@@ -109,6 +109,10 @@ SOURCE=..\..\agent\agent_trap.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\agent\agent_workers.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\agent\helpers\all_helpers.c
 # End Source File
 # Begin Source File
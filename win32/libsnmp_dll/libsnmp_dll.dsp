@@ -116,6 +116,10 @@ SOURCE=..\..\snmplib\container_binary_array.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\snmplib\container_hash.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\snmplib\container_iterator.c
 # End Source File
 # Begin Source File
@@ -128,6 +132,10 @@ SOURCE=..\..\snmplib\container_null.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\snmplib\container_skiplist.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\snmplib\data_list.c
 # End Source File
 # Begin Source File
@@ -164,6 +164,7 @@
 #include "mibgroup/agentx/client.h"
 #include "mibgroup/agentx/master_admin.h"
 #include "mibgroup/agentx/agentx_config.h"
+#include "mibgroup/agentx/master_stats.h"
 #endif
 
 #ifdef USING_EXAMPLES_EXAMPLE_MODULE
@@ -22,6 +22,9 @@
 /* Define if compiling with the agentx/agentx_config module files.  */
 #define USING_AGENTX_AGENTX_CONFIG_MODULE 1
  
+/* Define if compiling with the agentx/master_stats module files.  */
+#define USING_AGENTX_MASTER_STATS_MODULE 1
+ 
 #endif /* USING_AGENTX_MODULE */
  
 /* Define if compiling with the mibII/vacm_conf module files.  */
@@ -1410,6 +1410,9 @@
 /* Define to 1 if you have the `EVP_MD_CTX_destroy' function. */
 #define HAVE_EVP_MD_CTX_DESTROY 1
 
+/* Define to 1 if you have the `HMAC_CTX_new' function. */
+#define HAVE_HMAC_CTX_NEW 1
+
 /* Define if you have EVP_sha224/256 in openssl */
 #define HAVE_EVP_SHA224 /**/
 
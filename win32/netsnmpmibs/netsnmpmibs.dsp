@@ -381,6 +381,10 @@ SOURCE=..\..\agent\mibgroup\agentx\master_admin.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\agent\mibgroup\agentx\master_stats.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\agent\mibgroup\agentx\protocol.c
 # End Source File
 # Begin Source File